@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+
+// An I/O ring is a pair of queues shared between a process and the kernel. Userspace appends
+// IORingSubmissions to the submission queue and tells the kernel about them with io_ring_enter(),
+// and the kernel appends an IORingCompletion to the completion queue for each of them once it's done.
+//
+// Both queues live in a single mapping that is created by mmap()ing the ring's file descriptor at
+// offset 0 with the size the kernel reported in IORingParams::mapping_size. It starts with an
+// IORingHeader describing where the entries of each queue are located.
+//
+// Heads and tails are free-running counters that are masked to get an index into the entries.
+// The submission tail and the completion head are advanced by userspace, the submission head and
+// the completion tail by the kernel. They should be accessed with acquire/release semantics.
+
+enum class IORingOpcode : u8 {
+    Nop = 0,
+    // Read `length` bytes into the buffer at `address`.
+    Read,
+    // Write `length` bytes from the buffer at `address`.
+    Write,
+    // Flush the file to its backing storage.
+    Fsync,
+    // Accept a connection on a listening socket. The result is the new fd.
+    // If `address` is non-null, up to `length` bytes of the peer address are stored there.
+    // `operation_flags` may contain SOCK_NONBLOCK and SOCK_CLOEXEC.
+    Accept,
+    // Complete with ETIMEDOUT once the relative struct timespec at `address` has elapsed.
+    Timeout,
+};
+
+struct IORingSubmission {
+    IORingOpcode opcode;
+    u8 reserved0;
+    u16 reserved1;
+    i32 fd;
+    // Used by Read and Write. A negative offset means the file's current offset is used and advanced.
+    i64 offset;
+    u64 address;
+    u32 length;
+    u32 operation_flags;
+    // Passed back unmodified in the IORingCompletion.
+    u64 user_data;
+};
+
+struct IORingCompletion {
+    u64 user_data;
+    // The result of the operation if it succeeded, or a negated errno value otherwise.
+    i32 result;
+    u32 flags;
+};
+
+struct IORingHeader {
+    u32 submission_head;
+    u32 submission_tail;
+    u32 submission_mask;
+    u32 submission_entries_offset;
+    u32 completion_head;
+    u32 completion_tail;
+    u32 completion_mask;
+    u32 completion_entries_offset;
+};
+
+#define IO_RING_CLOEXEC (1 << 0)
+
+// Upper limit for IORingParams::submission_entries.
+#define IO_RING_MAX_ENTRIES 4096
+
+struct IORingParams {
+    // In: The requested number of submission entries. Rounded up to a power of two.
+    u32 submission_entries;
+    // Out: The number of completion entries, which is twice the number of submission entries.
+    u32 completion_entries;
+    // In: IO_RING_CLOEXEC.
+    u32 flags;
+    // Out: The size of the mapping that holds both queues.
+    u32 mapping_size;
+};
@@ -24,6 +24,17 @@ extern "C" {
 
 #define FD_CLOEXEC 1
 
+#define POSIX_FADV_DONTNEED 1
+#define POSIX_FADV_NOREUSE 2
+#define POSIX_FADV_NORMAL 3
+#define POSIX_FADV_RANDOM 4
+#define POSIX_FADV_SEQUENTIAL 5
+#define POSIX_FADV_WILLNEED 6
+
+#define SPLICE_F_MOVE (1 << 0)
+#define SPLICE_F_NONBLOCK (1 << 1)
+#define SPLICE_F_MORE (1 << 2)
+
 #define O_RDONLY (1 << 0)
 #define O_WRONLY (1 << 1)
 #define O_RDWR (O_RDONLY | O_WRONLY)
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TCP_NODELAY 10
+#define TCP_MAXSEG 11
+#define TCP_CONGESTION 13
+
+// The maximum length of a congestion control algorithm name for TCP_CONGESTION, including the null terminator.
+#define TCP_CA_NAME_MAX 16
+
+#ifdef __cplusplus
+}
+#endif
@@ -33,6 +33,8 @@ enum {
     PERF_EVENT_SYSCALL = 16384,
     PERF_EVENT_SIGNPOST = 32768,
     PERF_EVENT_READ = 65536,
+    PERF_EVENT_LOCK_CONTENTION = 131072,
+    PERF_EVENT_OFF_CPU = 262144,
 };
 
 #define PERF_EVENT_MASK_ALL (~0ull)
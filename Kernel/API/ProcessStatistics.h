@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+
+// /sys/kernel/process_statistics holds the same information as /sys/kernel/processes, in a binary
+// format that is much cheaper to generate and to parse.
+//
+// A snapshot starts with a ProcessStatisticsHeader, followed by `process_count` process records.
+// Each process record is a ProcessStatisticsRecord, its strings, and then `thread_count` thread
+// records. Each thread record is a ThreadStatisticsRecord followed by its strings. Strings are not
+// null-terminated, their lengths are given in the record, and they appear in the order in which
+// their lengths are declared. Every record (including its strings) is padded to a multiple of
+// PROCESS_STATISTICS_ALIGNMENT bytes. Readers must use the record sizes from the header rather than
+// sizeof(), so that fields can be added at the end of the records without breaking them.
+//
+// The first snapshot read from an open file is complete. Every later one only contains full records
+// for the processes that may have changed since the previous snapshot read from the same file, the
+// others are marked with PROCESS_STATISTICS_UNCHANGED and only have a valid pid. Processes that are
+// missing from a snapshot are gone.
+
+#define PROCESS_STATISTICS_VERSION 1
+#define PROCESS_STATISTICS_ALIGNMENT 8
+
+// The record only has a valid pid, everything else is as in the previous snapshot.
+#define PROCESS_STATISTICS_UNCHANGED (1 << 0)
+#define PROCESS_STATISTICS_KERNEL (1 << 1)
+#define PROCESS_STATISTICS_DUMPABLE (1 << 2)
+
+struct ProcessStatisticsHeader {
+    u32 version;
+    u32 header_size;
+    u32 process_record_size;
+    u32 thread_record_size;
+    // Pass this back as `since_generation` to learn what changed since this snapshot.
+    u64 generation;
+    // The generation of the snapshot this one is relative to, or 0 if it is complete.
+    u64 since_generation;
+    u64 total_time_scheduled;
+    u64 total_time_scheduled_kernel;
+    u32 process_count;
+    u32 reserved;
+};
+
+struct ProcessStatisticsRecord {
+    u32 flags;
+    i32 pid;
+    i32 pgid;
+    i32 pgp;
+    i32 sid;
+    u32 uid;
+    u32 gid;
+    i32 ppid;
+    u32 nfds;
+    u32 thread_count;
+    u64 amount_virtual;
+    u64 amount_resident;
+    u64 amount_shared;
+    u64 amount_dirty_private;
+    u64 amount_clean_inode;
+    u64 amount_purgeable_volatile;
+    u64 amount_purgeable_nonvolatile;
+    u16 name_length;
+    u16 executable_length;
+    u16 tty_length;
+    u16 pledge_length;
+    u16 veil_length;
+    u16 reserved[3];
+    u64 amount_large_page_backed;
+};
+
+struct ThreadStatisticsRecord {
+    i32 tid;
+    u32 times_scheduled;
+    u64 time_user;
+    u64 time_kernel;
+    u32 cpu;
+    u32 priority;
+    u32 syscall_count;
+    u32 inode_faults;
+    u32 zero_faults;
+    u32 cow_faults;
+    u64 unix_socket_read_bytes;
+    u64 unix_socket_write_bytes;
+    u64 ipv4_socket_read_bytes;
+    u64 ipv4_socket_write_bytes;
+    u64 file_read_bytes;
+    u64 file_write_bytes;
+    u16 name_length;
+    u16 state_length;
+    u32 reserved;
+};
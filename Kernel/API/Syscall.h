@@ -15,6 +15,8 @@
 constexpr int syscall_vector = 0x82;
 
 extern "C" {
+struct epoll_event;
+struct IORingParams;
 struct pollfd;
 struct timeval;
 struct timespec;
@@ -67,6 +69,9 @@ enum class NeedsBigProcessLock {
     S(dump_backtrace, NeedsBigProcessLock::No)              \
     S(dup2, NeedsBigProcessLock::No)                        \
     S(emuctl, NeedsBigProcessLock::No)                      \
+    S(epoll_create, NeedsBigProcessLock::No)                \
+    S(epoll_ctl, NeedsBigProcessLock::No)                   \
+    S(epoll_wait, NeedsBigProcessLock::No)                  \
     S(execve, NeedsBigProcessLock::Yes)                     \
     S(exit, NeedsBigProcessLock::Yes)                       \
     S(exit_thread, NeedsBigProcessLock::Yes)                \
@@ -109,6 +114,8 @@ enum class NeedsBigProcessLock {
     S(getuid, NeedsBigProcessLock::No)                      \
     S(inode_watcher_add_watch, NeedsBigProcessLock::Yes)    \
     S(inode_watcher_remove_watch, NeedsBigProcessLock::Yes) \
+    S(io_ring_create, NeedsBigProcessLock::No)              \
+    S(io_ring_enter, NeedsBigProcessLock::Yes)              \
     S(ioctl, NeedsBigProcessLock::Yes)                      \
     S(join_thread, NeedsBigProcessLock::Yes)                \
     S(jail_create, NeedsBigProcessLock::No)                 \
@@ -135,6 +142,7 @@ enum class NeedsBigProcessLock {
     S(pipe, NeedsBigProcessLock::No)                        \
     S(pledge, NeedsBigProcessLock::No)                      \
     S(poll, NeedsBigProcessLock::Yes)                       \
+    S(posix_fadvise, NeedsBigProcessLock::No)               \
     S(posix_fallocate, NeedsBigProcessLock::No)             \
     S(prctl, NeedsBigProcessLock::Yes)                      \
     S(profiling_disable, NeedsBigProcessLock::Yes)          \
@@ -154,6 +162,7 @@ enum class NeedsBigProcessLock {
     S(scheduler_get_parameters, NeedsBigProcessLock::No)    \
     S(scheduler_set_parameters, NeedsBigProcessLock::No)    \
     S(sendfd, NeedsBigProcessLock::No)                      \
+    S(sendfile, NeedsBigProcessLock::Yes)                   \
     S(sendmsg, NeedsBigProcessLock::Yes)                    \
     S(set_coredump_metadata, NeedsBigProcessLock::No)       \
     S(set_mmap_name, NeedsBigProcessLock::Yes)              \
@@ -183,6 +192,7 @@ enum class NeedsBigProcessLock {
     S(sigtimedwait, NeedsBigProcessLock::Yes)               \
     S(socket, NeedsBigProcessLock::No)                      \
     S(socketpair, NeedsBigProcessLock::No)                  \
+    S(splice, NeedsBigProcessLock::Yes)                     \
     S(stat, NeedsBigProcessLock::No)                        \
     S(statvfs, NeedsBigProcessLock::No)                     \
     S(symlink, NeedsBigProcessLock::No)                     \
@@ -196,6 +206,7 @@ enum class NeedsBigProcessLock {
     S(unveil, NeedsBigProcessLock::No)                      \
     S(utime, NeedsBigProcessLock::No)                       \
     S(utimensat, NeedsBigProcessLock::No)                   \
+    S(vfork, NeedsBigProcessLock::Yes)                      \
     S(waitid, NeedsBigProcessLock::Yes)                     \
     S(write, NeedsBigProcessLock::Yes)                      \
     S(pwritev, NeedsBigProcessLock::Yes)                    \
@@ -262,6 +273,14 @@ struct SC_poll_params {
     u32 const* sigmask;
 };
 
+struct SC_epoll_wait_params {
+    int epfd;
+    struct epoll_event* events;
+    int maxevents;
+    const struct timespec* timeout;
+    u32 const* sigmask;
+};
+
 struct SC_clock_nanosleep_params {
     int clock_id;
     int flags;
@@ -289,6 +308,15 @@ struct SC_getsockopt_params {
     socklen_t* value_size;
 };
 
+struct SC_splice_params {
+    int fd_in;
+    off_t* off_in;
+    int fd_out;
+    off_t* off_out;
+    size_t length;
+    unsigned flags;
+};
+
 struct SC_setsockopt_params {
     void const* value;
     int sockfd;
@@ -525,7 +553,8 @@ void initialize();
 int sync();
 
 #    if ARCH(X86_64) || ARCH(AARCH64)
-inline uintptr_t invoke(Function function)
+// NOTE: This has to be inlined for posix_spawn(), whose vfork() child must not return from the function that made the syscall.
+ALWAYS_INLINE uintptr_t invoke(Function function)
 {
     uintptr_t result;
 #        if ARCH(X86_64)
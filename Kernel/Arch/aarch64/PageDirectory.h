@@ -72,7 +72,8 @@ public:
     bool is_user_allowed() const { TODO_AARCH64(); }
     void set_user_allowed(bool) { }
 
-    bool is_huge() const { TODO_AARCH64(); }
+    // NOTE: We don't create block descriptors (yet), so nothing is ever huge.
+    bool is_huge() const { return false; }
     void set_huge(bool) { }
 
     bool is_writable() const { TODO_AARCH64(); }
@@ -174,6 +174,9 @@ protected:
     }
 
     void supply_chain_and_notify(u16 queue_index, QueueChain& chain);
+    // Supplying a batch of chains with these only notifies the device once, instead of once for each chain.
+    void supply_chain(u16 queue_index, QueueChain& chain);
+    void notify_queue_if_needed(u16 queue_index);
 
     virtual bool handle_device_config_change() = 0;
     virtual void handle_queue_update(u16 queue_index) = 0;
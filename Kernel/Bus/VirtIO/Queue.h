@@ -33,6 +33,7 @@ public:
     ~Queue();
 
     u16 notify_offset() const { return m_notify_offset; }
+    u16 size() const { return m_queue_size; }
 
     void enable_interrupts();
     void disable_interrupts();
@@ -203,10 +203,32 @@ UNMAP_AFTER_INIT StringView CommandLine::root_device() const
 }
 
 bool CommandLine::is_nvme_polling_enabled() const
+{
+    // Note: A bare "nvme_poll" polls every namespace, "nvme_poll=1,2" only the listed namespace IDs.
+    auto value = lookup("nvme_poll"sv);
+    return value.has_value() && value->is_empty();
+}
+
+bool CommandLine::is_nvme_polling_enabled_for_any_namespace() const
 {
     return contains("nvme_poll"sv);
 }
 
+bool CommandLine::is_nvme_polling_enabled_for_namespace(u32 nsid) const
+{
+    auto value = lookup("nvme_poll"sv);
+    if (!value.has_value())
+        return false;
+    if (value->is_empty())
+        return true;
+    bool found = false;
+    value->for_each_split_view(',', SplitBehavior::Nothing, [&](auto part) {
+        if (part.template to_uint<u32>() == nsid)
+            found = true;
+    });
+    return found;
+}
+
 UNMAP_AFTER_INIT AcpiFeatureLevel CommandLine::acpi_feature_level() const
 {
     auto value = kernel_command_line().lookup("acpi"sv).value_or("limited"sv);
@@ -100,6 +100,8 @@ public:
     [[nodiscard]] NonnullOwnPtrVector<KString> userspace_init_args() const;
     [[nodiscard]] StringView root_device() const;
     [[nodiscard]] bool is_nvme_polling_enabled() const;
+    [[nodiscard]] bool is_nvme_polling_enabled_for_any_namespace() const;
+    [[nodiscard]] bool is_nvme_polling_enabled_for_namespace(u32 nsid) const;
     [[nodiscard]] size_t switch_to_tty() const;
 
 private:
@@ -57,7 +57,7 @@ auto AsyncDeviceRequest::wait(Time* timeout) -> RequestWaitResult
     auto request_result = get_request_result();
     if (is_completed_result(request_result))
         return { request_result, Thread::BlockResult::NotBlocked };
-    auto wait_result = m_queue.wait_on(Thread::BlockTimeout(false, timeout), name());
+    auto wait_result = m_queue.wait_on(Thread::BlockTimeout(false, timeout), name(), Thread::WaitQueueBlocker::IsWaitingForIO::Yes);
     return { get_request_result(), wait_result };
 }
 
@@ -61,6 +61,7 @@ public:
     void add_sub_request(NonnullLockRefPtr<AsyncDeviceRequest>);
 
     [[nodiscard]] RequestWaitResult wait(Time* = nullptr);
+    [[nodiscard]] bool is_completed() const { return is_completed_result(get_request_result()); }
 
     void do_start(SpinlockLocker<Spinlock<LockRank::None>>&& requests_lock)
     {
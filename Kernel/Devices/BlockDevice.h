@@ -22,6 +22,9 @@ public:
     u8 block_size_log() const { return m_block_size_log; }
     virtual bool is_seekable() const override { return true; }
 
+    // The largest number of blocks a single AsyncBlockDeviceRequest to this device may transfer.
+    virtual size_t max_blocks_per_request() const { return max<size_t>(1, PAGE_SIZE >> m_block_size_log); }
+
     bool read_block(u64 index, UserOrKernelBuffer&);
     bool write_block(u64 index, UserOrKernelBuffer const&);
 
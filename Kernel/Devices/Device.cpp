@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/Find.h>
 #include <AK/Singleton.h>
 #include <Kernel/Devices/Device.h>
 #include <Kernel/Devices/DeviceManagement.h>
@@ -72,12 +73,19 @@ ErrorOr<NonnullLockRefPtr<OpenFileDescription>> Device::open(int options)
 void Device::process_next_queued_request(Badge<AsyncDeviceRequest>, AsyncDeviceRequest const& completed_request)
 {
     SpinlockLocker lock(m_requests_lock);
-    VERIFY(!m_requests.is_empty());
-    VERIFY(m_requests.first().ptr() == &completed_request);
-    m_requests.remove(m_requests.begin());
-    if (!m_requests.is_empty()) {
-        auto* next_request = m_requests.first().ptr();
-        next_request->do_start(move(lock));
+    VERIFY(m_requests_in_flight > 0);
+    // Note: Devices that work on multiple requests at once may complete them in any order.
+    auto completed = AK::find_if(m_requests.begin(), m_requests.end(), [&](auto& request) { return request.ptr() == &completed_request; });
+    VERIFY(completed != m_requests.end());
+    m_requests.remove(completed);
+    m_requests_in_flight--;
+
+    auto next_request = m_requests.begin();
+    for (size_t index = 0; index < m_requests_in_flight && next_request != m_requests.end(); index++)
+        ++next_request;
+    if (next_request != m_requests.end()) {
+        m_requests_in_flight++;
+        (*next_request)->do_start(move(lock));
     }
 
     evaluate_block_conditions();
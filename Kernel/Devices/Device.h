@@ -54,15 +54,22 @@ public:
     virtual bool is_openable_by_jailed_processes() const { return false; }
     void process_next_queued_request(Badge<AsyncDeviceRequest>, AsyncDeviceRequest const&);
 
+    // How many requests the device can work on at the same time. Any further requests
+    // wait in the queue until one of the started requests is completed.
+    virtual size_t max_requests_in_flight() const { return 1; }
+
     template<typename AsyncRequestType, typename... Args>
     ErrorOr<NonnullLockRefPtr<AsyncRequestType>> try_make_request(Args&&... args)
     {
         auto request = TRY(adopt_nonnull_lock_ref_or_enomem(new (nothrow) AsyncRequestType(*this, forward<Args>(args)...)));
         SpinlockLocker lock(m_requests_lock);
-        bool was_empty = m_requests.is_empty();
         TRY(m_requests.try_append(request));
-        if (was_empty)
+        // Note: Requests are started in the order they were queued, so if there is room for
+        // another request, nothing else can be waiting in the queue.
+        if (m_requests_in_flight < max_requests_in_flight()) {
+            m_requests_in_flight++;
             request->do_start(move(lock));
+        }
         return request;
     }
 
@@ -91,7 +98,9 @@ private:
     State m_state { State::Normal };
 
     Spinlock<LockRank::None> m_requests_lock {};
+    // The first m_requests_in_flight requests have been started, the rest are waiting.
     DoublyLinkedList<LockRefPtr<AsyncDeviceRequest>> m_requests;
+    size_t m_requests_in_flight { 0 };
 
 protected:
     // FIXME: This pointer will be eventually removed after all nodes in /sys/dev/block/ and
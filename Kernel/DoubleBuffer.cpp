@@ -4,30 +4,58 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/Atomic.h>
 #include <AK/StringView.h>
 #include <Kernel/DoubleBuffer.h>
 #include <Kernel/InterruptDisabler.h>
 
 namespace Kernel {
 
+static constexpr size_t maximum_bytes_in_pages_of_all_buffers = 64 * MiB;
+static Atomic<size_t> s_bytes_in_pages_of_all_buffers;
+
+bool DoubleBuffer::try_reserve_bytes_in_pages(size_t size)
+{
+    auto reserved = s_bytes_in_pages_of_all_buffers.load(AK::MemoryOrder::memory_order_relaxed);
+    do {
+        if (size > maximum_bytes_in_pages_of_all_buffers - reserved)
+            return false;
+    } while (!s_bytes_in_pages_of_all_buffers.compare_exchange_strong(reserved, reserved + size, AK::MemoryOrder::memory_order_relaxed));
+    return true;
+}
+
+void DoubleBuffer::unreserve_bytes_in_pages(size_t size)
+{
+    auto previously_reserved = s_bytes_in_pages_of_all_buffers.fetch_sub(size, AK::MemoryOrder::memory_order_relaxed);
+    VERIFY(previously_reserved >= size);
+}
+
 inline void DoubleBuffer::compute_lockfree_metadata()
 {
     InterruptDisabler disabler;
-    m_empty = m_read_buffer_index >= m_read_buffer->size && m_write_buffer->size == 0;
+    m_empty = m_read_buffer_index >= m_read_buffer->size && m_write_buffer->size == 0 && m_unread_bytes_in_pages == 0;
     m_space_for_writing = m_capacity - m_write_buffer->size;
 }
 
 ErrorOr<NonnullOwnPtr<DoubleBuffer>> DoubleBuffer::try_create(StringView name, size_t capacity)
 {
-    auto storage = TRY(KBuffer::try_create_with_size(name, capacity * 2, Memory::Region::Access::ReadWrite));
-    return adopt_nonnull_own_or_enomem(new (nothrow) DoubleBuffer(capacity, move(storage)));
+    return try_create_growable(name, capacity, capacity);
 }
 
-DoubleBuffer::DoubleBuffer(size_t capacity, NonnullOwnPtr<KBuffer> storage)
+ErrorOr<NonnullOwnPtr<DoubleBuffer>> DoubleBuffer::try_create_growable(StringView name, size_t initial_capacity, size_t maximum_capacity)
+{
+    VERIFY(initial_capacity <= maximum_capacity);
+    auto storage = TRY(KBuffer::try_create_with_size(name, initial_capacity * 2, Memory::Region::Access::ReadWrite));
+    return adopt_nonnull_own_or_enomem(new (nothrow) DoubleBuffer(name, initial_capacity, maximum_capacity, move(storage)));
+}
+
+DoubleBuffer::DoubleBuffer(StringView name, size_t capacity, size_t maximum_capacity, NonnullOwnPtr<KBuffer> storage)
     : m_write_buffer(&m_buffer1)
     , m_read_buffer(&m_buffer2)
+    , m_name(name)
     , m_storage(move(storage))
     , m_capacity(capacity)
+    , m_maximum_capacity(maximum_capacity)
 {
     m_buffer1.data = m_storage->data();
     m_buffer1.size = 0;
@@ -36,6 +64,12 @@ DoubleBuffer::DoubleBuffer(size_t capacity, NonnullOwnPtr<KBuffer> storage)
     m_space_for_writing = capacity;
 }
 
+DoubleBuffer::~DoubleBuffer()
+{
+    for (auto& pages : m_pages)
+        unreserve_bytes_in_pages(pages.region->size());
+}
+
 void DoubleBuffer::flip()
 {
     VERIFY(m_read_buffer_index == m_read_buffer->size);
@@ -45,33 +79,106 @@ void DoubleBuffer::flip()
     compute_lockfree_metadata();
 }
 
+ErrorOr<void> DoubleBuffer::try_grow(size_t minimum_capacity)
+{
+    size_t new_capacity = m_capacity;
+    while (new_capacity < minimum_capacity && new_capacity < m_maximum_capacity)
+        new_capacity *= 2;
+    new_capacity = min(new_capacity, m_maximum_capacity);
+    if (new_capacity <= m_capacity)
+        return {};
+
+    auto storage = TRY(KBuffer::try_create_with_size(m_name, new_capacity * 2, Memory::Region::Access::ReadWrite));
+
+    // What's left to read ends up in the first half, and what was written since the last flip in the second one.
+    size_t unread_size = m_read_buffer->size - m_read_buffer_index;
+    memcpy(storage->data(), m_read_buffer->data + m_read_buffer_index, unread_size);
+    memcpy(storage->data() + new_capacity, m_write_buffer->data, m_write_buffer->size);
+
+    m_buffer1 = { storage->data(), unread_size };
+    m_buffer2 = { storage->data() + new_capacity, m_write_buffer->size };
+    m_read_buffer = &m_buffer1;
+    m_write_buffer = &m_buffer2;
+    m_read_buffer_index = 0;
+    m_storage = move(storage);
+    m_capacity = new_capacity;
+    compute_lockfree_metadata();
+    return {};
+}
+
 ErrorOr<size_t> DoubleBuffer::write(UserOrKernelBuffer const& data, size_t size)
 {
     if (!size)
         return 0;
     MutexLocker locker(m_lock);
+    if (size > m_space_for_writing && m_capacity < m_maximum_capacity) {
+        // Not being able to grow isn't an error, the write just ends up being shorter.
+        (void)try_grow(m_write_buffer->size + size);
+    }
     size_t bytes_to_write = min(size, m_space_for_writing);
     u8* write_ptr = m_write_buffer->data + m_write_buffer->size;
     TRY(data.read(write_ptr, bytes_to_write));
     m_write_buffer->size += bytes_to_write;
+    m_bytes_written_to_buffers += bytes_to_write;
     compute_lockfree_metadata();
     if (m_unblock_callback && !m_empty)
         m_unblock_callback();
     return bytes_to_write;
 }
 
+ErrorOr<void> DoubleBuffer::append_pages(NonnullOwnPtr<Memory::Region> region)
+{
+    MutexLocker locker(m_lock);
+    size_t size = region->size();
+    if (auto result = m_pages.try_append({ move(region), m_bytes_written_to_buffers, 0 }); result.is_error()) {
+        unreserve_bytes_in_pages(size);
+        return result.release_error();
+    }
+    m_unread_bytes_in_pages += size;
+    compute_lockfree_metadata();
+    if (m_unblock_callback)
+        m_unblock_callback();
+    return {};
+}
+
+ErrorOr<size_t> DoubleBuffer::read_pages_impl(UserOrKernelBuffer& data, size_t size, bool advance_buffer_index)
+{
+    auto& pages = m_pages.first();
+    size_t nread = min(pages.region->size() - pages.read_offset, size);
+    TRY(data.write(pages.region->vaddr().offset(pages.read_offset).as_ptr(), nread));
+    if (advance_buffer_index) {
+        pages.read_offset += nread;
+        m_unread_bytes_in_pages -= nread;
+        if (pages.read_offset == pages.region->size())
+            unreserve_bytes_in_pages(m_pages.take_first().region->size());
+    }
+    compute_lockfree_metadata();
+    if (m_unblock_callback)
+        m_unblock_callback();
+    return nread;
+}
+
 ErrorOr<size_t> DoubleBuffer::read_impl(UserOrKernelBuffer& data, size_t size, MutexLocker&, bool advance_buffer_index)
 {
     if (size == 0)
         return 0;
+    if (!m_pages.is_empty()) {
+        // Don't read past the point where the queued pages come in.
+        auto buffered_bytes_before_pages = m_pages.first().buffered_bytes_before;
+        if (m_bytes_read_from_buffers == buffered_bytes_before_pages)
+            return read_pages_impl(data, size, advance_buffer_index);
+        size = min(size, buffered_bytes_before_pages - m_bytes_read_from_buffers);
+    }
     if (m_read_buffer_index >= m_read_buffer->size && m_write_buffer->size != 0)
         flip();
     if (m_read_buffer_index >= m_read_buffer->size)
         return 0;
     size_t nread = min(m_read_buffer->size - m_read_buffer_index, size);
     TRY(data.write(m_read_buffer->data + m_read_buffer_index, nread));
-    if (advance_buffer_index)
+    if (advance_buffer_index) {
         m_read_buffer_index += nread;
+        m_bytes_read_from_buffers += nread;
+    }
     compute_lockfree_metadata();
     if (m_unblock_callback && m_space_for_writing > 0)
         m_unblock_callback();
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <AK/Types.h>
+#include <AK/Vector.h>
 #include <Kernel/KBuffer.h>
 #include <Kernel/Locking/Mutex.h>
 #include <Kernel/Thread.h>
@@ -17,6 +18,10 @@ namespace Kernel {
 class DoubleBuffer {
 public:
     static ErrorOr<NonnullOwnPtr<DoubleBuffer>> try_create(StringView name, size_t capacity = 65536);
+    // Starts out with room for `initial_capacity` bytes, and grows when a write doesn't fit, up to `maximum_capacity`.
+    static ErrorOr<NonnullOwnPtr<DoubleBuffer>> try_create_growable(StringView name, size_t initial_capacity, size_t maximum_capacity);
+    ~DoubleBuffer();
+
     ErrorOr<size_t> write(UserOrKernelBuffer const&, size_t);
     ErrorOr<size_t> write(u8 const* data, size_t size)
     {
@@ -35,12 +40,28 @@ public:
         return peek(buffer, size);
     }
 
+    // The regions queued by all buffers together take up kernel address space, so they are limited as a whole.
+    // Room for a region has to be reserved before creating it, and append_pages() takes over that reservation.
+    static bool try_reserve_bytes_in_pages(size_t);
+    static void unreserve_bytes_in_pages(size_t);
+
+    // Queues the contents of a kernel region after everything written so far, without copying it.
+    // The region should map pages that nobody is going to write to anymore, like a copy-on-write snapshot.
+    // Its size must have been reserved with try_reserve_bytes_in_pages(), even if this fails.
+    ErrorOr<void> append_pages(NonnullOwnPtr<Memory::Region>);
+
     bool is_empty() const { return m_empty; }
 
+    size_t capacity() const { return m_capacity; }
+    size_t maximum_capacity() const { return m_maximum_capacity; }
+
     size_t space_for_writing() const { return m_space_for_writing; }
+    size_t space_for_pages() const { return m_maximum_bytes_in_pages - min(m_unread_bytes_in_pages, m_maximum_bytes_in_pages); }
+    void set_maximum_bytes_in_pages(size_t maximum) { m_maximum_bytes_in_pages = maximum; }
+
     size_t immediately_readable() const
     {
-        return (m_read_buffer->size - m_read_buffer_index) + m_write_buffer->size;
+        return (m_read_buffer->size - m_read_buffer_index) + m_write_buffer->size + m_unread_bytes_in_pages;
     }
 
     void set_unblock_callback(Function<void()> callback)
@@ -50,11 +71,13 @@ public:
     }
 
 private:
-    explicit DoubleBuffer(size_t capacity, NonnullOwnPtr<KBuffer> storage);
+    DoubleBuffer(StringView name, size_t capacity, size_t maximum_capacity, NonnullOwnPtr<KBuffer> storage);
     void flip();
     void compute_lockfree_metadata();
+    ErrorOr<void> try_grow(size_t minimum_capacity);
 
     ErrorOr<size_t> read_impl(UserOrKernelBuffer&, size_t, MutexLocker&, bool advance_buffer_index);
+    ErrorOr<size_t> read_pages_impl(UserOrKernelBuffer&, size_t, bool advance_buffer_index);
 
     struct InnerBuffer {
         u8* data { nullptr };
@@ -66,9 +89,24 @@ private:
     InnerBuffer m_buffer1;
     InnerBuffer m_buffer2;
 
+    // Regions queued with append_pages(). Each of them comes after `buffered_bytes_before` bytes
+    // that went through the inner buffers.
+    struct Pages {
+        NonnullOwnPtr<Memory::Region> region;
+        u64 buffered_bytes_before { 0 };
+        size_t read_offset { 0 };
+    };
+    Vector<Pages> m_pages;
+    u64 m_bytes_written_to_buffers { 0 };
+    u64 m_bytes_read_from_buffers { 0 };
+    size_t m_unread_bytes_in_pages { 0 };
+    size_t m_maximum_bytes_in_pages { 0 };
+
+    StringView m_name;
     NonnullOwnPtr<KBuffer> m_storage;
     Function<void()> m_unblock_callback;
     size_t m_capacity { 0 };
+    size_t m_maximum_capacity { 0 };
     size_t m_read_buffer_index { 0 };
     size_t m_space_for_writing { 0 };
     bool m_empty { true };
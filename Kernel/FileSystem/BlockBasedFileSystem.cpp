@@ -5,109 +5,376 @@
  */
 
 #include <AK/IntrusiveList.h>
+#include <AK/QuickSort.h>
 #include <Kernel/Debug.h>
 #include <Kernel/FileSystem/BlockBasedFileSystem.h>
+#include <Kernel/Memory/MemoryManager.h>
 #include <Kernel/Process.h>
 
 namespace Kernel {
 
+// These are shared by the caches of all mounted block-based file systems, so that
+// /sys/kernel/diskcache can report on them and so that growth is bounded globally.
+static Atomic<u64> s_cache_hits;
+static Atomic<u64> s_cache_misses;
+static Atomic<u64> s_cache_evictions;
+static Atomic<u64> s_cache_blocks_written_back;
+static Atomic<u64> s_cache_cached_bytes;
+static Atomic<u64> s_cache_dirty_bytes;
+static Atomic<u64> s_device_read_requests;
+static Atomic<u64> s_device_write_requests;
+static Atomic<u64> s_device_bytes_read;
+static Atomic<u64> s_device_bytes_written;
+
+// Runs of adjacent blocks are merged into a single device request of up to this size.
+static constexpr size_t max_batched_io_size = 64 * KiB;
+
+// NOTE: Storage devices may transfer less than we asked for in a single request,
+//       so keep going until everything has been transferred.
+static ErrorOr<void> read_from_device(OpenFileDescription& description, u64 offset, UserOrKernelBuffer& buffer, size_t length)
+{
+    size_t nread = 0;
+    while (nread < length) {
+        auto buffer_offset = buffer.offset(nread);
+        auto nread_now = TRY(description.read(buffer_offset, offset + nread, length - nread));
+        s_device_read_requests.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+        s_device_bytes_read.fetch_add(nread_now, AK::MemoryOrder::memory_order_relaxed);
+        if (nread_now == 0)
+            return EIO;
+        nread += nread_now;
+    }
+    return {};
+}
+
+static ErrorOr<void> write_to_device(OpenFileDescription& description, u64 offset, UserOrKernelBuffer const& buffer, size_t length)
+{
+    size_t nwritten = 0;
+    while (nwritten < length) {
+        auto nwritten_now = TRY(description.write(offset + nwritten, buffer.offset(nwritten), length - nwritten));
+        s_device_write_requests.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+        s_device_bytes_written.fetch_add(nwritten_now, AK::MemoryOrder::memory_order_relaxed);
+        if (nwritten_now == 0)
+            return EIO;
+        nwritten += nwritten_now;
+    }
+    return {};
+}
+
 struct CacheEntry {
     IntrusiveListNode<CacheEntry> list_node;
     BlockBasedFileSystem::BlockIndex block_index { 0 };
     u8* data { nullptr };
     bool has_data { false };
+    bool is_dirty { false };
+    bool is_mapped { false };
 };
 
-class DiskCache {
-public:
-    static constexpr size_t EntryCount = 10000;
-    explicit DiskCache(BlockBasedFileSystem& fs, NonnullOwnPtr<KBuffer> cached_block_data, NonnullOwnPtr<KBuffer> entries_buffer)
-        : m_fs(fs)
-        , m_cached_block_data(move(cached_block_data))
-        , m_entries(move(entries_buffer))
+struct CacheSegment {
+    static constexpr size_t EntryCount = 64;
+
+    explicit CacheSegment(NonnullOwnPtr<KBuffer> block_data)
+        : block_data(move(block_data))
     {
-        for (size_t i = 0; i < EntryCount; ++i) {
-            entries()[i].data = m_cached_block_data->data() + i * m_fs->block_size();
-            m_clean_list.append(entries()[i]);
-        }
     }
 
-    ~DiskCache() = default;
+    NonnullOwnPtr<KBuffer> block_data;
+    Array<CacheEntry, EntryCount> entries;
+};
 
-    bool is_dirty() const { return !m_dirty_list.is_empty(); }
-    bool entry_is_dirty(CacheEntry const& entry) const { return m_dirty_list.contains(entry); }
+class DiskCache;
 
-    void mark_all_clean()
+// A shard owns a disjoint subset of the cached blocks, along with its own lock and LRU,
+// so that I/O on unrelated parts of the disk does not serialize on a single cache lock.
+class DiskCacheShard {
+public:
+    explicit DiskCacheShard(DiskCache& cache)
+        : m_cache(cache)
     {
-        while (auto* entry = m_dirty_list.first())
-            m_clean_list.prepend(*entry);
     }
 
-    void mark_dirty(CacheEntry& entry)
+    ~DiskCacheShard()
     {
-        m_dirty_list.prepend(entry);
+        for (auto& segment : m_segments)
+            forget_segment(*segment);
     }
 
-    void mark_clean(CacheEntry& entry)
-    {
-        m_clean_list.prepend(entry);
-    }
+    Mutex& lock() { return m_lock; }
 
-    CacheEntry* get(BlockBasedFileSystem::BlockIndex block_index) const
+    CacheEntry* get(BlockBasedFileSystem::BlockIndex block_index)
     {
+        VERIFY(m_lock.is_locked());
         auto it = m_hash.find(block_index);
         if (it == m_hash.end())
             return nullptr;
-        auto& entry = const_cast<CacheEntry&>(*it->value);
+        auto& entry = *it->value;
         VERIFY(entry.block_index == block_index);
+        if (!entry.is_dirty)
+            m_clean_list.prepend(entry);
         return &entry;
     }
 
-    ErrorOr<CacheEntry*> ensure(BlockBasedFileSystem::BlockIndex block_index) const
+    ErrorOr<CacheEntry*> ensure(BlockBasedFileSystem::BlockIndex block_index)
     {
-        if (auto* entry = get(block_index))
+        VERIFY(m_lock.is_locked());
+        if (auto* entry = get(block_index)) {
+            s_cache_hits.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
             return entry;
-
-        if (m_clean_list.is_empty()) {
-            // Not a single clean entry! Flush writes and try again.
-            // NOTE: We want to make sure we only call FileBackedFileSystem flush here,
-            //       not some FileBackedFileSystem subclass flush!
-            m_fs->flush_writes_impl();
-            return ensure(block_index);
         }
+        s_cache_misses.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
 
-        VERIFY(m_clean_list.last());
-        auto& new_entry = *m_clean_list.last();
+        auto& new_entry = *TRY(take_unused_entry());
+        if (auto result = m_hash.try_set(block_index, &new_entry); result.is_error()) {
+            m_free_list.append(new_entry);
+            return result.release_error();
+        }
+        new_entry.block_index = block_index;
+        new_entry.has_data = false;
+        new_entry.is_mapped = true;
         m_clean_list.prepend(new_entry);
+        return &new_entry;
+    }
 
-        m_hash.remove(new_entry.block_index);
-        TRY(m_hash.try_set(block_index, &new_entry));
+    void mark_dirty(CacheEntry& entry)
+    {
+        if (!entry.is_dirty)
+            s_cache_dirty_bytes.fetch_add(m_block_size, AK::MemoryOrder::memory_order_relaxed);
+        entry.is_dirty = true;
+        m_dirty_list.prepend(entry);
+    }
 
-        new_entry.block_index = block_index;
-        new_entry.has_data = false;
+    void mark_clean(CacheEntry& entry)
+    {
+        if (entry.is_dirty)
+            s_cache_dirty_bytes.fetch_sub(m_block_size, AK::MemoryOrder::memory_order_relaxed);
+        entry.is_dirty = false;
+        m_clean_list.prepend(entry);
+    }
 
-        return &new_entry;
+    bool is_dirty() const { return !m_dirty_list.is_empty(); }
+
+    ErrorOr<void> grow();
+    size_t flush_dirty_entries();
+    void release_clean_segments();
+
+private:
+    ErrorOr<CacheEntry*> take_unused_entry();
+    void forget_segment(CacheSegment&);
+
+    DiskCache& m_cache;
+    size_t m_block_size { 0 };
+    Mutex m_lock { "DiskCacheShard"sv };
+    HashMap<BlockBasedFileSystem::BlockIndex, CacheEntry*> m_hash;
+    IntrusiveList<&CacheEntry::list_node> m_dirty_list;
+    IntrusiveList<&CacheEntry::list_node> m_clean_list;
+    IntrusiveList<&CacheEntry::list_node> m_free_list;
+    Vector<NonnullOwnPtr<CacheSegment>> m_segments;
+
+    friend class DiskCache;
+};
+
+class DiskCache {
+public:
+    static constexpr size_t ShardCount = 16;
+
+    // Consecutive blocks map to the same shard in runs of this many blocks, which keeps
+    // sequential I/O within one lock and gives write-back longer contiguous runs to sort.
+    static constexpr size_t BlocksPerShardRun = 64;
+
+    static ErrorOr<NonnullOwnPtr<DiskCache>> try_create(BlockBasedFileSystem& fs)
+    {
+        auto cache = TRY(adopt_nonnull_own_or_enomem(new (nothrow) DiskCache(fs)));
+        for (auto& shard : cache->m_shards) {
+            shard = TRY(adopt_nonnull_own_or_enomem(new (nothrow) DiskCacheShard(*cache)));
+            shard->m_block_size = fs.block_size();
+            MutexLocker locker(shard->lock());
+            TRY(shard->grow());
+        }
+        return cache;
     }
 
-    CacheEntry const* entries() const { return (CacheEntry const*)m_entries->data(); }
-    CacheEntry* entries() { return (CacheEntry*)m_entries->data(); }
+    ~DiskCache() = default;
+
+    BlockBasedFileSystem& fs() const { return *m_fs; }
+
+    DiskCacheShard& shard_for(BlockBasedFileSystem::BlockIndex block_index) const
+    {
+        return *m_shards[(block_index.value() / BlocksPerShardRun) % ShardCount];
+    }
 
     template<typename Callback>
-    void for_each_dirty_entry(Callback callback)
+    void for_each_shard(Callback callback) const
+    {
+        for (auto& shard : m_shards)
+            callback(*shard);
+    }
+
+    // Growth is bounded by a fraction of physical memory shared by all disk caches, and
+    // stops early once uncommitted memory is running low so we don't compete with processes.
+    static bool can_grow_by(size_t bytes)
+    {
+        auto info = MM.get_system_memory_info();
+        auto total_bytes = info.physical_pages * PAGE_SIZE;
+        if (s_cache_cached_bytes.load(AK::MemoryOrder::memory_order_relaxed) + bytes > total_bytes / 4)
+            return false;
+        return info.physical_pages_uncommitted * PAGE_SIZE > bytes + total_bytes / 8;
+    }
+
+    static bool is_under_memory_pressure()
     {
-        for (auto& entry : m_dirty_list)
-            callback(entry);
+        auto info = MM.get_system_memory_info();
+        return info.physical_pages_uncommitted * 16 < info.physical_pages;
     }
 
 private:
+    explicit DiskCache(BlockBasedFileSystem& fs)
+        : m_fs(fs)
+    {
+    }
+
     mutable NonnullRefPtr<BlockBasedFileSystem> m_fs;
-    mutable IntrusiveList<&CacheEntry::list_node> m_dirty_list;
-    mutable IntrusiveList<&CacheEntry::list_node> m_clean_list;
-    mutable HashMap<BlockBasedFileSystem::BlockIndex, CacheEntry*> m_hash;
-    NonnullOwnPtr<KBuffer> m_cached_block_data;
-    NonnullOwnPtr<KBuffer> m_entries;
+    Array<OwnPtr<DiskCacheShard>, ShardCount> m_shards;
 };
 
+ErrorOr<void> DiskCacheShard::grow()
+{
+    VERIFY(m_lock.is_locked());
+    auto block_data = TRY(KBuffer::try_create_with_size("BlockBasedFS: Cache blocks"sv, CacheSegment::EntryCount * m_block_size));
+    auto segment = TRY(adopt_nonnull_own_or_enomem(new (nothrow) CacheSegment(move(block_data))));
+    for (size_t i = 0; i < CacheSegment::EntryCount; ++i) {
+        segment->entries[i].data = segment->block_data->data() + i * m_block_size;
+        m_free_list.append(segment->entries[i]);
+    }
+    TRY(m_segments.try_append(move(segment)));
+    s_cache_cached_bytes.fetch_add(CacheSegment::EntryCount * m_block_size, AK::MemoryOrder::memory_order_relaxed);
+    return {};
+}
+
+ErrorOr<CacheEntry*> DiskCacheShard::take_unused_entry()
+{
+    if (auto* entry = m_free_list.take_first())
+        return entry;
+
+    if (DiskCache::can_grow_by(CacheSegment::EntryCount * m_block_size)) {
+        if (!grow().is_error())
+            return m_free_list.take_first();
+    }
+
+    if (m_clean_list.is_empty()) {
+        // Not a single clean entry in this shard! Write back its dirty blocks and try again.
+        flush_dirty_entries();
+        VERIFY(!m_clean_list.is_empty());
+    }
+
+    auto& entry = *m_clean_list.last();
+    m_clean_list.remove(entry);
+    m_hash.remove(entry.block_index);
+    entry.is_mapped = false;
+    s_cache_evictions.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+    return &entry;
+}
+
+size_t DiskCacheShard::flush_dirty_entries()
+{
+    VERIFY(m_lock.is_locked());
+    if (m_dirty_list.is_empty())
+        return 0;
+
+    // Write back in ascending block order so the device sees the shortest possible seeks.
+    // If we can't allocate the temporary array, fall back to list order.
+    Vector<CacheEntry*, 64> dirty_entries;
+    for (auto& entry : m_dirty_list) {
+        if (dirty_entries.try_append(&entry).is_error())
+            break;
+    }
+    quick_sort(dirty_entries, [](auto* a, auto* b) { return a->block_index < b->block_index; });
+
+    auto& description = m_cache.fs().file_description();
+    size_t count = 0;
+    auto write_entry = [&](CacheEntry& entry) {
+        auto base_offset = entry.block_index.value() * m_block_size;
+        auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
+        [[maybe_unused]] auto rc = write_to_device(description, base_offset, entry_data_buffer, m_block_size);
+        mark_clean(entry);
+        ++count;
+    };
+
+    // Adjacent dirty blocks are gathered into a bounce buffer and written with a single request.
+    size_t const max_blocks_per_batch = max<size_t>(max_batched_io_size / m_block_size, 1);
+    for (size_t i = 0; i < dirty_entries.size();) {
+        auto first_block_index = dirty_entries[i]->block_index.value();
+        size_t run_length = 1;
+        while (i + run_length < dirty_entries.size() && run_length < max_blocks_per_batch && dirty_entries[i + run_length]->block_index.value() == first_block_index + run_length)
+            ++run_length;
+
+        auto batch_buffer = run_length > 1 ? ByteBuffer::create_uninitialized(run_length * m_block_size) : ErrorOr<ByteBuffer> { ENOMEM };
+        if (batch_buffer.is_error()) {
+            for (size_t j = 0; j < run_length; ++j)
+                write_entry(*dirty_entries[i + j]);
+            i += run_length;
+            continue;
+        }
+
+        for (size_t j = 0; j < run_length; ++j)
+            memcpy(batch_buffer.value().offset_pointer(j * m_block_size), dirty_entries[i + j]->data, m_block_size);
+        auto data_buffer = UserOrKernelBuffer::for_kernel_buffer(batch_buffer.value().data());
+        [[maybe_unused]] auto rc = write_to_device(description, first_block_index * m_block_size, data_buffer, run_length * m_block_size);
+        for (size_t j = 0; j < run_length; ++j)
+            mark_clean(*dirty_entries[i + j]);
+        count += run_length;
+        i += run_length;
+    }
+    while (auto* entry = m_dirty_list.first())
+        write_entry(*entry);
+
+    s_cache_blocks_written_back.fetch_add(count, AK::MemoryOrder::memory_order_relaxed);
+    return count;
+}
+
+void DiskCacheShard::forget_segment(CacheSegment& segment)
+{
+    for (auto& entry : segment.entries) {
+        if (entry.is_mapped)
+            m_hash.remove(entry.block_index);
+        if (entry.is_dirty)
+            s_cache_dirty_bytes.fetch_sub(m_block_size, AK::MemoryOrder::memory_order_relaxed);
+        if (entry.list_node.is_in_list())
+            entry.list_node.remove();
+        entry.is_mapped = false;
+        entry.is_dirty = false;
+    }
+    s_cache_cached_bytes.fetch_sub(CacheSegment::EntryCount * m_block_size, AK::MemoryOrder::memory_order_relaxed);
+}
+
+void DiskCacheShard::release_clean_segments()
+{
+    VERIFY(m_lock.is_locked());
+    // Always keep one segment around so the shard can make progress without allocating.
+    for (size_t i = m_segments.size(); i > 1; --i) {
+        auto& segment = *m_segments[i - 1];
+        bool has_dirty_entries = any_of(segment.entries, [](auto& entry) { return entry.is_dirty; });
+        if (has_dirty_entries)
+            continue;
+        forget_segment(segment);
+        m_segments.remove(i - 1);
+    }
+}
+
+DiskCacheStatistics BlockBasedFileSystem::disk_cache_statistics()
+{
+    return {
+        .hits = s_cache_hits.load(AK::MemoryOrder::memory_order_relaxed),
+        .misses = s_cache_misses.load(AK::MemoryOrder::memory_order_relaxed),
+        .evictions = s_cache_evictions.load(AK::MemoryOrder::memory_order_relaxed),
+        .blocks_written_back = s_cache_blocks_written_back.load(AK::MemoryOrder::memory_order_relaxed),
+        .cached_bytes = s_cache_cached_bytes.load(AK::MemoryOrder::memory_order_relaxed),
+        .dirty_bytes = s_cache_dirty_bytes.load(AK::MemoryOrder::memory_order_relaxed),
+        .device_read_requests = s_device_read_requests.load(AK::MemoryOrder::memory_order_relaxed),
+        .device_write_requests = s_device_write_requests.load(AK::MemoryOrder::memory_order_relaxed),
+        .device_bytes_read = s_device_bytes_read.load(AK::MemoryOrder::memory_order_relaxed),
+        .device_bytes_written = s_device_bytes_written.load(AK::MemoryOrder::memory_order_relaxed),
+    };
+}
+
 BlockBasedFileSystem::BlockBasedFileSystem(OpenFileDescription& file_description)
     : FileBackedFileSystem(file_description)
 {
@@ -129,9 +396,7 @@ ErrorOr<void> BlockBasedFileSystem::initialize_while_locked()
     VERIFY(m_lock.is_locked());
     VERIFY(!is_initialized_while_locked());
     VERIFY(block_size() != 0);
-    auto cached_block_data = TRY(KBuffer::try_create_with_size("BlockBasedFS: Cache blocks"sv, DiskCache::EntryCount * block_size()));
-    auto entries_data = TRY(KBuffer::try_create_with_size("BlockBasedFS: Cache entries"sv, DiskCache::EntryCount * sizeof(CacheEntry)));
-    auto disk_cache = TRY(adopt_nonnull_own_or_enomem(new (nothrow) DiskCache(*this, move(cached_block_data), move(entries_data))));
+    auto disk_cache = TRY(DiskCache::try_create(*this));
 
     m_cache.with_exclusive([&](auto& cache) {
         cache = move(disk_cache);
@@ -152,23 +417,22 @@ ErrorOr<void> BlockBasedFileSystem::write_block(BlockIndex index, UserOrKernelBu
 
     TRY(data.read(buffered_data.bytes()));
 
-    return m_cache.with_exclusive([&](auto& cache) -> ErrorOr<void> {
+    return m_cache.with_shared([&](auto& cache) -> ErrorOr<void> {
+        auto& shard = cache->shard_for(index);
+        MutexLocker locker(shard.lock());
+
         if (!allow_cache) {
-            flush_specific_block_if_needed(index);
+            flush_specific_block_if_needed(shard, index);
             u64 base_offset = index.value() * block_size() + offset;
-            auto nwritten = TRY(file_description().write(base_offset, data, count));
-            VERIFY(nwritten == count);
-            return {};
+            return write_to_device(file_description(), base_offset, data, count);
         }
 
-        auto entry = TRY(cache->ensure(index));
-        if (count < block_size()) {
-            // Fill the cache first.
-            TRY(read_block(index, nullptr, block_size()));
-        }
+        auto entry = TRY(shard.ensure(index));
+        if (count < block_size())
+            TRY(fill_cache_entry_if_needed(*entry));
         memcpy(entry->data + offset, buffered_data.data(), count);
 
-        cache->mark_dirty(*entry);
+        shard.mark_dirty(*entry);
         entry->has_data = true;
         return {};
     });
@@ -176,44 +440,42 @@ ErrorOr<void> BlockBasedFileSystem::write_block(BlockIndex index, UserOrKernelBu
 
 ErrorOr<void> BlockBasedFileSystem::raw_read(BlockIndex index, UserOrKernelBuffer& buffer)
 {
-    auto base_offset = index.value() * m_logical_block_size;
-    auto nread = TRY(file_description().read(buffer, base_offset, m_logical_block_size));
-    VERIFY(nread == m_logical_block_size);
-    return {};
+    return raw_read_blocks(index, 1, buffer);
 }
 
 ErrorOr<void> BlockBasedFileSystem::raw_write(BlockIndex index, UserOrKernelBuffer const& buffer)
 {
-    auto base_offset = index.value() * m_logical_block_size;
-    auto nwritten = TRY(file_description().write(base_offset, buffer, m_logical_block_size));
-    VERIFY(nwritten == m_logical_block_size);
-    return {};
+    return raw_write_blocks(index, 1, buffer);
 }
 
 ErrorOr<void> BlockBasedFileSystem::raw_read_blocks(BlockIndex index, size_t count, UserOrKernelBuffer& buffer)
 {
-    auto current = buffer;
-    for (auto block = index.value(); block < (index.value() + count); block++) {
-        TRY(raw_read(BlockIndex { block }, current));
-        current = current.offset(logical_block_size());
-    }
-    return {};
+    auto base_offset = index.value() * m_logical_block_size;
+    return read_from_device(file_description(), base_offset, buffer, count * m_logical_block_size);
 }
 
 ErrorOr<void> BlockBasedFileSystem::raw_write_blocks(BlockIndex index, size_t count, UserOrKernelBuffer const& buffer)
 {
-    auto current = buffer;
-    for (auto block = index.value(); block < (index.value() + count); block++) {
-        TRY(raw_write(block, current));
-        current = current.offset(logical_block_size());
-    }
-    return {};
+    auto base_offset = index.value() * m_logical_block_size;
+    return write_to_device(file_description(), base_offset, buffer, count * m_logical_block_size);
 }
 
 ErrorOr<void> BlockBasedFileSystem::write_blocks(BlockIndex index, unsigned count, UserOrKernelBuffer const& data, bool allow_cache)
 {
     VERIFY(m_logical_block_size);
     dbgln_if(BBFS_DEBUG, "BlockBasedFileSystem::write_blocks {}, count={}", index, count);
+    if (!allow_cache) {
+        // Make sure nothing in the cache overwrites the data later on, then write everything in one go.
+        m_cache.with_shared([&](auto& cache) {
+            for (unsigned i = 0; i < count; ++i) {
+                BlockIndex block_index { index.value() + i };
+                auto& shard = cache->shard_for(block_index);
+                MutexLocker locker(shard.lock());
+                flush_specific_block_if_needed(shard, block_index);
+            }
+        });
+        return write_to_device(file_description(), index.value() * block_size(), data, count * block_size());
+    }
     for (unsigned i = 0; i < count; ++i) {
         TRY(write_block(BlockIndex { index.value() + i }, data.offset(i * block_size()), block_size(), 0, allow_cache));
     }
@@ -226,29 +488,35 @@ ErrorOr<void> BlockBasedFileSystem::read_block(BlockIndex index, UserOrKernelBuf
     VERIFY(offset + count <= block_size());
     dbgln_if(BBFS_DEBUG, "BlockBasedFileSystem::read_block {}", index);
 
-    return m_cache.with_exclusive([&](auto& cache) -> ErrorOr<void> {
+    return m_cache.with_shared([&](auto& cache) -> ErrorOr<void> {
+        auto& shard = cache->shard_for(index);
+        MutexLocker locker(shard.lock());
+
         if (!allow_cache) {
-            const_cast<BlockBasedFileSystem*>(this)->flush_specific_block_if_needed(index);
+            const_cast<BlockBasedFileSystem*>(this)->flush_specific_block_if_needed(shard, index);
             u64 base_offset = index.value() * block_size() + offset;
-            auto nread = TRY(file_description().read(*buffer, base_offset, count));
-            VERIFY(nread == count);
-            return {};
+            return read_from_device(file_description(), base_offset, *buffer, count);
         }
 
-        auto* entry = TRY(cache->ensure(index));
-        if (!entry->has_data) {
-            auto base_offset = index.value() * block_size();
-            auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry->data);
-            auto nread = TRY(file_description().read(entry_data_buffer, base_offset, block_size()));
-            VERIFY(nread == block_size());
-            entry->has_data = true;
-        }
+        auto* entry = TRY(shard.ensure(index));
+        TRY(fill_cache_entry_if_needed(*entry));
         if (buffer)
             TRY(buffer->write(entry->data + offset, count));
         return {};
     });
 }
 
+ErrorOr<void> BlockBasedFileSystem::fill_cache_entry_if_needed(CacheEntry& entry) const
+{
+    if (entry.has_data)
+        return {};
+    auto base_offset = entry.block_index.value() * block_size();
+    auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
+    TRY(read_from_device(file_description(), base_offset, entry_data_buffer, block_size()));
+    entry.has_data = true;
+    return {};
+}
+
 ErrorOr<void> BlockBasedFileSystem::read_blocks(BlockIndex index, unsigned count, UserOrKernelBuffer& buffer, bool allow_cache) const
 {
     VERIFY(m_logical_block_size);
@@ -256,46 +524,126 @@ ErrorOr<void> BlockBasedFileSystem::read_blocks(BlockIndex index, unsigned count
         return EINVAL;
     if (count == 1)
         return read_block(index, &buffer, block_size(), 0, allow_cache);
-    auto out = buffer;
-    for (unsigned i = 0; i < count; ++i) {
-        TRY(read_block(BlockIndex { index.value() + i }, &out, block_size(), 0, allow_cache));
-        out = out.offset(block_size());
-    }
+    return read_blocks_impl(index, count, &buffer, allow_cache);
+}
 
-    return {};
+ErrorOr<void> BlockBasedFileSystem::prefetch_blocks(BlockIndex index, unsigned count) const
+{
+    VERIFY(m_logical_block_size);
+    if (!count)
+        return {};
+    return read_blocks_impl(index, count, nullptr, true);
 }
 
-void BlockBasedFileSystem::flush_specific_block_if_needed(BlockIndex index)
+ErrorOr<void> BlockBasedFileSystem::read_blocks_impl(BlockIndex index, unsigned count, UserOrKernelBuffer* buffer, bool allow_cache) const
 {
-    m_cache.with_exclusive([&](auto& cache) {
-        if (!cache->is_dirty())
-            return;
-        auto* entry = cache->get(index);
-        if (!entry)
-            return;
-        if (!cache->entry_is_dirty(*entry))
-            return;
-        size_t base_offset = entry->block_index.value() * block_size();
-        auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry->data);
-        (void)file_description().write(base_offset, entry_data_buffer, block_size());
+    dbgln_if(BBFS_DEBUG, "BlockBasedFileSystem::read_blocks {}, count={}", index, count);
+
+    if (!allow_cache) {
+        VERIFY(buffer);
+        m_cache.with_shared([&](auto& cache) {
+            for (unsigned i = 0; i < count; ++i) {
+                BlockIndex block_index { index.value() + i };
+                auto& shard = cache->shard_for(block_index);
+                MutexLocker locker(shard.lock());
+                const_cast<BlockBasedFileSystem*>(this)->flush_specific_block_if_needed(shard, block_index);
+            }
+        });
+        return read_from_device(file_description(), index.value() * block_size(), *buffer, count * block_size());
+    }
+
+    return m_cache.with_shared([&](auto& cache) -> ErrorOr<void> {
+        size_t const max_blocks_per_batch = max<size_t>(max_batched_io_size / block_size(), 1);
+        u64 const end = index.value() + count;
+        u64 current = index.value();
+        while (current < end) {
+            // Handle one shard at a time, since all of its blocks are covered by the same lock.
+            auto& shard = cache->shard_for(current);
+            u64 const shard_run_end = min(end, (current / DiskCache::BlocksPerShardRun + 1) * DiskCache::BlocksPerShardRun);
+            MutexLocker locker(shard.lock());
+
+            auto copy_out = [&](CacheEntry const& entry) -> ErrorOr<void> {
+                if (!buffer)
+                    return {};
+                auto out = buffer->offset((entry.block_index.value() - index.value()) * block_size());
+                return out.write(entry.data, block_size());
+            };
+
+            while (current < shard_run_end) {
+                if (auto* entry = shard.get(current); entry && entry->has_data) {
+                    TRY(copy_out(*entry));
+                    ++current;
+                    continue;
+                }
+
+                // Gather the run of blocks that need to come from the device.
+                u64 run_end = current + 1;
+                while (run_end < shard_run_end && run_end - current < max_blocks_per_batch) {
+                    auto* entry = shard.get(run_end);
+                    if (entry && entry->has_data)
+                        break;
+                    ++run_end;
+                }
+                size_t run_length = run_end - current;
+
+                auto batch_buffer = run_length > 1 ? ByteBuffer::create_uninitialized(run_length * block_size()) : ErrorOr<ByteBuffer> { ENOMEM };
+                if (batch_buffer.is_error()) {
+                    // Fall back to reading this run one block at a time.
+                    for (; current < run_end; ++current) {
+                        auto* entry = TRY(shard.ensure(current));
+                        TRY(fill_cache_entry_if_needed(*entry));
+                        TRY(copy_out(*entry));
+                    }
+                    continue;
+                }
+
+                auto data_buffer = UserOrKernelBuffer::for_kernel_buffer(batch_buffer.value().data());
+                TRY(read_from_device(file_description(), current * block_size(), data_buffer, run_length * block_size()));
+
+                // NOTE: We look every entry up again right before touching it, since taking
+                //       a new entry may evict one we looked at earlier in this run.
+                for (size_t i = 0; i < run_length; ++i, ++current) {
+                    auto* entry = TRY(shard.ensure(current));
+                    if (!entry->has_data) {
+                        memcpy(entry->data, batch_buffer.value().offset_pointer(i * block_size()), block_size());
+                        entry->has_data = true;
+                    }
+                    TRY(copy_out(*entry));
+                }
+            }
+        }
+        return {};
     });
 }
 
+void BlockBasedFileSystem::flush_specific_block_if_needed(DiskCacheShard& shard, BlockIndex index)
+{
+    VERIFY(shard.lock().is_locked());
+    if (!shard.is_dirty())
+        return;
+    auto* entry = shard.get(index);
+    if (!entry || !entry->is_dirty)
+        return;
+    size_t base_offset = entry->block_index.value() * block_size();
+    auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry->data);
+    if (!write_to_device(file_description(), base_offset, entry_data_buffer, block_size()).is_error())
+        shard.mark_clean(*entry);
+}
+
 void BlockBasedFileSystem::flush_writes_impl()
 {
     size_t count = 0;
-    m_cache.with_exclusive([&](auto& cache) {
-        if (!cache->is_dirty())
-            return;
-        cache->for_each_dirty_entry([&](CacheEntry& entry) {
-            auto base_offset = entry.block_index.value() * block_size();
-            auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
-            [[maybe_unused]] auto rc = file_description().write(base_offset, entry_data_buffer, block_size());
-            ++count;
+    m_cache.with_shared([&](auto& cache) {
+        bool under_memory_pressure = DiskCache::is_under_memory_pressure();
+        cache->for_each_shard([&](DiskCacheShard& shard) {
+            MutexLocker locker(shard.lock());
+            count += shard.flush_dirty_entries();
+            if (under_memory_pressure)
+                shard.release_clean_segments();
         });
-        cache->mark_all_clean();
-        dbgln("{}: Flushed {} blocks to disk", class_name(), count);
     });
+    if (count)
+        dbgln("{}: Flushed {} blocks to disk", class_name(), count);
 }
 
 void BlockBasedFileSystem::flush_writes()
@@ -11,6 +11,22 @@
 
 namespace Kernel {
 
+struct CacheEntry;
+class DiskCacheShard;
+
+struct DiskCacheStatistics {
+    u64 hits { 0 };
+    u64 misses { 0 };
+    u64 evictions { 0 };
+    u64 blocks_written_back { 0 };
+    u64 cached_bytes { 0 };
+    u64 dirty_bytes { 0 };
+    u64 device_read_requests { 0 };
+    u64 device_write_requests { 0 };
+    u64 device_bytes_read { 0 };
+    u64 device_bytes_written { 0 };
+};
+
 class BlockBasedFileSystem : public FileBackedFileSystem {
 public:
     AK_TYPEDEF_DISTINCT_ORDERED_ID(u64, BlockIndex);
@@ -22,6 +38,8 @@ public:
     virtual void flush_writes() override;
     void flush_writes_impl();
 
+    static DiskCacheStatistics disk_cache_statistics();
+
 protected:
     explicit BlockBasedFileSystem(OpenFileDescription&);
 
@@ -29,6 +47,8 @@ protected:
 
     ErrorOr<void> read_block(BlockIndex, UserOrKernelBuffer*, size_t count, u64 offset = 0, bool allow_cache = true) const;
     ErrorOr<void> read_blocks(BlockIndex, unsigned count, UserOrKernelBuffer&, bool allow_cache = true) const;
+    // Pulls a range of blocks into the cache, merging adjacent missing blocks into larger device requests.
+    ErrorOr<void> prefetch_blocks(BlockIndex, unsigned count) const;
 
     ErrorOr<void> raw_read(BlockIndex, UserOrKernelBuffer&);
     ErrorOr<void> raw_write(BlockIndex, UserOrKernelBuffer const&);
@@ -44,7 +64,9 @@ protected:
     void remove_disk_cache_before_last_unmount();
 
 private:
-    void flush_specific_block_if_needed(BlockIndex index);
+    void flush_specific_block_if_needed(DiskCacheShard&, BlockIndex index);
+    ErrorOr<void> fill_cache_entry_if_needed(CacheEntry&) const;
+    ErrorOr<void> read_blocks_impl(BlockIndex, unsigned count, UserOrKernelBuffer*, bool allow_cache) const;
 
     mutable MutexProtected<OwnPtr<DiskCache>> m_cache;
 };
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Array.h>
+#include <AK/HashMap.h>
+#include <AK/IntrusiveList.h>
+#include <AK/Singleton.h>
+#include <Kernel/FileSystem/DentryCache.h>
+#include <Kernel/FileSystem/FileSystem.h>
+#include <Kernel/FileSystem/Inode.h>
+#include <Kernel/KString.h>
+#include <Kernel/Locking/Spinlock.h>
+
+namespace Kernel {
+
+static Atomic<u64> s_hits;
+static Atomic<u64> s_negative_hits;
+static Atomic<u64> s_misses;
+static Atomic<u64> s_insertions;
+static Atomic<u64> s_evictions;
+static Atomic<u64> s_invalidations;
+static Atomic<u64> s_entries;
+
+static constexpr size_t shard_count = 16;
+static constexpr size_t max_entries_per_shard = 512;
+
+struct DentryCacheKey {
+    InodeIdentifier parent;
+    StringView name;
+
+    bool operator==(DentryCacheKey const& other) const { return parent == other.parent && name == other.name; }
+};
+
+struct DentryCacheEntry {
+    InodeIdentifier parent;
+    NonnullOwnPtr<KString> name;
+    // Null for a negative entry, which remembers that there is no child with this name.
+    LockRefPtr<Inode> child;
+    IntrusiveListNode<DentryCacheEntry> lru_list_node;
+
+    DentryCacheKey key() const { return { parent, name->view() }; }
+};
+
+}
+
+namespace AK {
+
+template<>
+struct Traits<Kernel::DentryCacheKey> : public GenericTraits<Kernel::DentryCacheKey> {
+    static unsigned hash(Kernel::DentryCacheKey const& key) { return pair_int_hash(Traits<Kernel::InodeIdentifier>::hash(key.parent), key.name.hash()); }
+};
+
+}
+
+namespace Kernel {
+
+// Each shard has its own lock, so lookups of unrelated names don't contend with each other.
+struct DentryCacheShard {
+    Spinlock<LockRank::None> lock {};
+    HashMap<DentryCacheKey, NonnullOwnPtr<DentryCacheEntry>> entries;
+    // The most recently used entry is at the front.
+    IntrusiveList<&DentryCacheEntry::lru_list_node> lru_list;
+    // Bumped by every invalidation, so a lookup can tell whether the file system changed
+    // while it was asking it, and its result shouldn't be cached.
+    u64 generation { 0 };
+};
+
+static Singleton<Array<DentryCacheShard, shard_count>> s_shards;
+
+static DentryCacheShard& shard_for(DentryCacheKey const& key)
+{
+    return (*s_shards)[Traits<DentryCacheKey>::hash(key) % shard_count];
+}
+
+static void insert(DentryCacheShard& shard, u64 generation, DentryCacheKey const& key, Inode* child)
+{
+    auto name = KString::try_create(key.name);
+    if (name.is_error())
+        return;
+    auto new_entry = adopt_own_if_nonnull(new (nothrow) DentryCacheEntry { key.parent, name.release_value(), child, {} });
+    if (!new_entry)
+        return;
+
+    // NOTE: Evicted entries may hold the last reference to an inode, so they are only dropped after the lock is released.
+    Optional<NonnullOwnPtr<DentryCacheEntry>> evicted_entry;
+    SpinlockLocker locker(shard.lock);
+    if (shard.generation != generation || shard.entries.contains(key))
+        return;
+    if (shard.entries.size() >= max_entries_per_shard) {
+        auto* least_recently_used = shard.lru_list.take_last();
+        evicted_entry = shard.entries.take(least_recently_used->key());
+        s_evictions.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+        s_entries.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+    }
+    auto& entry = *new_entry;
+    if (shard.entries.try_set(entry.key(), new_entry.release_nonnull()).is_error())
+        return;
+    shard.lru_list.prepend(entry);
+    s_insertions.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+    s_entries.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+}
+
+ErrorOr<NonnullLockRefPtr<Inode>> DentryCache::lookup(Inode& parent, StringView name)
+{
+    if (!parent.fs().supports_dentry_cache())
+        return parent.lookup(name);
+
+    DentryCacheKey key { parent.identifier(), name };
+    auto& shard = shard_for(key);
+    u64 generation = 0;
+    {
+        SpinlockLocker locker(shard.lock);
+        if (auto it = shard.entries.find(key); it != shard.entries.end()) {
+            auto& entry = *it->value;
+            shard.lru_list.remove(entry);
+            shard.lru_list.prepend(entry);
+            if (!entry.child) {
+                s_negative_hits.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+                return ENOENT;
+            }
+            s_hits.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+            return NonnullLockRefPtr<Inode> { *entry.child };
+        }
+        generation = shard.generation;
+    }
+
+    s_misses.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+    auto child_or_error = parent.lookup(name);
+    if (!child_or_error.is_error())
+        insert(shard, generation, key, child_or_error.value().ptr());
+    else if (child_or_error.error().code() == ENOENT)
+        insert(shard, generation, key, nullptr);
+    return child_or_error;
+}
+
+void DentryCache::invalidate(InodeIdentifier parent, StringView name)
+{
+    DentryCacheKey key { parent, name };
+    auto& shard = shard_for(key);
+    // NOTE: Like in insert(), the removed entry is only dropped after the lock is released.
+    Optional<NonnullOwnPtr<DentryCacheEntry>> removed_entry;
+    SpinlockLocker locker(shard.lock);
+    ++shard.generation;
+    removed_entry = shard.entries.take(key);
+    if (removed_entry.has_value()) {
+        shard.lru_list.remove(*removed_entry.value());
+        s_invalidations.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+        s_entries.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+    }
+}
+
+void DentryCache::remove_all_entries_for(FileSystemID fsid)
+{
+    for (auto& shard : *s_shards) {
+        IntrusiveList<&DentryCacheEntry::lru_list_node> removed_entries;
+        SpinlockLocker locker(shard.lock);
+        ++shard.generation;
+        shard.entries.remove_all_matching([&](auto& key, auto& entry) {
+            if (key.parent.fsid() != fsid)
+                return false;
+            // Keep the entry alive until the lock is released.
+            shard.lru_list.remove(*entry);
+            removed_entries.append(*entry.leak_ptr());
+            s_invalidations.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+            s_entries.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+            return true;
+        });
+        locker.unlock();
+        while (auto* entry = removed_entries.take_first())
+            delete entry;
+    }
+}
+
+DentryCacheStatistics DentryCache::statistics()
+{
+    return {
+        .hits = s_hits.load(AK::MemoryOrder::memory_order_relaxed),
+        .negative_hits = s_negative_hits.load(AK::MemoryOrder::memory_order_relaxed),
+        .misses = s_misses.load(AK::MemoryOrder::memory_order_relaxed),
+        .insertions = s_insertions.load(AK::MemoryOrder::memory_order_relaxed),
+        .evictions = s_evictions.load(AK::MemoryOrder::memory_order_relaxed),
+        .invalidations = s_invalidations.load(AK::MemoryOrder::memory_order_relaxed),
+        .entries = s_entries.load(AK::MemoryOrder::memory_order_relaxed),
+    };
+}
+
+}
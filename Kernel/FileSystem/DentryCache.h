@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/StringView.h>
+#include <AK/Types.h>
+#include <Kernel/FileSystem/InodeIdentifier.h>
+#include <Kernel/Forward.h>
+#include <Kernel/Library/LockRefPtr.h>
+
+namespace Kernel {
+
+struct DentryCacheStatistics {
+    u64 hits { 0 };
+    u64 negative_hits { 0 };
+    u64 misses { 0 };
+    u64 insertions { 0 };
+    u64 evictions { 0 };
+    u64 invalidations { 0 };
+    u64 entries { 0 };
+};
+
+// Remembers which inode a name in a directory resolved to, or that it didn't exist, so that path
+// resolution doesn't have to ask the file system for every component of every path again.
+// Only file systems that report changes to their directories through Inode::did_add_child() and
+// Inode::did_remove_child() opt into this, see FileSystem::supports_dentry_cache().
+class DentryCache {
+public:
+    static ErrorOr<NonnullLockRefPtr<Inode>> lookup(Inode& parent, StringView name);
+
+    static void invalidate(InodeIdentifier parent, StringView name);
+    static void remove_all_entries_for(FileSystemID);
+
+    static DentryCacheStatistics statistics();
+};
+
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/FileSystem/EPoll.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+using BlockFlags = Thread::FileBlocker::BlockFlags;
+
+static BlockFlags block_flags_for(u32 events)
+{
+    // Errors and hang-ups are always reported, just like with poll().
+    BlockFlags block_flags = BlockFlags::WriteError | BlockFlags::WriteHangUp;
+    if (events & EPOLLIN)
+        block_flags |= BlockFlags::Read;
+    if (events & EPOLLOUT)
+        block_flags |= BlockFlags::Write;
+    if (events & EPOLLPRI)
+        block_flags |= BlockFlags::ReadPriority;
+    if (events & EPOLLWRBAND)
+        block_flags |= BlockFlags::WritePriority;
+    if (events & EPOLLRDHUP)
+        block_flags |= BlockFlags::ReadHangUp;
+    return block_flags;
+}
+
+static u32 epoll_events_for(BlockFlags unblocked_flags)
+{
+    u32 events = 0;
+    if (has_flag(unblocked_flags, BlockFlags::WriteHangUp))
+        events |= EPOLLHUP;
+    if (has_flag(unblocked_flags, BlockFlags::WriteError))
+        return events | EPOLLERR;
+    if (has_flag(unblocked_flags, BlockFlags::Read))
+        events |= EPOLLIN;
+    if (has_flag(unblocked_flags, BlockFlags::ReadPriority))
+        events |= EPOLLPRI;
+    if (!has_flag(unblocked_flags, BlockFlags::WriteHangUp) && has_flag(unblocked_flags, BlockFlags::Write))
+        events |= EPOLLOUT;
+    if (has_flag(unblocked_flags, BlockFlags::WritePriority))
+        events |= EPOLLWRBAND;
+    if (has_flag(unblocked_flags, BlockFlags::ReadHangUp))
+        events |= EPOLLRDHUP;
+    return events;
+}
+
+EPoll::Interest::Interest(EPoll& epoll, int fd, OpenFileDescription& description, epoll_event const& event)
+    : FileReadinessObserver(description)
+    , m_epoll(epoll)
+    , m_fd(fd)
+    , m_file(description.file())
+    , m_events(event.events)
+    , m_data(event.data.u64)
+{
+}
+
+ErrorOr<NonnullLockRefPtr<EPoll>> EPoll::try_create()
+{
+    return adopt_nonnull_lock_ref_or_enomem(new (nothrow) EPoll);
+}
+
+EPoll::~EPoll()
+{
+    HashMap<InterestKey, NonnullRefPtr<Interest>, InterestKeyTraits> interests;
+    {
+        SpinlockLocker lock(m_lock);
+        for (auto& it : m_interests)
+            it.value->m_removed = true;
+        m_ready_list.clear();
+        interests = move(m_interests);
+    }
+    for (auto& it : interests)
+        it.value->m_file->blocker_set().remove_observer(*it.value);
+}
+
+bool EPoll::can_read(OpenFileDescription const&, u64) const
+{
+    SpinlockLocker lock(m_lock);
+    return !m_ready_list.is_empty();
+}
+
+ErrorOr<NonnullOwnPtr<KString>> EPoll::pseudo_path(OpenFileDescription const&) const
+{
+    SpinlockLocker lock(m_lock);
+    return KString::formatted("EPoll:({})", m_interests.size());
+}
+
+ErrorOr<void> EPoll::add_interest(int fd, OpenFileDescription& description, epoll_event const& event)
+{
+    auto interest = TRY(adopt_nonnull_ref_or_enomem(new (nothrow) Interest(*this, fd, description, event)));
+    {
+        SpinlockLocker lock(m_lock);
+        InterestKey key { fd, &description };
+        if (m_interests.contains(key))
+            return EEXIST;
+        TRY(m_interests.try_set(key, interest));
+        // Check the description once right away, it might already be ready.
+        m_ready_list.append(*interest);
+    }
+    description.blocker_set().add_observer(*interest);
+
+    // NOTE: Someone might have removed the interest again before we attached it.
+    bool was_removed;
+    {
+        SpinlockLocker lock(m_lock);
+        was_removed = interest->m_removed;
+    }
+    if (was_removed) {
+        description.blocker_set().remove_observer(*interest);
+        return {};
+    }
+    evaluate_block_conditions();
+    return {};
+}
+
+ErrorOr<void> EPoll::modify_interest(int fd, OpenFileDescription& description, epoll_event const& event)
+{
+    {
+        SpinlockLocker lock(m_lock);
+        auto it = m_interests.find({ fd, &description });
+        if (it == m_interests.end())
+            return ENOENT;
+        auto& interest = *it->value;
+        interest.m_events = event.events;
+        interest.m_data = event.data.u64;
+        interest.m_disarmed = false;
+        if (!interest.m_ready_list_node.is_in_list())
+            m_ready_list.append(interest);
+    }
+    evaluate_block_conditions();
+    return {};
+}
+
+ErrorOr<void> EPoll::remove_interest(int fd, OpenFileDescription& description)
+{
+    RefPtr<Interest> interest;
+    {
+        SpinlockLocker lock(m_lock);
+        auto it = m_interests.find({ fd, &description });
+        if (it == m_interests.end())
+            return ENOENT;
+        interest = it->value;
+        m_interests.remove(it);
+        interest->m_removed = true;
+        if (interest->m_ready_list_node.is_in_list())
+            m_ready_list.remove(*interest);
+    }
+    interest->m_file->blocker_set().remove_observer(*interest);
+    return {};
+}
+
+void EPoll::enqueue_ready(Interest& interest)
+{
+    {
+        SpinlockLocker lock(m_lock);
+        if (interest.m_removed || interest.m_disarmed || interest.m_ready_list_node.is_in_list())
+            return;
+        m_ready_list.append(interest);
+    }
+    evaluate_block_conditions();
+}
+
+void EPoll::forget(Interest& interest)
+{
+    // The description is going away, so the interest is dropped along with it, like on other systems.
+    // NOTE: We're called with the File's blocker set locked, which keeps the File alive until we return.
+    SpinlockLocker lock(m_lock);
+    if (interest.m_removed)
+        return;
+    interest.m_removed = true;
+    if (interest.m_ready_list_node.is_in_list())
+        m_ready_list.remove(interest);
+    if (auto it = m_interests.find({ interest.m_fd, &interest.observed_description() }); it != m_interests.end() && it->value.ptr() == &interest)
+        m_interests.remove(it);
+}
+
+ErrorOr<size_t> EPoll::collect_ready_events(Span<epoll_event> events)
+{
+    struct Candidate {
+        NonnullRefPtr<Interest> interest;
+        NonnullLockRefPtr<OpenFileDescription> description;
+        int fd;
+        u32 events;
+        u64 data;
+    };
+    Vector<Candidate, 16> candidates;
+    TRY(candidates.try_ensure_capacity(events.size()));
+
+    {
+        SpinlockLocker lock(m_lock);
+        while (candidates.size() < events.size()) {
+            auto interest = m_ready_list.take_first();
+            if (!interest)
+                break;
+            // NOTE: If the description is already on its way out, forget() will take care of the interest.
+            auto& description = interest->observed_description();
+            if (interest->m_removed || !description.try_ref())
+                continue;
+            auto interest_fd = interest->m_fd;
+            auto interest_events = interest->m_events;
+            auto interest_data = interest->m_data;
+            candidates.unchecked_append({ interest.release_nonnull(), adopt_lock_ref(description), interest_fd, interest_events, interest_data });
+        }
+    }
+
+    // NOTE: Readiness is checked without holding our lock, since File::can_read() and friends may take
+    //       locks of their own that are also held while they notify us.
+    size_t count = 0;
+    for (auto& candidate : candidates) {
+        // NOTE: The description stays open as long as it's referred to by another fd (from dup() or fork()), so the
+        //       fd it was added with may have been closed and reused for another file in the meantime. Its events
+        //       must not show up under that number, so they are skipped until the fd refers to it again.
+        auto current_description = Process::current().open_file_description(candidate.fd);
+        if (current_description.is_error() || current_description.value().ptr() != candidate.description.ptr())
+            continue;
+
+        auto unblocked_flags = candidate.description->should_unblock(block_flags_for(candidate.events));
+        auto ready_events = epoll_events_for(unblocked_flags) & (candidate.events | EPOLLERR | EPOLLHUP);
+        if (ready_events == 0)
+            continue;
+
+        events[count++] = { ready_events, { .u64 = candidate.data } };
+
+        SpinlockLocker lock(m_lock);
+        auto& interest = *candidate.interest;
+        if (interest.m_removed)
+            continue;
+        if (candidate.events & EPOLLONESHOT) {
+            interest.m_disarmed = true;
+        } else if (!(candidate.events & EPOLLET) && !interest.m_ready_list_node.is_in_list()) {
+            // Level-triggered interests stay on the ready list until a wait finds them not ready anymore.
+            m_ready_list.append(interest);
+        }
+    }
+    return count;
+}
+
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/AtomicRefCounted.h>
+#include <AK/HashMap.h>
+#include <AK/IntrusiveList.h>
+#include <AK/RefPtr.h>
+#include <Kernel/FileSystem/File.h>
+#include <Kernel/Forward.h>
+#include <Kernel/Locking/Spinlock.h>
+#include <Kernel/UnixTypes.h>
+
+namespace Kernel {
+
+// An EPoll holds a persistent set of file descriptions that a process is interested in.
+// Instead of rechecking every one of them on each wait like poll() does, it attaches a
+// FileReadinessObserver to each File and collects the ones that report a change in a
+// ready list, so that waiting only has to look at descriptions that might be ready.
+class EPoll final : public File {
+public:
+    static ErrorOr<NonnullLockRefPtr<EPoll>> try_create();
+    virtual ~EPoll() override;
+
+    virtual bool can_read(OpenFileDescription const&, u64) const override;
+    virtual ErrorOr<size_t> read(OpenFileDescription&, u64, UserOrKernelBuffer&, size_t) override { return EINVAL; }
+    virtual bool can_write(OpenFileDescription const&, u64) const override { return false; }
+    virtual ErrorOr<size_t> write(OpenFileDescription&, u64, UserOrKernelBuffer const&, size_t) override { return EINVAL; }
+
+    virtual ErrorOr<NonnullOwnPtr<KString>> pseudo_path(OpenFileDescription const&) const override;
+    virtual StringView class_name() const override { return "EPoll"sv; }
+    virtual bool is_epoll() const override { return true; }
+
+    ErrorOr<void> add_interest(int fd, OpenFileDescription&, epoll_event const&);
+    ErrorOr<void> modify_interest(int fd, OpenFileDescription&, epoll_event const&);
+    ErrorOr<void> remove_interest(int fd, OpenFileDescription&);
+
+    ErrorOr<size_t> collect_ready_events(Span<epoll_event>);
+
+private:
+    class Interest final
+        : public AtomicRefCounted<Interest>
+        , public FileReadinessObserver {
+    public:
+        Interest(EPoll&, int fd, OpenFileDescription&, epoll_event const&);
+
+        virtual void readiness_may_have_changed() override { m_epoll.enqueue_ready(*this); }
+        virtual void observed_description_will_be_destroyed() override { m_epoll.forget(*this); }
+
+    private:
+        friend class EPoll;
+
+        EPoll& m_epoll;
+        int m_fd { -1 };
+        // NOTE: This keeps the File and its FileBlockerSet alive until we've detached from it.
+        NonnullLockRefPtr<File> m_file;
+        u32 m_events { 0 };
+        u64 m_data { 0 };
+        bool m_disarmed { false };
+        bool m_removed { false };
+        IntrusiveListNode<Interest, RefPtr<Interest>> m_ready_list_node;
+    };
+
+    // Like on other systems, an interest belongs to a file descriptor number together with the description it
+    // referred to when it was added. So the same number can be added again once it refers to something else.
+    struct InterestKey {
+        int fd { -1 };
+        OpenFileDescription const* description { nullptr };
+
+        bool operator==(InterestKey const&) const = default;
+    };
+    struct InterestKeyTraits : public GenericTraits<InterestKey> {
+        static unsigned hash(InterestKey const& key) { return pair_int_hash(key.fd, ptr_hash(key.description)); }
+    };
+
+    EPoll() = default;
+
+    void enqueue_ready(Interest&);
+    void forget(Interest&);
+
+    mutable Spinlock<LockRank::None> m_lock {};
+    HashMap<InterestKey, NonnullRefPtr<Interest>, InterestKeyTraits> m_interests;
+    IntrusiveList<&Interest::m_ready_list_node> m_ready_list;
+};
+
+}
@@ -203,6 +203,9 @@ ErrorOr<void> Ext2FSInode::flush_block_list()
 {
     MutexLocker locker(m_inode_lock);
 
+    // The on-disk block map is about to change, so drop any extents we derived from it.
+    invalidate_block_extents();
+
     if (m_block_list.is_empty()) {
         m_raw_inode.i_blocks = 0;
         memset(m_raw_inode.i_block, 0, sizeof(m_raw_inode.i_block));
@@ -507,16 +510,156 @@ ErrorOr<void> Ext2FSInode::flush_metadata()
     return {};
 }
 
-ErrorOr<void> Ext2FSInode::compute_block_list_with_exclusive_locking()
+void Ext2FSInode::invalidate_block_extents()
+{
+    MutexLocker block_list_locker(m_block_list_lock);
+    m_block_extents.clear();
+}
+
+size_t Ext2FSInode::index_of_first_block_extent_after(u64 logical_block_index) const
+{
+    VERIFY(m_block_list_lock.is_locked());
+    size_t low = 0;
+    size_t high = m_block_extents.size();
+    while (low < high) {
+        auto middle = low + (high - low) / 2;
+        if (m_block_extents[middle].logical_start <= logical_block_index)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+Ext2FSInode::BlockExtent const* Ext2FSInode::find_block_extent(u64 logical_block_index) const
+{
+    auto index = index_of_first_block_extent_after(logical_block_index);
+    if (index == 0)
+        return nullptr;
+    auto const& extent = m_block_extents[index - 1];
+    if (logical_block_index >= extent.logical_end())
+        return nullptr;
+    return &extent;
+}
+
+ErrorOr<Ext2FSInode::BlockExtent> Ext2FSInode::block_extent_for(u64 logical_block_index) const
 {
-    // Note: We verify that the inode mutex is being held locked. Because only the read_bytes_locked()
-    // method uses this method and the mutex can be locked in shared mode when reading the Inode if
-    // it is an ext2 regular file, but also in exclusive mode, when the Inode is an ext2 directory and being
-    // traversed, we use another exclusive lock to ensure we always mutate the block list safely.
+    // Note: The inode mutex may only be held in shared mode here, so we rely on the
+    // separate block list mutex to mutate the extent map safely.
     VERIFY(m_inode_lock.is_locked());
     MutexLocker block_list_locker(m_block_list_lock);
-    if (m_block_list.is_empty())
-        m_block_list = TRY(compute_block_list());
+    if (auto const* extent = find_block_extent(logical_block_index))
+        return *extent;
+    TRY(populate_block_extents_covering(logical_block_index));
+    auto const* extent = find_block_extent(logical_block_index);
+    VERIFY(extent);
+    return *extent;
+}
+
+ErrorOr<BlockBasedFileSystem::BlockIndex> Ext2FSInode::read_block_pointer(BlockBasedFileSystem::BlockIndex array_block_index, u64 index_in_array) const
+{
+    if (array_block_index.value() == 0)
+        return BlockBasedFileSystem::BlockIndex { 0 };
+    u32 block_pointer = 0;
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(reinterpret_cast<u8*>(&block_pointer));
+    TRY(fs().read_block(array_block_index, &buffer, sizeof(block_pointer), index_in_array * sizeof(block_pointer)));
+    return BlockBasedFileSystem::BlockIndex { block_pointer };
+}
+
+ErrorOr<void> Ext2FSInode::populate_block_extents_covering(u64 logical_block_index) const
+{
+    VERIFY(m_block_list_lock.is_locked());
+    u64 const entries_per_block = EXT2_ADDR_PER_BLOCK(&fs().super_block());
+
+    if (logical_block_index < EXT2_NDIR_BLOCKS)
+        return insert_block_extents(0, { m_raw_inode.i_block, EXT2_NDIR_BLOCKS });
+
+    // Walk down the indirect block tree to the single array block that maps the requested
+    // block, reading only one pointer per level. If any level is missing, the whole range
+    // covered by that array block is a hole.
+    u64 first_logical_block_index = EXT2_NDIR_BLOCKS;
+    u64 relative_index = logical_block_index - EXT2_NDIR_BLOCKS;
+    BlockBasedFileSystem::BlockIndex array_block_index { 0 };
+
+    u64 const doubly_indirect_range = entries_per_block * entries_per_block;
+
+    if (relative_index < entries_per_block) {
+        array_block_index = m_raw_inode.i_block[EXT2_IND_BLOCK];
+    } else if (relative_index < entries_per_block + doubly_indirect_range) {
+        relative_index -= entries_per_block;
+        first_logical_block_index += entries_per_block;
+        auto index_in_doubly_indirect_block = relative_index / entries_per_block;
+        array_block_index = TRY(read_block_pointer(m_raw_inode.i_block[EXT2_DIND_BLOCK], index_in_doubly_indirect_block));
+        first_logical_block_index += index_in_doubly_indirect_block * entries_per_block;
+    } else {
+        relative_index -= entries_per_block + doubly_indirect_range;
+        first_logical_block_index += entries_per_block + doubly_indirect_range;
+        auto index_in_triply_indirect_block = relative_index / doubly_indirect_range;
+        if (index_in_triply_indirect_block >= entries_per_block)
+            return EINVAL;
+        auto index_in_doubly_indirect_block = (relative_index / entries_per_block) % entries_per_block;
+        auto doubly_indirect_block_index = TRY(read_block_pointer(m_raw_inode.i_block[EXT2_TIND_BLOCK], index_in_triply_indirect_block));
+        array_block_index = TRY(read_block_pointer(doubly_indirect_block_index, index_in_doubly_indirect_block));
+        first_logical_block_index += index_in_triply_indirect_block * doubly_indirect_range + index_in_doubly_indirect_block * entries_per_block;
+    }
+
+    if (array_block_index.value() == 0) {
+        // Everything this missing array block would have mapped is a hole.
+        BlockExtent hole { first_logical_block_index, 0, entries_per_block };
+        return insert_block_extents({ &hole, 1 });
+    }
+
+    auto array_storage = TRY(ByteBuffer::create_uninitialized(entries_per_block * sizeof(u32)));
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(array_storage.data());
+    TRY(fs().read_block(array_block_index, &buffer, array_storage.size()));
+    return insert_block_extents(first_logical_block_index, { reinterpret_cast<u32 const*>(array_storage.data()), entries_per_block });
+}
+
+static bool can_append_block_extent(auto const& extent, auto const& next)
+{
+    if (extent.logical_end() != next.logical_start || extent.is_hole() != next.is_hole())
+        return false;
+    return extent.is_hole() || extent.physical_start.value() + extent.length == next.physical_start.value();
+}
+
+ErrorOr<void> Ext2FSInode::insert_block_extents(u64 first_logical_block_index, Span<u32 const> block_pointers) const
+{
+    Vector<BlockExtent, 16> new_extents;
+    for (size_t i = 0; i < block_pointers.size(); ++i) {
+        BlockExtent extent { first_logical_block_index + i, block_pointers[i], 1 };
+        if (!new_extents.is_empty() && can_append_block_extent(new_extents.last(), extent)) {
+            ++new_extents.last().length;
+            continue;
+        }
+        TRY(new_extents.try_append(extent));
+    }
+    return insert_block_extents(new_extents.span());
+}
+
+ErrorOr<void> Ext2FSInode::insert_block_extents(Span<BlockExtent const> new_extents) const
+{
+    VERIFY(m_block_list_lock.is_locked());
+    VERIFY(!new_extents.is_empty());
+    auto first_logical_block_index = new_extents.first().logical_start;
+
+    // Find the first extent that starts after the new range, then coalesce with the
+    // neighbours on either side so physically contiguous files stay a single extent.
+    size_t insertion_index = index_of_first_block_extent_after(first_logical_block_index);
+
+    TRY(m_block_extents.try_ensure_capacity(m_block_extents.size() + new_extents.size()));
+
+    size_t first_new_extent = 0;
+    if (insertion_index > 0 && can_append_block_extent(m_block_extents[insertion_index - 1], new_extents.first())) {
+        m_block_extents[insertion_index - 1].length += new_extents.first().length;
+        first_new_extent = 1;
+    }
+    for (size_t i = first_new_extent; i < new_extents.size(); ++i)
+        MUST(m_block_extents.try_insert(insertion_index++, new_extents[i]));
+
+    if (insertion_index > 0 && insertion_index < m_block_extents.size() && can_append_block_extent(m_block_extents[insertion_index - 1], m_block_extents[insertion_index])) {
+        m_block_extents[insertion_index - 1].length += m_block_extents[insertion_index].length;
+        m_block_extents.remove(insertion_index);
+    }
     return {};
 }
 
@@ -539,46 +682,44 @@ ErrorOr<size_t> Ext2FSInode::read_bytes_locked(off_t offset, size_t count, UserO
         return nread;
     }
 
-    // Note: We bypass the const declaration of this method, but this is a strong
-    // requirement to be able to accomplish the read operation successfully.
-    // We call this special method because it locks a separate mutex to ensure we
-    // update the block list of the inode safely, as the m_inode_lock is locked in
-    // shared mode.
-    TRY(const_cast<Ext2FSInode&>(*this).compute_block_list_with_exclusive_locking());
-
-    if (m_block_list.is_empty()) {
-        dmesgln("Ext2FSInode[{}]::read_bytes(): Empty block list", identifier());
-        return EIO;
-    }
-
     bool allow_cache = !description || !description->is_direct();
 
-    int const block_size = fs().block_size();
-
-    BlockBasedFileSystem::BlockIndex first_block_logical_index = offset / block_size;
-    BlockBasedFileSystem::BlockIndex last_block_logical_index = (offset + count) / block_size;
-    if (last_block_logical_index >= m_block_list.size())
-        last_block_logical_index = m_block_list.size() - 1;
-
-    int offset_into_first_block = offset % block_size;
+    u64 const block_size = fs().block_size();
 
     size_t nread = 0;
-    auto remaining_count = min((off_t)count, (off_t)size() - offset);
+    u64 remaining_count = min((off_t)count, (off_t)size() - offset);
 
     dbgln_if(EXT2_VERY_DEBUG, "Ext2FSInode[{}]::read_bytes(): Reading up to {} bytes, {} bytes into inode to {}", identifier(), count, offset, buffer.user_or_kernel_ptr());
 
-    for (auto bi = first_block_logical_index; remaining_count && bi <= last_block_logical_index; bi = bi.value() + 1) {
-        auto block_index = m_block_list[bi.value()];
-        size_t offset_into_block = (bi == first_block_logical_index) ? offset_into_first_block : 0;
-        size_t num_bytes_to_copy = min((size_t)block_size - offset_into_block, (size_t)remaining_count);
+    while (remaining_count) {
+        u64 current_offset = offset + nread;
+        u64 logical_block_index = current_offset / block_size;
+        u64 offset_into_block = current_offset % block_size;
+        auto extent = TRY(block_extent_for(logical_block_index));
+        u64 bytes_left_in_extent = (extent.logical_end() - logical_block_index) * block_size - offset_into_block;
         auto buffer_offset = buffer.offset(nread);
-        if (block_index.value() == 0) {
+
+        size_t num_bytes_to_copy;
+        if (extent.is_hole()) {
             // This is a hole, act as if it's filled with zeroes.
+            num_bytes_to_copy = min(bytes_left_in_extent, remaining_count);
             TRY(buffer_offset.memset(0, num_bytes_to_copy));
         } else {
-            if (auto result = fs().read_block(block_index, &buffer_offset, num_bytes_to_copy, offset_into_block, allow_cache); result.is_error()) {
-                dmesgln("Ext2FSInode[{}]::read_bytes(): Failed to read block {} (index {})", identifier(), block_index.value(), bi);
-                return result.release_error();
+            BlockBasedFileSystem::BlockIndex block_index { extent.physical_start.value() + (logical_block_index - extent.logical_start) };
+            u64 whole_blocks = min(bytes_left_in_extent, remaining_count) / block_size;
+            if (offset_into_block == 0 && whole_blocks > 1) {
+                // The rest of this extent is contiguous on disk, so hand it off as a single request.
+                num_bytes_to_copy = whole_blocks * block_size;
+                if (auto result = fs().read_blocks(block_index, whole_blocks, buffer_offset, allow_cache); result.is_error()) {
+                    dmesgln("Ext2FSInode[{}]::read_bytes(): Failed to read {} blocks at {} (index {})", identifier(), whole_blocks, block_index.value(), logical_block_index);
+                    return result.release_error();
+                }
+            } else {
+                num_bytes_to_copy = min(block_size - offset_into_block, remaining_count);
+                if (auto result = fs().read_block(block_index, &buffer_offset, num_bytes_to_copy, offset_into_block, allow_cache); result.is_error()) {
+                    dmesgln("Ext2FSInode[{}]::read_bytes(): Failed to read block {} (index {})", identifier(), block_index.value(), logical_block_index);
+                    return result.release_error();
+                }
             }
         }
         remaining_count -= num_bytes_to_copy;
@@ -588,6 +729,34 @@ ErrorOr<size_t> Ext2FSInode::read_bytes_locked(off_t offset, size_t count, UserO
     return nread;
 }
 
+ErrorOr<void> Ext2FSInode::read_ahead_locked(off_t offset, size_t count) const
+{
+    VERIFY(m_inode_lock.is_locked());
+    VERIFY(offset >= 0);
+    if (count == 0 || static_cast<u64>(offset) >= size())
+        return {};
+
+    if (is_symlink() && size() < max_inline_symlink_length)
+        return {};
+
+    auto const block_size = fs().block_size();
+    auto end_offset = min(static_cast<u64>(offset) + count, size());
+    u64 first_block_logical_index = offset / block_size;
+    u64 last_block_logical_index = (end_offset - 1) / block_size;
+
+    dbgln_if(EXT2_VERY_DEBUG, "Ext2FSInode[{}]::read_ahead(): Reading blocks {} through {} into the cache", identifier(), first_block_logical_index, last_block_logical_index);
+
+    for (auto bi = first_block_logical_index; bi <= last_block_logical_index;) {
+        auto extent = TRY(block_extent_for(bi));
+        auto last_in_extent = min(extent.logical_end() - 1, last_block_logical_index);
+        // Holes don't need to be read.
+        if (!extent.is_hole())
+            TRY(fs().prefetch_blocks(extent.physical_start.value() + (bi - extent.logical_start), last_in_extent - bi + 1));
+        bi = last_in_extent + 1;
+    }
+    return {};
+}
+
 ErrorOr<void> Ext2FSInode::resize(u64 new_size)
 {
     auto old_size = size();
@@ -688,32 +857,38 @@ ErrorOr<size_t> Ext2FSInode::write_bytes_locked(off_t offset, size_t count, User
 
     TRY(resize(new_size));
 
-    if (m_block_list.is_empty())
-        m_block_list = TRY(compute_block_list());
-
-    if (m_block_list.is_empty()) {
-        dbgln("Ext2FSInode[{}]::write_bytes(): Empty block list", identifier());
-        return EIO;
-    }
-
-    BlockBasedFileSystem::BlockIndex first_block_logical_index = offset / block_size;
-    BlockBasedFileSystem::BlockIndex last_block_logical_index = (offset + count) / block_size;
-    if (last_block_logical_index >= m_block_list.size())
-        last_block_logical_index = m_block_list.size() - 1;
-
-    size_t offset_into_first_block = offset % block_size;
-
     size_t nwritten = 0;
-    auto remaining_count = min((off_t)count, (off_t)new_size - offset);
+    u64 remaining_count = min((off_t)count, (off_t)new_size - offset);
 
     dbgln_if(EXT2_VERY_DEBUG, "Ext2FSInode[{}]::write_bytes_locked(): Writing {} bytes, {} bytes into inode from {}", identifier(), count, offset, data.user_or_kernel_ptr());
 
-    for (auto bi = first_block_logical_index; remaining_count && bi <= last_block_logical_index; bi = bi.value() + 1) {
-        size_t offset_into_block = (bi == first_block_logical_index) ? offset_into_first_block : 0;
-        size_t num_bytes_to_copy = min((size_t)block_size - offset_into_block, (size_t)remaining_count);
-        dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::write_bytes_locked(): Writing block {} (offset_into_block: {})", identifier(), m_block_list[bi.value()], offset_into_block);
-        if (auto result = fs().write_block(m_block_list[bi.value()], data.offset(nwritten), num_bytes_to_copy, offset_into_block, allow_cache); result.is_error()) {
-            dbgln("Ext2FSInode[{}]::write_bytes_locked(): Failed to write block {} (index {})", identifier(), m_block_list[bi.value()], bi);
+    while (remaining_count) {
+        u64 current_offset = offset + nwritten;
+        u64 logical_block_index = current_offset / block_size;
+        size_t offset_into_block = current_offset % block_size;
+        auto extent = TRY(block_extent_for(logical_block_index));
+        if (extent.is_hole()) {
+            // FIXME: Allocate blocks for holes instead of refusing to write into them.
+            dbgln("Ext2FSInode[{}]::write_bytes_locked(): Block {} is a hole", identifier(), logical_block_index);
+            return EIO;
+        }
+        BlockBasedFileSystem::BlockIndex block_index { extent.physical_start.value() + (logical_block_index - extent.logical_start) };
+        u64 bytes_left_in_extent = (extent.logical_end() - logical_block_index) * block_size - offset_into_block;
+        u64 whole_blocks = min(bytes_left_in_extent, remaining_count) / block_size;
+
+        size_t num_bytes_to_copy;
+        ErrorOr<void> result;
+        if (offset_into_block == 0 && whole_blocks > 1) {
+            num_bytes_to_copy = whole_blocks * block_size;
+            dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::write_bytes_locked(): Writing {} blocks at {}", identifier(), whole_blocks, block_index);
+            result = fs().write_blocks(block_index, whole_blocks, data.offset(nwritten), allow_cache);
+        } else {
+            num_bytes_to_copy = min((size_t)block_size - offset_into_block, (size_t)remaining_count);
+            dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::write_bytes_locked(): Writing block {} (offset_into_block: {})", identifier(), block_index, offset_into_block);
+            result = fs().write_block(block_index, data.offset(nwritten), num_bytes_to_copy, offset_into_block, allow_cache);
+        }
+        if (result.is_error()) {
+            dbgln("Ext2FSInode[{}]::write_bytes_locked(): Failed to write block {} (index {})", identifier(), block_index, logical_block_index);
             return result.release_error();
         }
         remaining_count -= num_bytes_to_copy;
@@ -722,7 +897,7 @@ ErrorOr<size_t> Ext2FSInode::write_bytes_locked(off_t offset, size_t count, User
 
     did_modify_contents();
 
-    dbgln_if(EXT2_VERY_DEBUG, "Ext2FSInode[{}]::write_bytes_locked(): After write, i_size={}, i_blocks={} ({} blocks in list)", identifier(), size(), m_raw_inode.i_blocks, m_block_list.size());
+    dbgln_if(EXT2_VERY_DEBUG, "Ext2FSInode[{}]::write_bytes_locked(): After write, i_size={}, i_blocks={}", identifier(), size(), m_raw_inode.i_blocks);
     return nwritten;
 }
 
@@ -1072,13 +1247,13 @@ ErrorOr<int> Ext2FSInode::get_block_address(int index)
 {
     MutexLocker locker(m_inode_lock);
 
-    if (m_block_list.is_empty())
-        m_block_list = TRY(compute_block_list());
-
-    if (index < 0 || (size_t)index >= m_block_list.size())
+    if (index < 0 || static_cast<u64>(index) >= ceil_div(size(), static_cast<u64>(fs().block_size())))
         return 0;
 
-    return m_block_list[index].value();
+    auto extent = TRY(block_extent_for(index));
+    if (extent.is_hole())
+        return 0;
+    return extent.physical_start.value() + (index - extent.logical_start);
 }
 
 }
@@ -28,6 +28,7 @@ public:
 private:
     // ^Inode
     virtual ErrorOr<size_t> read_bytes_locked(off_t, size_t, UserOrKernelBuffer& buffer, OpenFileDescription*) const override;
+    virtual ErrorOr<void> read_ahead_locked(off_t, size_t) const override;
     virtual InodeMetadata metadata() const override;
     virtual ErrorOr<void> traverse_as_directory(Function<ErrorOr<void>(FileSystem::DirectoryEntryView const&)>) const override;
     virtual ErrorOr<NonnullLockRefPtr<Inode>> lookup(StringView name) override;
@@ -55,7 +56,26 @@ private:
     ErrorOr<void> shrink_triply_indirect_block(BlockBasedFileSystem::BlockIndex, size_t, size_t, unsigned&);
     ErrorOr<void> flush_block_list();
 
-    ErrorOr<void> compute_block_list_with_exclusive_locking();
+    // A run of logically consecutive blocks that are also physically consecutive on disk,
+    // or a run of holes if physical_start is zero.
+    struct BlockExtent {
+        u64 logical_start { 0 };
+        BlockBasedFileSystem::BlockIndex physical_start { 0 };
+        u64 length { 0 };
+
+        bool is_hole() const { return physical_start.value() == 0; }
+        u64 logical_end() const { return logical_start + length; }
+    };
+
+    ErrorOr<BlockExtent> block_extent_for(u64 logical_block_index) const;
+    size_t index_of_first_block_extent_after(u64 logical_block_index) const;
+    BlockExtent const* find_block_extent(u64 logical_block_index) const;
+    ErrorOr<void> populate_block_extents_covering(u64 logical_block_index) const;
+    ErrorOr<void> insert_block_extents(u64 first_logical_block_index, Span<u32 const> block_pointers) const;
+    ErrorOr<void> insert_block_extents(Span<BlockExtent const>) const;
+    ErrorOr<BlockBasedFileSystem::BlockIndex> read_block_pointer(BlockBasedFileSystem::BlockIndex array_block_index, u64 index_in_array) const;
+    void invalidate_block_extents();
+
     ErrorOr<Vector<BlockBasedFileSystem::BlockIndex>> compute_block_list() const;
     ErrorOr<Vector<BlockBasedFileSystem::BlockIndex>> compute_block_list_with_meta_blocks() const;
     ErrorOr<Vector<BlockBasedFileSystem::BlockIndex>> compute_block_list_impl(bool include_block_list_blocks) const;
@@ -65,11 +85,15 @@ private:
     Ext2FS const& fs() const;
     Ext2FSInode(Ext2FS&, InodeIndex);
 
+    // NOTE: The full block list is only materialized when the inode is resized. Reads and
+    //       in-place writes go through m_block_extents, which is populated lazily one
+    //       indirect block at a time as the file is accessed.
     Vector<BlockBasedFileSystem::BlockIndex> m_block_list;
+    mutable Vector<BlockExtent> m_block_extents;
     HashMap<NonnullOwnPtr<KString>, InodeIndex> m_lookup_cache;
     ext2_inode m_raw_inode {};
 
-    Mutex m_block_list_lock { "BlockList"sv };
+    mutable Mutex m_block_list_lock { "BlockList"sv };
 };
 
 inline Ext2FS& Ext2FSInode::fs()
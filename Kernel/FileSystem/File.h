@@ -8,6 +8,7 @@
 
 #include <AK/AtomicRefCounted.h>
 #include <AK/Error.h>
+#include <AK/IntrusiveList.h>
 #include <AK/StringView.h>
 #include <AK/Types.h>
 #include <Kernel/Forward.h>
@@ -21,10 +22,67 @@ namespace Kernel {
 
 class File;
 
+// Unlike a FileBlocker, which is only registered while its thread is blocked,
+// a FileReadinessObserver stays attached to a File until it is removed, and is
+// told about every change that might have made the observed description ready.
+class FileReadinessObserver {
+public:
+    virtual ~FileReadinessObserver() = default;
+
+    OpenFileDescription& observed_description() const { return m_description; }
+
+    // NOTE: These are called with the FileBlockerSet's lock held.
+    virtual void readiness_may_have_changed() = 0;
+    virtual void observed_description_will_be_destroyed() = 0;
+
+protected:
+    explicit FileReadinessObserver(OpenFileDescription& description)
+        : m_description(description)
+    {
+    }
+
+private:
+    friend class FileBlockerSet;
+
+    OpenFileDescription& m_description;
+    IntrusiveListNode<FileReadinessObserver> m_observer_list_node;
+};
+
 class FileBlockerSet final : public Thread::BlockerSet {
 public:
     FileBlockerSet() { }
 
+    virtual ~FileBlockerSet() override
+    {
+        VERIFY(m_observers.is_empty());
+    }
+
+    void add_observer(FileReadinessObserver& observer)
+    {
+        SpinlockLocker lock(m_lock);
+        m_observers.append(observer);
+    }
+
+    void remove_observer(FileReadinessObserver& observer)
+    {
+        SpinlockLocker lock(m_lock);
+        if (observer.m_observer_list_node.is_in_list())
+            m_observers.remove(observer);
+    }
+
+    void detach_observers_of(OpenFileDescription const& description)
+    {
+        SpinlockLocker lock(m_lock);
+        for (auto it = m_observers.begin(); it != m_observers.end();) {
+            auto& observer = *it;
+            ++it;
+            if (&observer.m_description != &description)
+                continue;
+            m_observers.remove(observer);
+            observer.observed_description_will_be_destroyed();
+        }
+    }
+
     virtual bool should_add_blocker(Thread::Blocker& b, void* data) override
     {
         VERIFY(b.blocker_type() == Thread::Blocker::Type::File);
@@ -40,7 +98,12 @@ public:
             auto& blocker = static_cast<Thread::FileBlocker&>(b);
             return blocker.unblock_if_conditions_are_met(false, data);
         });
+        for (auto& observer : m_observers)
+            observer.readiness_may_have_changed();
     }
+
+private:
+    IntrusiveList<&FileReadinessObserver::m_observer_list_node> m_observers;
 };
 
 // File is the base class for anything that can be referenced by a OpenFileDescription.
@@ -114,6 +177,8 @@ public:
     virtual bool is_character_device() const { return false; }
     virtual bool is_socket() const { return false; }
     virtual bool is_inode_watcher() const { return false; }
+    virtual bool is_epoll() const { return false; }
+    virtual bool is_io_ring() const { return false; }
 
     virtual bool is_regular_file() const { return false; }
 
@@ -33,6 +33,9 @@ public:
     virtual StringView class_name() const = 0;
     virtual Inode& root_inode() = 0;
     virtual bool supports_watchers() const { return false; }
+    // File systems that return true here must call Inode::did_add_child() and Inode::did_remove_child()
+    // whenever a directory changes, and must not have directory entries that change on their own.
+    virtual bool supports_dentry_cache() const { return false; }
 
     bool is_readonly() const { return m_readonly; }
 
@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Atomic.h>
+#include <AK/NumericLimits.h>
+#include <Kernel/FileSystem/IORing.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Net/Socket.h>
+#include <Kernel/Process.h>
+#include <Kernel/StdLib.h>
+#include <Kernel/Time/TimeManagement.h>
+
+namespace Kernel {
+
+static constexpr size_t submission_queue_offset = 64;
+static_assert(sizeof(IORingHeader) <= submission_queue_offset);
+
+static size_t completion_queue_offset(u32 submission_entries)
+{
+    return submission_queue_offset + submission_entries * sizeof(IORingSubmission);
+}
+
+static i32 completion_result_for(Error const& error)
+{
+    return -static_cast<i32>(error.code());
+}
+
+static i32 completion_result_for(AsyncDeviceRequest::RequestResult result, size_t size)
+{
+    switch (result) {
+    case AsyncDeviceRequest::Success:
+        return static_cast<i32>(size);
+    case AsyncDeviceRequest::MemoryFault:
+        return -EFAULT;
+    case AsyncDeviceRequest::OutOfMemory:
+        return -ENOMEM;
+    default:
+        return -EIO;
+    }
+}
+
+IORing::PendingOperation::PendingOperation(IORing& ring, IORingSubmission const& submission, NonnullLockRefPtr<OpenFileDescription> description)
+    : FileReadinessObserver(*description)
+    , m_ring(ring)
+    , m_submission(submission)
+    , m_description(move(description))
+{
+    m_description->blocker_set().add_observer(*this);
+}
+
+IORing::PendingOperation::~PendingOperation()
+{
+    m_description->blocker_set().remove_observer(*this);
+}
+
+ErrorOr<NonnullLockRefPtr<IORing>> IORing::try_create(Process& process, u32 requested_submission_entries)
+{
+    if (requested_submission_entries == 0 || requested_submission_entries > IO_RING_MAX_ENTRIES)
+        return EINVAL;
+    u32 submission_entries = 1;
+    while (submission_entries < requested_submission_entries)
+        submission_entries <<= 1;
+
+    auto size = TRY(Memory::page_round_up(completion_queue_offset(submission_entries) + 2 * submission_entries * sizeof(IORingCompletion)));
+
+    // Just like KCOV, the queues are backed by a single VMObject that is mapped once into
+    // the kernel, and then into the process whenever it mmap()s the ring.
+    auto vmobject = TRY(Memory::AnonymousVMObject::try_create_with_size(size, AllocationStrategy::AllocateNow));
+    auto region_name = TRY(KString::formatted("IORing ({})", process.pid()));
+    auto region = TRY(MM.allocate_kernel_region_with_vmobject(*vmobject, size, region_name->view(), Memory::Region::Access::ReadWrite));
+    return adopt_nonnull_lock_ref_or_enomem(new (nothrow) IORing(process, move(vmobject), move(region), submission_entries));
+}
+
+IORing::IORing(Process& process, NonnullLockRefPtr<Memory::AnonymousVMObject> vmobject, NonnullOwnPtr<Memory::Region> region, u32 submission_entries)
+    : m_owner_pid(process.pid())
+    , m_vmobject(move(vmobject))
+    , m_region(move(region))
+    , m_submission_entries(submission_entries)
+    , m_completion_entries(2 * submission_entries)
+{
+    auto& header = this->header();
+    header = {};
+    header.submission_mask = m_submission_entries - 1;
+    header.submission_entries_offset = submission_queue_offset;
+    header.completion_mask = m_completion_entries - 1;
+    header.completion_entries_offset = completion_queue_offset(m_submission_entries);
+}
+
+IORing::~IORing() = default;
+
+bool IORing::can_read(OpenFileDescription const&, u64) const
+{
+    SpinlockLocker lock(m_readiness_lock);
+    return m_pending_operations_may_be_ready;
+}
+
+ErrorOr<NonnullLockRefPtr<Memory::VMObject>> IORing::vmobject_for_mmap(Process&, Memory::VirtualRange const&, u64& offset, bool shared)
+{
+    // A private mapping would be a copy of the queues, which is of no use to anyone.
+    if (offset != 0 || !shared)
+        return EINVAL;
+    return m_vmobject;
+}
+
+ErrorOr<NonnullOwnPtr<KString>> IORing::pseudo_path(OpenFileDescription const&) const
+{
+    return KString::formatted("IORing:({})", m_submission_entries);
+}
+
+IORingSubmission const* IORing::submission_queue() const
+{
+    return reinterpret_cast<IORingSubmission const*>(m_region->vaddr().offset(submission_queue_offset).as_ptr());
+}
+
+IORingCompletion* IORing::completion_queue() const
+{
+    return reinterpret_cast<IORingCompletion*>(m_region->vaddr().offset(completion_queue_offset(m_submission_entries)).as_ptr());
+}
+
+u32 IORing::unreaped_completions() const
+{
+    auto head = AK::atomic_load(&header().completion_head, AK::memory_order_acquire);
+    // NOTE: A bogus head from userspace makes the queue look full, so we never overwrite unreaped entries.
+    return min(m_completion_tail - head, m_completion_entries);
+}
+
+bool IORing::has_room_for_another_operation() const
+{
+    // Every operation we take on is guaranteed a slot in the completion queue.
+    auto outstanding = m_pending_operations.size() + m_pending_timeouts.size() + m_in_flight_block_requests.size();
+    return unreaped_completions() + outstanding < m_completion_entries;
+}
+
+void IORing::post_completion(u64 user_data, i32 result)
+{
+    // NOTE: This can only fail if userspace moved the completion head backwards, in which case it gets to keep the pieces.
+    if (unreaped_completions() >= m_completion_entries) {
+        dbgln("IORing: Dropping completion for {:#x}, the completion queue is full", user_data);
+        return;
+    }
+    completion_queue()[m_completion_tail & (m_completion_entries - 1)] = { user_data, result, 0 };
+    ++m_completion_tail;
+    AK::atomic_store(&header().completion_tail, m_completion_tail, AK::memory_order_release);
+}
+
+void IORing::pending_operation_may_be_ready()
+{
+    {
+        SpinlockLocker lock(m_readiness_lock);
+        m_pending_operations_may_be_ready = true;
+    }
+    evaluate_block_conditions();
+}
+
+ErrorOr<size_t> IORing::enter(OpenFileDescription& ring_description, u32 to_submit, u32 min_complete)
+{
+    // NOTE: Buffers are interpreted in the address space of the caller, so only the process
+    //       that created the ring may drive it, even if the fd was inherited by someone else.
+    if (Process::current().pid() != m_owner_pid)
+        return EPERM;
+    if (min_complete > m_completion_entries)
+        return EINVAL;
+
+    MutexLocker locker(m_enter_lock);
+
+    // Anything that finished since the last call might make room for new submissions.
+    MUST(reap_block_requests(false));
+    retry_pending_operations();
+
+    auto submission_tail = AK::atomic_load(&header().submission_tail, AK::memory_order_acquire);
+    to_submit = min(to_submit, min(submission_tail - m_submission_head, m_submission_entries));
+
+    size_t submitted = 0;
+    while (submitted < to_submit && has_room_for_another_operation()) {
+        // NOTE: Copy the entry out first, userspace could change it while we're looking at it.
+        IORingSubmission submission;
+        __builtin_memcpy(&submission, &submission_queue()[m_submission_head & (m_submission_entries - 1)], sizeof(submission));
+        ++m_submission_head;
+        AK::atomic_store(&header().submission_head, m_submission_head, AK::memory_order_release);
+        submit(submission);
+        ++submitted;
+    }
+    if (submitted == 0 && to_submit > 0)
+        return EBUSY;
+
+    while (unreaped_completions() < min_complete) {
+        if (!m_in_flight_block_requests.is_empty()) {
+            if (auto result = reap_block_requests(true); result.is_error()) {
+                if (submitted > 0)
+                    break;
+                return result.release_error();
+            }
+            continue;
+        }
+        // Nothing that's left could ever complete.
+        if (m_pending_operations.is_empty() && m_pending_timeouts.is_empty())
+            break;
+
+        // The ring is readable while one of the parked operations might be ready.
+        Thread::BlockTimeout timeout;
+        if (auto deadline = earliest_pending_deadline(); deadline.has_value())
+            timeout = Thread::BlockTimeout(true, &deadline.value());
+        auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+        if (Thread::current()->block<Thread::ReadBlocker>(timeout, ring_description, unblock_flags).was_interrupted()) {
+            if (submitted > 0)
+                break;
+            return EINTR;
+        }
+        retry_pending_operations();
+    }
+
+    MUST(reap_block_requests(false));
+    return submitted;
+}
+
+void IORing::submit(IORingSubmission const& submission)
+{
+    switch (submission.opcode) {
+    case IORingOpcode::Nop:
+        post_completion(submission.user_data, 0);
+        return;
+    case IORingOpcode::Timeout: {
+        Userspace<timespec const*> user_timeout(static_cast<FlatPtr>(submission.address));
+        auto timeout_or_error = copy_time_from_user(user_timeout);
+        if (timeout_or_error.is_error()) {
+            post_completion(submission.user_data, completion_result_for(timeout_or_error.error()));
+            return;
+        }
+        auto deadline = TimeManagement::the().monotonic_time() + timeout_or_error.value();
+        if (auto result = m_pending_timeouts.try_append({ submission.user_data, deadline }); result.is_error())
+            post_completion(submission.user_data, completion_result_for(result.error()));
+        return;
+    }
+    default:
+        break;
+    }
+
+    auto description_or_error = Process::current().open_file_description(submission.fd);
+    if (description_or_error.is_error()) {
+        post_completion(submission.user_data, completion_result_for(description_or_error.error()));
+        return;
+    }
+    auto description = description_or_error.release_value();
+
+    if (submission.opcode == IORingOpcode::Read || submission.opcode == IORingOpcode::Write) {
+        auto started_or_error = try_start_block_request(submission, *description);
+        if (started_or_error.is_error()) {
+            post_completion(submission.user_data, completion_result_for(started_or_error.error()));
+            return;
+        }
+        if (started_or_error.value())
+            return;
+    }
+
+    i32 result = 0;
+    if (execute(submission, *description, result) == ExecutionResult::Completed) {
+        post_completion(submission.user_data, result);
+        return;
+    }
+    if (!description->is_blocking()) {
+        post_completion(submission.user_data, -EAGAIN);
+        return;
+    }
+
+    auto operation = adopt_own_if_nonnull(new (nothrow) PendingOperation(*this, submission, move(description)));
+    if (!operation || m_pending_operations.try_append(operation.release_nonnull()).is_error()) {
+        post_completion(submission.user_data, -ENOMEM);
+        return;
+    }
+    // It might have become ready before we started watching it.
+    SpinlockLocker lock(m_readiness_lock);
+    m_pending_operations_may_be_ready = true;
+}
+
+auto IORing::execute(IORingSubmission const& submission, OpenFileDescription& description, i32& result) -> ExecutionResult
+{
+    switch (submission.opcode) {
+    case IORingOpcode::Read:
+    case IORingOpcode::Write: {
+        bool is_ready = submission.opcode == IORingOpcode::Read ? description.can_read() : description.can_write();
+        if (!is_ready)
+            return ExecutionResult::WouldBlock;
+        auto nio_or_error = execute_read_or_write(submission, description);
+        result = nio_or_error.is_error() ? completion_result_for(nio_or_error.error()) : static_cast<i32>(nio_or_error.value());
+        return ExecutionResult::Completed;
+    }
+    case IORingOpcode::Fsync: {
+        auto sync_result = description.sync();
+        result = sync_result.is_error() ? completion_result_for(sync_result.error()) : 0;
+        return ExecutionResult::Completed;
+    }
+    case IORingOpcode::Accept: {
+        auto fd_or_error = execute_accept(submission, description);
+        if (fd_or_error.is_error() && fd_or_error.error().code() == EAGAIN)
+            return ExecutionResult::WouldBlock;
+        result = fd_or_error.is_error() ? completion_result_for(fd_or_error.error()) : static_cast<i32>(fd_or_error.value());
+        return ExecutionResult::Completed;
+    }
+    default:
+        result = -EINVAL;
+        return ExecutionResult::Completed;
+    }
+}
+
+ErrorOr<size_t> IORing::execute_read_or_write(IORingSubmission const& submission, OpenFileDescription& description)
+{
+    if (submission.length > NumericLimits<i32>::max())
+        return EINVAL;
+    if (submission.offset >= 0 && !description.file().is_seekable())
+        return ESPIPE;
+    auto buffer = TRY(UserOrKernelBuffer::for_user_buffer(bit_cast<u8*>(static_cast<FlatPtr>(submission.address)), submission.length));
+
+    if (submission.opcode == IORingOpcode::Read) {
+        if (!description.is_readable())
+            return EBADF;
+        if (description.is_directory())
+            return EISDIR;
+        if (submission.offset >= 0)
+            return description.read(buffer, submission.offset, submission.length);
+        return description.read(buffer, submission.length);
+    }
+
+    if (!description.is_writable())
+        return EBADF;
+    if (submission.offset >= 0)
+        return description.write(submission.offset, buffer, submission.length);
+    return description.write(buffer, submission.length);
+}
+
+ErrorOr<FlatPtr> IORing::execute_accept(IORingSubmission const& submission, OpenFileDescription& description)
+{
+    if (!description.is_socket())
+        return ENOTSOCK;
+    if (submission.operation_flags & ~(SOCK_NONBLOCK | SOCK_CLOEXEC))
+        return EINVAL;
+    auto& process = Process::current();
+    TRY(process.require_promise(Pledge::accept));
+
+    // NOTE: The fd is allocated first, so a connection is never taken off the queue just to be dropped.
+    Process::ScopedDescriptionAllocation fd_allocation;
+    TRY(process.fds().with_exclusive([&](auto& fds) -> ErrorOr<void> {
+        fd_allocation = TRY(fds.allocate());
+        return {};
+    }));
+
+    auto accepted_socket = description.socket()->accept();
+    if (!accepted_socket)
+        return EAGAIN;
+
+    if (submission.address) {
+        sockaddr_un address_buffer {};
+        socklen_t address_size = min(sizeof(sockaddr_un), static_cast<size_t>(submission.length));
+        accepted_socket->get_peer_address((sockaddr*)&address_buffer, &address_size);
+        TRY(copy_to_user(bit_cast<u8*>(static_cast<FlatPtr>(submission.address)), &address_buffer, address_size));
+    }
+
+    auto accepted_socket_description = TRY(OpenFileDescription::try_create(*accepted_socket));
+    accepted_socket_description->set_readable(true);
+    accepted_socket_description->set_writable(true);
+    if (submission.operation_flags & SOCK_NONBLOCK)
+        accepted_socket_description->set_blocking(false);
+    int fd_flags = 0;
+    if (submission.operation_flags & SOCK_CLOEXEC)
+        fd_flags |= FD_CLOEXEC;
+
+    TRY(process.fds().with_exclusive([&](auto& fds) -> ErrorOr<void> {
+        fds[fd_allocation.fd].set(move(accepted_socket_description), fd_flags);
+        return {};
+    }));
+
+    // NOTE: Moving this state to Completed is what causes connect() to unblock on the client side.
+    accepted_socket->set_setup_state(Socket::SetupState::Completed);
+    return fd_allocation.fd;
+}
+
+ErrorOr<bool> IORing::try_start_block_request(IORingSubmission const& submission, OpenFileDescription& description)
+{
+    if (submission.offset < 0 || submission.length == 0 || !description.file().is_block_device())
+        return false;
+    auto& device = static_cast<BlockDevice&>(description.file());
+    // Anything that doesn't cover whole blocks goes through the regular read()/write() path.
+    if ((static_cast<u64>(submission.offset) | submission.length) & (device.block_size() - 1))
+        return false;
+
+    bool is_read = submission.opcode == IORingOpcode::Read;
+    if (is_read ? !description.is_readable() : !description.is_writable())
+        return EBADF;
+
+    // Just like read() and write(), long transfers are cut short to what the device takes in a single request.
+    size_t block_count = min<size_t>(submission.length >> device.block_size_log(), device.max_blocks_per_request());
+    size_t size = block_count << device.block_size_log();
+    auto buffer = TRY(UserOrKernelBuffer::for_user_buffer(bit_cast<u8*>(static_cast<FlatPtr>(submission.address)), size));
+
+    TRY(m_in_flight_block_requests.try_ensure_capacity(m_in_flight_block_requests.size() + 1));
+    auto request = TRY(device.try_make_request<AsyncBlockDeviceRequest>(is_read ? AsyncBlockDeviceRequest::Read : AsyncBlockDeviceRequest::Write,
+        static_cast<u64>(submission.offset) >> device.block_size_log(), block_count, buffer, size));
+    m_in_flight_block_requests.unchecked_append({ move(request), submission.user_data, size });
+    return true;
+}
+
+ErrorOr<void> IORing::reap_block_requests(bool wait_for_completion)
+{
+    if (!wait_for_completion) {
+        m_in_flight_block_requests.remove_all_matching([&](auto& in_flight) {
+            if (!in_flight.request->is_completed())
+                return false;
+            post_completion(in_flight.user_data, completion_result_for(in_flight.request->wait().request_result(), in_flight.size));
+            return true;
+        });
+        return {};
+    }
+
+    while (!m_in_flight_block_requests.is_empty()) {
+        auto& in_flight = m_in_flight_block_requests.first();
+        auto result = in_flight.request->wait();
+        // NOTE: The request is still in flight, so we'll pick it up again next time.
+        if (result.wait_result().was_interrupted())
+            return EINTR;
+        post_completion(in_flight.user_data, completion_result_for(result.request_result(), in_flight.size));
+        m_in_flight_block_requests.remove(0);
+    }
+    return {};
+}
+
+void IORing::retry_pending_operations()
+{
+    {
+        SpinlockLocker lock(m_readiness_lock);
+        m_pending_operations_may_be_ready = false;
+    }
+
+    if (!m_pending_timeouts.is_empty()) {
+        auto now = TimeManagement::the().monotonic_time();
+        m_pending_timeouts.remove_all_matching([&](auto& timeout) {
+            if (timeout.deadline > now)
+                return false;
+            post_completion(timeout.user_data, -ETIMEDOUT);
+            return true;
+        });
+    }
+
+    for (size_t i = 0; i < m_pending_operations.size();) {
+        auto& operation = *m_pending_operations[i];
+        i32 result = 0;
+        if (execute(operation.m_submission, *operation.m_description, result) == ExecutionResult::WouldBlock) {
+            ++i;
+            continue;
+        }
+        post_completion(operation.m_submission.user_data, result);
+        m_pending_operations.remove(i);
+    }
+}
+
+Optional<Time> IORing::earliest_pending_deadline() const
+{
+    Optional<Time> earliest;
+    for (auto& timeout : m_pending_timeouts) {
+        if (!earliest.has_value() || timeout.deadline < earliest.value())
+            earliest = timeout.deadline;
+    }
+    return earliest;
+}
+
+}
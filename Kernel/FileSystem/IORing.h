@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Vector.h>
+#include <Kernel/API/IORing.h>
+#include <Kernel/Devices/BlockDevice.h>
+#include <Kernel/FileSystem/File.h>
+#include <Kernel/Forward.h>
+#include <Kernel/Locking/Mutex.h>
+#include <Kernel/Locking/Spinlock.h>
+#include <Kernel/Memory/AnonymousVMObject.h>
+#include <Kernel/Memory/Region.h>
+
+namespace Kernel {
+
+// An IORing lets a process batch many I/O operations into a single io_ring_enter() call.
+// Its submission and completion queues are shared with the process through an mmap()ed
+// AnonymousVMObject, see Kernel/API/IORing.h for the layout.
+//
+// Operations are carried out in the context of the thread that calls io_ring_enter(), since
+// that's the address space their buffers live in:
+// - Block device reads and writes of whole blocks are started as AsyncBlockDeviceRequests
+//   for the whole batch before any of them is waited for, so the device sees all of them at once.
+// - Operations that would block, like reading from an empty pipe or accepting on a socket without
+//   pending connections, are parked and retried once their File reports a change in readiness.
+// - Everything else is performed right away.
+class IORing final : public File {
+public:
+    static ErrorOr<NonnullLockRefPtr<IORing>> try_create(Process&, u32 submission_entries);
+    virtual ~IORing() override;
+
+    virtual bool can_read(OpenFileDescription const&, u64) const override;
+    virtual ErrorOr<size_t> read(OpenFileDescription&, u64, UserOrKernelBuffer&, size_t) override { return EINVAL; }
+    virtual bool can_write(OpenFileDescription const&, u64) const override { return false; }
+    virtual ErrorOr<size_t> write(OpenFileDescription&, u64, UserOrKernelBuffer const&, size_t) override { return EINVAL; }
+    virtual ErrorOr<NonnullLockRefPtr<Memory::VMObject>> vmobject_for_mmap(Process&, Memory::VirtualRange const&, u64& offset, bool shared) override;
+
+    virtual ErrorOr<NonnullOwnPtr<KString>> pseudo_path(OpenFileDescription const&) const override;
+    virtual StringView class_name() const override { return "IORing"sv; }
+    virtual bool is_io_ring() const override { return true; }
+
+    u32 submission_entries() const { return m_submission_entries; }
+    u32 completion_entries() const { return m_completion_entries; }
+    size_t mapping_size() const { return m_region->size(); }
+
+    ErrorOr<size_t> enter(OpenFileDescription& ring_description, u32 to_submit, u32 min_complete);
+
+private:
+    // A parked operation waits for its File to become ready.
+    class PendingOperation final : public FileReadinessObserver {
+    public:
+        PendingOperation(IORing&, IORingSubmission const&, NonnullLockRefPtr<OpenFileDescription>);
+        virtual ~PendingOperation() override;
+
+        virtual void readiness_may_have_changed() override { m_ring.pending_operation_may_be_ready(); }
+        // NOTE: We keep a reference to the description, so it can't go away while we're watching it.
+        virtual void observed_description_will_be_destroyed() override { }
+
+    private:
+        friend class IORing;
+
+        IORing& m_ring;
+        IORingSubmission m_submission;
+        NonnullLockRefPtr<OpenFileDescription> m_description;
+    };
+
+    struct PendingTimeout {
+        u64 user_data;
+        Time deadline;
+    };
+
+    struct InFlightBlockRequest {
+        NonnullLockRefPtr<AsyncBlockDeviceRequest> request;
+        u64 user_data;
+        size_t size;
+    };
+
+    enum class ExecutionResult {
+        Completed,
+        WouldBlock,
+    };
+
+    IORing(Process&, NonnullLockRefPtr<Memory::AnonymousVMObject>, NonnullOwnPtr<Memory::Region>, u32 submission_entries);
+
+    IORingHeader& header() const { return *reinterpret_cast<IORingHeader*>(m_region->vaddr().as_ptr()); }
+    IORingSubmission const* submission_queue() const;
+    IORingCompletion* completion_queue() const;
+
+    u32 unreaped_completions() const;
+    bool has_room_for_another_operation() const;
+    void post_completion(u64 user_data, i32 result);
+
+    void submit(IORingSubmission const&);
+    ExecutionResult execute(IORingSubmission const&, OpenFileDescription&, i32& result);
+    ErrorOr<size_t> execute_read_or_write(IORingSubmission const&, OpenFileDescription&);
+    ErrorOr<FlatPtr> execute_accept(IORingSubmission const&, OpenFileDescription&);
+    ErrorOr<bool> try_start_block_request(IORingSubmission const&, OpenFileDescription&);
+
+    ErrorOr<void> reap_block_requests(bool wait_for_completion);
+    void retry_pending_operations();
+    Optional<Time> earliest_pending_deadline() const;
+
+    void pending_operation_may_be_ready();
+
+    ProcessID m_owner_pid;
+    NonnullLockRefPtr<Memory::AnonymousVMObject> m_vmobject;
+    NonnullOwnPtr<Memory::Region> m_region;
+    u32 m_submission_entries { 0 };
+    u32 m_completion_entries { 0 };
+
+    // NOTE: These are our own copies of the counters that belong to us, the ones in the
+    //       shared header are only ever written, since userspace could scribble over them.
+    u32 m_submission_head { 0 };
+    u32 m_completion_tail { 0 };
+
+    // Serializes calls to enter(), and protects everything below.
+    Mutex m_enter_lock { "IORing"sv };
+    Vector<NonnullOwnPtr<PendingOperation>> m_pending_operations;
+    Vector<PendingTimeout> m_pending_timeouts;
+    Vector<InFlightBlockRequest> m_in_flight_block_requests;
+
+    mutable Spinlock<LockRank::None> m_readiness_lock {};
+    bool m_pending_operations_may_be_ready { false };
+};
+
+}
@@ -33,6 +33,8 @@ public:
 
     virtual ~ISO9660FS() override;
     virtual StringView class_name() const override { return "ISO9660FS"sv; }
+    // NOTE: This file system is read-only, so its directories never change.
+    virtual bool supports_dentry_cache() const override { return true; }
     virtual Inode& root_inode() override;
 
     virtual unsigned total_block_count() const override;
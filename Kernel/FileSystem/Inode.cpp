@@ -10,6 +10,7 @@
 #include <AK/StringView.h>
 #include <Kernel/API/InodeWatcherEvent.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DentryCache.h>
 #include <Kernel/FileSystem/Inode.h>
 #include <Kernel/FileSystem/InodeWatcher.h>
 #include <Kernel/FileSystem/OpenFileDescription.h>
@@ -19,6 +20,7 @@
 #include <Kernel/Memory/SharedInodeVMObject.h>
 #include <Kernel/Net/LocalSocket.h>
 #include <Kernel/Process.h>
+#include <Kernel/WorkQueue.h>
 
 namespace Kernel {
 
@@ -119,6 +121,16 @@ ErrorOr<size_t> Inode::read_bytes(off_t offset, size_t length, UserOrKernelBuffe
     return read_bytes_locked(offset, length, buffer, open_description);
 }
 
+void Inode::read_ahead(off_t offset, size_t length)
+{
+    // NOTE: Read-ahead is only a hint, so we don't care if we can't queue it.
+    (void)g_read_ahead_work->try_queue([inode = NonnullLockRefPtr<Inode>(*this), offset, length] {
+        MutexLocker locker(inode->m_inode_lock, Mutex::Mode::Shared);
+        if (auto result = inode->read_ahead_locked(offset, length); result.is_error())
+            dbgln("Inode[{}]::read_ahead(): Failed to read ahead {} bytes at offset {}: {}", inode->identifier(), length, offset, result.error());
+    });
+}
+
 ErrorOr<void> Inode::update_timestamps([[maybe_unused]] Optional<Time> atime, [[maybe_unused]] Optional<Time> ctime, [[maybe_unused]] Optional<Time> mtime)
 {
     return ENOTIMPL;
@@ -217,6 +229,9 @@ void Inode::set_metadata_dirty(bool metadata_dirty)
 
 void Inode::did_add_child(InodeIdentifier, StringView name)
 {
+    if (fs().supports_dentry_cache())
+        DentryCache::invalidate(identifier(), name);
+
     m_watchers.for_each([&](auto& watcher) {
         watcher->notify_inode_event({}, identifier(), InodeWatcherEvent::Type::ChildCreated, name);
     });
@@ -224,6 +239,9 @@ void Inode::did_add_child(InodeIdentifier, StringView name)
 
 void Inode::did_remove_child(InodeIdentifier, StringView name)
 {
+    if (fs().supports_dentry_cache())
+        DentryCache::invalidate(identifier(), name);
+
     if (name == "." || name == "..") {
         // These are just aliases and are not interesting to userspace.
         return;
@@ -34,6 +34,8 @@ ErrorOr<size_t> InodeFile::read(OpenFileDescription& description, u64 offset, Us
         Thread::current()->did_file_read(nread);
         evaluate_block_conditions();
     }
+    if (auto read_ahead = description.did_read(offset, nread); read_ahead.has_value() && read_ahead->offset < m_inode->size())
+        m_inode->read_ahead(read_ahead->offset, read_ahead->length);
     return nread;
 }
 
@@ -9,7 +9,9 @@
 #include <Kernel/API/POSIX/errno.h>
 #include <Kernel/Devices/BlockDevice.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/EPoll.h>
 #include <Kernel/FileSystem/FIFO.h>
+#include <Kernel/FileSystem/IORing.h>
 #include <Kernel/FileSystem/InodeFile.h>
 #include <Kernel/FileSystem/InodeWatcher.h>
 #include <Kernel/FileSystem/OpenFileDescription.h>
@@ -52,6 +54,7 @@ OpenFileDescription::OpenFileDescription(File& file)
 
 OpenFileDescription::~OpenFileDescription()
 {
+    m_file->blocker_set().detach_observers_of(*this);
     m_file->detach(*this);
     if (is_fifo())
         static_cast<FIFO*>(m_file.ptr())->detach(fifo_direction());
@@ -323,6 +326,30 @@ InodeWatcher* OpenFileDescription::inode_watcher()
     return static_cast<InodeWatcher*>(m_file.ptr());
 }
 
+bool OpenFileDescription::is_epoll() const
+{
+    return m_file->is_epoll();
+}
+
+EPoll* OpenFileDescription::epoll()
+{
+    if (!is_epoll())
+        return nullptr;
+    return static_cast<EPoll*>(m_file.ptr());
+}
+
+bool OpenFileDescription::is_io_ring() const
+{
+    return m_file->is_io_ring();
+}
+
+IORing* OpenFileDescription::io_ring()
+{
+    if (!is_io_ring())
+        return nullptr;
+    return static_cast<IORing*>(m_file.ptr());
+}
+
 bool OpenFileDescription::is_master_pty() const
 {
     return m_file->is_master_pty();
@@ -489,6 +516,62 @@ bool OpenFileDescription::is_direct() const
     return m_state.with([](auto& state) { return state.direct; });
 }
 
+OpenFileDescription::AccessPattern OpenFileDescription::access_pattern() const
+{
+    return m_state.with([](auto& state) { return state.access_pattern; });
+}
+
+void OpenFileDescription::set_access_pattern(AccessPattern access_pattern)
+{
+    m_state.with([&](auto& state) {
+        state.access_pattern = access_pattern;
+        state.read_ahead_window = 0;
+        state.read_ahead_end = 0;
+    });
+}
+
+Optional<OpenFileDescription::ReadAheadRange> OpenFileDescription::did_read(u64 offset, size_t nread)
+{
+    static constexpr size_t initial_read_ahead_window = 16 * KiB;
+    static constexpr size_t maximum_read_ahead_window = 128 * KiB;
+    static constexpr size_t initial_sequential_read_ahead_window = 128 * KiB;
+    static constexpr size_t maximum_sequential_read_ahead_window = 1 * MiB;
+
+    return m_state.with([&](auto& state) -> Optional<ReadAheadRange> {
+        if (state.access_pattern == AccessPattern::Random || state.direct || nread == 0)
+            return {};
+
+        bool is_sequential = offset == state.next_sequential_read_offset;
+        state.next_sequential_read_offset = offset + nread;
+        if (!is_sequential) {
+            // Start over, we'll ramp up again once the reader settles into a sequential pattern.
+            state.read_ahead_window = 0;
+            state.read_ahead_end = 0;
+            return {};
+        }
+
+        bool advised_sequential = state.access_pattern == AccessPattern::Sequential;
+        auto initial_window = advised_sequential ? initial_sequential_read_ahead_window : initial_read_ahead_window;
+        auto maximum_window = advised_sequential ? maximum_sequential_read_ahead_window : maximum_read_ahead_window;
+        if (state.read_ahead_window == 0)
+            state.read_ahead_window = initial_window;
+
+        // Only kick off more read-ahead once the reader has consumed half of the previous window.
+        auto next_offset = state.next_sequential_read_offset;
+        if (state.read_ahead_end > next_offset + state.read_ahead_window / 2)
+            return {};
+
+        // The previous read-ahead has paid off, so the next one can be larger.
+        if (state.read_ahead_end != 0)
+            state.read_ahead_window = min(state.read_ahead_window * 2, maximum_window);
+
+        auto start = max(next_offset, state.read_ahead_end);
+        auto end = next_offset + state.read_ahead_window;
+        state.read_ahead_end = end;
+        return ReadAheadRange { start, static_cast<size_t>(end - start) };
+    });
+}
+
 bool OpenFileDescription::is_directory() const
 {
     return m_state.with([](auto& state) { return state.is_directory; });
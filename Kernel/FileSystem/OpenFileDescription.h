@@ -26,6 +26,17 @@ public:
 
 class OpenFileDescription final : public AtomicRefCounted<OpenFileDescription> {
 public:
+    enum class AccessPattern : u8 {
+        Normal,
+        Sequential,
+        Random,
+    };
+
+    struct ReadAheadRange {
+        u64 offset { 0 };
+        size_t length { 0 };
+    };
+
     static ErrorOr<NonnullLockRefPtr<OpenFileDescription>> try_create(Custody&);
     static ErrorOr<NonnullLockRefPtr<OpenFileDescription>> try_create(File&);
     ~OpenFileDescription();
@@ -65,6 +76,12 @@ public:
 
     bool is_direct() const;
 
+    AccessPattern access_pattern() const;
+    void set_access_pattern(AccessPattern);
+
+    // Tracks sequential reads, and returns the range that should be read ahead, if any.
+    Optional<ReadAheadRange> did_read(u64 offset, size_t nread);
+
     bool is_directory() const;
 
     File& file() { return *m_file; }
@@ -82,6 +99,12 @@ public:
     InodeWatcher const* inode_watcher() const;
     InodeWatcher* inode_watcher();
 
+    bool is_epoll() const;
+    EPoll* epoll();
+
+    bool is_io_ring() const;
+    IORing* io_ring();
+
     bool is_master_pty() const;
     MasterPTY const* master_pty() const;
     MasterPTY* master_pty();
@@ -155,6 +178,10 @@ private:
         bool should_append : 1 { false };
         bool direct : 1 { false };
         FIFO::Direction fifo_direction : 2 { FIFO::Direction::Neither };
+        AccessPattern access_pattern : 2 { AccessPattern::Normal };
+        u64 next_sequential_read_offset { 0 };
+        u64 read_ahead_end { 0 };
+        size_t read_ahead_window { 0 };
     };
 
     SpinlockProtected<State, LockRank::None> m_state {};
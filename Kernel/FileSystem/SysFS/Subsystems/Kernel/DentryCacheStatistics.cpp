@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/JsonObjectSerializer.h>
+#include <Kernel/FileSystem/DentryCache.h>
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/DentryCacheStatistics.h>
+#include <Kernel/Sections.h>
+
+namespace Kernel {
+
+UNMAP_AFTER_INIT SysFSDentryCacheStatistics::SysFSDentryCacheStatistics(SysFSDirectory const& parent_directory)
+    : SysFSGlobalInformation(parent_directory)
+{
+}
+
+UNMAP_AFTER_INIT NonnullLockRefPtr<SysFSDentryCacheStatistics> SysFSDentryCacheStatistics::must_create(SysFSDirectory const& parent_directory)
+{
+    return adopt_lock_ref_if_nonnull(new (nothrow) SysFSDentryCacheStatistics(parent_directory)).release_nonnull();
+}
+
+ErrorOr<void> SysFSDentryCacheStatistics::try_generate(KBufferBuilder& builder)
+{
+    auto statistics = DentryCache::statistics();
+    auto all_hits = statistics.hits + statistics.negative_hits;
+    auto lookups = all_hits + statistics.misses;
+    auto json = TRY(JsonObjectSerializer<>::try_create(builder));
+    TRY(json.add("hits"sv, statistics.hits));
+    TRY(json.add("negative_hits"sv, statistics.negative_hits));
+    TRY(json.add("misses"sv, statistics.misses));
+    TRY(json.add("hit_rate_percent"sv, lookups ? all_hits * 100 / lookups : 0));
+    TRY(json.add("insertions"sv, statistics.insertions));
+    TRY(json.add("evictions"sv, statistics.evictions));
+    TRY(json.add("invalidations"sv, statistics.invalidations));
+    TRY(json.add("entries"sv, statistics.entries));
+    TRY(json.finish());
+    return {};
+}
+
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/JsonObjectSerializer.h>
+#include <Kernel/FileSystem/BlockBasedFileSystem.h>
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/DiskCacheStatistics.h>
+#include <Kernel/Sections.h>
+
+namespace Kernel {
+
+UNMAP_AFTER_INIT SysFSDiskCacheStatistics::SysFSDiskCacheStatistics(SysFSDirectory const& parent_directory)
+    : SysFSGlobalInformation(parent_directory)
+{
+}
+
+UNMAP_AFTER_INIT NonnullLockRefPtr<SysFSDiskCacheStatistics> SysFSDiskCacheStatistics::must_create(SysFSDirectory const& parent_directory)
+{
+    return adopt_lock_ref_if_nonnull(new (nothrow) SysFSDiskCacheStatistics(parent_directory)).release_nonnull();
+}
+
+ErrorOr<void> SysFSDiskCacheStatistics::try_generate(KBufferBuilder& builder)
+{
+    auto statistics = BlockBasedFileSystem::disk_cache_statistics();
+    auto lookups = statistics.hits + statistics.misses;
+    auto json = TRY(JsonObjectSerializer<>::try_create(builder));
+    TRY(json.add("hits"sv, statistics.hits));
+    TRY(json.add("misses"sv, statistics.misses));
+    TRY(json.add("hit_rate_percent"sv, lookups ? statistics.hits * 100 / lookups : 0));
+    TRY(json.add("evictions"sv, statistics.evictions));
+    TRY(json.add("blocks_written_back"sv, statistics.blocks_written_back));
+    TRY(json.add("cached_bytes"sv, statistics.cached_bytes));
+    TRY(json.add("dirty_bytes"sv, statistics.dirty_bytes));
+    TRY(json.add("device_read_requests"sv, statistics.device_read_requests));
+    TRY(json.add("device_write_requests"sv, statistics.device_write_requests));
+    TRY(json.add("device_bytes_read"sv, statistics.device_bytes_read));
+    TRY(json.add("device_bytes_written"sv, statistics.device_bytes_written));
+    TRY(json.finish());
+    return {};
+}
+
+}
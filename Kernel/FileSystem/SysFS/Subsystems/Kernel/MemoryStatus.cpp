@@ -37,6 +37,19 @@ ErrorOr<void> SysFSMemoryStatus::try_generate(KBufferBuilder& builder)
     TRY(json.add("physical_uncommitted"sv, system_memory.physical_pages_uncommitted));
     TRY(json.add("kmalloc_call_count"sv, stats.kmalloc_call_count));
     TRY(json.add("kfree_call_count"sv, stats.kfree_call_count));
+    auto slabheaps_array = TRY(json.add_array("kmalloc_slabheaps"sv));
+    for (auto const& slabheap : stats.slabheaps) {
+        auto slabheap_object = TRY(slabheaps_array.add_object());
+        TRY(slabheap_object.add("slab_size"sv, slabheap.slab_size));
+        TRY(slabheap_object.add("allocated"sv, slabheap.bytes_allocated));
+        TRY(slabheap_object.add("available"sv, slabheap.bytes_free));
+        TRY(slabheap_object.add("cached"sv, slabheap.bytes_cached));
+        TRY(slabheap_object.add("cache_hits"sv, slabheap.cache_hits));
+        TRY(slabheap_object.add("cache_refills"sv, slabheap.cache_refills));
+        TRY(slabheap_object.add("cache_drains"sv, slabheap.cache_drains));
+        TRY(slabheap_object.finish());
+    }
+    TRY(slabheaps_array.finish());
     TRY(json.finish());
     return {};
 }
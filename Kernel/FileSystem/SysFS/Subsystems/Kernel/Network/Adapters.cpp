@@ -40,10 +40,22 @@ ErrorOr<void> SysFSNetworkAdaptersStats::try_generate(KBufferBuilder& builder)
         TRY(obj.add("bytes_in"sv, adapter.bytes_in()));
         TRY(obj.add("packets_out"sv, adapter.packets_out()));
         TRY(obj.add("bytes_out"sv, adapter.bytes_out()));
+        TRY(obj.add("checksum_errors"sv, adapter.checksum_errors()));
         TRY(obj.add("link_up"sv, adapter.link_up()));
         TRY(obj.add("link_speed"sv, adapter.link_speed()));
         TRY(obj.add("link_full_duplex"sv, adapter.link_full_duplex()));
         TRY(obj.add("mtu"sv, adapter.mtu()));
+        auto receive_queues = TRY(obj.add_array("receive_queues"sv));
+        for (size_t queue_index = 0; queue_index < adapter.receive_queue_count(); ++queue_index) {
+            auto statistics = adapter.receive_queue_statistics(queue_index);
+            auto queue_object = TRY(receive_queues.add_object());
+            TRY(queue_object.add("packets_received"sv, statistics.packets_received));
+            TRY(queue_object.add("packets_dropped"sv, statistics.packets_dropped));
+            TRY(queue_object.add("packets_processed"sv, statistics.packets_processed));
+            TRY(queue_object.add("packets_per_second"sv, statistics.packets_per_second));
+            TRY(queue_object.finish());
+        }
+        TRY(receive_queues.finish());
         TRY(obj.finish());
         return {};
     }));
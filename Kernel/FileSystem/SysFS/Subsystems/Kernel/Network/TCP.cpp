@@ -41,6 +41,21 @@ ErrorOr<void> SysFSNetworkTCPStats::try_generate(KBufferBuilder& builder)
         TRY(obj.add("bytes_in"sv, socket.bytes_in()));
         TRY(obj.add("packets_out"sv, socket.packets_out()));
         TRY(obj.add("bytes_out"sv, socket.bytes_out()));
+        TRY(obj.add("packets_dropped"sv, socket.packets_dropped()));
+        TRY(obj.add("retransmits"sv, socket.retransmits()));
+        auto& congestion_controller = socket.congestion_controller();
+        TRY(obj.add("congestion_control"sv, congestion_controller.name()));
+        TRY(obj.add("congestion_window"sv, congestion_controller.congestion_window()));
+        TRY(obj.add("slow_start_threshold"sv, congestion_controller.slow_start_threshold()));
+        TRY(obj.add("maximum_segment_size"sv, congestion_controller.maximum_segment_size()));
+        TRY(obj.add("smoothed_rtt_us"sv, socket.smoothed_round_trip_time().to_microseconds()));
+        TRY(obj.add("rtt_variance_us"sv, socket.round_trip_time_variance().to_microseconds()));
+        TRY(obj.add("rto_ms"sv, socket.retransmission_timeout().to_milliseconds()));
+        TRY(obj.add("send_window"sv, socket.send_window_size()));
+        TRY(obj.add("send_window_scale"sv, socket.send_window_scale()));
+        TRY(obj.add("receive_window"sv, socket.receive_window_size()));
+        TRY(obj.add("receive_window_scale"sv, socket.receive_window_scale()));
+        TRY(obj.add("sack_permitted"sv, socket.is_sack_permitted()));
         auto current_process_credentials = Process::current().credentials();
         if (current_process_credentials->is_superuser() || current_process_credentials->uid() == socket.origin_uid()) {
             TRY(obj.add("origin_pid"sv, socket.origin_pid().value()));
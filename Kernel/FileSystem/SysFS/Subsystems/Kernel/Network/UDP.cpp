@@ -33,6 +33,7 @@ ErrorOr<void> SysFSNetworkUDPStats::try_generate(KBufferBuilder& builder)
         auto peer_address = TRY(socket.peer_address().to_string());
         TRY(obj.add("peer_address"sv, peer_address->view()));
         TRY(obj.add("peer_port"sv, socket.peer_port()));
+        TRY(obj.add("packets_dropped"sv, socket.packets_dropped()));
         auto current_process_credentials = Process::current().credentials();
         if (current_process_credentials->is_superuser() || current_process_credentials->uid() == socket.origin_uid()) {
             TRY(obj.add("origin_pid"sv, socket.origin_pid().value()));
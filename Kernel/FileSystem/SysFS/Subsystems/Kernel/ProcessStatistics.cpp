@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/NumericLimits.h>
+#include <AK/StringBuilder.h>
+#include <AK/Try.h>
+#include <Kernel/API/ProcessStatistics.h>
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/ProcessStatistics.h>
+#include <Kernel/Process.h>
+#include <Kernel/Scheduler.h>
+#include <Kernel/Sections.h>
+#include <Kernel/TTY/TTY.h>
+
+namespace Kernel {
+
+UNMAP_AFTER_INIT SysFSProcessStatistics::SysFSProcessStatistics(SysFSDirectory const& parent_directory)
+    : SysFSGlobalInformation(parent_directory)
+{
+}
+
+UNMAP_AFTER_INIT NonnullLockRefPtr<SysFSProcessStatistics> SysFSProcessStatistics::must_create(SysFSDirectory const& parent_directory)
+{
+    return adopt_lock_ref_if_nonnull(new (nothrow) SysFSProcessStatistics(parent_directory)).release_nonnull();
+}
+
+ErrorOr<size_t> SysFSProcessStatistics::read_bytes(off_t offset, size_t count, UserOrKernelBuffer& buffer, OpenFileDescription* description) const
+{
+    auto nread = TRY(SysFSGlobalInformation::read_bytes(offset, count, buffer, description));
+    if (nread > 0) {
+        // Now that this snapshot was seen, the next one only has to contain what changed since.
+        MutexLocker locker(m_refresh_lock);
+        auto& data = static_cast<Data&>(*description->data());
+        data.read_generation = data.buffered_generation;
+    }
+    return nread;
+}
+
+ErrorOr<void> SysFSProcessStatistics::refresh_data(OpenFileDescription& description) const
+{
+    MutexLocker lock(m_refresh_lock);
+    auto& cached_data = description.data();
+    if (!cached_data) {
+        cached_data = adopt_own_if_nonnull(new (nothrow) Data);
+        if (!cached_data)
+            return ENOMEM;
+    }
+    TRY(Process::current().jail().with([&](auto const& my_jail) -> ErrorOr<void> {
+        if (my_jail && !is_readable_by_jailed_processes())
+            return Error::from_errno(EPERM);
+        return {};
+    }));
+    auto& data = static_cast<Data&>(*cached_data);
+    auto builder = TRY(KBufferBuilder::try_create());
+    data.buffered_generation = TRY(generate(builder, data.read_generation));
+    data.buffer = builder.build();
+    if (!data.buffer)
+        return ENOMEM;
+    return {};
+}
+
+ErrorOr<void> SysFSProcessStatistics::try_generate(KBufferBuilder& builder)
+{
+    TRY(generate(builder, 0));
+    return {};
+}
+
+template<typename Record>
+static ErrorOr<void> append_record(KBufferBuilder& builder, Record const& record, ReadonlySpan<StringView> strings)
+{
+    TRY(builder.append_bytes({ &record, sizeof(record) }));
+    size_t size = sizeof(record);
+    for (auto string : strings) {
+        TRY(builder.append_bytes(string.bytes()));
+        size += string.length();
+    }
+    static constexpr u8 padding[PROCESS_STATISTICS_ALIGNMENT] {};
+    return builder.append_bytes({ padding, align_up_to(size, PROCESS_STATISTICS_ALIGNMENT) - size });
+}
+
+// NOTE: The lengths in the records are only 16 bits wide.
+static StringView limited(StringView string)
+{
+    return string.substring_view(0, min(string.length(), static_cast<size_t>(NumericLimits<u16>::max())));
+}
+
+static ErrorOr<void> append_thread(KBufferBuilder& builder, Thread const& thread)
+{
+    SpinlockLocker locker(thread.get_lock());
+    auto name = TRY(thread.name().with([](auto& name) { return name->try_clone(); }));
+    auto state = limited(thread.state_string());
+
+    ThreadStatisticsRecord record {};
+    record.tid = thread.tid().value();
+    record.times_scheduled = thread.times_scheduled();
+    record.time_user = thread.time_in_user();
+    record.time_kernel = thread.time_in_kernel();
+    record.cpu = thread.cpu();
+    record.priority = thread.priority();
+    record.syscall_count = thread.syscall_count();
+    record.inode_faults = thread.inode_faults();
+    record.zero_faults = thread.zero_faults();
+    record.cow_faults = thread.cow_faults();
+    record.unix_socket_read_bytes = thread.unix_socket_read_bytes();
+    record.unix_socket_write_bytes = thread.unix_socket_write_bytes();
+    record.ipv4_socket_read_bytes = thread.ipv4_socket_read_bytes();
+    record.ipv4_socket_write_bytes = thread.ipv4_socket_write_bytes();
+    record.file_read_bytes = thread.file_read_bytes();
+    record.file_write_bytes = thread.file_write_bytes();
+    record.name_length = limited(name->view()).length();
+    record.state_length = state.length();
+
+    StringView strings[] = { limited(name->view()), state };
+    return append_record(builder, record, strings);
+}
+
+static bool has_changed(Process& process, u64 since_generation)
+{
+    if (since_generation == 0 || process.statistics_generation() >= since_generation)
+        return true;
+    // Running threads don't tell us about it when their times and counters go up.
+    return process.for_each_thread([](Thread& thread) {
+        return thread.state() == Thread::State::Running ? IterationDecision::Break : IterationDecision::Continue;
+    }) == IterationDecision::Break;
+}
+
+static ErrorOr<void> append_process(KBufferBuilder& builder, Process& process, u64 since_generation)
+{
+    ProcessStatisticsRecord record {};
+    record.pid = process.pid().value();
+    if (!has_changed(process, since_generation)) {
+        record.flags = PROCESS_STATISTICS_UNCHANGED;
+        return append_record(builder, record, {});
+    }
+
+    StringBuilder pledge_builder;
+    StringView veil;
+    if (process.is_user_process()) {
+#define __ENUMERATE_PLEDGE_PROMISE(promise)    \
+    if (process.has_promised(Pledge::promise)) \
+        TRY(pledge_builder.try_append(#promise " "sv));
+        ENUMERATE_PLEDGE_PROMISES
+#undef __ENUMERATE_PLEDGE_PROMISE
+
+        switch (process.veil_state()) {
+        case VeilState::None:
+            veil = "None"sv;
+            break;
+        case VeilState::Dropped:
+            veil = "Dropped"sv;
+            break;
+        case VeilState::Locked:
+        case VeilState::LockedInherited:
+            // Note: We don't reveal if the locked state is either by our choice
+            // or someone else applied it.
+            veil = "Locked"sv;
+            break;
+        }
+    }
+
+    auto name = TRY(process.name().with([](auto& name) { return name->try_clone(); }));
+    OwnPtr<KString> executable;
+    if (process.executable())
+        executable = TRY(process.executable()->try_serialize_absolute_path());
+    OwnPtr<KString> tty;
+    if (process.tty())
+        tty = TRY(process.tty()->pseudo_name());
+
+    record.flags = (process.is_kernel_process() ? PROCESS_STATISTICS_KERNEL : 0) | (process.is_dumpable() ? PROCESS_STATISTICS_DUMPABLE : 0);
+    record.pgid = process.tty() ? process.tty()->pgid().value() : 0;
+    record.pgp = process.pgid().value();
+    record.sid = process.sid().value();
+    auto credentials = process.credentials();
+    record.uid = credentials->uid().value();
+    record.gid = credentials->gid().value();
+    record.ppid = process.ppid().value();
+    record.nfds = process.fds().with_shared([](auto& fds) { return fds.open_count(); });
+
+    TRY(process.address_space().with([&](auto& space) -> ErrorOr<void> {
+        record.amount_virtual = space->amount_virtual();
+        record.amount_resident = space->amount_resident();
+        record.amount_dirty_private = space->amount_dirty_private();
+        record.amount_clean_inode = TRY(space->amount_clean_inode());
+        record.amount_shared = space->amount_shared();
+        record.amount_purgeable_volatile = space->amount_purgeable_volatile();
+        record.amount_purgeable_nonvolatile = space->amount_purgeable_nonvolatile();
+        record.amount_large_page_backed = space->amount_large_page_backed();
+        return {};
+    }));
+
+    Vector<NonnullLockRefPtr<Thread const>> threads;
+    TRY(process.try_for_each_thread([&](Thread const& thread) -> ErrorOr<void> {
+        return threads.try_append(thread);
+    }));
+    record.thread_count = threads.size();
+
+    StringView strings[] = {
+        limited(name->view()),
+        executable ? limited(executable->view()) : ""sv,
+        tty ? limited(tty->view()) : ""sv,
+        limited(pledge_builder.string_view()),
+        veil,
+    };
+    record.name_length = strings[0].length();
+    record.executable_length = strings[1].length();
+    record.tty_length = strings[2].length();
+    record.pledge_length = strings[3].length();
+    record.veil_length = strings[4].length();
+    TRY(append_record(builder, record, strings));
+
+    for (auto& thread : threads)
+        TRY(append_thread(builder, thread));
+    return {};
+}
+
+ErrorOr<u64> SysFSProcessStatistics::generate(KBufferBuilder& builder, u64 since_generation) const
+{
+    // Processes that change from now on will show up in the next snapshot relative to this one.
+    auto generation = g_process_statistics_generation.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+
+    // NOTE: We don't want to hold the list lock while generating the records.
+    Vector<NonnullLockRefPtr<Process>> processes;
+    // FIXME: Do we actually want to expose the colonel process in a Jail environment?
+    TRY(processes.try_append(*Scheduler::colonel()));
+    TRY(Process::for_each_in_same_jail([&](Process& process) -> ErrorOr<void> {
+        return processes.try_append(process);
+    }));
+
+    auto total_time_scheduled = Scheduler::get_total_time_scheduled();
+    ProcessStatisticsHeader header {};
+    header.version = PROCESS_STATISTICS_VERSION;
+    header.header_size = sizeof(header);
+    header.process_record_size = sizeof(ProcessStatisticsRecord);
+    header.thread_record_size = sizeof(ThreadStatisticsRecord);
+    header.generation = generation;
+    header.since_generation = since_generation;
+    header.total_time_scheduled = total_time_scheduled.total;
+    header.total_time_scheduled_kernel = total_time_scheduled.total_kernel;
+    header.process_count = processes.size();
+    TRY(builder.append_bytes({ &header, sizeof(header) }));
+
+    for (auto& process : processes)
+        TRY(append_process(builder, process, since_generation));
+    return generation;
+}
+
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/GlobalInformation.h>
+#include <Kernel/KBufferBuilder.h>
+#include <Kernel/Library/LockRefPtr.h>
+#include <Kernel/UserOrKernelBuffer.h>
+
+namespace Kernel {
+
+// The binary counterpart of /sys/kernel/processes, see Kernel/API/ProcessStatistics.h for its format.
+class SysFSProcessStatistics final : public SysFSGlobalInformation {
+public:
+    virtual StringView name() const override { return "process_statistics"sv; }
+
+    static NonnullLockRefPtr<SysFSProcessStatistics> must_create(SysFSDirectory const& parent_directory);
+
+    virtual ErrorOr<size_t> read_bytes(off_t offset, size_t count, UserOrKernelBuffer& buffer, OpenFileDescription* description) const override;
+
+private:
+    struct Data : public SysFSInodeData {
+        // The generation of the last snapshot that was read through this description, and of the one in the buffer.
+        u64 read_generation { 0 };
+        u64 buffered_generation { 0 };
+    };
+
+    explicit SysFSProcessStatistics(SysFSDirectory const& parent_directory);
+    virtual ErrorOr<void> refresh_data(OpenFileDescription&) const override;
+    virtual ErrorOr<void> try_generate(KBufferBuilder& builder) override;
+
+    // Returns the generation of the generated snapshot.
+    ErrorOr<u64> generate(KBufferBuilder&, u64 since_generation) const;
+
+    virtual bool is_readable_by_jailed_processes() const override { return true; }
+};
+
+}
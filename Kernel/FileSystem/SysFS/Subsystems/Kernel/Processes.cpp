@@ -89,6 +89,7 @@ ErrorOr<void> SysFSOverallProcesses::try_generate(KBufferBuilder& builder)
         size_t amount_shared = 0;
         size_t amount_purgeable_volatile = 0;
         size_t amount_purgeable_nonvolatile = 0;
+        size_t amount_large_page_backed = 0;
 
         TRY(process.address_space().with([&](auto& space) -> ErrorOr<void> {
             amount_virtual = space->amount_virtual();
@@ -98,6 +99,7 @@ ErrorOr<void> SysFSOverallProcesses::try_generate(KBufferBuilder& builder)
             amount_shared = space->amount_shared();
             amount_purgeable_volatile = space->amount_purgeable_volatile();
             amount_purgeable_nonvolatile = space->amount_purgeable_nonvolatile();
+            amount_large_page_backed = space->amount_large_page_backed();
             return {};
         }));
 
@@ -108,6 +110,7 @@ ErrorOr<void> SysFSOverallProcesses::try_generate(KBufferBuilder& builder)
         TRY(process_object.add("amount_shared"sv, amount_shared));
         TRY(process_object.add("amount_purgeable_volatile"sv, amount_purgeable_volatile));
         TRY(process_object.add("amount_purgeable_nonvolatile"sv, amount_purgeable_nonvolatile));
+        TRY(process_object.add("amount_large_page_backed"sv, amount_large_page_backed));
         TRY(process_object.add("dumpable"sv, process.is_dumpable()));
         TRY(process_object.add("kernel"sv, process.is_kernel_process()));
         auto thread_array = TRY(process_object.add_array("threads"sv));
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/JsonObjectSerializer.h>
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/SchedulerStatistics.h>
+#include <Kernel/Scheduler.h>
+#include <Kernel/Sections.h>
+
+namespace Kernel {
+
+UNMAP_AFTER_INIT SysFSSchedulerStatistics::SysFSSchedulerStatistics(SysFSDirectory const& parent_directory)
+    : SysFSGlobalInformation(parent_directory)
+{
+}
+
+UNMAP_AFTER_INIT NonnullLockRefPtr<SysFSSchedulerStatistics> SysFSSchedulerStatistics::must_create(SysFSDirectory const& parent_directory)
+{
+    return adopt_lock_ref_if_nonnull(new (nothrow) SysFSSchedulerStatistics(parent_directory)).release_nonnull();
+}
+
+ErrorOr<void> SysFSSchedulerStatistics::try_generate(KBufferBuilder& builder)
+{
+    auto array = TRY(JsonArraySerializer<>::try_create(builder));
+    TRY(Processor::try_for_each(
+        [&](Processor& processor) -> ErrorOr<void> {
+            auto statistics = Scheduler::ready_queue_statistics(processor.id());
+            auto obj = TRY(array.add_object());
+            TRY(obj.add("processor"sv, processor.id()));
+            TRY(obj.add("ready_threads"sv, statistics.ready_threads));
+            TRY(obj.add("steal_count"sv, statistics.steal_count));
+            TRY(obj.add("stolen_count"sv, statistics.stolen_count));
+            TRY(obj.finish());
+            return {};
+        }));
+    TRY(array.finish());
+    return {};
+}
+
+}
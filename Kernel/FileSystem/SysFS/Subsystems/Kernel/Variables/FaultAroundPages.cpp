@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/Variables/FaultAroundPages.h>
+#include <Kernel/Memory/Region.h>
+#include <Kernel/Sections.h>
+
+namespace Kernel {
+
+UNMAP_AFTER_INIT SysFSFaultAroundPages::SysFSFaultAroundPages(SysFSDirectory const& parent_directory)
+    : SysFSSystemUnsignedIntegerVariable(parent_directory)
+{
+}
+
+UNMAP_AFTER_INIT NonnullLockRefPtr<SysFSFaultAroundPages> SysFSFaultAroundPages::must_create(SysFSDirectory const& parent_directory)
+{
+    return adopt_lock_ref_if_nonnull(new (nothrow) SysFSFaultAroundPages(parent_directory)).release_nonnull();
+}
+
+u64 SysFSFaultAroundPages::value() const
+{
+    return Memory::g_fault_around_pages.load(AK::MemoryOrder::memory_order_relaxed);
+}
+
+ErrorOr<void> SysFSFaultAroundPages::set_value(u64 new_value)
+{
+    if (new_value > Memory::max_fault_around_pages)
+        return EINVAL;
+    Memory::g_fault_around_pages.store(new_value, AK::MemoryOrder::memory_order_relaxed);
+    return {};
+}
+
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/Variables/UnsignedIntegerVariable.h>
+#include <Kernel/Library/LockRefPtr.h>
+
+namespace Kernel {
+
+class SysFSFaultAroundPages final : public SysFSSystemUnsignedIntegerVariable {
+public:
+    virtual StringView name() const override { return "fault_around_pages"sv; }
+    static NonnullLockRefPtr<SysFSFaultAroundPages> must_create(SysFSDirectory const&);
+
+private:
+    virtual u64 value() const override;
+    virtual ErrorOr<void> set_value(u64 new_value) override;
+
+    explicit SysFSFaultAroundPages(SysFSDirectory const&);
+};
+
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/Variables/UnsignedIntegerVariable.h>
+#include <Kernel/Process.h>
+#include <Kernel/Sections.h>
+
+namespace Kernel {
+
+ErrorOr<void> SysFSSystemUnsignedIntegerVariable::try_generate(KBufferBuilder& builder)
+{
+    return builder.appendff("{}\n", value());
+}
+
+ErrorOr<size_t> SysFSSystemUnsignedIntegerVariable::write_bytes(off_t, size_t count, UserOrKernelBuffer const& buffer, OpenFileDescription*)
+{
+    MutexLocker locker(m_refresh_lock);
+    // Note: We do all of this code before taking the spinlock because then we disable
+    // interrupts so page faults will not work.
+    char value_buffer[21] {};
+    if (count == 0 || count >= sizeof(value_buffer))
+        return Error::from_errno(EINVAL);
+    TRY(buffer.read(value_buffer, count));
+
+    // NOTE: If we are in a jail, don't let the current process to change the variable.
+    if (Process::current().is_currently_in_jail())
+        return Error::from_errno(EPERM);
+
+    auto new_value = StringView { value_buffer, count }.trim("\n"sv).to_uint<u64>();
+    if (!new_value.has_value())
+        return Error::from_errno(EINVAL);
+    TRY(set_value(new_value.value()));
+    return count;
+}
+
+ErrorOr<void> SysFSSystemUnsignedIntegerVariable::truncate(u64 size)
+{
+    if (size != 0)
+        return EPERM;
+    return {};
+}
+
+}
@@ -21,12 +21,14 @@ class Custody;
 class Device;
 class DiskCache;
 class DoubleBuffer;
+class EPoll;
 class File;
 class FATInode;
 class OpenFileDescription;
 class DisplayConnector;
 class FileSystem;
 class FutexQueue;
+class IORing;
 class IPv4Socket;
 class Inode;
 class InodeIdentifier;
@@ -6,12 +6,18 @@
 
 #include <Kernel/Debug.h>
 #include <Kernel/FutexQueue.h>
+#include <Kernel/StdLib.h>
 #include <Kernel/Thread.h>
 
 namespace Kernel {
 
 FutexQueue::FutexQueue() = default;
-FutexQueue::~FutexQueue() = default;
+
+FutexQueue::~FutexQueue()
+{
+    SpinlockLocker lock(m_lock);
+    stop_lending_priority_locked();
+}
 
 bool FutexQueue::should_add_blocker(Thread::Blocker& b, void*)
 {
@@ -25,14 +31,21 @@ bool FutexQueue::should_add_blocker(Thread::Blocker& b, void*)
         dbgln_if(FUTEXQUEUE_DEBUG, "FutexQueue @ {}: should not block thread {}: was removed", this, b.thread());
         return false;
     }
+    auto& blocker = static_cast<Thread::FutexBlocker&>(b);
+    if (blocker.is_waiting_for_pi_owner() && blocker.pi_generation() != m_pi_generation) {
+        dbgln_if(FUTEXQUEUE_DEBUG, "FutexQueue @ {}: should not block thread {}: owner went away", this, b.thread());
+        return false;
+    }
     dbgln_if(FUTEXQUEUE_DEBUG, "FutexQueue @ {}: should block thread {}", this, b.thread());
 
     return true;
 }
 
-ErrorOr<u32> FutexQueue::wake_n_requeue(u32 wake_count, Function<ErrorOr<FutexQueue*>()> const& get_target_queue, u32 requeue_count, bool& is_empty, bool& is_empty_target)
+u32 FutexQueue::wake_n_requeue(u32 wake_count, FutexQueue* target_futex_queue, u32 requeue_count, bool& is_empty)
 {
-    is_empty_target = false;
+    // NOTE: The caller has to look up (or create) the target queue before calling this, since we must not
+    //       take a bucket lock while holding a queue lock. We also never hold two queue locks at once.
+    VERIFY(requeue_count == 0 || target_futex_queue);
     SpinlockLocker lock(m_lock);
 
     dbgln_if(FUTEXQUEUE_DEBUG, "FutexQueue @ {}: wake_n_requeue({}, {})", this, wake_count, requeue_count);
@@ -51,38 +64,35 @@ ErrorOr<u32> FutexQueue::wake_n_requeue(u32 wake_count, Function<ErrorOr<FutexQu
         }
         return false;
     });
-    is_empty = is_empty_and_no_imminent_waits_locked();
     if (requeue_count > 0) {
         auto blockers_to_requeue = do_take_blockers(requeue_count);
+        // Once the blockers are taken, this queue may be left without anyone waiting on it.
+        is_empty = is_empty_and_no_imminent_waits_locked();
         if (!blockers_to_requeue.is_empty()) {
-            if (auto* target_futex_queue = TRY(get_target_queue())) {
-                dbgln_if(FUTEXQUEUE_DEBUG, "FutexQueue @ {}: wake_n_requeue requeueing {} blockers to {}", this, blockers_to_requeue.size(), target_futex_queue);
-
-                // While still holding m_lock, notify each blocker
-                for (auto& info : blockers_to_requeue) {
-                    VERIFY(info.blocker->blocker_type() == Thread::Blocker::Type::Futex);
-                    auto& blocker = *static_cast<Thread::FutexBlocker*>(info.blocker);
-                    blocker.begin_requeue();
-                }
-
-                lock.unlock();
-                did_requeue = blockers_to_requeue.size();
-
-                SpinlockLocker target_lock(target_futex_queue->m_lock);
-                // Now that we have the lock of the target, append the blockers
-                // and notify them that they completed the move
-                for (auto& info : blockers_to_requeue) {
-                    VERIFY(info.blocker->blocker_type() == Thread::Blocker::Type::Futex);
-                    auto& blocker = *static_cast<Thread::FutexBlocker*>(info.blocker);
-                    blocker.finish_requeue(*target_futex_queue);
-                }
-                target_futex_queue->do_append_blockers(move(blockers_to_requeue));
-                is_empty_target = target_futex_queue->is_empty_and_no_imminent_waits_locked();
-            } else {
-                dbgln_if(FUTEXQUEUE_DEBUG, "FutexQueue @ {}: wake_n_requeue could not get target queue to requeue {} blockers", this, blockers_to_requeue.size());
-                do_append_blockers(move(blockers_to_requeue));
+            dbgln_if(FUTEXQUEUE_DEBUG, "FutexQueue @ {}: wake_n_requeue requeueing {} blockers to {}", this, blockers_to_requeue.size(), target_futex_queue);
+
+            // While still holding m_lock, notify each blocker
+            for (auto& info : blockers_to_requeue) {
+                VERIFY(info.blocker->blocker_type() == Thread::Blocker::Type::Futex);
+                auto& blocker = *static_cast<Thread::FutexBlocker*>(info.blocker);
+                blocker.begin_requeue();
+            }
+
+            lock.unlock();
+            did_requeue = blockers_to_requeue.size();
+
+            SpinlockLocker target_lock(target_futex_queue->m_lock);
+            // Now that we have the lock of the target, append the blockers
+            // and notify them that they completed the move
+            for (auto& info : blockers_to_requeue) {
+                VERIFY(info.blocker->blocker_type() == Thread::Blocker::Type::Futex);
+                auto& blocker = *static_cast<Thread::FutexBlocker*>(info.blocker);
+                blocker.finish_requeue(*target_futex_queue);
             }
+            target_futex_queue->do_append_blockers(move(blockers_to_requeue));
         }
+    } else {
+        is_empty = is_empty_and_no_imminent_waits_locked();
     }
     return did_wake + did_requeue;
 }
@@ -146,6 +156,13 @@ bool FutexQueue::queue_imminent_wait()
     return true;
 }
 
+void FutexQueue::cancel_imminent_wait()
+{
+    SpinlockLocker lock(m_lock);
+    VERIFY(m_imminent_waits > 0);
+    m_imminent_waits--;
+}
+
 bool FutexQueue::try_remove()
 {
     SpinlockLocker lock(m_lock);
@@ -154,7 +171,111 @@ bool FutexQueue::try_remove()
     if (!is_empty_and_no_imminent_waits_locked())
         return false;
     m_was_removed = true;
+    // Nobody is waiting anymore, so there's nobody to lend their priority either.
+    stop_lending_priority_locked();
     return true;
 }
 
+void FutexQueue::prepare_for_reuse()
+{
+    SpinlockLocker lock(m_lock);
+    VERIFY(m_was_removed);
+    VERIFY(is_empty_and_no_imminent_waits_locked());
+    VERIFY(!m_pi_priority_borrower);
+    m_was_removed = false;
+    m_imminent_waits = 1;
+}
+
+void FutexQueue::stop_lending_priority_locked()
+{
+    VERIFY(m_lock.is_locked());
+    if (auto borrower = move(m_pi_priority_borrower))
+        borrower->end_priority_inheritance();
+}
+
+void FutexQueue::lend_priority_to_pi_owner(Thread& owner, u32 priority)
+{
+    SpinlockLocker lock(m_lock);
+    if (m_pi_priority_borrower == &owner) {
+        owner.raise_inherited_priority(priority);
+        return;
+    }
+    // If the futex changed owners behind our back (e.g. because the previous owner
+    // died while holding it), the previous owner doesn't need our priority anymore.
+    stop_lending_priority_locked();
+    m_pi_priority_borrower = owner;
+    owner.begin_priority_inheritance(priority);
+}
+
+ErrorOr<void> FutexQueue::unlock_pi(u32* user_address, ThreadID owner)
+{
+    SpinlockLocker lock(m_lock);
+
+    // Pick the waiter with the highest priority to hand the futex to.
+    Thread::FutexBlocker* next_owner_blocker = nullptr;
+    size_t waiter_count = 0;
+    for_each_blocker_locked([&](Thread::Blocker& b, void*) {
+        VERIFY(b.blocker_type() == Thread::Blocker::Type::Futex);
+        auto& blocker = static_cast<Thread::FutexBlocker&>(b);
+        if (!blocker.is_waiting_for_pi_owner())
+            return;
+        ++waiter_count;
+        if (!next_owner_blocker || blocker.thread().priority() > next_owner_blocker->thread().priority())
+            next_owner_blocker = &blocker;
+    });
+
+    u32 new_value = 0;
+    if (next_owner_blocker) {
+        new_value = next_owner_blocker->thread().tid().value();
+        if (waiter_count > 1 || m_imminent_waits > 0)
+            new_value |= FUTEX_WAITERS;
+    }
+
+    auto expected = user_atomic_load_relaxed(user_address);
+    for (;;) {
+        if (!expected.has_value())
+            return EFAULT;
+        if ((expected.value() & FUTEX_TID_MASK) != static_cast<u32>(owner.value()))
+            return EPERM;
+        u32 expected_value = expected.value();
+        auto did_exchange = user_atomic_compare_exchange_relaxed(user_address, expected_value, new_value);
+        if (!did_exchange.has_value())
+            return EFAULT;
+        if (did_exchange.value())
+            break;
+        expected = expected_value;
+    }
+
+    dbgln_if(FUTEXQUEUE_DEBUG, "FutexQueue @ {}: unlock_pi by {} hands off to {:#x}", this, owner, new_value);
+
+    stop_lending_priority_locked();
+
+    if (!next_owner_blocker) {
+        // Anyone who is about to wait for us has to try again, the futex is free now.
+        ++m_pi_generation;
+        return {};
+    }
+
+    auto& next_owner = next_owner_blocker->thread();
+    unblock_all_blockers_whose_conditions_are_met_locked([&](Thread::Blocker& b, void*, bool& stop_iterating) {
+        if (&b != next_owner_blocker)
+            return false;
+        stop_iterating = true;
+        return static_cast<Thread::FutexBlocker&>(b).unblock();
+    });
+
+    // The remaining waiters now lend their priority to the new owner.
+    Optional<u32> highest_waiter_priority;
+    for_each_blocker_locked([&](Thread::Blocker& b, void*) {
+        auto& blocker = static_cast<Thread::FutexBlocker&>(b);
+        if (blocker.is_waiting_for_pi_owner())
+            highest_waiter_priority = max(highest_waiter_priority.value_or(0), blocker.thread().priority());
+    });
+    if (highest_waiter_priority.has_value()) {
+        m_pi_priority_borrower = next_owner;
+        next_owner.begin_priority_inheritance(highest_waiter_priority.value());
+    }
+    return {};
+}
+
 }
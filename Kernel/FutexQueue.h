@@ -7,6 +7,8 @@
 #pragma once
 
 #include <AK/AtomicRefCounted.h>
+#include <Kernel/API/POSIX/futex.h>
+#include <Kernel/Library/LockRefPtr.h>
 #include <Kernel/Locking/Spinlock.h>
 #include <Kernel/Thread.h>
 
@@ -19,7 +21,7 @@ public:
     FutexQueue();
     virtual ~FutexQueue();
 
-    ErrorOr<u32> wake_n_requeue(u32, Function<ErrorOr<FutexQueue*>()> const&, u32, bool&, bool&);
+    u32 wake_n_requeue(u32, FutexQueue*, u32, bool&);
     u32 wake_n(u32, Optional<u32> const&, bool&);
     u32 wake_all(bool&);
 
@@ -30,7 +32,24 @@ public:
     }
 
     bool queue_imminent_wait();
+    void cancel_imminent_wait();
     bool try_remove();
+    void prepare_for_reuse();
+
+    // Priority inheritance futexes (FUTEX_LOCK_PI and friends) keep the owner's thread ID
+    // in the futex word. Threads waiting for the owner lend it their priority, and
+    // unlocking hands the futex directly to the highest priority waiter.
+    u32 pi_generation()
+    {
+        SpinlockLocker lock(m_lock);
+        return m_pi_generation;
+    }
+    Thread::BlockResult wait_on_pi(Thread::BlockTimeout const& timeout, u32 generation)
+    {
+        return Thread::current()->block<Thread::FutexBlocker>(timeout, *this, FUTEX_BITSET_MATCH_ANY, generation);
+    }
+    void lend_priority_to_pi_owner(Thread& owner, u32 priority);
+    ErrorOr<void> unlock_pi(u32* user_address, ThreadID owner);
 
     bool is_empty_and_no_imminent_waits()
     {
@@ -43,8 +62,15 @@ protected:
     virtual bool should_add_blocker(Thread::Blocker& b, void*) override;
 
 private:
+    void stop_lending_priority_locked();
+
     size_t m_imminent_waits { 1 }; // We only create this object if we're going to be waiting, so start out with 1
     bool m_was_removed { false };
+
+    // Bumped whenever a priority inheritance futex is released without a waiter to hand it to,
+    // so threads that were just about to wait for the previous owner know to try again.
+    u32 m_pi_generation { 0 };
+    LockRefPtr<Thread> m_pi_priority_borrower;
 };
 
 }
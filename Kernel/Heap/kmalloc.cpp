@@ -4,12 +4,15 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/Array.h>
 #include <AK/Assertions.h>
+#include <AK/Atomic.h>
 #include <AK/Types.h>
 #include <Kernel/Arch/PageDirectory.h>
 #include <Kernel/Debug.h>
 #include <Kernel/Heap/Heap.h>
 #include <Kernel/Heap/kmalloc.h>
+#include <Kernel/InterruptDisabler.h>
 #include <Kernel/KSyms.h>
 #include <Kernel/Locking/Spinlock.h>
 #include <Kernel/Memory/MemoryManager.h>
@@ -149,7 +152,12 @@ public:
     void deallocate(void* ptr)
     {
         memset(ptr, KFREE_SCRUB_BYTE, m_slab_size);
+        deallocate_scrubbed(ptr);
+    }
 
+    // For memory that was already scrubbed when it was freed, like the rounds in a processor's magazine.
+    void deallocate_scrubbed(void* ptr)
+    {
         auto* block = (KmallocSlabBlock*)((FlatPtr)ptr & KmallocSlabBlock::block_mask);
         bool block_was_full = block->is_full();
         block->deallocate(ptr);
@@ -205,6 +213,55 @@ private:
     KmallocSlabBlock::List m_full_blocks;
 };
 
+// A per-processor stash of free slabs for each slabheap size class. Each processor
+// only ever touches its own cache (with interrupts disabled), so the common case of
+// allocating or freeing a small object does not need to take s_lock at all.
+// The shared slabheaps are only consulted to refill or drain a magazine in batches.
+struct KmallocProcessorCache {
+    static constexpr size_t magazine_capacity = 32;
+    static constexpr size_t batch_size = magazine_capacity / 2;
+    // NOTE: Rounds freed while the heap is being expanded can't be drained to the slabheaps, so they are parked here.
+    static constexpr size_t spare_capacity = batch_size - 1;
+
+    struct Magazine {
+        bool is_empty() const { return count.load() == 0; }
+        bool is_full() const { return count.load() >= magazine_capacity; }
+        bool has_spare_room() const { return count.load() < magazine_capacity + spare_capacity; }
+
+        void push(void* ptr)
+        {
+            auto index = count.load();
+            VERIFY(index < magazine_capacity + spare_capacity);
+            rounds[index] = ptr;
+            count.store(index + 1);
+        }
+
+        void* pop()
+        {
+            auto index = count.load();
+            VERIFY(index > 0);
+            count.store(index - 1);
+            return rounds[index - 1];
+        }
+
+        // NOTE: These are only ever written by the owning processor, but may be read
+        //       by others when collecting statistics.
+        Atomic<size_t, AK::MemoryOrder::memory_order_relaxed> count { 0 };
+        Atomic<size_t, AK::MemoryOrder::memory_order_relaxed> hits { 0 };
+        Atomic<size_t, AK::MemoryOrder::memory_order_relaxed> refills { 0 };
+        Atomic<size_t, AK::MemoryOrder::memory_order_relaxed> drains { 0 };
+        void* rounds[magazine_capacity + spare_capacity];
+    };
+
+    static void increment(Atomic<size_t, AK::MemoryOrder::memory_order_relaxed>& counter)
+    {
+        // Single writer, so there's no need for a locked read-modify-write.
+        counter.store(counter.load() + 1);
+    }
+
+    Array<Magazine, kmalloc_slabheap_count> magazines;
+};
+
 struct KmallocGlobalData {
     static constexpr size_t minimum_subheap_size = 1 * MiB;
 
@@ -221,6 +278,141 @@ struct KmallocGlobalData {
         subheaps.append(*subheap);
     }
 
+    Optional<size_t> slabheap_index_for_allocation(size_t size, size_t alignment) const
+    {
+        for (size_t i = 0; i < kmalloc_slabheap_count; ++i) {
+            if (size <= slabheaps[i].slab_size() && alignment <= slabheaps[i].slab_size())
+                return i;
+        }
+        return {};
+    }
+
+    Optional<size_t> slabheap_index_for_deallocation(size_t size) const
+    {
+        for (size_t i = 0; i < kmalloc_slabheap_count; ++i) {
+            if (size <= slabheaps[i].slab_size())
+                return i;
+        }
+        return {};
+    }
+
+    // NOTE: Must be called with interrupts disabled, so we can't be moved to another processor.
+    KmallocProcessorCache* current_processor_cache()
+    {
+        auto cpu = Processor::current_id();
+        VERIFY(cpu < MAX_CPU_COUNT);
+        if (auto* cache = processor_caches[cpu])
+            return cache;
+
+        SpinlockLocker lock(s_lock);
+        if (expansion_in_progress)
+            return nullptr;
+        auto* storage = allocate(sizeof(KmallocProcessorCache), alignof(KmallocProcessorCache), CallerWillInitializeMemory::Yes);
+        if (!storage)
+            return nullptr;
+        processor_caches[cpu] = new (storage) KmallocProcessorCache;
+        return processor_caches[cpu];
+    }
+
+    void* allocate_from_processor_cache(size_t size, size_t alignment, CallerWillInitializeMemory caller_will_initialize_memory)
+    {
+        auto index = slabheap_index_for_allocation(size, alignment);
+        if (!index.has_value())
+            return nullptr;
+
+        InterruptDisabler disabler;
+        auto* cache = current_processor_cache();
+        if (!cache)
+            return nullptr;
+
+        auto& magazine = cache->magazines[*index];
+        auto& slabheap = slabheaps[*index];
+        if (magazine.is_empty()) {
+            SpinlockLocker lock(s_lock);
+            if (expansion_in_progress)
+                return nullptr;
+            for (size_t i = 0; i < KmallocProcessorCache::batch_size; ++i) {
+                auto* ptr = slabheap.allocate(CallerWillInitializeMemory::Yes);
+                if (!ptr)
+                    break;
+                magazine.push(ptr);
+            }
+            // If we couldn't get anything, let the slow path try purging and expanding the heap.
+            if (magazine.is_empty())
+                return nullptr;
+            KmallocProcessorCache::increment(magazine.refills);
+        } else {
+            KmallocProcessorCache::increment(magazine.hits);
+        }
+
+        auto* ptr = magazine.pop();
+        if (caller_will_initialize_memory == CallerWillInitializeMemory::No)
+            memset(ptr, KMALLOC_SCRUB_BYTE, slabheap.slab_size());
+        return ptr;
+    }
+
+    bool deallocate_to_processor_cache(void* ptr, size_t size)
+    {
+        auto index = slabheap_index_for_deallocation(size);
+        if (!index.has_value())
+            return false;
+
+        VERIFY(is_valid_kmalloc_address(VirtualAddress { ptr }));
+
+        InterruptDisabler disabler;
+        auto* cache = current_processor_cache();
+        if (!cache)
+            return false;
+
+        auto& magazine = cache->magazines[*index];
+        auto& slabheap = slabheaps[*index];
+        if (magazine.is_full()) {
+            SpinlockLocker lock(s_lock);
+            if (expansion_in_progress) {
+                // NOTE: Only the processor that is expanding the heap can get here, since it holds s_lock.
+                //       The slow path can't free anything during the expansion either, so the round has to wait
+                //       in the magazine until the next drain.
+                if (!magazine.has_spare_room())
+                    PANIC("kfree: Too many objects of size {} freed while expanding the heap", slabheap.slab_size());
+            } else {
+                // Rounds were either scrubbed when they were freed into the magazine, or haven't been handed out
+                // since a refill took them from the slabheap, so they don't have to be scrubbed again.
+                while (magazine.count.load() > KmallocProcessorCache::magazine_capacity - KmallocProcessorCache::batch_size)
+                    slabheap.deallocate_scrubbed(magazine.pop());
+                KmallocProcessorCache::increment(magazine.drains);
+            }
+        }
+        memset(ptr, KFREE_SCRUB_BYTE, slabheap.slab_size());
+        magazine.push(ptr);
+        return true;
+    }
+
+    void drain_current_processor_cache()
+    {
+        VERIFY(s_lock.is_locked_by_current_processor());
+        auto* cache = processor_caches[Processor::current_id()];
+        if (!cache)
+            return;
+        for (size_t i = 0; i < kmalloc_slabheap_count; ++i) {
+            auto& magazine = cache->magazines[i];
+            if (magazine.is_empty())
+                continue;
+            while (!magazine.is_empty())
+                slabheaps[i].deallocate_scrubbed(magazine.pop());
+            KmallocProcessorCache::increment(magazine.drains);
+        }
+    }
+
+    size_t cached_bytes(size_t slabheap_index) const
+    {
+        size_t total = 0;
+        for (auto const* cache : processor_caches) {
+            if (cache)
+                total += cache->magazines[slabheap_index].count.load() * slabheaps[slabheap_index].slab_size();
+        }
+        return total;
+    }
+
     void* allocate(size_t size, size_t alignment, CallerWillInitializeMemory caller_will_initialize_memory)
     {
         VERIFY(!expansion_in_progress);
@@ -239,6 +431,8 @@ struct KmallocGlobalData {
         if (size <= KmallocSlabBlock::block_size * 2 + sizeof(ptrdiff_t) + sizeof(size_t)) {
             // FIXME: We should propagate a freed pointer, to find the specific subheap it belonged to
             //        This would save us iterating over them in the next step and remove a recursion
+            // NOTE: We can only drain our own processor's cache here, but that may be enough to empty some blocks.
+            drain_current_processor_cache();
             bool did_purge = false;
             for (auto& slabheap : slabheaps) {
                 if (slabheap.try_purge()) {
@@ -284,8 +478,8 @@ struct KmallocGlobalData {
         size_t total = 0;
         for (auto const& subheap : subheaps)
             total += subheap.allocator.allocated_bytes();
-        for (auto const& slabheap : slabheaps)
-            total += slabheap.allocated_bytes();
+        for (size_t i = 0; i < kmalloc_slabheap_count; ++i)
+            total += slabheaps[i].allocated_bytes() - cached_bytes(i);
         return total;
     }
 
@@ -294,8 +488,8 @@ struct KmallocGlobalData {
         size_t total = 0;
         for (auto const& subheap : subheaps)
             total += subheap.allocator.free_bytes();
-        for (auto const& slabheap : slabheaps)
-            total += slabheap.free_bytes();
+        for (size_t i = 0; i < kmalloc_slabheap_count; ++i)
+            total += slabheaps[i].free_bytes() + cached_bytes(i);
         return total;
     }
 
@@ -394,7 +588,9 @@ struct KmallocGlobalData {
 
     KmallocSubheap::List subheaps;
 
-    KmallocSlabheap slabheaps[6] = { 16, 32, 64, 128, 256, 512 };
+    KmallocSlabheap slabheaps[kmalloc_slabheap_count] = { 16, 32, 64, 128, 256, 512 };
+
+    Array<KmallocProcessorCache*, MAX_CPU_COUNT> processor_caches {};
 
     bool expansion_in_progress { false };
 };
@@ -402,8 +598,8 @@ struct KmallocGlobalData {
 READONLY_AFTER_INIT static KmallocGlobalData* g_kmalloc_global;
 alignas(KmallocGlobalData) static u8 g_kmalloc_global_heap[sizeof(KmallocGlobalData)];
 
-static size_t g_kmalloc_call_count;
-static size_t g_kfree_call_count;
+static Atomic<size_t, AK::MemoryOrder::memory_order_relaxed> g_kmalloc_call_count;
+static Atomic<size_t, AK::MemoryOrder::memory_order_relaxed> g_kfree_call_count;
 static size_t g_nested_kfree_calls;
 bool g_dump_kmalloc_stacks;
 
@@ -421,6 +617,12 @@ UNMAP_AFTER_INIT void kmalloc_init()
     s_lock.initialize();
 }
 
+// NOTE: Profiling events are still recorded under s_lock, so only take it when someone is listening.
+static bool is_profiling(Thread& thread)
+{
+    return g_profiling_all_threads || thread.process().is_profiling();
+}
+
 static void* kmalloc_impl(size_t size, size_t alignment, CallerWillInitializeMemory caller_will_initialize_memory)
 {
     // Catch bad callers allocating under spinlock.
@@ -431,15 +633,19 @@ static void* kmalloc_impl(size_t size, size_t alignment, CallerWillInitializeMem
     // Alignment must be a power of two.
     VERIFY(is_power_of_two(alignment));
 
-    SpinlockLocker lock(s_lock);
     ++g_kmalloc_call_count;
 
     if (g_dump_kmalloc_stacks && Kernel::g_kernel_symbols_available) {
+        SpinlockLocker lock(s_lock);
         dbgln("kmalloc({})", size);
         Kernel::dump_backtrace();
     }
 
-    void* ptr = g_kmalloc_global->allocate(size, alignment, caller_will_initialize_memory);
+    void* ptr = g_kmalloc_global->allocate_from_processor_cache(size, alignment, caller_will_initialize_memory);
+    if (!ptr) {
+        SpinlockLocker lock(s_lock);
+        ptr = g_kmalloc_global->allocate(size, alignment, caller_will_initialize_memory);
+    }
 
     Thread* current_thread = Thread::current();
     if (!current_thread)
@@ -448,7 +654,10 @@ static void* kmalloc_impl(size_t size, size_t alignment, CallerWillInitializeMem
         // FIXME: By the time we check this, we have already allocated above.
         //        This means that in the case of an infinite recursion, we can't catch it this way.
         VERIFY(current_thread->is_allocation_enabled());
-        PerformanceManager::add_kmalloc_perf_event(*current_thread, size, (FlatPtr)ptr);
+        if (is_profiling(*current_thread)) {
+            SpinlockLocker lock(s_lock);
+            PerformanceManager::add_kmalloc_perf_event(*current_thread, size, (FlatPtr)ptr);
+        }
     }
 
     return ptr;
@@ -482,22 +691,27 @@ void kfree_sized(void* ptr, size_t size)
         Processor::verify_no_spinlocks_held();
     }
 
-    SpinlockLocker lock(s_lock);
     ++g_kfree_call_count;
-    ++g_nested_kfree_calls;
-
-    if (g_nested_kfree_calls == 1) {
-        Thread* current_thread = Thread::current();
-        if (!current_thread)
-            current_thread = Processor::idle_thread();
-        if (current_thread) {
-            VERIFY(current_thread->is_allocation_enabled());
-            PerformanceManager::add_kfree_perf_event(*current_thread, 0, (FlatPtr)ptr);
+
+    Thread* current_thread = Thread::current();
+    if (!current_thread)
+        current_thread = Processor::idle_thread();
+    if (current_thread) {
+        VERIFY(current_thread->is_allocation_enabled());
+        if (is_profiling(*current_thread)) {
+            SpinlockLocker lock(s_lock);
+            ++g_nested_kfree_calls;
+            if (g_nested_kfree_calls == 1)
+                PerformanceManager::add_kfree_perf_event(*current_thread, 0, (FlatPtr)ptr);
+            --g_nested_kfree_calls;
         }
     }
 
+    if (g_kmalloc_global->deallocate_to_processor_cache(ptr, size))
+        return;
+
+    SpinlockLocker lock(s_lock);
     g_kmalloc_global->deallocate(ptr, size);
-    --g_nested_kfree_calls;
 }
 
 size_t kmalloc_good_size(size_t size)
@@ -584,6 +798,26 @@ void get_kmalloc_stats(kmalloc_stats& stats)
     SpinlockLocker lock(s_lock);
     stats.bytes_allocated = g_kmalloc_global->allocated_bytes();
     stats.bytes_free = g_kmalloc_global->free_bytes();
-    stats.kmalloc_call_count = g_kmalloc_call_count;
-    stats.kfree_call_count = g_kfree_call_count;
+    stats.kmalloc_call_count = g_kmalloc_call_count.load();
+    stats.kfree_call_count = g_kfree_call_count.load();
+
+    for (size_t i = 0; i < kmalloc_slabheap_count; ++i) {
+        auto const& slabheap = g_kmalloc_global->slabheaps[i];
+        auto& slabheap_stats = stats.slabheaps[i];
+        auto cached_bytes = g_kmalloc_global->cached_bytes(i);
+        slabheap_stats.slab_size = slabheap.slab_size();
+        slabheap_stats.bytes_allocated = slabheap.allocated_bytes() - cached_bytes;
+        slabheap_stats.bytes_free = slabheap.free_bytes();
+        slabheap_stats.bytes_cached = cached_bytes;
+        slabheap_stats.cache_hits = 0;
+        slabheap_stats.cache_refills = 0;
+        slabheap_stats.cache_drains = 0;
+        for (auto const* cache : g_kmalloc_global->processor_caches) {
+            if (!cache)
+                continue;
+            slabheap_stats.cache_hits += cache->magazines[i].hits.load();
+            slabheap_stats.cache_refills += cache->magazines[i].refills.load();
+            slabheap_stats.cache_drains += cache->magazines[i].drains.load();
+        }
+    }
 }
@@ -47,11 +47,24 @@ void kmalloc_init();
 
 void kfree_sized(void*, size_t);
 
+constexpr size_t kmalloc_slabheap_count = 6;
+
+struct kmalloc_slabheap_stats {
+    size_t slab_size;
+    size_t bytes_allocated;
+    size_t bytes_free;
+    size_t bytes_cached;
+    size_t cache_hits;
+    size_t cache_refills;
+    size_t cache_drains;
+};
+
 struct kmalloc_stats {
     size_t bytes_allocated;
     size_t bytes_free;
     size_t kmalloc_call_count;
     size_t kfree_call_count;
+    kmalloc_slabheap_stats slabheaps[kmalloc_slabheap_count];
 };
 void get_kmalloc_stats(kmalloc_stats&);
 
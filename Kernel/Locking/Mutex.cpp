@@ -10,7 +10,9 @@
 #include <Kernel/Locking/LockLocation.h>
 #include <Kernel/Locking/Mutex.h>
 #include <Kernel/Locking/Spinlock.h>
+#include <Kernel/PerformanceManager.h>
 #include <Kernel/Thread.h>
+#include <Kernel/Time/TimeManagement.h>
 
 extern bool g_in_early_boot;
 
@@ -230,6 +232,12 @@ void Mutex::block(Thread& current_thread, Mode mode, SpinlockLocker<Spinlock<Loc
             append_to_list(lists.list_for_mode(mode));
     });
 
+    // NOTE: Contention is only timed while someone is profiling it, reading the clock isn't free.
+    Optional<Time> wait_start;
+    ThreadID holder_tid = m_holder ? m_holder->tid() : 0;
+    if (PerformanceManager::is_tracing_lock_contention(current_thread))
+        wait_start = TimeManagement::the().monotonic_time();
+
     dbgln_if(LOCK_TRACE_DEBUG, "Mutex::lock @ {} ({}) waiting...", this, m_name);
     current_thread.block(*this, lock, requested_locks);
     dbgln_if(LOCK_TRACE_DEBUG, "Mutex::lock @ {} ({}) waited", this, m_name);
@@ -245,6 +253,9 @@ void Mutex::block(Thread& current_thread, Mode mode, SpinlockLocker<Spinlock<Loc
         else
             remove_from_list(lists.list_for_mode(mode));
     });
+
+    if (wait_start.has_value())
+        PerformanceManager::add_lock_waiter_event(current_thread, *this, holder_tid, TimeManagement::the().monotonic_time() - wait_start.value());
 }
 
 void Mutex::unblock_waiters(Mode previous_mode)
@@ -252,7 +263,14 @@ void Mutex::unblock_waiters(Mode previous_mode)
     VERIFY(m_times_locked == 0);
     VERIFY(m_mode == Mode::Unlocked);
 
+    auto* current_thread = Thread::current();
+    bool is_tracing_contention = current_thread && PerformanceManager::is_tracing_lock_contention(*current_thread);
+    size_t waiter_count = 0;
+
     m_blocked_thread_lists.with([&](auto& lists) {
+        if (is_tracing_contention)
+            waiter_count = lists.exclusive.size_slow() + lists.shared.size_slow() + lists.exclusive_big_lock.size_slow();
+
         auto unblock_shared = [&]() {
             if (lists.shared.is_empty())
                 return false;
@@ -289,6 +307,10 @@ void Mutex::unblock_waiters(Mode previous_mode)
                 unblock_shared();
         }
     });
+
+    // This is where the holder made others wait, so its backtrace shows which critical section was contended.
+    if (waiter_count > 0)
+        PerformanceManager::add_lock_holder_event(*current_thread, *this, waiter_count);
 }
 
 auto Mutex::force_unlock_exclusive_if_locked(u32& lock_count_to_restore) -> Mode
@@ -419,4 +419,12 @@ size_t AddressSpace::amount_purgeable_nonvolatile() const
     return amount;
 }
 
+size_t AddressSpace::amount_large_page_backed() const
+{
+    size_t amount = 0;
+    for (auto const& region : m_region_tree.regions())
+        amount += region.amount_large_page_backed();
+    return amount;
+}
+
 }
@@ -76,6 +76,66 @@ ErrorOr<NonnullLockRefPtr<VMObject>> AnonymousVMObject::try_clone()
     return clone;
 }
 
+ErrorOr<NonnullLockRefPtr<AnonymousVMObject>> AnonymousVMObject::try_snapshot_pages(size_t first_page_index, size_t page_count)
+{
+    VERIFY(first_page_index + page_count <= this->page_count());
+
+    SpinlockLocker lock(m_lock);
+
+    // Purgeable memory could be taken away at any moment, and COW faults in it would crash anyway.
+    if (is_purgeable())
+        return EINVAL;
+
+    // NOTE: ensure_cow_map() would mark every page as COW, but only the shared ones need to be.
+    if (m_cow_map.is_null())
+        m_cow_map = TRY(Bitmap::create(this->page_count(), false));
+
+    auto pages = TRY(FixedArray<RefPtr<PhysicalPage>>::create(page_count));
+    for (size_t i = 0; i < page_count; ++i) {
+        auto const& page = m_physical_pages[first_page_index + i];
+        VERIFY(page);
+        pages[i] = page;
+    }
+
+    // Writing to a snapshotted page must not fail for lack of memory, so we commit a page for each COW fault
+    // up front. If we can't, the caller has to copy the data instead.
+    size_t new_cow_pages_needed = 0;
+    for (auto const& page : pages) {
+        if (!page->is_shared_zero_page() && !page->is_lazy_committed_page())
+            ++new_cow_pages_needed;
+    }
+    auto committed_pages = TRY(MM.commit_physical_pages(new_cow_pages_needed));
+    auto snapshot = TRY(adopt_nonnull_lock_ref_or_enomem(new (nothrow) AnonymousVMObject(move(pages))));
+
+    if (m_snapshot_committed_cow_pages.has_value())
+        m_snapshot_committed_cow_pages->absorb(move(committed_pages));
+    else
+        m_snapshot_committed_cow_pages = move(committed_pages);
+
+    for (size_t i = 0; i < page_count; ++i) {
+        auto const& page = m_physical_pages[first_page_index + i];
+        if (!page->is_shared_zero_page() && !page->is_lazy_committed_page())
+            m_cow_map.set(first_page_index + i, true);
+    }
+
+    // Pages that were already COW from an earlier snapshot only need one committed page each.
+    auto cow_page_count = m_cow_map.count_slow(true);
+    if (m_snapshot_committed_cow_pages->page_count() > cow_page_count)
+        m_snapshot_committed_cow_pages->uncommit(m_snapshot_committed_cow_pages->page_count() - cow_page_count);
+
+    // Only the snapshotted pages have to lose their write access.
+    for_each_region([&](Region& region) {
+        if (!region.is_mapped())
+            return;
+        for (size_t i = 0; i < page_count; ++i) {
+            auto page_index = first_page_index + i;
+            (void)region.remap_vmobject_page(page_index, *m_physical_pages[page_index]);
+        }
+    });
+
+    return snapshot;
+}
+
 ErrorOr<NonnullLockRefPtr<AnonymousVMObject>> AnonymousVMObject::try_create_with_size(size_t size, AllocationStrategy strategy)
 {
     Optional<CommittedPhysicalPageSet> committed_pages;
@@ -276,6 +336,37 @@ NonnullRefPtr<PhysicalPage> AnonymousVMObject::allocate_committed_page(Badge<Reg
     return m_unused_committed_pages->take_one();
 }
 
+bool AnonymousVMObject::try_populate_large_page(Badge<Region>, size_t page_index)
+{
+    VERIFY(m_lock.is_locked());
+    if (page_index + PAGES_PER_LARGE_PAGE > page_count())
+        return false;
+
+    // We only replace pages that haven't been touched yet, and they all have to be backed by the same pool.
+    auto const* first_page = m_physical_pages[page_index].ptr();
+    bool is_lazy_committed = first_page->is_lazy_committed_page();
+    if (!is_lazy_committed && !first_page->is_shared_zero_page())
+        return false;
+    for (size_t i = 1; i < PAGES_PER_LARGE_PAGE; ++i) {
+        if (m_physical_pages[page_index + i].ptr() != first_page)
+            return false;
+    }
+
+    VERIFY(!is_lazy_committed || m_unused_committed_pages.has_value());
+    auto large_page_or_error = is_lazy_committed ? m_unused_committed_pages->take_large_page() : MM.allocate_large_physical_page();
+    if (large_page_or_error.is_error())
+        return false;
+    auto large_page = large_page_or_error.release_value();
+
+    for (size_t i = 0; i < PAGES_PER_LARGE_PAGE; ++i) {
+        m_physical_pages[page_index + i] = large_page.ptr_at(i);
+        // These are brand new pages that nobody else can see, so there is nothing to copy on write.
+        if (!m_cow_map.is_null())
+            m_cow_map.set(page_index + i, false);
+    }
+    return true;
+}
+
 ErrorOr<void> AnonymousVMObject::ensure_cow_map()
 {
     if (m_cow_map.is_null())
@@ -342,11 +433,16 @@ PageFaultResponse AnonymousVMObject::handle_cow_fault(size_t page_index, Virtual
             if (m_shared_committed_cow_pages->is_empty())
                 m_shared_committed_cow_pages = nullptr;
         }
+        if (m_snapshot_committed_cow_pages.has_value() && !m_snapshot_committed_cow_pages->is_empty())
+            m_snapshot_committed_cow_pages->uncommit_one();
         return PageFaultResponse::Continue;
     }
 
     RefPtr<PhysicalPage> page;
-    if (m_shared_committed_cow_pages) {
+    if (m_snapshot_committed_cow_pages.has_value() && !m_snapshot_committed_cow_pages->is_empty()) {
+        dbgln_if(PAGE_FAULT_DEBUG, "    >> It's a COW page shared with a snapshot and it's time to COW!");
+        page = m_snapshot_committed_cow_pages->take_one();
+    } else if (m_shared_committed_cow_pages) {
         dbgln_if(PAGE_FAULT_DEBUG, "    >> It's a committed COW page and it's time to COW!");
         page = m_shared_committed_cow_pages->take_one();
     } else {
@@ -25,7 +25,12 @@ public:
     static ErrorOr<NonnullLockRefPtr<AnonymousVMObject>> try_create_physically_contiguous_with_size(size_t);
     virtual ErrorOr<NonnullLockRefPtr<VMObject>> try_clone() override;
 
+    // Returns a new VMObject that shares the given pages with this one. The pages become copy-on-write
+    // for us, so the snapshot keeps their current contents even if our regions write to them later.
+    ErrorOr<NonnullLockRefPtr<AnonymousVMObject>> try_snapshot_pages(size_t first_page_index, size_t page_count);
+
     [[nodiscard]] NonnullRefPtr<PhysicalPage> allocate_committed_page(Badge<Region>);
+    bool try_populate_large_page(Badge<Region>, size_t page_index);
     PageFaultResponse handle_cow_fault(size_t, VirtualAddress);
     size_t cow_pages() const;
     bool should_cow(size_t page_index, bool) const;
@@ -60,6 +65,8 @@ private:
     ErrorOr<void> ensure_or_reset_cow_map();
 
     Optional<CommittedPhysicalPageSet> m_unused_committed_pages;
+    // Pages committed for COW faults on pages that we have shared with snapshots.
+    Optional<CommittedPhysicalPageSet> m_snapshot_committed_cow_pages;
     Bitmap m_cow_map;
 
     // AnonymousVMObject shares committed COW pages with cloned children (happens on fork)
@@ -568,7 +568,8 @@ PageTableEntry* MemoryManager::pte(PageDirectory& page_directory, VirtualAddress
 
     auto* pd = quickmap_pd(const_cast<PageDirectory&>(page_directory), page_directory_table_index);
     PageDirectoryEntry const& pde = pd[page_directory_index];
-    if (!pde.is_present())
+    // NOTE: Large pages are mapped without a page table, so there is no PTE we could return.
+    if (!pde.is_present() || pde.is_huge())
         return nullptr;
 
     return &quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()))[page_table_index];
@@ -584,6 +585,12 @@ PageTableEntry* MemoryManager::ensure_pte(PageDirectory& page_directory, Virtual
 
     auto* pd = quickmap_pd(page_directory, page_directory_table_index);
     auto& pde = pd[page_directory_index];
+    if (pde.is_present() && pde.is_huge()) {
+        // Someone wants to map an individual page within a large page, so we need a page table after all.
+        if (!split_large_page(page_directory, vaddr))
+            return nullptr;
+        pd = quickmap_pd(page_directory, page_directory_table_index);
+    }
     if (pde.is_present())
         return &quickmap_pt(PhysicalAddress(pde.page_table_base()))[page_table_index];
 
@@ -625,6 +632,17 @@ void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress va
 
     auto* pd = quickmap_pd(page_directory, page_directory_table_index);
     PageDirectoryEntry& pde = pd[page_directory_index];
+    if (pde.is_present() && pde.is_huge()) {
+        if (!split_large_page(page_directory, vaddr)) {
+            // We couldn't allocate a page table to keep the rest of the large page mapped, so drop all of it.
+            // The remaining pages are still in their VMObjects and will be mapped again when they're accessed.
+            dbgln("MM: Unable to split large page to release {}, dropping the whole mapping", vaddr);
+            pd = quickmap_pd(page_directory, page_directory_table_index);
+            pde.clear();
+            return;
+        }
+        pd = quickmap_pd(page_directory, page_directory_table_index);
+    }
     if (pde.is_present()) {
         auto* page_table = quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()));
         auto& pte = page_table[page_table_index];
@@ -648,6 +666,108 @@ void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress va
     }
 }
 
+bool MemoryManager::map_large_page(PageDirectory& page_directory, VirtualAddress vaddr, PhysicalAddress paddr, LargePageFlags flags)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(page_directory.get_lock().is_locked_by_current_processor());
+    VERIFY(vaddr.get() % LARGE_PAGE_SIZE == 0);
+    VERIFY(paddr.get() % LARGE_PAGE_SIZE == 0);
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x1ff;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    PageDirectoryEntry& pde = pd[page_directory_index];
+    if (pde.is_present() && !pde.is_huge()) {
+        // The caller owns the whole range, so the page table only holds mappings we are about to replace.
+        get_physical_page_entry(PhysicalAddress { pde.page_table_base() }).allocated.physical_page.unref();
+    }
+
+    pde.clear();
+    pde.set_page_table_base(paddr.get());
+    pde.set_huge(true);
+    pde.set_user_allowed(flags.user_allowed);
+    pde.set_writable(flags.writable);
+    pde.set_execute_disabled(flags.execute_disabled);
+    pde.set_present(true);
+    return true;
+}
+
+bool MemoryManager::release_large_page(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(page_directory.get_lock().is_locked_by_current_processor());
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x1ff;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    PageDirectoryEntry& pde = pd[page_directory_index];
+    if (!pde.is_present() || !pde.is_huge())
+        return false;
+    pde.clear();
+    return true;
+}
+
+bool MemoryManager::is_mapped_as_large_page(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(page_directory.get_lock().is_locked_by_current_processor());
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x1ff;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    PageDirectoryEntry const& pde = pd[page_directory_index];
+    return pde.is_present() && pde.is_huge();
+}
+
+bool MemoryManager::split_large_page(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(page_directory.get_lock().is_locked_by_current_processor());
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x1ff;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto page_table_or_error = allocate_physical_page(ShouldZeroFill::No);
+    if (page_table_or_error.is_error()) {
+        dbgln("MM: Unable to allocate page table to split large page at {}", vaddr);
+        return false;
+    }
+    auto page_table = page_table_or_error.release_value();
+
+    // NOTE: Allocating may have purged memory and touched the page directory, so only look at it now.
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    PageDirectoryEntry& pde = pd[page_directory_index];
+    if (!pde.is_present() || !pde.is_huge())
+        return true;
+
+    auto large_page_base = pde.page_table_base();
+    auto* ptes = quickmap_pt(page_table->paddr());
+    for (size_t i = 0; i < PAGES_PER_LARGE_PAGE; ++i) {
+        auto& pte = ptes[i];
+        pte.clear();
+        pte.set_physical_page_base(large_page_base + i * PAGE_SIZE);
+        pte.set_user_allowed(pde.is_user_allowed());
+        pte.set_writable(pde.is_writable());
+        pte.set_write_through(pde.is_write_through());
+        pte.set_cache_disabled(pde.is_cache_disabled());
+        pte.set_global(pde.is_global());
+        pte.set_execute_disabled(pde.is_execute_disabled());
+        pte.set_present(true);
+    }
+
+    // NOTE: The translations don't change, so stale TLB entries for the large page are harmless.
+    pd = quickmap_pd(page_directory, page_directory_table_index);
+    pde.clear();
+    pde.set_page_table_base(page_table->paddr().get());
+    pde.set_user_allowed(true);
+    pde.set_present(true);
+    pde.set_writable(true);
+    pde.set_global(&page_directory == m_kernel_page_directory.ptr());
+
+    // NOTE: This leaked ref is matched by the unref in MemoryManager::release_pte()
+    (void)page_table.leak_ref();
+    return true;
+}
+
 UNMAP_AFTER_INIT void MemoryManager::initialize(u32 cpu)
 {
     dmesgln("Initialize MMU");
@@ -953,6 +1073,43 @@ NonnullRefPtr<PhysicalPage> MemoryManager::allocate_committed_physical_page(Badg
     return page.release_nonnull();
 }
 
+ErrorOr<NonnullRefPtrVector<PhysicalPage>> MemoryManager::find_free_large_physical_page(bool committed)
+{
+    auto physical_pages = TRY(m_global_data.with([&](auto& global_data) -> ErrorOr<NonnullRefPtrVector<PhysicalPage>> {
+        auto& pool = committed ? global_data.system_memory_info.physical_pages_committed : global_data.system_memory_info.physical_pages_uncommitted;
+        if (pool < PAGES_PER_LARGE_PAGE)
+            return ENOMEM;
+
+        for (auto& physical_region : global_data.physical_regions) {
+            auto physical_pages = physical_region.take_contiguous_free_pages(PAGES_PER_LARGE_PAGE, LARGE_PAGE_SIZE);
+            if (!physical_pages.is_empty()) {
+                pool -= PAGES_PER_LARGE_PAGE;
+                global_data.system_memory_info.physical_pages_used += PAGES_PER_LARGE_PAGE;
+                return physical_pages;
+            }
+        }
+        return ENOMEM;
+    }));
+
+    InterruptDisabler disabler;
+    for (auto& page : physical_pages) {
+        auto* ptr = quickmap_page(page);
+        memset(ptr, 0, PAGE_SIZE);
+        unquickmap_page();
+    }
+    return physical_pages;
+}
+
+ErrorOr<NonnullRefPtrVector<PhysicalPage>> MemoryManager::allocate_committed_large_physical_page(Badge<CommittedPhysicalPageSet>)
+{
+    return find_free_large_physical_page(true);
+}
+
+ErrorOr<NonnullRefPtrVector<PhysicalPage>> MemoryManager::allocate_large_physical_page()
+{
+    return find_free_large_physical_page(false);
+}
+
 ErrorOr<NonnullRefPtr<PhysicalPage>> MemoryManager::allocate_physical_page(ShouldZeroFill should_zero_fill, bool* did_purge)
 {
     return m_global_data.with([&](auto&) -> ErrorOr<NonnullRefPtr<PhysicalPage>> {
@@ -1195,11 +1352,25 @@ NonnullRefPtr<PhysicalPage> CommittedPhysicalPageSet::take_one()
     return MM.allocate_committed_physical_page({}, MemoryManager::ShouldZeroFill::Yes);
 }
 
+ErrorOr<NonnullRefPtrVector<PhysicalPage>> CommittedPhysicalPageSet::take_large_page()
+{
+    if (m_page_count < PAGES_PER_LARGE_PAGE)
+        return ENOMEM;
+    auto physical_pages = TRY(MM.allocate_committed_large_physical_page({}));
+    m_page_count -= PAGES_PER_LARGE_PAGE;
+    return physical_pages;
+}
+
 void CommittedPhysicalPageSet::uncommit_one()
 {
-    VERIFY(m_page_count > 0);
-    --m_page_count;
-    MM.uncommit_physical_pages({}, 1);
+    uncommit(1);
+}
+
+void CommittedPhysicalPageSet::uncommit(size_t page_count)
+{
+    VERIFY(m_page_count >= page_count);
+    m_page_count -= page_count;
+    MM.uncommit_physical_pages({}, page_count);
 }
 
 void MemoryManager::copy_physical_page(PhysicalPage& physical_page, u8 page_buffer[PAGE_SIZE])
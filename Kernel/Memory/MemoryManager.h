@@ -115,7 +115,11 @@ public:
     size_t page_count() const { return m_page_count; }
 
     [[nodiscard]] NonnullRefPtr<PhysicalPage> take_one();
+    ErrorOr<NonnullRefPtrVector<PhysicalPage>> take_large_page();
     void uncommit_one();
+    void uncommit(size_t page_count);
+
+    void absorb(CommittedPhysicalPageSet&& other) { m_page_count += exchange(other.m_page_count, 0); }
 
     void operator=(CommittedPhysicalPageSet&&) = delete;
 
@@ -166,6 +170,10 @@ public:
 
     NonnullRefPtr<PhysicalPage> allocate_committed_physical_page(Badge<CommittedPhysicalPageSet>, ShouldZeroFill = ShouldZeroFill::Yes);
     ErrorOr<NonnullRefPtr<PhysicalPage>> allocate_physical_page(ShouldZeroFill = ShouldZeroFill::Yes, bool* did_purge = nullptr);
+    // Large pages are PAGES_PER_LARGE_PAGE zero-filled physical pages, contiguous and aligned to LARGE_PAGE_SIZE.
+    // Unlike the single page allocators, these don't try to purge anything when memory is tight.
+    ErrorOr<NonnullRefPtrVector<PhysicalPage>> allocate_committed_large_physical_page(Badge<CommittedPhysicalPageSet>);
+    ErrorOr<NonnullRefPtrVector<PhysicalPage>> allocate_large_physical_page();
     ErrorOr<NonnullRefPtrVector<PhysicalPage>> allocate_contiguous_physical_pages(size_t size);
     void deallocate_physical_page(PhysicalAddress);
 
@@ -256,6 +264,7 @@ private:
     static Region* find_region_from_vaddr(VirtualAddress);
 
     RefPtr<PhysicalPage> find_free_physical_page(bool);
+    ErrorOr<NonnullRefPtrVector<PhysicalPage>> find_free_large_physical_page(bool committed);
 
     ALWAYS_INLINE u8* quickmap_page(PhysicalPage& page)
     {
@@ -275,6 +284,16 @@ private:
     };
     void release_pte(PageDirectory&, VirtualAddress, IsLastPTERelease);
 
+    struct LargePageFlags {
+        bool writable { false };
+        bool user_allowed { false };
+        bool execute_disabled { false };
+    };
+    bool map_large_page(PageDirectory&, VirtualAddress, PhysicalAddress, LargePageFlags);
+    bool release_large_page(PageDirectory&, VirtualAddress);
+    bool is_mapped_as_large_page(PageDirectory&, VirtualAddress);
+    bool split_large_page(PageDirectory&, VirtualAddress);
+
     // NOTE: These are outside of GlobalData as they are only assigned on startup,
     //       and then never change. Atomic ref-counting covers that case without
     //       the need for additional synchronization.
@@ -11,6 +11,10 @@
 
 namespace Kernel::Memory {
 
+// A large page is mapped by a single page directory entry instead of a page table.
+static constexpr size_t LARGE_PAGE_SIZE = 2 * MiB;
+static constexpr size_t PAGES_PER_LARGE_PAGE = LARGE_PAGE_SIZE / PAGE_SIZE;
+
 enum class MayReturnToFreeList : bool {
     No,
     Yes
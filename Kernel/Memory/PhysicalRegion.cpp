@@ -56,6 +56,21 @@ void PhysicalRegion::initialize_zones()
         return zone_count;
     };
 
+    // If we don't start on a large page boundary, carve off a few small zones first,
+    // so that the blocks handed out by the large zones are naturally aligned.
+    size_t pages_until_aligned = (align_up_to(base_address.get(), LARGE_PAGE_SIZE) - base_address.get()) / PAGE_SIZE;
+    pages_until_aligned = min(pages_until_aligned, remaining_pages);
+    while (pages_until_aligned > 0) {
+        // Zones have to be a power of two in size, so use the smallest one we need first.
+        size_t pages_in_zone = 1u << count_trailing_zeroes(pages_until_aligned);
+        m_zones.append(adopt_nonnull_own_or_enomem(new (nothrow) PhysicalZone(base_address, pages_in_zone)).release_value_but_fixme_should_propagate_errors());
+        m_usable_zones.append(m_zones.last());
+        base_address = base_address.offset(pages_in_zone * PAGE_SIZE);
+        remaining_pages -= pages_in_zone;
+        pages_until_aligned -= pages_in_zone;
+        ++m_leading_zones;
+    }
+
     // First make 16 MiB zones (with 4096 pages each)
     m_large_zones = make_zones(large_zone_size);
 
@@ -75,13 +90,17 @@ OwnPtr<PhysicalRegion> PhysicalRegion::try_take_pages_from_beginning(size_t page
     return try_create(taken_lower, taken_upper);
 }
 
-NonnullRefPtrVector<PhysicalPage> PhysicalRegion::take_contiguous_free_pages(size_t count)
+NonnullRefPtrVector<PhysicalPage> PhysicalRegion::take_contiguous_free_pages(size_t count, size_t physical_alignment)
 {
     auto rounded_page_count = next_power_of_two(count);
     auto order = count_trailing_zeroes(rounded_page_count);
+    // Buddy blocks are aligned to their size relative to the zone base.
+    VERIFY(physical_alignment <= rounded_page_count * PAGE_SIZE);
 
     Optional<PhysicalAddress> page_base;
     for (auto& zone : m_usable_zones) {
+        if (zone.base().get() % physical_alignment != 0)
+            continue;
         page_base = zone.allocate_block(order);
         if (page_base.has_value()) {
             if (zone.is_empty()) {
@@ -122,14 +141,20 @@ RefPtr<PhysicalPage> PhysicalRegion::take_free_page()
 
 void PhysicalRegion::return_page(PhysicalAddress paddr)
 {
-    auto large_zone_base = lower().get();
-    auto small_zone_base = lower().get() + (m_large_zones * large_zone_size);
+    auto large_zone_base = m_leading_zones ? m_zones[m_leading_zones - 1].base().get() + m_zones[m_leading_zones - 1].page_count() * PAGE_SIZE : lower().get();
+    auto small_zone_base = large_zone_base + (m_large_zones * large_zone_size);
 
     size_t zone_index;
-    if (paddr.get() < small_zone_base)
-        zone_index = (paddr.get() - large_zone_base) / large_zone_size;
-    else
-        zone_index = m_large_zones + (paddr.get() - small_zone_base) / small_zone_size;
+    if (paddr.get() < large_zone_base) {
+        // There are only a handful of leading zones, so just look for the right one.
+        zone_index = 0;
+        while (!m_zones[zone_index].contains(paddr))
+            ++zone_index;
+    } else if (paddr.get() < small_zone_base) {
+        zone_index = m_leading_zones + (paddr.get() - large_zone_base) / large_zone_size;
+    } else {
+        zone_index = m_leading_zones + m_large_zones + (paddr.get() - small_zone_base) / small_zone_size;
+    }
 
     auto& zone = m_zones[zone_index];
     VERIFY(zone.contains(paddr));
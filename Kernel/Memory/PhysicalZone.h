@@ -35,6 +35,7 @@ public:
     bool is_empty() const { return available() == 0; }
 
     PhysicalAddress base() const { return m_base_address; }
+    size_t page_count() const { return m_page_count; }
     bool contains(PhysicalAddress paddr) const
     {
         return paddr >= m_base_address && paddr < m_base_address.offset(m_page_count * PAGE_SIZE);
@@ -21,6 +21,8 @@
 
 namespace Kernel::Memory {
 
+Atomic<size_t> g_fault_around_pages { default_fault_around_pages };
+
 Region::Region()
     : m_range(VirtualRange({}, 0))
 {
@@ -135,6 +137,25 @@ ErrorOr<NonnullOwnPtr<Region>> Region::try_clone()
     return clone_region;
 }
 
+ErrorOr<NonnullOwnPtr<Region>> Region::try_clone_sharing_vmobject()
+{
+    VERIFY(Process::has_current());
+
+    // Unlike try_clone(), this doesn't set up COW, so writes through either region are seen by both.
+    // This is what a vfork() child gets, and it doesn't keep the region after it exec()s or dies.
+
+    OwnPtr<KString> region_name;
+    if (m_name)
+        region_name = TRY(m_name->try_clone());
+
+    auto region = TRY(Region::try_create_user_accessible(
+        m_range, vmobject(), m_offset_in_vmobject, move(region_name), access(), m_cacheable ? Cacheable::Yes : Cacheable::No, m_shared));
+    region->set_mmap(m_mmap, m_mmapped_from_readable, m_mmapped_from_writable);
+    region->set_stack(m_stack);
+    region->set_syscall_region(is_syscall_region());
+    return region;
+}
+
 void Region::set_vmobject(NonnullLockRefPtr<VMObject>&& obj)
 {
     if (m_vmobject.ptr() == obj.ptr())
@@ -180,6 +201,20 @@ size_t Region::amount_shared() const
     return bytes;
 }
 
+size_t Region::amount_large_page_backed() const
+{
+    if (!m_page_directory || !can_use_large_pages())
+        return 0;
+    size_t bytes = 0;
+    auto& page_directory = const_cast<PageDirectory&>(*m_page_directory);
+    SpinlockLocker page_lock(page_directory.get_lock());
+    for (auto address = align_up_to(vaddr().get(), LARGE_PAGE_SIZE); address + LARGE_PAGE_SIZE <= range().end().get(); address += LARGE_PAGE_SIZE) {
+        if (MM.is_mapped_as_large_page(page_directory, VirtualAddress { address }))
+            bytes += LARGE_PAGE_SIZE;
+    }
+    return bytes;
+}
+
 ErrorOr<NonnullOwnPtr<Region>> Region::try_create_user_accessible(VirtualRange const& range, NonnullLockRefPtr<VMObject> vmobject, size_t offset_in_vmobject, OwnPtr<KString> name, Region::Access access, Cacheable cacheable, bool shared)
 {
     return adopt_nonnull_own_or_enomem(new (nothrow) Region(range, move(vmobject), offset_in_vmobject, move(name), access, cacheable, shared));
@@ -236,6 +271,50 @@ bool Region::map_individual_page_impl(size_t page_index, RefPtr<PhysicalPage> pa
     return true;
 }
 
+bool Region::can_use_large_pages() const
+{
+#if ARCH(X86_64)
+    return is_user() && vmobject().is_anonymous() && m_cacheable && !m_write_combine;
+#else
+    return false;
+#endif
+}
+
+bool Region::map_large_page_if_possible(size_t page_index)
+{
+    VERIFY(m_page_directory->get_lock().is_locked_by_current_processor());
+
+    auto page_vaddr = vaddr_from_page_index(page_index);
+    if (page_vaddr.get() % LARGE_PAGE_SIZE != 0 || page_index + PAGES_PER_LARGE_PAGE > page_count())
+        return false;
+    if (!can_use_large_pages() || (!is_readable() && !is_writable()))
+        return false;
+
+    PhysicalAddress large_page_base;
+    {
+        SpinlockLocker vmobject_locker(vmobject().m_lock);
+        auto first_page_index_in_vmobject = translate_to_vmobject_page(page_index);
+        auto physical_pages = const_cast<VMObject const&>(vmobject()).physical_pages();
+        auto const& first_page = physical_pages[first_page_index_in_vmobject];
+        if (!first_page || first_page->paddr().get() % LARGE_PAGE_SIZE != 0)
+            return false;
+        large_page_base = first_page->paddr();
+
+        // All pages have to be physically contiguous, and need to be mapped with the same permissions.
+        for (size_t i = 0; i < PAGES_PER_LARGE_PAGE; ++i) {
+            auto const& page = physical_pages[first_page_index_in_vmobject + i];
+            if (!page || page->paddr() != large_page_base.offset(i * PAGE_SIZE) || should_cow(page_index + i))
+                return false;
+        }
+    }
+
+    MemoryManager::LargePageFlags flags;
+    flags.writable = is_writable();
+    flags.user_allowed = page_vaddr.get() >= USER_RANGE_BASE && is_user_address(page_vaddr);
+    flags.execute_disabled = Processor::current().has_nx() && !is_executable();
+    return MM.map_large_page(*m_page_directory, page_vaddr, large_page_base, flags);
+}
+
 bool Region::map_individual_page_impl(size_t page_index)
 {
     RefPtr<PhysicalPage> page;
@@ -260,6 +339,18 @@ bool Region::remap_vmobject_page(size_t page_index, NonnullRefPtr<PhysicalPage>
     return success;
 }
 
+bool Region::remap_vmobject_page_in_all_regions(size_t page_index, NonnullRefPtr<PhysicalPage> physical_page)
+{
+    bool success = remap_vmobject_page(page_index, physical_page);
+    // NOTE: Other regions showing this VMObject (like those of a vfork() parent and its child) would otherwise keep
+    //       the page that was just replaced mapped, and then fail to handle the next write fault on it.
+    vmobject().for_each_region([&](Region& region) {
+        if (&region != this && region.m_page_directory)
+            (void)region.remap_vmobject_page(page_index, physical_page);
+    });
+    return success;
+}
+
 void Region::unmap(ShouldFlushTLB should_flush_tlb)
 {
     if (!m_page_directory)
@@ -275,6 +366,10 @@ void Region::unmap_with_locks_held(ShouldFlushTLB should_flush_tlb, SpinlockLock
     size_t count = page_count();
     for (size_t i = 0; i < count; ++i) {
         auto vaddr = vaddr_from_page_index(i);
+        if (vaddr.get() % LARGE_PAGE_SIZE == 0 && i + PAGES_PER_LARGE_PAGE <= count && MM.release_large_page(*m_page_directory, vaddr)) {
+            i += PAGES_PER_LARGE_PAGE - 1;
+            continue;
+        }
         MM.release_pte(*m_page_directory, vaddr, i == count - 1 ? MemoryManager::IsLastPTERelease::Yes : MemoryManager::IsLastPTERelease::No);
     }
     if (should_flush_tlb == ShouldFlushTLB::Yes)
@@ -300,6 +395,10 @@ ErrorOr<void> Region::map(PageDirectory& page_directory, ShouldFlushTLB should_f
     set_page_directory(page_directory);
     size_t page_index = 0;
     while (page_index < page_count()) {
+        if (map_large_page_if_possible(page_index)) {
+            page_index += PAGES_PER_LARGE_PAGE;
+            continue;
+        }
         if (!map_individual_page_impl(page_index))
             break;
         ++page_index;
@@ -369,10 +468,35 @@ PageFaultResponse Region::handle_fault(PageFault const& fault)
             auto page_index_in_vmobject = translate_to_vmobject_page(page_index_in_region);
             VERIFY(m_vmobject->is_anonymous());
             page_slot = static_cast<AnonymousVMObject&>(*m_vmobject).allocate_committed_page({});
-            if (!remap_vmobject_page(page_index_in_vmobject, *page_slot))
+            if (!remap_vmobject_page_in_all_regions(page_index_in_vmobject, *page_slot))
                 return PageFaultResponse::OutOfMemory;
             return PageFaultResponse::Continue;
         }
+        // NOTE: Regions cloned by fork() don't get their pages mapped up front, so the page can be missing from
+        //       the page tables even though the VMObject has it. It can also have been dropped because we couldn't
+        //       split the large page around it. Either way, we just have to map it (again).
+        if (page_slot && page_slot->is_shared_zero_page()) {
+            if (fault.is_write()) {
+                NonnullRefPtr<PhysicalPage> zero_page = *page_slot;
+                vmobject_locker.unlock();
+                return handle_zero_fault(page_index_in_region, *zero_page);
+            }
+            if (!remap_vmobject_page(translate_to_vmobject_page(page_index_in_region), *page_slot))
+                return PageFaultResponse::OutOfMemory;
+            map_resident_pages_around(page_index_in_region);
+            return PageFaultResponse::Continue;
+        }
+        if (page_slot) {
+            if (!remap_vmobject_page(translate_to_vmobject_page(page_index_in_region), *page_slot))
+                return PageFaultResponse::OutOfMemory;
+            map_resident_pages_around(page_index_in_region);
+            if (fault.is_write() && should_cow(page_index_in_region)) {
+                // The COW fault handler copies the page through our mapping, so it had to be mapped first.
+                vmobject_locker.unlock();
+                return handle_cow_fault(page_index_in_region);
+            }
+            return PageFaultResponse::Continue;
+        }
         dbgln("BUG! Unexpected NP fault at {}", fault.vaddr());
         dbgln("     - Physical page slot pointer: {:p}", page_slot.ptr());
         if (page_slot) {
@@ -406,6 +530,11 @@ PageFaultResponse Region::handle_zero_fault(size_t page_index_in_region, Physica
     if (current_thread != nullptr)
         current_thread->did_zero_fault();
 
+    if (try_populate_large_page(page_index_in_region)) {
+        dbgln_if(PAGE_FAULT_DEBUG, "      >> POPULATED LARGE PAGE around {}", vaddr_from_page_index(page_index_in_region));
+        return PageFaultResponse::Continue;
+    }
+
     RefPtr<PhysicalPage> new_physical_page;
 
     if (page_in_slot_at_time_of_fault.is_lazy_committed_page()) {
@@ -437,13 +566,46 @@ PageFaultResponse Region::handle_zero_fault(size_t page_index_in_region, Physica
         }
     }
 
-    if (!remap_vmobject_page(page_index_in_vmobject, *new_physical_page)) {
+    if (!remap_vmobject_page_in_all_regions(page_index_in_vmobject, *new_physical_page)) {
         dmesgln("MM: handle_zero_fault was unable to allocate a page table to map {}", new_physical_page);
         return PageFaultResponse::OutOfMemory;
     }
     return PageFaultResponse::Continue;
 }
 
+bool Region::try_populate_large_page(size_t page_index_in_region)
+{
+    if (!can_use_large_pages() || !m_page_directory)
+        return false;
+
+    auto large_page_vaddr = VirtualAddress { vaddr_from_page_index(page_index_in_region).get() & ~(LARGE_PAGE_SIZE - 1) };
+    if (large_page_vaddr < vaddr() || large_page_vaddr.offset(LARGE_PAGE_SIZE) > range().end())
+        return false;
+    auto first_page_index = page_index_from_address(large_page_vaddr);
+
+    {
+        SpinlockLocker locker(vmobject().m_lock);
+        // Other regions showing this VMObject would keep the shared zero pages mapped, so leave those to the slow path.
+        size_t region_count = 0;
+        vmobject().for_each_region([&](auto&) { ++region_count; });
+        if (region_count > 1)
+            return false;
+        if (!static_cast<AnonymousVMObject&>(vmobject()).try_populate_large_page({}, translate_to_vmobject_page(first_page_index)))
+            return false;
+    }
+
+    SpinlockLocker page_lock(m_page_directory->get_lock());
+    bool success = map_large_page_if_possible(first_page_index);
+    if (!success) {
+        // The pages are in the VMObject now, so we have to map them one way or another.
+        success = true;
+        for (size_t i = 0; i < PAGES_PER_LARGE_PAGE && success; ++i)
+            success = map_individual_page_impl(first_page_index + i);
+    }
+    MemoryManager::flush_tlb(m_page_directory, large_page_vaddr, PAGES_PER_LARGE_PAGE);
+    return success;
+}
+
 PageFaultResponse Region::handle_cow_fault(size_t page_index_in_region)
 {
     auto current_thread = Thread::current();
@@ -455,11 +617,42 @@ PageFaultResponse Region::handle_cow_fault(size_t page_index_in_region)
 
     auto page_index_in_vmobject = translate_to_vmobject_page(page_index_in_region);
     auto response = reinterpret_cast<AnonymousVMObject&>(vmobject()).handle_cow_fault(page_index_in_vmobject, vaddr().offset(page_index_in_region * PAGE_SIZE));
-    if (!remap_vmobject_page(page_index_in_vmobject, *vmobject().physical_pages()[page_index_in_vmobject]))
+    if (!remap_vmobject_page_in_all_regions(page_index_in_vmobject, *vmobject().physical_pages()[page_index_in_vmobject]))
         return PageFaultResponse::OutOfMemory;
     return response;
 }
 
+Region::FaultAroundWindow Region::fault_around_window(size_t page_index_in_region) const
+{
+    size_t window_size = g_fault_around_pages.load(AK::MemoryOrder::memory_order_relaxed);
+    if (window_size <= 1)
+        return { page_index_in_region, page_index_in_region + 1 };
+    // NOTE: We align the window in the VMObject rather than in the Region, so that
+    //       all mappings of the same file agree on which pages belong together.
+    auto page_index_in_vmobject = translate_to_vmobject_page(page_index_in_region);
+    auto window_start_in_vmobject = page_index_in_vmobject - (page_index_in_vmobject % window_size);
+    auto first_page_index = page_index_in_region - min(page_index_in_vmobject - window_start_in_vmobject, page_index_in_region);
+    auto end_page_index = min(first_page_index + window_size, page_count());
+    return { first_page_index, end_page_index };
+}
+
+void Region::map_resident_pages_around(size_t page_index_in_region)
+{
+    auto window = fault_around_window(page_index_in_region);
+    if (window.end_page_index - window.first_page_index <= 1)
+        return;
+
+    SpinlockLocker page_lock(m_page_directory->get_lock());
+    for (size_t page_index = window.first_page_index; page_index < window.end_page_index; ++page_index) {
+        if (page_index == page_index_in_region)
+            continue;
+        // NOTE: Pages that aren't resident yet will simply stay unmapped.
+        if (!map_individual_page_impl(page_index))
+            break;
+    }
+    MemoryManager::flush_tlb(m_page_directory, vaddr_from_page_index(window.first_page_index), window.end_page_index - window.first_page_index);
+}
+
 PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
 {
     VERIFY(vmobject().is_inode());
@@ -470,6 +663,9 @@ PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
     auto page_index_in_vmobject = translate_to_vmobject_page(page_index_in_region);
     auto& vmobject_physical_page_slot = inode_vmobject.physical_pages()[page_index_in_vmobject];
 
+    auto window = fault_around_window(page_index_in_region);
+    size_t pages_to_read = 1;
+
     {
         // NOTE: The VMObject lock is required when manipulating the VMObject's physical page slot.
         SpinlockLocker locker(inode_vmobject.m_lock);
@@ -477,21 +673,39 @@ PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
             dbgln_if(PAGE_FAULT_DEBUG, "handle_inode_fault: Page faulted in by someone else before reading, remapping.");
             if (!remap_vmobject_page(page_index_in_vmobject, *vmobject_physical_page_slot))
                 return PageFaultResponse::OutOfMemory;
+            locker.unlock();
+            map_resident_pages_around(page_index_in_region);
             return PageFaultResponse::Continue;
         }
+
+        // Read in the missing pages that directly follow this one within the window together with it.
+        auto physical_pages = inode_vmobject.physical_pages();
+        while (page_index_in_region + pages_to_read < window.end_page_index && physical_pages[page_index_in_vmobject + pages_to_read].is_null())
+            ++pages_to_read;
     }
 
-    dbgln_if(PAGE_FAULT_DEBUG, "Inode fault in {} page index: {}", name(), page_index_in_region);
+    dbgln_if(PAGE_FAULT_DEBUG, "Inode fault in {} page index: {}, reading {} pages", name(), page_index_in_region, pages_to_read);
 
     auto current_thread = Thread::current();
     if (current_thread)
         current_thread->did_inode_fault();
 
     u8 page_buffer[PAGE_SIZE];
+    u8* read_buffer = page_buffer;
+    ByteBuffer batch_buffer;
+    if (pages_to_read > 1) {
+        if (auto buffer_or_error = ByteBuffer::create_uninitialized(pages_to_read * PAGE_SIZE); !buffer_or_error.is_error()) {
+            batch_buffer = buffer_or_error.release_value();
+            read_buffer = batch_buffer.data();
+        } else {
+            pages_to_read = 1;
+        }
+    }
+
     auto& inode = inode_vmobject.inode();
 
-    auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer);
-    auto result = inode.read_bytes(page_index_in_vmobject * PAGE_SIZE, PAGE_SIZE, buffer, nullptr);
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(read_buffer);
+    auto result = inode.read_bytes(page_index_in_vmobject * PAGE_SIZE, pages_to_read * PAGE_SIZE, buffer, nullptr);
 
     if (result.is_error()) {
         dmesgln("handle_inode_fault: Error ({}) while reading from inode", result.error());
@@ -504,43 +718,56 @@ PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
     if (nread == 0)
         return PageFaultResponse::BusError;
 
-    if (nread < PAGE_SIZE) {
+    if (nread % PAGE_SIZE) {
         // If we read less than a page, zero out the rest to avoid leaking uninitialized data.
-        memset(page_buffer + nread, 0, PAGE_SIZE - nread);
+        memset(read_buffer + nread, 0, PAGE_SIZE - (nread % PAGE_SIZE));
     }
 
-    // Allocate a new physical page, and copy the read inode contents into it.
-    auto new_physical_page_or_error = MM.allocate_physical_page(MemoryManager::ShouldZeroFill::No);
-    if (new_physical_page_or_error.is_error()) {
-        dmesgln("MM: handle_inode_fault was unable to allocate a physical page");
-        return PageFaultResponse::OutOfMemory;
-    }
-    auto new_physical_page = new_physical_page_or_error.release_value();
-    {
-        InterruptDisabler disabler;
-        u8* dest_ptr = MM.quickmap_page(*new_physical_page);
-        memcpy(dest_ptr, page_buffer, PAGE_SIZE);
-        MM.unquickmap_page();
-    }
+    size_t pages_read = ceil_div(nread, static_cast<size_t>(PAGE_SIZE));
+    for (size_t i = 0; i < pages_read; ++i) {
+        // Allocate a new physical page, and copy the read inode contents into it.
+        auto new_physical_page_or_error = MM.allocate_physical_page(MemoryManager::ShouldZeroFill::No);
+        if (new_physical_page_or_error.is_error()) {
+            // The neighboring pages were only a bonus, but we do need the page that faulted.
+            if (i > 0)
+                break;
+            dmesgln("MM: handle_inode_fault was unable to allocate a physical page");
+            return PageFaultResponse::OutOfMemory;
+        }
+        auto new_physical_page = new_physical_page_or_error.release_value();
+        {
+            InterruptDisabler disabler;
+            u8* dest_ptr = MM.quickmap_page(*new_physical_page);
+            memcpy(dest_ptr, read_buffer + i * PAGE_SIZE, PAGE_SIZE);
+            MM.unquickmap_page();
+        }
 
-    {
         // NOTE: The VMObject lock is required when manipulating the VMObject's physical page slot.
         SpinlockLocker locker(inode_vmobject.m_lock);
-
-        if (!vmobject_physical_page_slot.is_null()) {
+        auto& physical_page_slot = inode_vmobject.physical_pages()[page_index_in_vmobject + i];
+        if (!physical_page_slot.is_null()) {
             // Someone else faulted in this page while we were reading from the inode.
-            // No harm done (other than some duplicate work), remap the page here and return.
+            // No harm done (other than some duplicate work), we'll just use their page.
             dbgln_if(PAGE_FAULT_DEBUG, "handle_inode_fault: Page faulted in by someone else, remapping.");
-            if (!remap_vmobject_page(page_index_in_vmobject, *vmobject_physical_page_slot))
-                return PageFaultResponse::OutOfMemory;
-            return PageFaultResponse::Continue;
+            continue;
         }
+        physical_page_slot = new_physical_page;
+    }
 
-        vmobject_physical_page_slot = new_physical_page;
+    {
+        SpinlockLocker locker(inode_vmobject.m_lock);
+        // NOTE: If the page was released again in the meantime, we'll just fault on it once more.
+        if (!vmobject_physical_page_slot.is_null() && !remap_vmobject_page(page_index_in_vmobject, *vmobject_physical_page_slot))
+            return PageFaultResponse::OutOfMemory;
     }
 
-    if (!remap_vmobject_page(page_index_in_vmobject, *vmobject_physical_page_slot))
-        return PageFaultResponse::OutOfMemory;
+    map_resident_pages_around(page_index_in_region);
+
+    // Get the rest of the window on its way into the cache, so that faulting it in later doesn't have to wait for the disk.
+    auto first_missing_page_index_in_vmobject = page_index_in_vmobject + pages_read;
+    auto window_end_in_vmobject = translate_to_vmobject_page(window.end_page_index - 1) + 1;
+    if (pages_read == pages_to_read && first_missing_page_index_in_vmobject < window_end_in_vmobject)
+        inode.read_ahead(first_missing_page_index_in_vmobject * PAGE_SIZE, (window_end_in_vmobject - first_missing_page_index_in_vmobject) * PAGE_SIZE);
 
     return PageFaultResponse::Continue;
 }
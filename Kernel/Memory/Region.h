@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <AK/Atomic.h>
 #include <AK/EnumBits.h>
 #include <AK/IntrusiveList.h>
 #include <AK/IntrusiveRedBlackTree.h>
@@ -30,8 +31,16 @@ enum class ShouldFlushTLB {
     Yes,
 };
 
+// When servicing a page fault in a file-backed region, we also read in and map the pages
+// around it, within an aligned window of this many pages. 0 or 1 turns this off.
+// This can be tuned through /sys/kernel/variables/fault_around_pages.
+static constexpr size_t default_fault_around_pages = 16;
+static constexpr size_t max_fault_around_pages = 64;
+extern Atomic<size_t> g_fault_around_pages;
+
 class Region final
     : public LockWeakable<Region> {
+    friend class AnonymousVMObject;
     friend class AddressSpace;
     friend class MemoryManager;
     friend class RegionTree;
@@ -110,6 +119,7 @@ public:
     PageFaultResponse handle_fault(PageFault const&);
 
     ErrorOr<NonnullOwnPtr<Region>> try_clone();
+    ErrorOr<NonnullOwnPtr<Region>> try_clone_sharing_vmobject();
 
     [[nodiscard]] bool contains(VirtualAddress vaddr) const
     {
@@ -178,6 +188,7 @@ public:
     [[nodiscard]] size_t amount_resident() const;
     [[nodiscard]] size_t amount_shared() const;
     [[nodiscard]] size_t amount_dirty() const;
+    [[nodiscard]] size_t amount_large_page_backed() const;
 
     [[nodiscard]] bool should_cow(size_t page_index) const;
     ErrorOr<void> set_should_cow(size_t page_index, bool);
@@ -213,6 +224,11 @@ private:
     Region(VirtualRange const&, NonnullLockRefPtr<VMObject>, size_t offset_in_vmobject, OwnPtr<KString>, Region::Access access, Cacheable, bool shared);
 
     [[nodiscard]] bool remap_vmobject_page(size_t page_index, NonnullRefPtr<PhysicalPage>);
+    [[nodiscard]] bool remap_vmobject_page_in_all_regions(size_t page_index, NonnullRefPtr<PhysicalPage>);
+
+    [[nodiscard]] bool can_use_large_pages() const;
+    [[nodiscard]] bool map_large_page_if_possible(size_t page_index);
+    [[nodiscard]] bool try_populate_large_page(size_t page_index);
 
     void set_access_bit(Access access, bool b)
     {
@@ -224,6 +240,12 @@ private:
 
     [[nodiscard]] PageFaultResponse handle_cow_fault(size_t page_index);
     [[nodiscard]] PageFaultResponse handle_inode_fault(size_t page_index);
+    struct FaultAroundWindow {
+        size_t first_page_index { 0 };
+        size_t end_page_index { 0 };
+    };
+    [[nodiscard]] FaultAroundWindow fault_around_window(size_t page_index) const;
+    void map_resident_pages_around(size_t page_index);
     [[nodiscard]] PageFaultResponse handle_zero_fault(size_t page_index, PhysicalPage& page_in_slot_at_time_of_fault);
 
     [[nodiscard]] bool map_individual_page_impl(size_t page_index);
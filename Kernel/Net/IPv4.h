@@ -121,4 +121,19 @@ inline NetworkOrdered<u16> internet_checksum(void const* ptr, size_t count)
     return ~checksum & 0xffff;
 }
 
+// The (not yet complemented) checksum of the pseudo header that TCP and UDP checksums cover, which is what
+// adapters that finish these checksums expect to find in the checksum field.
+inline NetworkOrdered<u16> ipv4_pseudo_header_checksum(IPv4Address const& source, IPv4Address const& destination, IPv4Protocol protocol, u16 length)
+{
+    struct [[gnu::packed]] {
+        IPv4Address source;
+        IPv4Address destination;
+        u8 zero;
+        u8 protocol;
+        NetworkOrdered<u16> length;
+    } pseudo_header { source, destination, 0, (u8)protocol, length };
+    static_assert(sizeof(pseudo_header) == 12);
+    return ~static_cast<u16>(internet_checksum(&pseudo_header, sizeof(pseudo_header))) & 0xffff;
+}
+
 }
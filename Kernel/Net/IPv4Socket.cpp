@@ -40,6 +40,11 @@ ErrorOr<NonnullOwnPtr<DoubleBuffer>> IPv4Socket::try_create_receive_buffer()
     return DoubleBuffer::try_create("IPv4Socket: Receive buffer"sv, 256 * KiB);
 }
 
+size_t IPv4Socket::space_in_receive_buffer() const
+{
+    return m_receive_buffer ? m_receive_buffer->space_for_writing() : 0;
+}
+
 ErrorOr<NonnullLockRefPtr<Socket>> IPv4Socket::create(int type, int protocol)
 {
     auto receive_buffer = TRY(IPv4Socket::try_create_receive_buffer());
@@ -429,6 +434,7 @@ bool IPv4Socket::did_receive(IPv4Address const& source_address, u16 source_port,
         if (packet_size > space_in_receive_buffer) {
             dbgln("IPv4Socket({}): did_receive refusing packet since buffer is full.", this);
             VERIFY(m_can_read);
+            m_packets_dropped++;
             return false;
         }
         auto scratch_buffer = UserOrKernelBuffer::for_kernel_buffer(m_scratch_buffer->data());
@@ -440,8 +446,9 @@ bool IPv4Socket::did_receive(IPv4Address const& source_address, u16 source_port,
             return false;
         set_can_read(!m_receive_buffer->is_empty());
     } else {
-        if (m_receive_queue.size() > 2000) {
+        if (m_receive_queue.size() > maximum_receive_queue_size) {
             dbgln("IPv4Socket({}): did_receive refusing packet since queue is full.", this);
+            m_packets_dropped++;
             return false;
         }
         auto data_or_error = KBuffer::try_create_with_bytes("IPv4Socket: Packet buffer"sv, packet);
@@ -47,6 +47,8 @@ public:
     virtual ErrorOr<void> ioctl(OpenFileDescription&, unsigned request, Userspace<void*> arg) override;
 
     bool did_receive(IPv4Address const& peer_address, u16 peer_port, ReadonlyBytes, Time const&);
+    // The number of packets that were refused because the receive queue or buffer was full.
+    u32 packets_dropped() const { return m_packets_dropped; }
 
     IPv4Address const& local_address() const { return m_local_address; }
     u16 local_port() const { return m_local_port; }
@@ -94,6 +96,7 @@ protected:
 
     static ErrorOr<NonnullOwnPtr<DoubleBuffer>> try_create_receive_buffer();
     void drop_receive_buffer();
+    size_t space_in_receive_buffer() const;
 
 private:
     virtual bool is_ipv4() const override { return true; }
@@ -116,6 +119,8 @@ private:
         OwnPtr<KBuffer> data;
     };
 
+    // Incoming packets wait here until they are read, packets beyond this limit are dropped.
+    static constexpr size_t maximum_receive_queue_size = 2000;
     SinglyLinkedList<ReceivedPacket, CountingSizeCalculationPolicy> m_receive_queue;
 
     OwnPtr<DoubleBuffer> m_receive_buffer;
@@ -124,6 +129,7 @@ private:
     u16 m_peer_port { 0 };
 
     u32 m_bytes_received { 0 };
+    u32 m_packets_dropped { 0 };
 
     u8 m_type_of_service { IPTOS_LOWDELAY };
     u8 m_ttl { 64 };
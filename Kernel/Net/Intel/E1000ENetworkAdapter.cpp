@@ -223,6 +223,8 @@ UNMAP_AFTER_INIT ErrorOr<void> E1000ENetworkAdapter::initialize(Badge<Networking
 
     initialize_rx_descriptors();
     initialize_tx_descriptors();
+    setup_checksum_offload();
+    set_capabilities(Capability::TransmitChecksum | Capability::ReceiveChecksum | Capability::TCPSegmentation, maximum_tcp_segmentation_size);
 
     setup_link();
     setup_interrupts();
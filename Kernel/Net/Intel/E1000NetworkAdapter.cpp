@@ -10,7 +10,9 @@
 #include <Kernel/Debug.h>
 #include <Kernel/Net/Intel/E1000NetworkAdapter.h>
 #include <Kernel/Net/NetworkingManagement.h>
+#include <Kernel/Net/TCP.h>
 #include <Kernel/Sections.h>
+#include <Kernel/WorkQueue.h>
 
 namespace Kernel {
 
@@ -39,6 +41,7 @@ namespace Kernel {
 #define REG_RADV 0x282C             // RX Int. Absolute Delay Timer
 #define REG_RSRPD 0x2C00            // RX Small Packet Detect Interrupt
 #define REG_TIPG 0x0410             // Transmit Inter Packet Gap
+#define REG_RXCSUM 0x5000           // RX Checksum Control
 #define ECTRL_SLU 0x40              // set link up
 #define RCTL_EN (1 << 1)            // Receiver Enable
 #define RCTL_SBP (1 << 2)           // Store Bad Packets
@@ -71,6 +74,19 @@ namespace Kernel {
 #define RCTL_BSIZE_8192 ((2 << 16) | (1 << 25))
 #define RCTL_BSIZE_16384 ((1 << 16) | (1 << 25))
 
+// RX Checksum Control
+
+#define RXCSUM_IPOFL (1 << 8) // IP Checksum Offload Enable
+#define RXCSUM_TUOFL (1 << 9) // TCP/UDP Checksum Offload Enable
+
+// Receive Status and Errors
+
+#define RSTA_DD (1 << 0)   // Descriptor Done
+#define RSTA_EOP (1 << 1)  // End of Packet
+#define RSTA_IXSM (1 << 2) // Ignore Checksum Indication
+#define RERR_TCPE (1 << 5) // TCP/UDP Checksum Error
+#define RERR_IPE (1 << 6)  // IP Checksum Error
+
 // Transmit Command
 
 #define CMD_EOP (1 << 0)  // End of Packet
@@ -81,6 +97,28 @@ namespace Kernel {
 #define CMD_VLE (1 << 6)  // VLAN Packet Enable
 #define CMD_IDE (1 << 7)  // Interrupt Delay Enable
 
+// Extended (context and data) Transmit Descriptors, as they appear in the third dword
+
+#define DTYP_CONTEXT (0 << 20) // Context Descriptor
+#define DTYP_DATA (1 << 20)    // Data Descriptor
+#define TUCMD_TCP (1 << 24)    // Packet is TCP (instead of UDP)
+#define TUCMD_IP (1 << 25)     // Packet is IPv4
+#define TUCMD_TSE (1 << 26)    // TCP Segmentation Enable
+#define TUCMD_RS (1 << 27)     // Report Status
+#define TUCMD_DEXT (1 << 29)   // Descriptor Extension
+#define DCMD_EOP (1 << 24)     // End of Packet
+#define DCMD_IFCS (1 << 25)    // Insert FCS
+#define DCMD_TSE (1 << 26)     // TCP Segmentation Enable
+#define DCMD_RS (1 << 27)      // Report Status
+#define DCMD_DEXT (1 << 29)    // Descriptor Extension
+#define POPTS_IXSM (1 << 0)    // Insert IP Checksum
+#define POPTS_TXSM (1 << 1)    // Insert TCP/UDP Checksum
+
+// Where the checksums are, relative to the start of their header
+static constexpr u8 ipv4_checksum_offset = 10;
+static constexpr u8 tcp_checksum_offset = 16;
+static constexpr u8 udp_checksum_offset = 6;
+
 // TCTL Register
 
 #define TCTL_EN (1 << 1)      // Transmit Enable
@@ -121,6 +159,8 @@ namespace Kernel {
 #define INTERRUPT_TXD_LOW (1 << 15)
 #define INTERRUPT_SRPD (1 << 16)
 
+static constexpr u32 receive_interrupts = INTERRUPT_RXT0 | INTERRUPT_RXO | INTERRUPT_RXDMT0;
+
 // https://www.intel.com/content/dam/doc/manual/pci-pci-x-family-gbe-controllers-software-dev-manual.pdf Section 5.2
 UNMAP_AFTER_INIT static bool is_valid_device_id(u16 device_id)
 {
@@ -202,6 +242,8 @@ UNMAP_AFTER_INIT ErrorOr<void> E1000NetworkAdapter::initialize(Badge<NetworkingM
 
     initialize_rx_descriptors();
     initialize_tx_descriptors();
+    setup_checksum_offload();
+    set_capabilities(Capability::TransmitChecksum | Capability::ReceiveChecksum);
 
     setup_link();
     setup_interrupts();
@@ -219,12 +261,19 @@ UNMAP_AFTER_INIT void E1000NetworkAdapter::setup_link()
 
 UNMAP_AFTER_INIT void E1000NetworkAdapter::setup_interrupts()
 {
-    out32(REG_INTERRUPT_RATE, 6000); // Interrupt rate of 1.536 milliseconds
-    out32(REG_INTERRUPT_MASK_SET, INTERRUPT_LSC | INTERRUPT_RXT0 | INTERRUPT_RXO);
+    // NOTE: Received packets are polled in batches once the first interrupt came in,
+    //       so we can afford a much shorter interval than without that.
+    out32(REG_INTERRUPT_RATE, 500); // Interrupt rate of 128 microseconds
+    out32(REG_INTERRUPT_MASK_SET, INTERRUPT_LSC | receive_interrupts);
     in32(REG_INTERRUPT_CAUSE_READ);
     enable_irq();
 }
 
+UNMAP_AFTER_INIT void E1000NetworkAdapter::setup_checksum_offload()
+{
+    out32(REG_RXCSUM, in32(REG_RXCSUM) | RXCSUM_IPOFL | RXCSUM_TUOFL);
+}
+
 UNMAP_AFTER_INIT E1000NetworkAdapter::E1000NetworkAdapter(PCI::DeviceIdentifier const& device_identifier, u8 irq,
     NonnullOwnPtr<IOWindow> registers_io_window, NonnullOwnPtr<Memory::Region> rx_buffer_region,
     NonnullOwnPtr<Memory::Region> tx_buffer_region, NonnullOwnPtr<Memory::Region> rx_descriptors_region,
@@ -257,17 +306,17 @@ bool E1000NetworkAdapter::handle_irq(RegisterState const&)
 
         m_link_up = ((in32(REG_STATUS) & STATUS_LU) != 0);
     }
-    if (status & INTERRUPT_RXDMT0) {
-        // Threshold OK?
-    }
     if (status & INTERRUPT_RXO) {
         dbgln_if(E1000_DEBUG, "E1000: RX buffer overrun");
     }
-    if (status & INTERRUPT_RXT0) {
-        receive();
+    if (status & receive_interrupts) {
+        schedule_receive_poll();
+    }
+    if (status & INTERRUPT_TXDW) {
+        // Someone is waiting for room in the transmit ring, see wait_for_tx_descriptors().
+        out32(REG_INTERRUPT_MASK_CLEAR, INTERRUPT_TXDW);
+        m_wait_queue.wake_all();
     }
-
-    m_wait_queue.wake_all();
 
     out32(REG_INTERRUPT_CAUSE_READ, 0xffffffff);
     return true;
@@ -400,51 +449,195 @@ u32 E1000NetworkAdapter::in32(u16 address)
     return m_registers_io_window->read32(address);
 }
 
-void E1000NetworkAdapter::send_raw(ReadonlyBytes payload)
+size_t E1000NetworkAdapter::reclaim_tx_descriptors()
 {
-    disable_irq();
-    size_t tx_current = in32(REG_TXDESCTAIL) % number_of_tx_descriptors;
-    dbgln_if(E1000_DEBUG, "E1000: Sending packet ({} bytes)", payload.size());
     auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
-    auto& descriptor = tx_descriptors[tx_current];
-    VERIFY(payload.size() <= 8192);
-    auto* vptr = (void*)m_tx_buffers[tx_current];
-    memcpy(vptr, payload.data(), payload.size());
-    descriptor.length = payload.size();
-    descriptor.status = 0;
-    descriptor.cmd = CMD_EOP | CMD_IFCS | CMD_RS;
-    dbgln_if(E1000_DEBUG, "E1000: Using tx descriptor {} (head is at {})", tx_current, in32(REG_TXDESCHEAD));
-    tx_current = (tx_current + 1) % number_of_tx_descriptors;
-    Processor::disable_interrupts();
-    enable_irq();
-    out32(REG_TXDESCTAIL, tx_current);
+    while (m_tx_clean != m_tx_next && (tx_descriptors[m_tx_clean].status & TSTA_DD))
+        m_tx_clean = (m_tx_clean + 1) % number_of_tx_descriptors;
+    // NOTE: One descriptor always stays unused, otherwise a full ring would look just like an empty one.
+    return (m_tx_clean + number_of_tx_descriptors - m_tx_next - 1) % number_of_tx_descriptors;
+}
+
+void E1000NetworkAdapter::wait_for_tx_descriptors(size_t count)
+{
+    VERIFY(m_tx_lock.is_locked());
+    if (reclaim_tx_descriptors() >= count)
+        return;
+
+    // We only ask for an interrupt once the ring is full, everything else is cleaned up lazily.
+    // NOTE: handle_irq() masks TXDW again whenever it fires, and that interrupt might not have freed
+    //       enough descriptors (or might have come before we started waiting), so we have to unmask
+    //       it again before every check.
     for (;;) {
-        if (descriptor.status) {
-            Processor::enable_interrupts();
-            break;
-        }
+        out32(REG_INTERRUPT_MASK_SET, INTERRUPT_TXDW);
+        if (reclaim_tx_descriptors() >= count)
+            return;
+        dbgln_if(E1000_DEBUG, "E1000: No free TX descriptors, waiting for the hardware");
         m_wait_queue.wait_forever("E1000NetworkAdapter"sv);
     }
-    dbgln_if(E1000_DEBUG, "E1000: Sent packet, status is now {:#02x}!", (u8)descriptor.status);
 }
 
-void E1000NetworkAdapter::receive()
+void E1000NetworkAdapter::send_raw(ReadonlyBytes payload, TransmitOffload offload)
 {
-    auto* rx_descriptors = (e1000_tx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
-    u32 rx_current;
-    for (;;) {
-        rx_current = in32(REG_RXDESCTAIL) % number_of_rx_descriptors;
-        rx_current = (rx_current + 1) % number_of_rx_descriptors;
-        if (!(rx_descriptors[rx_current].status & 1))
+    dbgln_if(E1000_DEBUG, "E1000: Sending packet ({} bytes)", payload.size());
+    VERIFY(payload.size() <= (offload.tcp_segment_size ? maximum_tcp_segmentation_size : tx_buffer_size));
+
+    // Offloads need a context descriptor in front of the data descriptors.
+    bool needs_context = offload.layer4_checksum || offload.tcp_segment_size;
+    size_t data_descriptor_count = ceil_div(payload.size(), tx_buffer_size);
+
+    MutexLocker locker(m_tx_lock);
+    wait_for_tx_descriptors(data_descriptor_count + (needs_context ? 1 : 0));
+
+    auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
+    size_t context_index = m_tx_next;
+    if (needs_context)
+        m_tx_next = (m_tx_next + 1) % number_of_tx_descriptors;
+    size_t first_data_index = m_tx_next;
+
+    for (size_t offset = 0; offset < payload.size(); offset += tx_buffer_size) {
+        size_t chunk_size = min(payload.size() - offset, tx_buffer_size);
+        memcpy(m_tx_buffers[m_tx_next], payload.data() + offset, chunk_size);
+        auto& descriptor = tx_descriptors[m_tx_next];
+        // NOTE: The address might have been overwritten if this was used as a context descriptor before.
+        descriptor.addr = m_tx_buffer_region->physical_page(m_tx_next * (tx_buffer_size / PAGE_SIZE))->paddr().get();
+        descriptor.length = chunk_size;
+        descriptor.status = 0;
+        m_tx_next = (m_tx_next + 1) % number_of_tx_descriptors;
+    }
+
+    if (!needs_context) {
+        VERIFY(data_descriptor_count == 1);
+        tx_descriptors[first_data_index].cmd = CMD_EOP | CMD_IFCS | CMD_RS;
+    } else {
+        // NOTE: The headers always end up in the first buffer, which is where we patch them up if necessary.
+        auto* frame = static_cast<u8*>(m_tx_buffers[first_data_index]);
+        auto& ipv4 = *reinterpret_cast<IPv4Packet*>(frame + sizeof(EthernetFrameHeader));
+        size_t ipv4_offset = sizeof(EthernetFrameHeader);
+        size_t layer4_offset = ipv4_offset + ipv4.internet_header_length() * sizeof(u32);
+        bool is_tcp = ipv4.protocol() == (u8)IPv4Protocol::TCP;
+        VERIFY(is_tcp || ipv4.protocol() == (u8)IPv4Protocol::UDP);
+
+        auto& context = *reinterpret_cast<e1000_tx_context_desc*>(&tx_descriptors[context_index]);
+        context.ipcss = 0;
+        context.ipcso = 0;
+        context.ipcse = 0;
+        context.tucss = layer4_offset;
+        context.tucso = layer4_offset + (is_tcp ? tcp_checksum_offset : udp_checksum_offset);
+        context.tucse = 0;
+        context.status = 0;
+        context.hdrlen = 0;
+        context.mss = 0;
+        u32 context_command = DTYP_CONTEXT | TUCMD_DEXT | TUCMD_IP | TUCMD_RS | (is_tcp ? TUCMD_TCP : 0);
+        u32 data_command = DTYP_DATA | DCMD_DEXT | DCMD_IFCS | DCMD_RS;
+        u32 payload_length = 0;
+
+        if (offload.tcp_segment_size) {
+            VERIFY(is_tcp);
+            auto& tcp = *reinterpret_cast<TCPPacket*>(frame + layer4_offset);
+            size_t header_length = layer4_offset + tcp.header_size();
+            // The hardware fills in the length and checksum of every segment's IPv4 header,
+            // and adds the length of each segment to the pseudo header checksum on its own.
+            ipv4.set_length(0);
+            ipv4.set_checksum(0);
+            tcp.set_checksum(ipv4_pseudo_header_checksum(ipv4.source(), ipv4.destination(), IPv4Protocol::TCP, 0));
+            context.ipcss = ipv4_offset;
+            context.ipcso = ipv4_offset + ipv4_checksum_offset;
+            context.ipcse = layer4_offset - 1;
+            context.hdrlen = header_length;
+            context.mss = offload.tcp_segment_size;
+            payload_length = payload.size() - header_length;
+            context_command |= TUCMD_TSE;
+            data_command |= DCMD_TSE;
+        }
+        context.paylen_dtyp_tucmd = context_command | payload_length;
+
+        for (size_t i = 0; i < data_descriptor_count; ++i) {
+            size_t index = (first_data_index + i) % number_of_tx_descriptors;
+            auto& descriptor = *reinterpret_cast<e1000_tx_data_desc*>(&tx_descriptors[index]);
+            u32 command = data_command | (i == data_descriptor_count - 1 ? DCMD_EOP : 0);
+            descriptor.length_dtyp_dcmd = command | min(payload.size() - i * tx_buffer_size, tx_buffer_size);
+            descriptor.popts = POPTS_TXSM | (offload.tcp_segment_size ? POPTS_IXSM : 0);
+            descriptor.special = 0;
+        }
+    }
+
+    dbgln_if(E1000_DEBUG, "E1000: Using tx descriptors {} to {}", context_index, m_tx_next);
+    out32(REG_TXDESCTAIL, m_tx_next);
+}
+
+bool E1000NetworkAdapter::has_received_packets() const
+{
+    auto* rx_descriptors = (e1000_rx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
+    return rx_descriptors[(m_rx_tail + 1) % number_of_rx_descriptors].status & RSTA_DD;
+}
+
+size_t E1000NetworkAdapter::receive()
+{
+    auto* rx_descriptors = (e1000_rx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
+    Vector<ReadonlyBytes, receive_poll_budget> packets;
+    size_t count = 0;
+    for (; count < receive_poll_budget; ++count) {
+        size_t rx_current = (m_rx_tail + 1 + count) % number_of_rx_descriptors;
+        auto& descriptor = rx_descriptors[rx_current];
+        if (!(descriptor.status & RSTA_DD))
             break;
+        if (!(descriptor.status & RSTA_IXSM) && (descriptor.errors & (RERR_TCPE | RERR_IPE))) {
+            dbgln_if(E1000_DEBUG, "E1000: Dropping packet with bad checksum");
+            did_drop_packet_with_bad_checksum();
+            continue;
+        }
         auto* buffer = m_rx_buffers[rx_current];
-        u16 length = rx_descriptors[rx_current].length;
-        VERIFY(length <= 8192);
+        u16 length = descriptor.length;
+        VERIFY(length <= rx_buffer_size);
         dbgln_if(E1000_DEBUG, "E1000: Received 1 packet @ {:p} ({} bytes)", buffer, length);
-        did_receive({ buffer, length });
-        rx_descriptors[rx_current].status = 0;
-        out32(REG_RXDESCTAIL, rx_current);
+        packets.unchecked_append({ buffer, length });
     }
+
+    if (count == 0)
+        return 0;
+
+    // NOTE: The packets are copied out of our buffers here, after that the hardware may have them back.
+    did_receive_batch(packets);
+    for (size_t i = 1; i <= count; ++i)
+        rx_descriptors[(m_rx_tail + i) % number_of_rx_descriptors].status = 0;
+    m_rx_tail = (m_rx_tail + count) % number_of_rx_descriptors;
+    out32(REG_RXDESCTAIL, m_rx_tail);
+    return count;
+}
+
+void E1000NetworkAdapter::schedule_receive_poll()
+{
+    if (m_receive_poll_scheduled.exchange(true))
+        return;
+
+    // Receive interrupts stay off until a poll finds the ring empty, so a burst of packets only costs us one of them.
+    out32(REG_INTERRUPT_MASK_CLEAR, receive_interrupts);
+    auto result = g_io_work->try_queue([this] { poll_receive(); });
+    if (result.is_error()) {
+        // NOTE: Without a work item we can't defer anything, so just empty the ring right away.
+        while (receive() == receive_poll_budget)
+            ;
+        m_receive_poll_scheduled = false;
+        out32(REG_INTERRUPT_MASK_SET, receive_interrupts);
+    }
+}
+
+void E1000NetworkAdapter::poll_receive()
+{
+    if (receive() == receive_poll_budget) {
+        // There's probably more, but give the other work items a chance first.
+        if (!g_io_work->try_queue([this] { poll_receive(); }).is_error())
+            return;
+        while (receive() == receive_poll_budget)
+            ;
+    }
+
+    m_receive_poll_scheduled = false;
+    out32(REG_INTERRUPT_MASK_SET, receive_interrupts);
+    // NOTE: If a packet arrived after we last looked, another interrupt might have acknowledged its cause already.
+    if (has_received_packets())
+        schedule_receive_poll();
 }
 
 i32 E1000NetworkAdapter::link_speed()
@@ -6,11 +6,13 @@
 
 #pragma once
 
+#include <AK/Atomic.h>
 #include <AK/OwnPtr.h>
 #include <Kernel/Bus/PCI/Access.h>
 #include <Kernel/Bus/PCI/Device.h>
 #include <Kernel/IOWindow.h>
 #include <Kernel/Interrupts/IRQHandler.h>
+#include <Kernel/Locking/Mutex.h>
 #include <Kernel/Net/NetworkAdapter.h>
 #include <Kernel/Random.h>
 
@@ -26,7 +28,7 @@ public:
 
     virtual ~E1000NetworkAdapter() override;
 
-    virtual void send_raw(ReadonlyBytes) override;
+    virtual void send_raw(ReadonlyBytes, TransmitOffload) override;
     virtual bool link_up() override { return m_link_up; };
     virtual i32 link_speed() override;
     virtual bool link_full_duplex() override;
@@ -38,9 +40,14 @@ public:
 protected:
     static constexpr size_t rx_buffer_size = 8192;
     static constexpr size_t tx_buffer_size = 8192;
+    // Packets handed to us for TCP segmentation may span several transmit buffers.
+    static constexpr size_t maximum_tcp_segmentation_size = 4 * tx_buffer_size;
+    // The most packets we take off the receive ring in one go before letting everyone else run again.
+    static constexpr size_t receive_poll_budget = 64;
 
     void setup_interrupts();
     void setup_link();
+    void setup_checksum_offload();
 
     E1000NetworkAdapter(PCI::DeviceIdentifier const&, u8 irq,
         NonnullOwnPtr<IOWindow> registers_io_window, NonnullOwnPtr<Memory::Region> rx_buffer_region,
@@ -69,6 +76,31 @@ protected:
         volatile uint16_t special { 0 };
     };
 
+    // A context descriptor configures the checksum and segmentation offloads for the data descriptors following it.
+    struct [[gnu::packed]] e1000_tx_context_desc {
+        volatile uint8_t ipcss { 0 };
+        volatile uint8_t ipcso { 0 };
+        volatile uint16_t ipcse { 0 };
+        volatile uint8_t tucss { 0 };
+        volatile uint8_t tucso { 0 };
+        volatile uint16_t tucse { 0 };
+        volatile uint32_t paylen_dtyp_tucmd { 0 };
+        volatile uint8_t status { 0 };
+        volatile uint8_t hdrlen { 0 };
+        volatile uint16_t mss { 0 };
+    };
+
+    struct [[gnu::packed]] e1000_tx_data_desc {
+        volatile uint64_t addr { 0 };
+        volatile uint32_t length_dtyp_dcmd { 0 };
+        volatile uint8_t status { 0 };
+        volatile uint8_t popts { 0 };
+        volatile uint16_t special { 0 };
+    };
+
+    static_assert(AssertSize<e1000_tx_context_desc, sizeof(e1000_tx_desc)>());
+    static_assert(AssertSize<e1000_tx_data_desc, sizeof(e1000_tx_desc)>());
+
     virtual void detect_eeprom();
     virtual u32 read_eeprom(u8 address);
     void read_mac_address();
@@ -83,7 +115,14 @@ protected:
     u16 in16(u16 address);
     u32 in32(u16 address);
 
-    void receive();
+    // Takes up to receive_poll_budget packets off the receive ring, and returns how many there were.
+    size_t receive();
+    bool has_received_packets() const;
+    void schedule_receive_poll();
+    void poll_receive();
+
+    size_t reclaim_tx_descriptors();
+    void wait_for_tx_descriptors(size_t count);
 
     static constexpr size_t number_of_rx_descriptors = 256;
     static constexpr size_t number_of_tx_descriptors = 256;
@@ -96,6 +135,13 @@ protected:
     NonnullOwnPtr<Memory::Region> m_tx_buffer_region;
     Array<void*, number_of_rx_descriptors> m_rx_buffers;
     Array<void*, number_of_tx_descriptors> m_tx_buffers;
+    size_t m_rx_tail { number_of_rx_descriptors - 1 };
+    Atomic<bool> m_receive_poll_scheduled { false };
+
+    // Protects the transmit ring, the hardware owns the descriptors from m_tx_clean up to m_tx_next.
+    Mutex m_tx_lock { "E1000 TX"sv };
+    size_t m_tx_next { 0 };
+    size_t m_tx_clean { 0 };
     bool m_has_eeprom { false };
     bool m_link_up { false };
     EntropySource m_entropy_source;
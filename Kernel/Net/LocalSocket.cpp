@@ -13,6 +13,8 @@
 #include <Kernel/FileSystem/VirtualFileSystem.h>
 #include <Kernel/Locking/Mutex.h>
 #include <Kernel/Locking/MutexProtected.h>
+#include <Kernel/Memory/AnonymousVMObject.h>
+#include <Kernel/Memory/MemoryManager.h>
 #include <Kernel/Net/LocalSocket.h>
 #include <Kernel/Process.h>
 #include <Kernel/StdLib.h>
@@ -22,6 +24,15 @@ namespace Kernel {
 
 static Singleton<MutexProtected<LocalSocket::List>> s_list;
 
+// Most messages are small, so the socket buffers start out small and only grow when needed.
+static constexpr size_t initial_buffer_capacity = 16 * KiB;
+static constexpr size_t maximum_buffer_capacity = 1 * MiB;
+
+// Large writes from private memory don't go through the socket buffer. Instead, the receiver
+// gets a copy-on-write snapshot of the sender's pages, and only has to copy the data once.
+static constexpr size_t minimum_page_donation_size = 64 * KiB;
+static constexpr size_t maximum_donated_bytes_in_flight = 16 * MiB;
+
 static MutexProtected<LocalSocket::List>& all_sockets()
 {
     return *s_list;
@@ -45,8 +56,10 @@ ErrorOr<void> LocalSocket::try_for_each(Function<ErrorOr<void>(LocalSocket const
 
 ErrorOr<NonnullLockRefPtr<LocalSocket>> LocalSocket::try_create(int type)
 {
-    auto client_buffer = TRY(DoubleBuffer::try_create("LocalSocket: Client buffer"sv));
-    auto server_buffer = TRY(DoubleBuffer::try_create("LocalSocket: Server buffer"sv));
+    auto client_buffer = TRY(DoubleBuffer::try_create_growable("LocalSocket: Client buffer"sv, initial_buffer_capacity, maximum_buffer_capacity));
+    auto server_buffer = TRY(DoubleBuffer::try_create_growable("LocalSocket: Server buffer"sv, initial_buffer_capacity, maximum_buffer_capacity));
+    client_buffer->set_maximum_bytes_in_pages(maximum_donated_bytes_in_flight);
+    server_buffer->set_maximum_bytes_in_pages(maximum_donated_bytes_in_flight);
     return adopt_nonnull_lock_ref_or_enomem(new (nothrow) LocalSocket(type, move(client_buffer), move(server_buffer)));
 }
 
@@ -301,6 +314,69 @@ bool LocalSocket::can_write(OpenFileDescription const& description, u64) const
     return false;
 }
 
+static ErrorOr<NonnullOwnPtr<Memory::Region>> try_snapshot_user_pages(VirtualAddress vaddr, size_t size)
+{
+    VERIFY(vaddr.is_page_aligned());
+    VERIFY(size % PAGE_SIZE == 0);
+
+    Memory::VirtualRange range { vaddr, size };
+    auto snapshot = TRY(Process::current().address_space().with([&](auto& space) -> ErrorOr<NonnullLockRefPtr<Memory::AnonymousVMObject>> {
+        auto* region = space->find_region_containing(range);
+        // Changes to shared memory have to stay visible to everyone, so we can't hand out a snapshot of it.
+        if (!region || region->is_shared() || !region->vmobject().is_anonymous())
+            return ENOTSUP;
+        auto first_page_index = region->translate_to_vmobject_page(region->page_index_from_address(vaddr));
+        return static_cast<Memory::AnonymousVMObject&>(region->vmobject()).try_snapshot_pages(first_page_index, size / PAGE_SIZE);
+    }));
+    return MM.allocate_kernel_region_with_vmobject(*snapshot, size, "LocalSocket: Donated pages"sv, Memory::Region::Access::Read);
+}
+
+static ErrorOr<size_t> write_to_socket_buffer(DoubleBuffer& socket_buffer, UserOrKernelBuffer const& data, size_t data_size)
+{
+    if (data.is_kernel_buffer() || data_size < minimum_page_donation_size)
+        return socket_buffer.write(data, data_size);
+
+    // Everything before the first page boundary is copied, so we can hand over whole pages after that.
+    auto vaddr = VirtualAddress { data.user_or_kernel_ptr() };
+    auto first_page_boundary = TRY(Memory::page_round_up(vaddr.get()));
+    size_t head_size = min(first_page_boundary - vaddr.get(), data_size);
+    size_t nwritten = 0;
+    if (head_size > 0) {
+        nwritten = TRY(socket_buffer.write(data, head_size));
+        if (nwritten < head_size)
+            return nwritten;
+    }
+
+    // Once some of the data is in the buffer, we have to report that instead of any error.
+    auto copy_remaining_data = [&]() -> size_t {
+        auto remaining_or_error = socket_buffer.write(data.offset(nwritten), data_size - nwritten);
+        if (!remaining_or_error.is_error())
+            nwritten += remaining_or_error.value();
+        return nwritten;
+    };
+
+    size_t donated_size = Memory::page_round_down(min(data_size - nwritten, socket_buffer.space_for_pages()));
+    if (donated_size < minimum_page_donation_size)
+        return copy_remaining_data();
+
+    // Once every socket together has used up its share of kernel address space for donated pages, we copy.
+    if (!DoubleBuffer::try_reserve_bytes_in_pages(donated_size))
+        return copy_remaining_data();
+    auto region_or_error = try_snapshot_user_pages(vaddr.offset(nwritten), donated_size);
+    if (region_or_error.is_error()) {
+        DoubleBuffer::unreserve_bytes_in_pages(donated_size);
+        // This isn't private anonymous memory, so it's copied like everything else.
+        return copy_remaining_data();
+    }
+    if (socket_buffer.append_pages(region_or_error.release_value()).is_error())
+        return copy_remaining_data();
+    nwritten += donated_size;
+
+    if (nwritten < data_size)
+        return copy_remaining_data();
+    return nwritten;
+}
+
 ErrorOr<size_t> LocalSocket::sendto(OpenFileDescription& description, UserOrKernelBuffer const& data, size_t data_size, int, Userspace<sockaddr const*>, socklen_t)
 {
     if (!has_attached_peer(description))
@@ -308,7 +384,7 @@ ErrorOr<size_t> LocalSocket::sendto(OpenFileDescription& description, UserOrKern
     auto* socket_buffer = send_buffer_for(description);
     if (!socket_buffer)
         return set_so_error(EINVAL);
-    auto nwritten_or_error = socket_buffer->write(data, data_size);
+    auto nwritten_or_error = write_to_socket_buffer(*socket_buffer, data, data_size);
     if (!nwritten_or_error.is_error() && nwritten_or_error.value() > 0)
         Thread::current()->did_unix_socket_write(nwritten_or_error.value());
     return nwritten_or_error;
@@ -404,9 +480,17 @@ ErrorOr<void> LocalSocket::getsockopt(OpenFileDescription& description, int leve
 
     switch (option) {
     case SO_SNDBUF:
-        return ENOTSUP;
-    case SO_RCVBUF:
-        return ENOTSUP;
+    case SO_RCVBUF: {
+        if (size < sizeof(int))
+            return EINVAL;
+        auto* socket_buffer = option == SO_SNDBUF ? send_buffer_for(description) : receive_buffer_for(description);
+        if (!socket_buffer)
+            return ENOTCONN;
+        int buffer_size = socket_buffer->maximum_capacity();
+        TRY(copy_to_user(static_ptr_cast<int*>(value), &buffer_size));
+        size = sizeof(int);
+        return copy_to_user(value_size, &size);
+    }
     case SO_PEERCRED: {
         if (size < sizeof(ucred))
             return EINVAL;
@@ -25,12 +25,14 @@ LoopbackAdapter::LoopbackAdapter(NonnullOwnPtr<KString> interface_name)
     VERIFY(!s_loopback_initialized);
     s_loopback_initialized = true;
     set_mtu(65536);
+    // NOTE: Packets never leave the machine, so there is no need to checksum them.
+    set_capabilities(Capability::TransmitChecksum);
     set_mac_address({ 19, 85, 2, 9, 0x55, 0xaa });
 }
 
 LoopbackAdapter::~LoopbackAdapter() = default;
 
-void LoopbackAdapter::send_raw(ReadonlyBytes payload)
+void LoopbackAdapter::send_raw(ReadonlyBytes payload, TransmitOffload)
 {
     dbgln("LoopbackAdapter: Sending {} byte(s) to myself.", payload.size());
     did_receive(payload);
@@ -4,8 +4,9 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/HashFunctions.h>
+#include <Kernel/Arch/Processor.h>
 #include <Kernel/Heap/kmalloc.h>
-#include <Kernel/InterruptDisabler.h>
 #include <Kernel/Net/EtherType.h>
 #include <Kernel/Net/NetworkAdapter.h>
 #include <Kernel/Net/NetworkingManagement.h>
@@ -15,17 +16,20 @@
 namespace Kernel {
 
 NetworkAdapter::NetworkAdapter(NonnullOwnPtr<KString> interface_name)
-    : m_name(move(interface_name))
+    : m_receive_queue_count(min<size_t>(Processor::count(), maximum_receive_queues))
+    , m_name(move(interface_name))
 {
 }
 
 NetworkAdapter::~NetworkAdapter() = default;
 
-void NetworkAdapter::send_packet(ReadonlyBytes packet)
+void NetworkAdapter::send_packet(ReadonlyBytes packet, TransmitOffload offload)
 {
+    VERIFY(!offload.layer4_checksum || has_capability(Capability::TransmitChecksum));
+    VERIFY(!offload.tcp_segment_size || has_capability(Capability::TCPSegmentation));
     m_packets_out++;
     m_bytes_out += packet.size();
-    send_raw(packet);
+    send_raw(packet, offload);
 }
 
 void NetworkAdapter::send(MACAddress const& destination, ARPPacket const& packet)
@@ -47,7 +51,7 @@ void NetworkAdapter::send(MACAddress const& destination, ARPPacket const& packet
 void NetworkAdapter::fill_in_ipv4_header(PacketWithTimestamp& packet, IPv4Address const& source_ipv4, MACAddress const& destination_mac, IPv4Address const& destination_ipv4, IPv4Protocol protocol, size_t payload_size, u8 type_of_service, u8 ttl)
 {
     size_t ipv4_packet_size = sizeof(IPv4Packet) + payload_size;
-    VERIFY(ipv4_packet_size <= mtu());
+    VERIFY(ipv4_packet_size <= max<size_t>(mtu(), m_maximum_tcp_segmentation_size));
 
     size_t ethernet_frame_size = ipv4_payload_offset() + payload_size;
     VERIFY(packet.buffer->size() == ethernet_frame_size);
@@ -69,46 +73,131 @@ void NetworkAdapter::fill_in_ipv4_header(PacketWithTimestamp& packet, IPv4Addres
     ipv4.set_checksum(ipv4.compute_checksum());
 }
 
-void NetworkAdapter::did_receive(ReadonlyBytes payload)
+size_t NetworkAdapter::receive_queue_index_for(ReadonlyBytes frame) const
+{
+    if (m_receive_queue_count == 1)
+        return 0;
+
+    // NOTE: Everything that isn't IPv4 (like ARP) goes to the first queue.
+    if (frame.size() < sizeof(EthernetFrameHeader) + sizeof(IPv4Packet))
+        return 0;
+    auto& eth = *reinterpret_cast<EthernetFrameHeader const*>(frame.data());
+    if (eth.ether_type() != EtherType::IPv4)
+        return 0;
+    auto& ipv4 = *reinterpret_cast<IPv4Packet const*>(eth.payload());
+
+    u32 hash = pair_int_hash(ipv4.source().to_u32(), ipv4.destination().to_u32());
+    hash = pair_int_hash(hash, ipv4.protocol());
+
+    // Fragments don't carry the ports (except for the first one), so they are only hashed by their addresses.
+    bool is_tcp_or_udp = ipv4.protocol() == (u8)IPv4Protocol::TCP || ipv4.protocol() == (u8)IPv4Protocol::UDP;
+    bool is_fragment = ipv4.is_a_fragment();
+    size_t ports_offset = sizeof(EthernetFrameHeader) + ipv4.internet_header_length() * sizeof(u32);
+    if (is_tcp_or_udp && !is_fragment && frame.size() >= ports_offset + sizeof(u32)) {
+        // Both TCP and UDP start with the source and destination port.
+        u32 ports;
+        memcpy(&ports, frame.data() + ports_offset, sizeof(ports));
+        hash = pair_int_hash(hash, ports);
+    }
+
+    return hash % m_receive_queue_count;
+}
+
+Optional<size_t> NetworkAdapter::enqueue_received_packet(ReadonlyBytes payload)
 {
-    InterruptDisabler disabler;
     m_packets_in++;
     m_bytes_in += payload.size();
 
-    if (m_packet_queue_size == max_packet_buffers) {
-        // FIXME: Keep track of the number of dropped packets
-        return;
-    }
+    auto queue_index = receive_queue_index_for(payload);
+    auto& queue = m_receive_queues[queue_index];
 
     auto packet = acquire_packet_buffer(payload.size());
     if (!packet) {
         dbgln("Discarding packet because we're out of memory");
-        return;
+        queue.packets.with([](auto& packets) {
+            packets.received++;
+            packets.dropped++;
+        });
+        return {};
     }
 
     memcpy(packet->buffer->data(), payload.data(), payload.size());
 
-    m_packet_queue.append(*packet);
-    m_packet_queue_size++;
+    bool did_enqueue = queue.packets.with([&](auto& packets) {
+        packets.received++;
+        if (packets.size == max_packet_buffers) {
+            packets.dropped++;
+            return false;
+        }
+        packets.list.append(*packet);
+        packets.size++;
+        return true;
+    });
+
+    if (!did_enqueue) {
+        release_packet_buffer(*packet);
+        return {};
+    }
 
-    if (on_receive)
-        on_receive();
+    return queue_index;
 }
 
-size_t NetworkAdapter::dequeue_packet(u8* buffer, size_t buffer_size, Time& packet_timestamp)
+void NetworkAdapter::did_receive(ReadonlyBytes payload)
 {
-    InterruptDisabler disabler;
-    if (m_packet_queue.is_empty())
-        return 0;
-    auto packet_with_timestamp = m_packet_queue.take_first();
-    m_packet_queue_size--;
-    packet_timestamp = packet_with_timestamp->timestamp;
-    auto& packet_buffer = packet_with_timestamp->buffer;
-    size_t packet_size = packet_buffer->size();
-    VERIFY(packet_size <= buffer_size);
-    memcpy(buffer, packet_buffer->data(), packet_size);
-    release_packet_buffer(*packet_with_timestamp);
-    return packet_size;
+    if (auto queue_index = enqueue_received_packet(payload); queue_index.has_value())
+        m_receive_queues[queue_index.value()].wait_queue.wake_one();
+}
+
+void NetworkAdapter::did_receive_batch(Span<ReadonlyBytes const> payloads)
+{
+    static_assert(maximum_receive_queues <= 32);
+    u32 queues_to_wake = 0;
+    for (auto payload : payloads) {
+        if (auto queue_index = enqueue_received_packet(payload); queue_index.has_value())
+            queues_to_wake |= 1u << queue_index.value();
+    }
+
+    for (size_t queue_index = 0; queue_index < m_receive_queue_count; ++queue_index) {
+        if (queues_to_wake & (1u << queue_index))
+            m_receive_queues[queue_index].wait_queue.wake_one();
+    }
+}
+
+void NetworkAdapter::dequeue_packets(size_t queue_index, PacketBatch& batch)
+{
+    m_receive_queues[queue_index].packets.with([&](auto& packets) {
+        while (!packets.list.is_empty() && batch.size() < maximum_dequeue_batch_size) {
+            batch.unchecked_append(*packets.list.take_first());
+            packets.size--;
+        }
+    });
+}
+
+void NetworkAdapter::did_process_packets(size_t queue_index, size_t count)
+{
+    auto& queue = m_receive_queues[queue_index];
+    queue.packets_processed += count;
+
+    auto now = kgettimeofday();
+    auto elapsed_ms = (now - queue.last_sample_time).to_milliseconds();
+    if (elapsed_ms < 1000)
+        return;
+    queue.packets_per_second = (queue.packets_processed - queue.packets_processed_at_last_sample) * 1000 / elapsed_ms;
+    queue.packets_processed_at_last_sample = queue.packets_processed;
+    queue.last_sample_time = now;
+}
+
+NetworkAdapter::ReceiveQueueStatistics NetworkAdapter::receive_queue_statistics(size_t queue_index) const
+{
+    auto& queue = m_receive_queues[queue_index];
+    ReceiveQueueStatistics statistics;
+    queue.packets.with([&](auto& packets) {
+        statistics.packets_received = packets.received;
+        statistics.packets_dropped = packets.dropped;
+    });
+    statistics.packets_processed = queue.packets_processed;
+    statistics.packets_per_second = queue.packets_per_second;
+    return statistics;
 }
 
 LockRefPtr<PacketWithTimestamp> NetworkAdapter::acquire_packet_buffer(size_t size)
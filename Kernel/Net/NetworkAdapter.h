@@ -6,21 +6,26 @@
 
 #pragma once
 
+#include <AK/Array.h>
 #include <AK/AtomicRefCounted.h>
 #include <AK/ByteBuffer.h>
+#include <AK/EnumBits.h>
 #include <AK/Function.h>
 #include <AK/IntrusiveList.h>
+#include <AK/Vector.h>
 #include <AK/MACAddress.h>
 #include <AK/Types.h>
 #include <Kernel/Bus/PCI/Definitions.h>
 #include <Kernel/KBuffer.h>
 #include <Kernel/Library/LockWeakPtr.h>
 #include <Kernel/Library/LockWeakable.h>
+#include <Kernel/Locking/SpinlockProtected.h>
 #include <Kernel/Net/ARP.h>
 #include <Kernel/Net/EthernetFrameHeader.h>
 #include <Kernel/Net/ICMP.h>
 #include <Kernel/Net/IPv4.h>
 #include <Kernel/UserOrKernelBuffer.h>
+#include <Kernel/WaitQueue.h>
 
 namespace Kernel {
 
@@ -42,6 +47,14 @@ struct PacketWithTimestamp final : public AtomicRefCounted<PacketWithTimestamp>
     IntrusiveListNode<PacketWithTimestamp, LockRefPtr<PacketWithTimestamp>> packet_node;
 };
 
+// Work an adapter should do on an outgoing packet instead of the network stack, see NetworkAdapter::Capability.
+struct TransmitOffload {
+    // The TCP or UDP checksum field only holds the checksum of the pseudo header, the adapter has to finish it.
+    bool layer4_checksum { false };
+    // The TCP payload is larger than the MTU allows and has to be cut into segments of this many bytes.
+    u16 tcp_segment_size { 0 };
+};
+
 class NetworkingManagement;
 class NetworkAdapter
     : public AtomicRefCounted<NetworkAdapter>
@@ -52,6 +65,17 @@ public:
         Ethernet
     };
 
+    enum class Capability : u32 {
+        None = 0,
+        // Finishes TCP and UDP checksums of outgoing packets, see TransmitOffload::layer4_checksum.
+        TransmitChecksum = 1 << 0,
+        // Verifies the checksums of incoming IPv4, TCP and UDP packets, and drops the ones that don't match.
+        ReceiveChecksum = 1 << 1,
+        // Cuts up outgoing TCP packets of up to maximum_tcp_segmentation_size() bytes, see TransmitOffload::tcp_segment_size.
+        TCPSegmentation = 1 << 2,
+    };
+    AK_ENUM_BITWISE_FRIEND_OPERATORS(Capability);
+
     static constexpr i32 LINKSPEED_INVALID = -1;
 
     virtual ~NetworkAdapter();
@@ -73,15 +97,35 @@ public:
     }
     virtual bool link_full_duplex() { return false; }
 
+    Capability capabilities() const { return m_capabilities; }
+    bool has_capability(Capability capability) const { return has_flag(m_capabilities, capability); }
+    size_t maximum_tcp_segmentation_size() const { return m_maximum_tcp_segmentation_size; }
+
     void set_ipv4_address(IPv4Address const&);
     void set_ipv4_netmask(IPv4Address const&);
 
     void send(MACAddress const&, ARPPacket const&);
     void fill_in_ipv4_header(PacketWithTimestamp&, IPv4Address const&, MACAddress const&, IPv4Address const&, IPv4Protocol, size_t, u8 type_of_service, u8 ttl);
 
-    size_t dequeue_packet(u8* buffer, size_t buffer_size, Time& packet_timestamp);
-
-    bool has_queued_packets() const { return !m_packet_queue.is_empty(); }
+    // Received packets are spread over several receive queues by hashing their flow, so all packets of a
+    // connection end up in the same queue. Each queue is drained by its own NetworkTask thread.
+    static constexpr size_t maximum_receive_queues = 4;
+    size_t receive_queue_count() const { return m_receive_queue_count; }
+
+    static constexpr size_t maximum_dequeue_batch_size = 32;
+    using PacketBatch = Vector<NonnullLockRefPtr<PacketWithTimestamp>, maximum_dequeue_batch_size>;
+    // The packets have to be handed back with release_packet_buffer() once they have been processed.
+    void dequeue_packets(size_t queue_index, PacketBatch&);
+    void did_process_packets(size_t queue_index, size_t count);
+    WaitQueue& receive_wait_queue(size_t queue_index) { return m_receive_queues[queue_index].wait_queue; }
+
+    struct ReceiveQueueStatistics {
+        u64 packets_received { 0 };
+        u64 packets_dropped { 0 };
+        u64 packets_processed { 0 };
+        u64 packets_per_second { 0 };
+    };
+    ReceiveQueueStatistics receive_queue_statistics(size_t queue_index) const;
 
     u32 mtu() const { return m_mtu; }
     void set_mtu(u32 mtu) { m_mtu = mtu; }
@@ -90,6 +134,7 @@ public:
     u32 bytes_in() const { return m_bytes_in; }
     u32 packets_out() const { return m_packets_out; }
     u32 bytes_out() const { return m_bytes_out; }
+    u32 checksum_errors() const { return m_checksum_errors; }
 
     LockRefPtr<PacketWithTimestamp> acquire_packet_buffer(size_t);
     void release_packet_buffer(PacketWithTimestamp&);
@@ -97,15 +142,25 @@ public:
     constexpr size_t layer3_payload_offset() const { return sizeof(EthernetFrameHeader); }
     constexpr size_t ipv4_payload_offset() const { return layer3_payload_offset() + sizeof(IPv4Packet); }
 
-    Function<void()> on_receive;
-
-    void send_packet(ReadonlyBytes);
+    // The offloads must be supported by the adapter, see has_capability().
+    void send_packet(ReadonlyBytes, TransmitOffload = {});
 
 protected:
     NetworkAdapter(NonnullOwnPtr<KString>);
     void set_mac_address(MACAddress const& mac_address) { m_mac_address = mac_address; }
+    void set_capabilities(Capability capabilities, size_t maximum_tcp_segmentation_size = 0)
+    {
+        VERIFY(has_flag(capabilities, Capability::TCPSegmentation) == (maximum_tcp_segmentation_size > 0));
+        // The segments need their checksums recomputed anyway, so we rely on that for both.
+        VERIFY(!has_flag(capabilities, Capability::TCPSegmentation) || has_flag(capabilities, Capability::TransmitChecksum));
+        m_capabilities = capabilities;
+        m_maximum_tcp_segmentation_size = maximum_tcp_segmentation_size;
+    }
     void did_receive(ReadonlyBytes);
-    virtual void send_raw(ReadonlyBytes) = 0;
+    // Drivers that drain their receive ring in batches should use this, it wakes every receive queue only once.
+    void did_receive_batch(Span<ReadonlyBytes const>);
+    void did_drop_packet_with_bad_checksum() { m_checksum_errors++; }
+    virtual void send_raw(ReadonlyBytes, TransmitOffload) = 0;
 
 private:
     MACAddress m_mac_address;
@@ -117,15 +172,39 @@ private:
 
     using PacketList = IntrusiveList<&PacketWithTimestamp::packet_node>;
 
-    PacketList m_packet_queue;
-    size_t m_packet_queue_size { 0 };
+    size_t receive_queue_index_for(ReadonlyBytes frame) const;
+    // Returns the index of the queue the packet was put into, if it wasn't dropped.
+    Optional<size_t> enqueue_received_packet(ReadonlyBytes);
+
+    struct ReceiveQueue {
+        struct Packets {
+            PacketList list;
+            size_t size { 0 };
+            u64 received { 0 };
+            u64 dropped { 0 };
+        };
+        SpinlockProtected<Packets, LockRank::None> packets {};
+        WaitQueue wait_queue;
+
+        // Only ever touched by the thread that drains this queue.
+        u64 packets_processed { 0 };
+        u64 packets_per_second { 0 };
+        u64 packets_processed_at_last_sample { 0 };
+        Time last_sample_time;
+    };
+
+    Array<ReceiveQueue, maximum_receive_queues> m_receive_queues;
+    size_t m_receive_queue_count { 1 };
     SpinlockProtected<PacketList, LockRank::None> m_unused_packets {};
     NonnullOwnPtr<KString> m_name;
     u32 m_packets_in { 0 };
     u32 m_bytes_in { 0 };
     u32 m_packets_out { 0 };
     u32 m_bytes_out { 0 };
+    u32 m_checksum_errors { 0 };
     u32 m_mtu { 1500 };
+    Capability m_capabilities { Capability::None };
+    size_t m_maximum_tcp_segmentation_size { 0 };
 };
 
 }
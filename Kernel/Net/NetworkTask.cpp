@@ -35,10 +35,16 @@ static void send_tcp_rst(IPv4Packet const& ipv4_packet, TCPPacket const& tcp_pac
 static void flush_delayed_tcp_acks();
 static void retransmit_tcp_packets();
 
-static Thread* network_task = nullptr;
-static HashTable<LockRefPtr<TCPSocket>>* delayed_ack_sockets;
+static Process* network_task_process = nullptr;
+static MutexProtected<HashTable<LockRefPtr<TCPSocket>>>* delayed_ack_sockets;
+
+struct ReceiveThreadContext {
+    NonnullLockRefPtr<NetworkAdapter> adapter;
+    size_t queue_index { 0 };
+};
 
 [[noreturn]] static void NetworkTask_main(void*);
+[[noreturn]] static void receive_thread_main(void*);
 
 void NetworkTask::spawn()
 {
@@ -46,87 +52,92 @@ void NetworkTask::spawn()
     auto name = KString::try_create("Network Task"sv);
     if (name.is_error())
         TODO();
-    (void)Process::create_kernel_process(thread, name.release_value(), NetworkTask_main, nullptr);
-    network_task = thread;
+    network_task_process = Process::create_kernel_process(thread, name.release_value(), NetworkTask_main, nullptr);
 }
 
 bool NetworkTask::is_current()
 {
-    return Thread::current() == network_task;
+    // NOTE: The receive threads are all part of the Network Task process.
+    return &Thread::current()->process() == network_task_process;
 }
 
 void NetworkTask_main(void*)
 {
-    delayed_ack_sockets = new HashTable<LockRefPtr<TCPSocket>>;
+    delayed_ack_sockets = new MutexProtected<HashTable<LockRefPtr<TCPSocket>>>;
 
-    WaitQueue packet_wait_queue;
-    int pending_packets = 0;
     NetworkingManagement::the().for_each([&](auto& adapter) {
-        dmesgln("NetworkTask: {} network adapter found: hw={}", adapter.class_name(), adapter.mac_address().to_string());
+        dmesgln("NetworkTask: {} network adapter found: hw={}, receive queues={}", adapter.class_name(), adapter.mac_address().to_string(), adapter.receive_queue_count());
 
         if (adapter.class_name() == "LoopbackAdapter"sv) {
             adapter.set_ipv4_address({ 127, 0, 0, 1 });
             adapter.set_ipv4_netmask({ 255, 0, 0, 0 });
         }
 
-        adapter.on_receive = [&]() {
-            pending_packets++;
-            packet_wait_queue.wake_all();
-        };
+        for (size_t queue_index = 0; queue_index < adapter.receive_queue_count(); ++queue_index) {
+            auto name = KString::formatted("NetworkTask: {} #{}", adapter.name(), queue_index);
+            if (name.is_error())
+                TODO();
+            auto* context = new ReceiveThreadContext { adapter, queue_index };
+            (void)Process::current().create_kernel_thread(receive_thread_main, context, THREAD_PRIORITY_NORMAL, name.release_value(), THREAD_AFFINITY_DEFAULT, false);
+        }
     });
 
-    auto dequeue_packet = [&pending_packets](u8* buffer, size_t buffer_size, Time& packet_timestamp) -> size_t {
-        if (pending_packets == 0)
-            return 0;
-        size_t packet_size = 0;
-        NetworkingManagement::the().for_each([&](auto& adapter) {
-            if (packet_size || !adapter.has_queued_packets())
-                return;
-            packet_size = adapter.dequeue_packet(buffer, buffer_size, packet_timestamp);
-            pending_packets--;
-            dbgln_if(NETWORK_TASK_DEBUG, "NetworkTask: Dequeued packet from {} ({} bytes)", adapter.name(), packet_size);
-        });
-        return packet_size;
-    };
-
-    size_t buffer_size = 64 * KiB;
-    auto region_or_error = MM.allocate_kernel_region(buffer_size, "Kernel Packet Buffer"sv, Memory::Region::Access::ReadWrite);
-    if (region_or_error.is_error())
-        TODO();
-    auto buffer_region = region_or_error.release_value();
-    auto buffer = (u8*)buffer_region->vaddr().get();
-    Time packet_timestamp;
-
+    // The receive threads do the actual packet processing, this one only takes care of the TCP timers.
     for (;;) {
         flush_delayed_tcp_acks();
         retransmit_tcp_packets();
-        size_t packet_size = dequeue_packet(buffer, buffer_size, packet_timestamp);
-        if (!packet_size) {
+        (void)Thread::current()->sleep(Time::from_milliseconds(100));
+    }
+}
+
+static void handle_frame(ReadonlyBytes frame, Time const& packet_timestamp)
+{
+    if (frame.size() < sizeof(EthernetFrameHeader)) {
+        dbgln("NetworkTask: Packet is too small to be an Ethernet packet! ({})", frame.size());
+        return;
+    }
+    auto& eth = *(EthernetFrameHeader const*)frame.data();
+    dbgln_if(ETHERNET_DEBUG, "NetworkTask: From {} to {}, ether_type={:#04x}, packet_size={}", eth.source().to_string(), eth.destination().to_string(), eth.ether_type(), frame.size());
+
+    switch (eth.ether_type()) {
+    case EtherType::ARP:
+        handle_arp(eth, frame.size());
+        break;
+    case EtherType::IPv4:
+        handle_ipv4(eth, frame.size(), packet_timestamp);
+        break;
+    case EtherType::IPv6:
+        // ignore
+        break;
+    default:
+        dbgln_if(ETHERNET_DEBUG, "NetworkTask: Unknown ethernet type {:#04x}", eth.ether_type());
+    }
+}
+
+void receive_thread_main(void* data)
+{
+    auto& context = *static_cast<ReceiveThreadContext*>(data);
+    auto& adapter = *context.adapter;
+
+    NetworkAdapter::PacketBatch batch;
+    for (;;) {
+        adapter.dequeue_packets(context.queue_index, batch);
+        if (batch.is_empty()) {
+            adapter.did_process_packets(context.queue_index, 0);
             auto timeout_time = Time::from_milliseconds(500);
             auto timeout = Thread::BlockTimeout { false, &timeout_time };
-            [[maybe_unused]] auto result = packet_wait_queue.wait_on(timeout, "NetworkTask"sv);
-            continue;
-        }
-        if (packet_size < sizeof(EthernetFrameHeader)) {
-            dbgln("NetworkTask: Packet is too small to be an Ethernet packet! ({})", packet_size);
+            [[maybe_unused]] auto result = adapter.receive_wait_queue(context.queue_index).wait_on(timeout, "NetworkTask"sv);
             continue;
         }
-        auto& eth = *(EthernetFrameHeader const*)buffer;
-        dbgln_if(ETHERNET_DEBUG, "NetworkTask: From {} to {}, ether_type={:#04x}, packet_size={}", eth.source().to_string(), eth.destination().to_string(), eth.ether_type(), packet_size);
-
-        switch (eth.ether_type()) {
-        case EtherType::ARP:
-            handle_arp(eth, packet_size);
-            break;
-        case EtherType::IPv4:
-            handle_ipv4(eth, packet_size, packet_timestamp);
-            break;
-        case EtherType::IPv6:
-            // ignore
-            break;
-        default:
-            dbgln_if(ETHERNET_DEBUG, "NetworkTask: Unknown ethernet type {:#04x}", eth.ether_type());
+
+        dbgln_if(NETWORK_TASK_DEBUG, "NetworkTask: Dequeued {} packets from {} #{}", batch.size(), adapter.name(), context.queue_index);
+
+        for (auto& packet : batch) {
+            handle_frame(packet->bytes(), packet->timestamp);
+            adapter.release_packet_buffer(*packet);
         }
+        adapter.did_process_packets(context.queue_index, batch.size());
+        batch.clear_with_capacity();
     }
 }
 
@@ -310,13 +321,22 @@ void send_delayed_tcp_ack(LockRefPtr<TCPSocket> socket)
         return;
     }
 
-    delayed_ack_sockets->set(move(socket));
+    delayed_ack_sockets->with_exclusive([&](auto& table) {
+        table.set(move(socket));
+    });
 }
 
 void flush_delayed_tcp_acks()
 {
+    // NOTE: We don't hold on to the table while locking the sockets, since the receive threads
+    //       lock them in the opposite order in send_delayed_tcp_ack().
+    HashTable<LockRefPtr<TCPSocket>> sockets;
+    delayed_ack_sockets->with_exclusive([&](auto& table) {
+        sockets = move(table);
+    });
+
     Vector<LockRefPtr<TCPSocket>, 32> remaining_sockets;
-    for (auto& socket : *delayed_ack_sockets) {
+    for (auto& socket : sockets) {
         MutexLocker locker(socket->mutex());
         if (socket->should_delay_next_ack()) {
             MUST(remaining_sockets.try_append(socket));
@@ -325,13 +345,12 @@ void flush_delayed_tcp_acks()
         [[maybe_unused]] auto result = socket->send_ack();
     }
 
-    if (remaining_sockets.size() != delayed_ack_sockets->size()) {
-        delayed_ack_sockets->clear();
-        if (remaining_sockets.size() > 0)
-            dbgln("flush_delayed_tcp_acks: {} sockets remaining", remaining_sockets.size());
+    if (remaining_sockets.is_empty())
+        return;
+    delayed_ack_sockets->with_exclusive([&](auto& table) {
         for (auto&& socket : remaining_sockets)
-            delayed_ack_sockets->set(move(socket));
-    }
+            table.set(move(socket));
+    });
 }
 
 void send_tcp_rst(IPv4Packet const& ipv4_packet, TCPPacket const& tcp_packet, LockRefPtr<NetworkAdapter> adapter)
@@ -457,6 +476,7 @@ void handle_tcp(IPv4Packet const& ipv4_packet, Time const& packet_timestamp)
             auto client = client_or_error.release_value();
             MutexLocker locker(client->mutex());
             dbgln_if(TCP_DEBUG, "handle_tcp: created new client socket with tuple {}", client->tuple().to_string());
+            client->process_syn_options(tcp_packet);
             client->set_sequence_number(1000);
             client->set_ack_number(tcp_packet.sequence_number() + payload_size + 1);
             [[maybe_unused]] auto rc2 = client->send_tcp_packet(TCPFlags::SYN | TCPFlags::ACK);
@@ -620,6 +640,13 @@ void handle_tcp(IPv4Packet const& ipv4_packet, Time const& packet_timestamp)
         }
 
         if (tcp_packet.sequence_number() != socket->ack_number()) {
+            if (payload_size != 0 && !tcp_packet.has_fin() && socket->queue_out_of_order_segment({ &ipv4_packet, sizeof(IPv4Packet) + ipv4_packet.payload_size() }, tcp_packet, payload_size, packet_timestamp)) {
+                dbgln_if(TCP_DEBUG, "Queued out of order packet: seq {} vs. ack {}", tcp_packet.sequence_number(), socket->ack_number());
+                // RFC 5681, 4.2: Out of order segments are acknowledged right away, and the ACK carries SACK blocks for them.
+                [[maybe_unused]] auto result = socket->send_ack(true);
+                return;
+            }
+
             dbgln_if(TCP_DEBUG, "Discarding out of order packet: seq {} vs. ack {}", tcp_packet.sequence_number(), socket->ack_number());
             if (socket->duplicate_acks() < TCPSocket::maximum_duplicate_acks) {
                 dbgln_if(TCP_DEBUG, "Sending ACK with same ack number to trigger fast retransmission");
@@ -647,7 +674,11 @@ void handle_tcp(IPv4Packet const& ipv4_packet, Time const& packet_timestamp)
                 socket->set_ack_number(tcp_packet.sequence_number() + payload_size);
                 dbgln_if(TCP_DEBUG, "Got packet with ack_no={}, seq_no={}, payload_size={}, acking it with new ack_no={}, seq_no={}",
                     tcp_packet.ack_number(), tcp_packet.sequence_number(), payload_size, socket->ack_number(), socket->sequence_number());
-                send_delayed_tcp_ack(socket);
+                // RFC 5681, 4.2: A segment that fills a gap is acknowledged right away.
+                if (socket->deliver_out_of_order_segments())
+                    (void)socket->send_ack(true);
+                else
+                    send_delayed_tcp_ack(socket);
             }
         }
     }
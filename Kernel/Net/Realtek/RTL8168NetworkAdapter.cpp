@@ -11,6 +11,7 @@
 #include <Kernel/Net/NetworkingManagement.h>
 #include <Kernel/Net/Realtek/RTL8168NetworkAdapter.h>
 #include <Kernel/Sections.h>
+#include <Kernel/WorkQueue.h>
 
 namespace Kernel {
 
@@ -82,6 +83,8 @@ namespace Kernel {
 #define INT_RX_FIFO_OVERFLOW 0x40
 #define INT_SYS_ERR 0x8000
 
+static constexpr u16 receive_interrupts = INT_RXOK | INT_RXERR | INT_RX_OVERFLOW | INT_RX_FIFO_OVERFLOW;
+
 #define CFG9346_NONE 0x00
 #define CFG9346_EEM0 0x40
 #define CFG9346_EEM1 0x80
@@ -347,6 +350,8 @@ UNMAP_AFTER_INIT ErrorOr<void> RTL8168NetworkAdapter::initialize(Badge<Networkin
     }
 
     startup();
+    // NOTE: Received checksums are verified through CPLUS_COMMAND_VERIFY_CHECKSUM.
+    set_capabilities(Capability::TransmitChecksum | Capability::ReceiveChecksum);
     return {};
 }
 
@@ -399,6 +404,7 @@ void RTL8168NetworkAdapter::startup()
         enabled_interrupts |= INT_RX_FIFO_OVERFLOW;
         enabled_interrupts &= ~INT_RX_OVERFLOW;
     }
+    m_interrupt_mask = enabled_interrupts;
     out16(REG_IMR, enabled_interrupts);
 
     // update link status
@@ -1140,13 +1146,17 @@ bool RTL8168NetworkAdapter::handle_irq(RegisterState const&)
 
         dbgln_if(RTL8168_DEBUG, "RTL8168: handle_irq status={:#04x}", status);
 
+        // NOTE: The status bits are set even while their interrupts are masked, so ignore the ones a receive poll takes care of.
+        if (m_receive_poll_scheduled)
+            status &= ~receive_interrupts;
+
         if ((status & (INT_RXOK | INT_RXERR | INT_TXOK | INT_TXERR | INT_RX_OVERFLOW | INT_LINK_CHANGE | INT_RX_FIFO_OVERFLOW | INT_SYS_ERR)) == 0)
             break;
 
         was_handled = true;
         if (status & INT_RXOK) {
             dbgln_if(RTL8168_DEBUG, "RTL8168: RX ready");
-            receive();
+            schedule_receive_poll();
         }
         if (status & INT_RXERR) {
             dbgln_if(RTL8168_DEBUG, "RTL8168: RX error - invalid packet");
@@ -1160,7 +1170,7 @@ bool RTL8168NetworkAdapter::handle_irq(RegisterState const&)
         }
         if (status & INT_RX_OVERFLOW) {
             dmesgln_pci(*this, "RX descriptor unavailable (packet lost)");
-            receive();
+            schedule_receive_poll();
         }
         if (status & INT_LINK_CHANGE) {
             m_link_up = (in8(REG_PHYSTATUS) & PHY_LINK_STATUS) != 0;
@@ -1168,7 +1178,7 @@ bool RTL8168NetworkAdapter::handle_irq(RegisterState const&)
         }
         if (status & INT_RX_FIFO_OVERFLOW) {
             dmesgln_pci(*this, "RX FIFO overflow");
-            receive();
+            schedule_receive_poll();
         }
         if (status & INT_SYS_ERR) {
             dmesgln_pci(*this, "Fatal system error");
@@ -1192,48 +1202,71 @@ UNMAP_AFTER_INIT void RTL8168NetworkAdapter::read_mac_address()
     set_mac_address(mac);
 }
 
-void RTL8168NetworkAdapter::send_raw(ReadonlyBytes payload)
+void RTL8168NetworkAdapter::send_raw(ReadonlyBytes payload, TransmitOffload offload)
 {
     dbgln_if(RTL8168_DEBUG, "RTL8168: send_raw length={}", payload.size());
+    VERIFY(!offload.tcp_segment_size);
 
     if (payload.size() > TX_BUFFER_SIZE) {
         dmesgln_pci(*this, "Packet was too big; discarding");
         return;
     }
 
+    u16 flags = TXDescriptor::Ownership | TXDescriptor::FirstSegment | TXDescriptor::LastSegment;
+    u16 vlan_flags = 0;
+    if (offload.layer4_checksum) {
+        auto& ipv4 = *reinterpret_cast<IPv4Packet const*>(payload.data() + sizeof(EthernetFrameHeader));
+        bool is_tcp = ipv4.protocol() == (u8)IPv4Protocol::TCP;
+        VERIFY(is_tcp || ipv4.protocol() == (u8)IPv4Protocol::UDP);
+        if (m_version <= ChipVersion::Version3) {
+            flags |= TXDescriptor::IPChecksum | (is_tcp ? TXDescriptor::TCPChecksum : TXDescriptor::UDPChecksum);
+        } else {
+            u16 transport_offset = sizeof(EthernetFrameHeader) + ipv4.internet_header_length() * sizeof(u32);
+            vlan_flags = TXDescriptor::IPv4ChecksumV2 | (is_tcp ? TXDescriptor::TCPChecksumV2 : TXDescriptor::UDPChecksumV2) | (transport_offset << TXDescriptor::TransportOffsetShiftV2);
+        }
+    }
+
+    MutexLocker locker(m_tx_lock);
     auto* tx_descriptors = (TXDescriptor*)m_tx_descriptors_region->vaddr().as_ptr();
     auto& free_descriptor = tx_descriptors[m_tx_free_index];
 
-    if ((free_descriptor.flags & TXDescriptor::Ownership) != 0) {
+    while ((free_descriptor.flags & TXDescriptor::Ownership) != 0) {
         dbgln_if(RTL8168_DEBUG, "RTL8168: No free TX buffers, sleeping until one is available");
         m_wait_queue.wait_forever("RTL8168NetworkAdapter"sv);
-        return send_raw(payload);
-        // if we woke up a TX descriptor is guaranteed to be available, so this should never recurse more than once
-        // but this can probably be done more cleanly
     }
 
     dbgln_if(RTL8168_DEBUG, "RTL8168: Chose descriptor {}", m_tx_free_index);
     memcpy(m_tx_buffers_regions[m_tx_free_index].vaddr().as_ptr(), payload.data(), payload.size());
 
+    if (m_tx_free_index == number_of_tx_descriptors - 1)
+        flags |= TXDescriptor::EndOfRing;
     m_tx_free_index = (m_tx_free_index + 1) % number_of_tx_descriptors;
 
     free_descriptor.frame_length = payload.size() & 0x3FFF;
-    free_descriptor.flags = free_descriptor.flags | TXDescriptor::Ownership;
+    free_descriptor.vlan_tag = 0;
+    free_descriptor.vlan_flags = vlan_flags;
+    free_descriptor.flags = flags;
 
     out8(REG_TXSTART, TXSTART_START); // FIXME: this shouldn't be done so often, we should look into doing this using the watchdog timer
 }
 
-void RTL8168NetworkAdapter::receive()
+bool RTL8168NetworkAdapter::has_received_packets() const
 {
     auto* rx_descriptors = (RXDescriptor*)m_rx_descriptors_region->vaddr().as_ptr();
-    for (u16 i = 0; i < number_of_rx_descriptors; ++i) {
-        auto descriptor_index = (m_rx_free_index + i) % number_of_rx_descriptors;
+    return (rx_descriptors[m_rx_free_index].flags & RXDescriptor::Ownership) == 0;
+}
+
+size_t RTL8168NetworkAdapter::receive()
+{
+    auto* rx_descriptors = (RXDescriptor*)m_rx_descriptors_region->vaddr().as_ptr();
+    Vector<ReadonlyBytes, receive_poll_budget> packets;
+    size_t count = 0;
+    for (; count < receive_poll_budget; ++count) {
+        auto descriptor_index = (m_rx_free_index + count) % number_of_rx_descriptors;
         auto& descriptor = rx_descriptors[descriptor_index];
 
-        if ((descriptor.flags & RXDescriptor::Ownership) != 0) {
-            m_rx_free_index = descriptor_index;
+        if ((descriptor.flags & RXDescriptor::Ownership) != 0)
             break;
-        }
 
         u16 flags = descriptor.flags;
         u16 length = descriptor.buffer_size & 0x3FFF;
@@ -1246,16 +1279,64 @@ void RTL8168NetworkAdapter::receive()
             VERIFY_NOT_REACHED();
             // Our maximum received packet size is smaller than the descriptor buffer size, so packets should never be segmented
             // if this happens on a real NIC it might not respect that, and we will have to support packet segmentation
+        } else if (descriptor.has_bad_checksum()) {
+            dbgln_if(RTL8168_DEBUG, "RTL8168: Dropping packet with bad checksum");
+            did_drop_packet_with_bad_checksum();
         } else {
-            did_receive({ m_rx_buffers_regions[descriptor_index].vaddr().as_ptr(), length });
+            packets.unchecked_append({ m_rx_buffers_regions[descriptor_index].vaddr().as_ptr(), length });
         }
+    }
+
+    if (count == 0)
+        return 0;
 
+    // NOTE: The packets are copied out of our buffers here, after that the NIC may have them back.
+    did_receive_batch(packets);
+    for (size_t i = 0; i < count; ++i) {
+        auto descriptor_index = (m_rx_free_index + i) % number_of_rx_descriptors;
+        auto& descriptor = rx_descriptors[descriptor_index];
         descriptor.buffer_size = RX_BUFFER_SIZE;
-        flags = RXDescriptor::Ownership;
+        u16 flags = RXDescriptor::Ownership;
         if (descriptor_index == number_of_rx_descriptors - 1)
             flags |= RXDescriptor::EndOfRing;
         descriptor.flags = flags; // let the NIC know it can use this descriptor again
     }
+    m_rx_free_index = (m_rx_free_index + count) % number_of_rx_descriptors;
+    return count;
+}
+
+void RTL8168NetworkAdapter::schedule_receive_poll()
+{
+    if (m_receive_poll_scheduled.exchange(true))
+        return;
+
+    // Receive interrupts stay off until a poll finds the ring empty, so a burst of packets only costs us one of them.
+    out16(REG_IMR, m_interrupt_mask & ~receive_interrupts);
+    auto result = g_io_work->try_queue([this] { poll_receive(); });
+    if (result.is_error()) {
+        // NOTE: Without a work item we can't defer anything, so just empty the ring right away.
+        while (receive() == receive_poll_budget)
+            ;
+        m_receive_poll_scheduled = false;
+        out16(REG_IMR, m_interrupt_mask);
+    }
+}
+
+void RTL8168NetworkAdapter::poll_receive()
+{
+    if (receive() == receive_poll_budget) {
+        // There's probably more, but give the other work items a chance first.
+        if (!g_io_work->try_queue([this] { poll_receive(); }).is_error())
+            return;
+        while (receive() == receive_poll_budget)
+            ;
+    }
+
+    m_receive_poll_scheduled = false;
+    out16(REG_IMR, m_interrupt_mask);
+    // NOTE: If a packet arrived after we last looked, its interrupt might have been acknowledged while it was masked.
+    if (has_received_packets())
+        schedule_receive_poll();
 }
 
 void RTL8168NetworkAdapter::out8(u16 address, u8 data)
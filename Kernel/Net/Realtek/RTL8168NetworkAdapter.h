@@ -6,12 +6,14 @@
 
 #pragma once
 
+#include <AK/Atomic.h>
 #include <AK/NonnullOwnPtrVector.h>
 #include <AK/OwnPtr.h>
 #include <Kernel/Bus/PCI/Access.h>
 #include <Kernel/Bus/PCI/Device.h>
 #include <Kernel/IOWindow.h>
 #include <Kernel/Interrupts/IRQHandler.h>
+#include <Kernel/Locking/Mutex.h>
 #include <Kernel/Net/NetworkAdapter.h>
 #include <Kernel/Random.h>
 
@@ -28,7 +30,7 @@ public:
 
     virtual ~RTL8168NetworkAdapter() override;
 
-    virtual void send_raw(ReadonlyBytes) override;
+    virtual void send_raw(ReadonlyBytes, TransmitOffload) override;
     virtual bool link_up() override { return m_link_up; }
     virtual bool link_full_duplex() override;
     virtual i32 link_speed() override;
@@ -41,6 +43,8 @@ private:
     // FIXME: should this be increased? (maximum allowed here is 1024) - memory usage vs packet loss chance tradeoff
     static constexpr size_t number_of_rx_descriptors = 64;
     static constexpr size_t number_of_tx_descriptors = 16;
+    // The most packets we take off the receive ring in one go before letting everyone else run again.
+    static constexpr size_t receive_poll_budget = 32;
 
     RTL8168NetworkAdapter(PCI::DeviceIdentifier const&, u8 irq, NonnullOwnPtr<IOWindow> registers_io_window, NonnullOwnPtr<KString>);
 
@@ -63,6 +67,16 @@ private:
         static constexpr u16 FirstSegment = 0x2000u;
         static constexpr u16 LastSegment = 0x1000u;
         static constexpr u16 LargeSend = 0x800u;
+        // Checksum offload on the first generation of chips (RTL8168B)
+        static constexpr u16 TCPChecksum = 0x1u;
+        static constexpr u16 UDPChecksum = 0x2u;
+        static constexpr u16 IPChecksum = 0x4u;
+
+        // vlan_flags bit field, checksum offload on all later chips
+        static constexpr u16 IPv4ChecksumV2 = 0x2000u;
+        static constexpr u16 TCPChecksumV2 = 0x4000u;
+        static constexpr u16 UDPChecksumV2 = 0x8000u;
+        static constexpr u16 TransportOffsetShiftV2 = 2;
     };
 
     static_assert(AssertSize<TXDescriptor, 16u>());
@@ -87,6 +101,26 @@ private:
         static constexpr u16 ErrorSummary = 0x20;
         static constexpr u16 RuntPacket = 0x10;
         static constexpr u16 CRCError = 0x8;
+        static constexpr u16 ProtocolMask = 0x6;
+        static constexpr u16 ProtocolTCP = 0x2;
+        static constexpr u16 ProtocolUDP = 0x4;
+        static constexpr u16 IPChecksumFailure = 0x1;
+
+        // buffer_size bit field, only valid with checksum verification enabled
+        static constexpr u16 UDPChecksumFailure = 0x8000u;
+        static constexpr u16 TCPChecksumFailure = 0x4000u;
+
+        bool has_bad_checksum() const
+        {
+            if (flags & IPChecksumFailure)
+                return true;
+            auto protocol = flags & ProtocolMask;
+            if (protocol == ProtocolTCP)
+                return buffer_size & TCPChecksumFailure;
+            if (protocol == ProtocolUDP)
+                return buffer_size & UDPChecksumFailure;
+            return false;
+        }
     };
 
     static_assert(AssertSize<RXDescriptor, 16u>());
@@ -152,7 +186,11 @@ private:
     void initialize_rx_descriptors();
     void initialize_tx_descriptors();
 
-    void receive();
+    // Takes up to receive_poll_budget packets off the receive ring, and returns how many there were.
+    size_t receive();
+    bool has_received_packets() const;
+    void schedule_receive_poll();
+    void poll_receive();
 
     void out8(u16 address, u8 data);
     void out16(u16 address, u16 data);
@@ -207,6 +245,9 @@ private:
     OwnPtr<Memory::Region> m_rx_descriptors_region;
     NonnullOwnPtrVector<Memory::Region> m_rx_buffers_regions;
     u16 m_rx_free_index { 0 };
+    u16 m_interrupt_mask { 0 };
+    Atomic<bool> m_receive_poll_scheduled { false };
+    Mutex m_tx_lock { "RTL8168 TX"sv };
     OwnPtr<Memory::Region> m_tx_descriptors_region;
     NonnullOwnPtrVector<Memory::Region> m_tx_buffers_regions;
     u16 m_tx_free_index { 0 };
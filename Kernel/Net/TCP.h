@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <AK/Vector.h>
 #include <Kernel/Net/IPv4.h>
 
 namespace Kernel {
@@ -21,6 +22,15 @@ struct TCPFlags {
     };
 };
 
+enum class TCPOptionKind : u8 {
+    End = 0,
+    NoOperation = 1,
+    MaximumSegmentSize = 2,
+    WindowScale = 3,
+    SACKPermitted = 4,
+    SACK = 5,
+};
+
 class [[gnu::packed]] TCPOptionMSS {
 public:
     TCPOptionMSS(u16 value)
@@ -38,6 +48,45 @@ private:
 
 static_assert(AssertSize<TCPOptionMSS, 4>());
 
+// RFC 7323, 2.2. Window Scale Option
+class [[gnu::packed]] TCPOptionWindowScale {
+public:
+    TCPOptionWindowScale(u8 shift_count)
+        : m_shift_count(shift_count)
+    {
+    }
+
+    u8 shift_count() const { return m_shift_count; }
+
+private:
+    u8 m_option_kind { to_underlying(TCPOptionKind::WindowScale) };
+    u8 m_option_length { sizeof(TCPOptionWindowScale) };
+    u8 m_shift_count { 0 };
+};
+
+static_assert(AssertSize<TCPOptionWindowScale, 3>());
+
+// RFC 7323 says the shift count must not be larger than 14.
+static constexpr u8 maximum_tcp_window_scale = 14;
+
+// RFC 2018, 2. Sack-Permitted Option
+class [[gnu::packed]] TCPOptionSACKPermitted {
+private:
+    u8 m_option_kind { to_underlying(TCPOptionKind::SACKPermitted) };
+    u8 m_option_length { sizeof(TCPOptionSACKPermitted) };
+};
+
+static_assert(AssertSize<TCPOptionSACKPermitted, 2>());
+
+// RFC 2018, 3. Sack Option Format
+struct TCPSACKBlock {
+    u32 left_edge { 0 };
+    u32 right_edge { 0 };
+};
+
+// Without timestamps, at most four SACK blocks fit into the 40 bytes of option space.
+static constexpr size_t maximum_tcp_sack_blocks = 4;
+
 class [[gnu::packed]] TCPPacket {
 public:
     TCPPacket() = default;
@@ -94,4 +143,55 @@ private:
 
 static_assert(AssertSize<TCPPacket, 20>());
 
+struct TCPOptions {
+    Optional<u16> maximum_segment_size;
+    Optional<u8> window_scale;
+    bool sack_permitted { false };
+    Vector<TCPSACKBlock, maximum_tcp_sack_blocks> sack_blocks;
+
+    static TCPOptions parse(TCPPacket const& packet)
+    {
+        TCPOptions options;
+        auto read_u32 = [](u8 const* bytes) -> u32 {
+            return (static_cast<u32>(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+        };
+        auto const* option = reinterpret_cast<u8 const*>(&packet) + sizeof(TCPPacket);
+        auto const* end = reinterpret_cast<u8 const*>(packet.payload());
+        while (option < end) {
+            auto kind = static_cast<TCPOptionKind>(option[0]);
+            if (kind == TCPOptionKind::End)
+                break;
+            if (kind == TCPOptionKind::NoOperation) {
+                ++option;
+                continue;
+            }
+            if (end - option < 2 || option[1] < 2 || option[1] > end - option)
+                break;
+            u8 length = option[1];
+            switch (kind) {
+            case TCPOptionKind::MaximumSegmentSize:
+                if (length == sizeof(TCPOptionMSS))
+                    options.maximum_segment_size = (option[2] << 8) | option[3];
+                break;
+            case TCPOptionKind::WindowScale:
+                if (length == sizeof(TCPOptionWindowScale))
+                    options.window_scale = min(option[2], maximum_tcp_window_scale);
+                break;
+            case TCPOptionKind::SACKPermitted:
+                options.sack_permitted = length == sizeof(TCPOptionSACKPermitted);
+                break;
+            case TCPOptionKind::SACK:
+                for (size_t offset = 2; offset + 2 * sizeof(u32) <= length && options.sack_blocks.size() < maximum_tcp_sack_blocks; offset += 2 * sizeof(u32)) {
+                    options.sack_blocks.unchecked_append({ read_u32(option + offset), read_u32(option + offset + sizeof(u32)) });
+                }
+                break;
+            default:
+                break;
+            }
+            option += length;
+        }
+        return options;
+    }
+};
+
 }
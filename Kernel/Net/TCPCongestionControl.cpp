@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Net/TCPCongestionControl.h>
+
+namespace Kernel {
+
+ErrorOr<NonnullOwnPtr<TCPCongestionController>> TCPCongestionController::try_create(Algorithm algorithm, u32 maximum_segment_size)
+{
+    switch (algorithm) {
+    case Algorithm::NewReno:
+        return TRY(adopt_nonnull_own_or_enomem(new (nothrow) TCPNewRenoCongestionController(maximum_segment_size)));
+    case Algorithm::CUBIC:
+        return TRY(adopt_nonnull_own_or_enomem(new (nothrow) TCPCUBICCongestionController(maximum_segment_size)));
+    }
+    VERIFY_NOT_REACHED();
+}
+
+Optional<TCPCongestionController::Algorithm> TCPCongestionController::algorithm_from_name(StringView name)
+{
+    if (name == "newreno"sv || name == "reno"sv)
+        return Algorithm::NewReno;
+    if (name == "cubic"sv)
+        return Algorithm::CUBIC;
+    return {};
+}
+
+TCPCongestionController::TCPCongestionController(u32 maximum_segment_size)
+{
+    set_maximum_segment_size(maximum_segment_size);
+}
+
+void TCPCongestionController::set_maximum_segment_size(u32 maximum_segment_size)
+{
+    VERIFY(maximum_segment_size > 0);
+    m_maximum_segment_size = maximum_segment_size;
+    // RFC 6928, 2. TCP Modification
+    m_congestion_window = min(10 * maximum_segment_size, max(2 * maximum_segment_size, 14600u));
+}
+
+void TCPCongestionController::grow_in_slow_start(u32 acknowledged_bytes)
+{
+    u32 increase = min(acknowledged_bytes, 2 * m_maximum_segment_size);
+    m_congestion_window = min(static_cast<u64>(m_congestion_window) + increase, static_cast<u64>(NumericLimits<u32>::max()));
+}
+
+void TCPCongestionController::did_time_out(u32 bytes_in_flight, Time const&)
+{
+    // RFC 5681, 3.1. Equation (4), and the loss window of one segment.
+    m_slow_start_threshold = max(bytes_in_flight / 2, 2 * m_maximum_segment_size);
+    m_congestion_window = m_maximum_segment_size;
+}
+
+void TCPNewRenoCongestionController::did_acknowledge(u32 acknowledged_bytes, Time const&, Time const&)
+{
+    if (is_in_slow_start()) {
+        grow_in_slow_start(acknowledged_bytes);
+        return;
+    }
+
+    // RFC 5681, 3.1: Grow by one segment per window's worth of acknowledged data.
+    m_bytes_acknowledged_in_congestion_avoidance += acknowledged_bytes;
+    if (m_bytes_acknowledged_in_congestion_avoidance >= m_congestion_window) {
+        m_bytes_acknowledged_in_congestion_avoidance -= m_congestion_window;
+        m_congestion_window += m_maximum_segment_size;
+    }
+}
+
+void TCPNewRenoCongestionController::did_detect_loss(u32 bytes_in_flight, Time const&)
+{
+    m_slow_start_threshold = max(bytes_in_flight / 2, 2 * m_maximum_segment_size);
+    m_congestion_window = m_slow_start_threshold;
+    m_bytes_acknowledged_in_congestion_avoidance = 0;
+}
+
+// The constants from RFC 8312 as fractions, since we can't use floating point in the kernel.
+// C = 0.4, beta = 0.7 and alpha = 3 * (1 - beta) / (1 + beta) = 9 / 17.
+static constexpr i64 cubic_c_numerator = 4;
+static constexpr i64 cubic_c_denominator = 10;
+static constexpr u64 cubic_beta_numerator = 7;
+static constexpr u64 cubic_beta_denominator = 10;
+static constexpr u64 cubic_alpha_numerator = 9;
+static constexpr u64 cubic_alpha_denominator = 17;
+
+// Keeps (t - K)^3 from overflowing, the window stops growing after this long anyway.
+static constexpr i64 maximum_cubic_offset_ms = 100'000;
+
+static u64 integer_cube_root(u64 value)
+{
+    u64 root = 0;
+    for (int shift = 63; shift >= 0; shift -= 3) {
+        root *= 2;
+        u64 step = 3 * root * (root + 1) + 1;
+        if ((value >> shift) >= step) {
+            value -= step << shift;
+            ++root;
+        }
+    }
+    return root;
+}
+
+void TCPCUBICCongestionController::did_acknowledge(u32 acknowledged_bytes, Time const& now, Time const& smoothed_round_trip_time)
+{
+    if (is_in_slow_start()) {
+        grow_in_slow_start(acknowledged_bytes);
+        return;
+    }
+
+    if (!m_epoch_start.has_value()) {
+        m_epoch_start = now;
+        if (m_congestion_window < m_window_before_reduction) {
+            // K = cubic_root((W_max - cwnd) / C), with the window in segments and K in milliseconds.
+            u64 missing_segments = (m_window_before_reduction - m_congestion_window) / m_maximum_segment_size;
+            m_origin_point = m_window_before_reduction;
+            m_time_to_origin_point_ms = integer_cube_root(missing_segments * cubic_c_denominator * 1'000'000'000 / cubic_c_numerator);
+        } else {
+            m_origin_point = m_congestion_window;
+            m_time_to_origin_point_ms = 0;
+        }
+        m_reno_friendly_window = m_congestion_window;
+    }
+
+    // RFC 8312, 4.1: W_cubic(t) = C * (t - K)^3 + W_max, evaluated one RTT into the future.
+    i64 elapsed_ms = (now - m_epoch_start.value() + smoothed_round_trip_time).to_milliseconds();
+    i64 offset_ms = clamp(elapsed_ms - static_cast<i64>(m_time_to_origin_point_ms), -maximum_cubic_offset_ms, maximum_cubic_offset_ms);
+    i64 offset_segments = cubic_c_numerator * offset_ms * offset_ms * offset_ms / (cubic_c_denominator * 1'000'000'000);
+    i64 target = static_cast<i64>(m_origin_point) + offset_segments * m_maximum_segment_size;
+    // RFC 8312, 4.3: The target is kept between cwnd and 1.5 * cwnd.
+    target = clamp(target, static_cast<i64>(m_congestion_window), static_cast<i64>(m_congestion_window) * 3 / 2);
+
+    // RFC 8312, 4.2: In the TCP-friendly region, W_est grows by alpha segments per RTT.
+    u64 reno_friendly_increase = static_cast<u64>(acknowledged_bytes) * m_maximum_segment_size * cubic_alpha_numerator / (cubic_alpha_denominator * m_congestion_window);
+    m_reno_friendly_window = min(m_reno_friendly_window + reno_friendly_increase, static_cast<u64>(NumericLimits<u32>::max()));
+    if (m_reno_friendly_window > target) {
+        m_congestion_window = m_reno_friendly_window;
+        return;
+    }
+
+    // RFC 8312, 4.3 and 4.4: Grow by (target - cwnd) / cwnd for each acknowledged segment.
+    u64 increase = static_cast<u64>(target - m_congestion_window) * acknowledged_bytes / m_congestion_window;
+    m_congestion_window = min(m_congestion_window + increase, static_cast<u64>(NumericLimits<u32>::max()));
+}
+
+void TCPCUBICCongestionController::did_detect_loss(u32, Time const&)
+{
+    m_epoch_start.clear();
+
+    // RFC 8312, 4.6. Fast Convergence
+    if (m_congestion_window < m_window_before_reduction)
+        m_window_before_reduction = static_cast<u64>(m_congestion_window) * (cubic_beta_denominator + cubic_beta_numerator) / (2 * cubic_beta_denominator);
+    else
+        m_window_before_reduction = m_congestion_window;
+
+    // RFC 8312, 4.5. Multiplicative Decrease
+    m_slow_start_threshold = max(static_cast<u64>(m_congestion_window) * cubic_beta_numerator / cubic_beta_denominator, static_cast<u64>(2 * m_maximum_segment_size));
+    m_congestion_window = m_slow_start_threshold;
+}
+
+void TCPCUBICCongestionController::did_time_out(u32 bytes_in_flight, Time const& now)
+{
+    // RFC 8312, 4.7: A timeout is handled like any other congestion event, but with a loss window of one segment.
+    did_detect_loss(bytes_in_flight, now);
+    m_congestion_window = m_maximum_segment_size;
+}
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/StringView.h>
+#include <AK/Time.h>
+#include <AK/Types.h>
+
+namespace Kernel {
+
+// A TCPCongestionController decides how much unacknowledged data a TCPSocket may have in flight.
+// The socket takes care of detecting loss (through duplicate ACKs, SACK or a retransmission timeout)
+// and only informs the controller about it, so the algorithms only differ in how they grow and
+// shrink the congestion window.
+class TCPCongestionController {
+public:
+    enum class Algorithm {
+        NewReno,
+        CUBIC,
+    };
+
+    static constexpr Algorithm default_algorithm = Algorithm::CUBIC;
+
+    static ErrorOr<NonnullOwnPtr<TCPCongestionController>> try_create(Algorithm, u32 maximum_segment_size);
+    static Optional<Algorithm> algorithm_from_name(StringView);
+
+    virtual ~TCPCongestionController() = default;
+
+    virtual Algorithm algorithm() const = 0;
+    virtual StringView name() const = 0;
+
+    u32 congestion_window() const { return m_congestion_window; }
+    u32 slow_start_threshold() const { return m_slow_start_threshold; }
+    bool is_in_slow_start() const { return m_congestion_window < m_slow_start_threshold; }
+
+    u32 maximum_segment_size() const { return m_maximum_segment_size; }
+    void set_maximum_segment_size(u32);
+
+    // Called for every ACK that acknowledges new data while the socket is not recovering from loss.
+    virtual void did_acknowledge(u32 acknowledged_bytes, Time const& now, Time const& smoothed_round_trip_time) = 0;
+    // Called once when the socket enters loss recovery after duplicate ACKs or SACK blocks indicated loss.
+    virtual void did_detect_loss(u32 bytes_in_flight, Time const& now) = 0;
+    // Called when the retransmission timer expired.
+    virtual void did_time_out(u32 bytes_in_flight, Time const& now);
+
+protected:
+    explicit TCPCongestionController(u32 maximum_segment_size);
+
+    // RFC 3465, 2.2. Appropriate Byte Counting during slow start with L = 2 * SMSS.
+    void grow_in_slow_start(u32 acknowledged_bytes);
+
+    u32 m_maximum_segment_size { 0 };
+    u32 m_congestion_window { 0 };
+    u32 m_slow_start_threshold { NumericLimits<u32>::max() };
+};
+
+// RFC 5681 and RFC 6582
+class TCPNewRenoCongestionController final : public TCPCongestionController {
+public:
+    explicit TCPNewRenoCongestionController(u32 maximum_segment_size)
+        : TCPCongestionController(maximum_segment_size)
+    {
+    }
+
+    virtual Algorithm algorithm() const override { return Algorithm::NewReno; }
+    virtual StringView name() const override { return "newreno"sv; }
+
+    virtual void did_acknowledge(u32 acknowledged_bytes, Time const& now, Time const& smoothed_round_trip_time) override;
+    virtual void did_detect_loss(u32 bytes_in_flight, Time const& now) override;
+
+private:
+    u32 m_bytes_acknowledged_in_congestion_avoidance { 0 };
+};
+
+// RFC 8312
+class TCPCUBICCongestionController final : public TCPCongestionController {
+public:
+    explicit TCPCUBICCongestionController(u32 maximum_segment_size)
+        : TCPCongestionController(maximum_segment_size)
+    {
+    }
+
+    virtual Algorithm algorithm() const override { return Algorithm::CUBIC; }
+    virtual StringView name() const override { return "cubic"sv; }
+
+    virtual void did_acknowledge(u32 acknowledged_bytes, Time const& now, Time const& smoothed_round_trip_time) override;
+    virtual void did_detect_loss(u32 bytes_in_flight, Time const& now) override;
+    virtual void did_time_out(u32 bytes_in_flight, Time const& now) override;
+
+private:
+    // The window size just before the last reduction.
+    u32 m_window_before_reduction { 0 };
+    // The window the cubic function grows back to, and the time in milliseconds it takes to get there.
+    u32 m_origin_point { 0 };
+    u64 m_time_to_origin_point_ms { 0 };
+    // The window a Reno-style flow would have, used to stay TCP-friendly on short RTT paths.
+    u32 m_reno_friendly_window { 0 };
+    Optional<Time> m_epoch_start;
+};
+
+}
@@ -6,6 +6,7 @@
 
 #include <AK/Singleton.h>
 #include <AK/Time.h>
+#include <Kernel/API/POSIX/netinet/tcp.h>
 #include <Kernel/Debug.h>
 #include <Kernel/Devices/RandomDevice.h>
 #include <Kernel/FileSystem/OpenFileDescription.h>
@@ -22,6 +23,29 @@
 
 namespace Kernel {
 
+// RFC 5681, 3.2: Fast retransmit happens after three duplicate ACKs, RFC 6675 uses the same threshold for SACKed segments.
+static constexpr u32 duplicate_ack_threshold = 3;
+
+// RFC 6298 recommends a minimum RTO of one second, but like most other implementations we use a shorter one,
+// since a whole second of silence after a single lost segment is very noticeable on low latency links.
+static constexpr Time minimum_retransmission_timeout = Time::from_milliseconds(200);
+static constexpr Time maximum_retransmission_timeout = Time::from_seconds(60);
+static constexpr i64 clock_granularity_us = 1000;
+
+// The window scale we offer, which is enough to advertise our whole 256 KiB receive buffer.
+static constexpr u8 receive_window_scale_to_offer = 3;
+
+// RFC 793, 3.3: Sequence numbers wrap around, so they have to be compared modulo 2^32.
+static constexpr bool seq_lt(u32 a, u32 b)
+{
+    return static_cast<i32>(a - b) < 0;
+}
+
+static constexpr bool seq_leq(u32 a, u32 b)
+{
+    return static_cast<i32>(a - b) <= 0;
+}
+
 void TCPSocket::for_each(Function<void(TCPSocket const&)> callback)
 {
     sockets_by_tuple().for_each_shared([&](auto const& it) {
@@ -130,7 +154,7 @@ ErrorOr<NonnullLockRefPtr<TCPSocket>> TCPSocket::try_create_client(IPv4Address c
             return EEXIST;
 
         auto receive_buffer = TRY(try_create_receive_buffer());
-        auto client = TRY(TCPSocket::try_create(protocol(), move(receive_buffer)));
+        auto client = TRY(TCPSocket::try_create(protocol(), move(receive_buffer), m_congestion_controller->algorithm()));
 
         client->set_setup_state(SetupState::InProgress);
         client->set_local_address(new_local_address);
@@ -162,10 +186,10 @@ void TCPSocket::release_for_accept(NonnullLockRefPtr<TCPSocket> socket)
     [[maybe_unused]] auto rc = queue_connection_from(move(socket));
 }
 
-TCPSocket::TCPSocket(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, NonnullOwnPtr<KBuffer> scratch_buffer)
+TCPSocket::TCPSocket(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, NonnullOwnPtr<KBuffer> scratch_buffer, NonnullOwnPtr<TCPCongestionController> congestion_controller)
     : IPv4Socket(SOCK_STREAM, protocol, move(receive_buffer), move(scratch_buffer))
+    , m_congestion_controller(move(congestion_controller))
 {
-    m_last_retransmit_time = kgettimeofday();
 }
 
 TCPSocket::~TCPSocket()
@@ -175,11 +199,12 @@ TCPSocket::~TCPSocket()
     dbgln_if(TCP_SOCKET_DEBUG, "~TCPSocket in state {}", to_string(state()));
 }
 
-ErrorOr<NonnullLockRefPtr<TCPSocket>> TCPSocket::try_create(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer)
+ErrorOr<NonnullLockRefPtr<TCPSocket>> TCPSocket::try_create(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, TCPCongestionController::Algorithm congestion_control_algorithm)
 {
     // Note: Scratch buffer is only used for SOCK_STREAM sockets.
     auto scratch_buffer = TRY(KBuffer::try_create_with_size("TCPSocket: Scratch buffer"sv, 65536));
-    return adopt_nonnull_lock_ref_or_enomem(new (nothrow) TCPSocket(protocol, move(receive_buffer), move(scratch_buffer)));
+    auto congestion_controller = TRY(TCPCongestionController::try_create(congestion_control_algorithm, 536));
+    return adopt_nonnull_lock_ref_or_enomem(new (nothrow) TCPSocket(protocol, move(receive_buffer), move(scratch_buffer), move(congestion_controller)));
 }
 
 ErrorOr<size_t> TCPSocket::protocol_size(ReadonlyBytes raw_ipv4_packet)
@@ -205,8 +230,24 @@ ErrorOr<size_t> TCPSocket::protocol_send(UserOrKernelBuffer const& data, size_t
     RoutingDecision routing_decision = route_to(peer_address(), local_address(), bound_interface());
     if (routing_decision.is_zero())
         return set_so_error(EHOSTUNREACH);
-    size_t mss = routing_decision.adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
-    data_length = min(data_length, mss);
+    auto& adapter = *routing_decision.adapter;
+    size_t mss = maximum_segment_payload_size(adapter, TCPFlags::PSH | TCPFlags::ACK);
+    if (data_length > mss && adapter.has_capability(NetworkAdapter::Capability::TCPSegmentation)) {
+        // Hand the adapter as many segments as the windows allow at once, it will cut them up for us.
+        size_t room = m_unacked_packets.with_shared([&](auto& unacked_packets) -> size_t {
+            size_t send_window_room = m_send_window_size > unacked_packets.size ? m_send_window_size - unacked_packets.size : 0;
+            size_t congestion_window = m_congestion_controller->congestion_window();
+            size_t bytes_in_flight = unacked_packets.bytes_in_flight();
+            size_t congestion_window_room = congestion_window > bytes_in_flight ? congestion_window - bytes_in_flight : 0;
+            return min(send_window_room, congestion_window_room);
+        });
+        size_t headers_size = adapter.ipv4_payload_offset() + sizeof(TCPPacket) + options_size_for(TCPFlags::PSH | TCPFlags::ACK);
+        size_t limit = min(room, adapter.maximum_tcp_segmentation_size() - headers_size);
+        limit -= limit % mss;
+        data_length = min(data_length, max(limit, mss));
+    } else {
+        data_length = min(data_length, mss);
+    }
     TRY(send_tcp_packet(TCPFlags::PSH | TCPFlags::ACK, &data, data_length, &routing_decision));
     return data_length;
 }
@@ -226,8 +267,7 @@ ErrorOr<void> TCPSocket::send_tcp_packet(u16 flags, UserOrKernelBuffer const* pa
 
     auto ipv4_payload_offset = routing_decision.adapter->ipv4_payload_offset();
 
-    bool const has_mss_option = flags == TCPFlags::SYN;
-    const size_t options_size = has_mss_option ? sizeof(TCPOptionMSS) : 0;
+    const size_t options_size = options_size_for(flags);
     const size_t tcp_header_size = sizeof(TCPPacket) + options_size;
     const size_t buffer_size = ipv4_payload_offset + tcp_header_size + payload_size;
     auto packet = routing_decision.adapter->acquire_packet_buffer(buffer_size);
@@ -241,7 +281,9 @@ ErrorOr<void> TCPSocket::send_tcp_packet(u16 flags, UserOrKernelBuffer const* pa
     VERIFY(local_port());
     tcp_packet.set_source_port(local_port());
     tcp_packet.set_destination_port(peer_port());
-    tcp_packet.set_window_size(NumericLimits<u16>::max());
+    // RFC 7323, 2.2: The window field of a SYN segment is never scaled.
+    u8 window_scale = (flags & TCPFlags::SYN) ? 0 : m_receive_window_scale;
+    tcp_packet.set_window_size(min(receive_window_size() >> window_scale, static_cast<u32>(NumericLimits<u16>::max())));
     tcp_packet.set_sequence_number(m_sequence_number);
     tcp_packet.set_data_offset(tcp_header_size / sizeof(u32));
     tcp_packet.set_flags(flags);
@@ -259,26 +301,39 @@ ErrorOr<void> TCPSocket::send_tcp_packet(u16 flags, UserOrKernelBuffer const* pa
         tcp_packet.set_ack_number(m_ack_number);
     }
 
+    u32 sequence_number = m_sequence_number;
     if (flags & TCPFlags::SYN) {
         ++m_sequence_number;
     } else {
         m_sequence_number += payload_size;
     }
 
-    if (has_mss_option) {
+    if (options_size > 0) {
         u16 mss = routing_decision.adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
-        TCPOptionMSS mss_option { mss };
-        VERIFY(packet->buffer->size() >= ipv4_payload_offset + sizeof(TCPPacket) + sizeof(mss_option));
-        memcpy(packet->buffer->data() + ipv4_payload_offset + sizeof(TCPPacket), &mss_option, sizeof(mss_option));
+        VERIFY(packet->buffer->size() >= ipv4_payload_offset + sizeof(TCPPacket) + options_size);
+        write_options(flags, packet->buffer->data() + ipv4_payload_offset + sizeof(TCPPacket), mss);
     }
 
-    tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
+    auto& adapter = *routing_decision.adapter;
+    TransmitOffload offload;
+    if (payload_size > maximum_segment_payload_size(adapter, flags))
+        offload.tcp_segment_size = maximum_segment_payload_size(adapter, flags);
+    if (adapter.has_capability(NetworkAdapter::Capability::TransmitChecksum)) {
+        offload.layer4_checksum = true;
+        tcp_packet.set_checksum(ipv4_pseudo_header_checksum(local_address(), peer_address(), IPv4Protocol::TCP, tcp_header_size + payload_size));
+    } else {
+        tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
+    }
 
     bool expect_ack { tcp_packet.has_syn() || payload_size > 0 };
     if (expect_ack) {
         bool append_failed { false };
         m_unacked_packets.with_exclusive([&](auto& unacked_packets) {
-            auto result = unacked_packets.packets.try_append({ m_sequence_number, packet, ipv4_payload_offset, *routing_decision.adapter });
+            auto now = kgettimeofday();
+            // RFC 6298, 5.1: Start the retransmission timer if it isn't running yet.
+            if (unacked_packets.packets.is_empty())
+                m_retransmit_deadline = now + m_retransmission_timeout;
+            auto result = unacked_packets.packets.try_append({ m_sequence_number, packet, ipv4_payload_offset, *routing_decision.adapter, 0, sequence_number, static_cast<u32>(payload_size), now, offload });
             if (result.is_error()) {
                 dbgln("TCPSocket: Dropped outbound packet because try_append() failed");
                 append_failed = true;
@@ -293,34 +348,198 @@ ErrorOr<void> TCPSocket::send_tcp_packet(u16 flags, UserOrKernelBuffer const* pa
 
     m_packets_out++;
     m_bytes_out += buffer_size;
-    routing_decision.adapter->send_packet(packet->bytes());
+    routing_decision.adapter->send_packet(packet->bytes(), offload);
     if (!expect_ack)
         routing_decision.adapter->release_packet_buffer(*packet);
 
     return {};
 }
 
+size_t TCPSocket::maximum_segment_payload_size(NetworkAdapter const& adapter, u16 flags) const
+{
+    size_t mss = min<size_t>(adapter.mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket), m_peer_maximum_segment_size);
+    return mss - options_size_for(flags);
+}
+
+size_t TCPSocket::options_size_for(u16 flags) const
+{
+    if (flags & TCPFlags::SYN) {
+        // We always offer window scaling and SACK, but a SYN|ACK may only contain them if the peer offered them too.
+        // Both of them get padded to four bytes with NOPs.
+        bool is_reply = flags & TCPFlags::ACK;
+        size_t size = sizeof(TCPOptionMSS);
+        if (!is_reply || m_receive_window_scale > 0)
+            size += 1 + sizeof(TCPOptionWindowScale);
+        if (!is_reply || m_sack_permitted)
+            size += 2 + sizeof(TCPOptionSACKPermitted);
+        return size;
+    }
+
+    if ((flags & TCPFlags::ACK) && m_sack_permitted && !m_out_of_order_segments.is_empty())
+        return 2 + 2 + sack_blocks_to_send().size() * 2 * sizeof(u32);
+
+    return 0;
+}
+
+void TCPSocket::write_options(u16 flags, u8* options, u16 maximum_segment_size) const
+{
+    auto append = [&](auto const& option) {
+        memcpy(options, &option, sizeof(option));
+        options += sizeof(option);
+    };
+    auto append_byte = [&](TCPOptionKind kind) {
+        *options++ = to_underlying(kind);
+    };
+    auto append_u32 = [&](u32 value) {
+        NetworkOrdered<u32> network_value = value;
+        memcpy(options, &network_value, sizeof(network_value));
+        options += sizeof(network_value);
+    };
+
+    if (flags & TCPFlags::SYN) {
+        bool is_reply = flags & TCPFlags::ACK;
+        append(TCPOptionMSS { maximum_segment_size });
+        if (!is_reply || m_receive_window_scale > 0) {
+            append_byte(TCPOptionKind::NoOperation);
+            append(TCPOptionWindowScale { receive_window_scale_to_offer });
+        }
+        if (!is_reply || m_sack_permitted) {
+            append_byte(TCPOptionKind::NoOperation);
+            append_byte(TCPOptionKind::NoOperation);
+            append(TCPOptionSACKPermitted {});
+        }
+        return;
+    }
+
+    auto blocks = sack_blocks_to_send();
+    append_byte(TCPOptionKind::NoOperation);
+    append_byte(TCPOptionKind::NoOperation);
+    append_byte(TCPOptionKind::SACK);
+    *options++ = 2 + blocks.size() * 2 * sizeof(u32);
+    for (auto& block : blocks) {
+        append_u32(block.left_edge);
+        append_u32(block.right_edge);
+    }
+}
+
+Vector<TCPSACKBlock, maximum_tcp_sack_blocks> TCPSocket::sack_blocks_to_send() const
+{
+    // Coalesces the queued segments into contiguous blocks.
+    auto for_each_block = [&](auto callback) {
+        Optional<TCPSACKBlock> current;
+        for (auto& segment : m_out_of_order_segments) {
+            u32 end = segment.sequence_number + segment.payload_size;
+            if (current.has_value() && seq_leq(segment.sequence_number, current->right_edge)) {
+                if (seq_lt(current->right_edge, end))
+                    current->right_edge = end;
+                continue;
+            }
+            if (current.has_value())
+                callback(*current);
+            current = TCPSACKBlock { segment.sequence_number, end };
+        }
+        if (current.has_value())
+            callback(*current);
+    };
+
+    // RFC 2018, 4: The first block has to contain the most recently received segment.
+    Vector<TCPSACKBlock, maximum_tcp_sack_blocks> blocks;
+    for_each_block([&](auto& block) {
+        if (blocks.is_empty() && seq_leq(block.left_edge, m_last_out_of_order_sequence_number) && seq_lt(m_last_out_of_order_sequence_number, block.right_edge))
+            blocks.unchecked_append(block);
+    });
+    for_each_block([&](auto& block) {
+        if (blocks.size() == maximum_tcp_sack_blocks)
+            return;
+        if (!blocks.is_empty() && blocks.first().left_edge == block.left_edge)
+            return;
+        blocks.unchecked_append(block);
+    });
+    return blocks;
+}
+
+u32 TCPSocket::receive_window_size() const
+{
+    // RFC 7323, 2.3: Without window scaling, the largest window we can advertise is 64 KiB.
+    return min(space_in_receive_buffer(), static_cast<size_t>(NumericLimits<u16>::max()) << m_receive_window_scale);
+}
+
+void TCPSocket::process_syn_options(TCPPacket const& packet)
+{
+    auto options = TCPOptions::parse(packet);
+
+    m_peer_maximum_segment_size = options.maximum_segment_size.value_or(536);
+    if (m_peer_maximum_segment_size == 0)
+        m_peer_maximum_segment_size = 536;
+
+    // RFC 7323, 2.2: Window scaling is only enabled if both sides sent the option, and we always do.
+    if (options.window_scale.has_value()) {
+        m_send_window_scale = options.window_scale.value();
+        m_receive_window_scale = receive_window_scale_to_offer;
+    } else {
+        m_send_window_scale = 0;
+        m_receive_window_scale = 0;
+    }
+
+    m_sack_permitted = options.sack_permitted;
+
+    auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
+    u32 mss = m_peer_maximum_segment_size;
+    if (!routing_decision.is_zero())
+        mss = min<u32>(mss, routing_decision.adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket));
+    m_congestion_controller->set_maximum_segment_size(mss);
+
+    dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket({}) peer options: mss={}, window_scale={}, sack_permitted={}", this, m_peer_maximum_segment_size, m_send_window_scale, m_sack_permitted);
+}
+
 void TCPSocket::receive_tcp_packet(TCPPacket const& packet, u16 size)
 {
+    // NOTE: A listening socket hands the options in a SYN over to the client socket it creates for it.
+    if (packet.has_syn() && m_state != State::Listen)
+        process_syn_options(packet);
+
     if (packet.has_ack()) {
         u32 ack_number = packet.ack_number();
+        auto now = kgettimeofday();
 
         dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: receive_tcp_packet: {}", ack_number);
 
+        u32 previous_send_window_size = m_send_window_size;
+        // RFC 7323, 2.2: The window field of a SYN segment is never scaled.
+        if (packet.has_syn())
+            m_send_window_size = packet.window_size();
+        else
+            m_send_window_size = static_cast<u32>(packet.window_size()) << m_send_window_scale;
+
+        Vector<TCPSACKBlock, maximum_tcp_sack_blocks> sack_blocks;
+        if (m_sack_permitted && !packet.has_syn() && packet.header_size() > sizeof(TCPPacket))
+            sack_blocks = TCPOptions::parse(packet).sack_blocks;
+
+        bool carries_data_or_control = packet.has_syn() || packet.has_fin() || size > packet.header_size();
+
         int removed = 0;
         m_unacked_packets.with_exclusive([&](auto& unacked_packets) {
+            u32 acknowledged_bytes = 0;
+            Optional<Time> round_trip_time_sample;
+
             while (!unacked_packets.packets.is_empty()) {
                 auto& packet = unacked_packets.packets.first();
 
                 dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: iterate: {}", packet.ack_number);
 
-                if (packet.ack_number <= ack_number) {
+                if (seq_leq(packet.ack_number, ack_number)) {
                     auto old_adapter = packet.adapter.strong_ref();
                     if (old_adapter)
                         old_adapter->release_packet_buffer(*packet.buffer);
-                    TCPPacket& tcp_packet = *(TCPPacket*)(packet.buffer->buffer->data() + packet.ipv4_payload_offset);
-                    auto payload_size = packet.buffer->buffer->data() + packet.buffer->buffer->size() - (u8*)tcp_packet.payload();
-                    unacked_packets.size -= payload_size;
+                    unacked_packets.size -= packet.payload_size;
+                    if (packet.sacked)
+                        unacked_packets.sacked_size -= packet.payload_size;
+                    if (packet.lost)
+                        unacked_packets.lost_size -= packet.payload_size;
+                    // RFC 6298, 3: Karn's algorithm, retransmitted packets don't give us valid samples.
+                    if (packet.tx_counter == 0)
+                        round_trip_time_sample = now - packet.sent_time;
+                    acknowledged_bytes += packet.payload_size;
                     evaluate_block_conditions();
                     unacked_packets.packets.take_first();
                     removed++;
@@ -329,8 +548,55 @@ void TCPSocket::receive_tcp_packet(TCPPacket const& packet, u16 size)
                 }
             }
 
+            if (!sack_blocks.is_empty())
+                process_sack_blocks(unacked_packets, sack_blocks);
+
+            if (removed > 0) {
+                if (round_trip_time_sample.has_value())
+                    update_round_trip_time(round_trip_time_sample.value());
+                m_retransmit_attempts = 0;
+                m_duplicate_acks_received = 0;
+                // RFC 6298, 5.3: Restart the retransmission timer when new data is acknowledged.
+                m_retransmit_deadline = now + m_retransmission_timeout;
+
+                if (m_in_loss_recovery && seq_leq(m_recovery_point, ack_number))
+                    m_in_loss_recovery = false;
+                else if (!m_in_loss_recovery && acknowledged_bytes > 0)
+                    m_congestion_controller->did_acknowledge(acknowledged_bytes, now, smoothed_round_trip_time());
+            } else if (!unacked_packets.packets.is_empty() && !carries_data_or_control && m_send_window_size == previous_send_window_size) {
+                // RFC 5681, 2: A window update is not a duplicate ACK.
+                ++m_duplicate_acks_received;
+            }
+
+            if (!unacked_packets.packets.is_empty()) {
+                if (!m_in_loss_recovery) {
+                    bool sack_indicates_loss = m_sack_permitted && mark_lost_packets(unacked_packets);
+                    if (sack_indicates_loss || m_duplicate_acks_received >= duplicate_ack_threshold) {
+                        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket({}) entering loss recovery, duplicate_acks={}", this, m_duplicate_acks_received);
+                        m_in_loss_recovery = true;
+                        m_recovery_point = m_sequence_number;
+                        m_congestion_controller->did_detect_loss(unacked_packets.size, now);
+                        // RFC 5681, 3.2: The first unacknowledged segment is retransmitted right away.
+                        auto& first_packet = unacked_packets.packets.first();
+                        if (!first_packet.sacked && !first_packet.lost) {
+                            first_packet.lost = true;
+                            unacked_packets.lost_size += first_packet.payload_size;
+                        }
+                    }
+                } else if (m_sack_permitted) {
+                    mark_lost_packets(unacked_packets);
+                }
+
+                if (unacked_packets.lost_size > 0) {
+                    auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
+                    if (!routing_decision.is_zero())
+                        retransmit_lost_packets(unacked_packets, routing_decision);
+                }
+            }
+
             if (unacked_packets.packets.is_empty()) {
                 m_retransmit_attempts = 0;
+                m_in_loss_recovery = false;
                 dequeue_for_retransmit();
             }
 
@@ -342,10 +608,246 @@ void TCPSocket::receive_tcp_packet(TCPPacket const& packet, u16 size)
     m_bytes_in += packet.header_size() + size;
 }
 
+void TCPSocket::update_round_trip_time(Time const& sample)
+{
+    // RFC 6298, 2. The Basic Algorithm
+    i64 sample_us = max<i64>(sample.to_microseconds(), 0);
+    i64 smoothed_us;
+    i64 variance_us;
+    if (!m_smoothed_round_trip_time.has_value()) {
+        smoothed_us = sample_us;
+        variance_us = sample_us / 2;
+    } else {
+        smoothed_us = m_smoothed_round_trip_time->to_microseconds();
+        variance_us = m_round_trip_time_variance.to_microseconds();
+        i64 difference_us = smoothed_us > sample_us ? smoothed_us - sample_us : sample_us - smoothed_us;
+        variance_us = (3 * variance_us + difference_us) / 4;
+        smoothed_us = (7 * smoothed_us + sample_us) / 8;
+    }
+
+    m_smoothed_round_trip_time = Time::from_microseconds(smoothed_us);
+    m_round_trip_time_variance = Time::from_microseconds(variance_us);
+    auto timeout = Time::from_microseconds(smoothed_us + max(clock_granularity_us, 4 * variance_us));
+    m_retransmission_timeout = clamp(timeout, minimum_retransmission_timeout, maximum_retransmission_timeout);
+}
+
+void TCPSocket::process_sack_blocks(UnackedPackets& unacked_packets, Span<TCPSACKBlock const> blocks)
+{
+    for (auto& packet : unacked_packets.packets) {
+        if (packet.sacked || packet.payload_size == 0)
+            continue;
+        for (auto& block : blocks) {
+            if (seq_lt(packet.sequence_number, block.left_edge) || seq_lt(block.right_edge, packet.ack_number))
+                continue;
+            packet.sacked = true;
+            unacked_packets.sacked_size += packet.payload_size;
+            if (packet.lost) {
+                packet.lost = false;
+                unacked_packets.lost_size -= packet.payload_size;
+            }
+            break;
+        }
+    }
+}
+
+bool TCPSocket::mark_lost_packets(UnackedPackets& unacked_packets)
+{
+    // RFC 6675, 4: A packet is considered lost once at least DupThresh packets after it have been SACKed.
+    size_t sacked_packets_after = 0;
+    for (auto& packet : unacked_packets.packets) {
+        if (packet.sacked)
+            ++sacked_packets_after;
+    }
+
+    bool did_mark_any = false;
+    for (auto& packet : unacked_packets.packets) {
+        if (sacked_packets_after < duplicate_ack_threshold)
+            break;
+        if (packet.sacked) {
+            --sacked_packets_after;
+            continue;
+        }
+        if (packet.lost || packet.retransmitted_after_loss)
+            continue;
+        packet.lost = true;
+        unacked_packets.lost_size += packet.payload_size;
+        did_mark_any = true;
+    }
+    return did_mark_any;
+}
+
+void TCPSocket::retransmit_lost_packets(UnackedPackets& unacked_packets, RoutingDecision& routing_decision)
+{
+    // RFC 6675, 5: Retransmissions are limited by the congestion window just like new data.
+    for (auto& packet : unacked_packets.packets) {
+        if (unacked_packets.lost_size == 0)
+            break;
+        if (!packet.lost)
+            continue;
+        if (unacked_packets.bytes_in_flight() >= m_congestion_controller->congestion_window())
+            break;
+        packet.lost = false;
+        packet.retransmitted_after_loss = true;
+        unacked_packets.lost_size -= packet.payload_size;
+        retransmit_packet(packet, routing_decision);
+    }
+}
+
+void TCPSocket::retransmit_packet(OutgoingPacket& packet, RoutingDecision& routing_decision)
+{
+    auto& adapter = *routing_decision.adapter;
+    packet.tx_counter++;
+    m_retransmits++;
+
+    if constexpr (TCP_SOCKET_DEBUG) {
+        auto& tcp_packet = *(const TCPPacket*)(packet.buffer->buffer->data() + packet.ipv4_payload_offset);
+        dbgln("Sending TCP packet from {}:{} to {}:{} with ({}{}{}{}) seq_no={}, ack_no={}, tx_counter={}",
+            local_address(), local_port(),
+            peer_address(), peer_port(),
+            (tcp_packet.has_syn() ? "SYN " : ""),
+            (tcp_packet.has_ack() ? "ACK " : ""),
+            (tcp_packet.has_fin() ? "FIN " : ""),
+            (tcp_packet.has_rst() ? "RST " : ""),
+            tcp_packet.sequence_number(),
+            tcp_packet.ack_number(),
+            packet.tx_counter);
+    }
+
+    if (packet.offload.tcp_segment_size && !adapter.has_capability(NetworkAdapter::Capability::TCPSegmentation)) {
+        // NOTE: This can happen if after a route change we ended up on another adapter which can't do it for us.
+        retransmit_packet_in_segments(packet, routing_decision);
+        return;
+    }
+
+    size_t ipv4_payload_offset = routing_decision.adapter->ipv4_payload_offset();
+    if (ipv4_payload_offset != packet.ipv4_payload_offset) {
+        // FIXME: Add support for this. This can happen if after a route change
+        // we ended up on another adapter which doesn't have the same layer 2 type
+        // like the previous adapter.
+        VERIFY_NOT_REACHED();
+    }
+
+    auto packet_buffer = packet.buffer->bytes();
+
+    if (packet.offload.layer4_checksum && !adapter.has_capability(NetworkAdapter::Capability::TransmitChecksum)) {
+        auto& tcp_packet = *(TCPPacket*)(packet.buffer->buffer->data() + packet.ipv4_payload_offset);
+        tcp_packet.set_checksum(0);
+        tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, packet.payload_size));
+        packet.offload.layer4_checksum = false;
+    }
+
+    adapter.fill_in_ipv4_header(*packet.buffer,
+        local_address(), routing_decision.next_hop, peer_address(),
+        IPv4Protocol::TCP, packet_buffer.size() - ipv4_payload_offset, type_of_service(), ttl());
+    adapter.send_packet(packet_buffer, packet.offload);
+    m_packets_out++;
+    m_bytes_out += packet_buffer.size();
+}
+
+void TCPSocket::retransmit_packet_in_segments(OutgoingPacket const& packet, RoutingDecision& routing_decision)
+{
+    auto& adapter = *routing_decision.adapter;
+    auto const& original_tcp_packet = *(TCPPacket const*)(packet.buffer->buffer->data() + packet.ipv4_payload_offset);
+    size_t tcp_header_size = original_tcp_packet.header_size();
+    size_t segment_size = min<size_t>(packet.offload.tcp_segment_size, adapter.mtu() - sizeof(IPv4Packet) - tcp_header_size);
+    size_t ipv4_payload_offset = adapter.ipv4_payload_offset();
+
+    TransmitOffload offload;
+    offload.layer4_checksum = adapter.has_capability(NetworkAdapter::Capability::TransmitChecksum);
+
+    for (size_t offset = 0; offset < packet.payload_size; offset += segment_size) {
+        size_t payload_size = min<size_t>(segment_size, packet.payload_size - offset);
+        size_t buffer_size = ipv4_payload_offset + tcp_header_size + payload_size;
+        auto segment = adapter.acquire_packet_buffer(buffer_size);
+        if (!segment) {
+            // NOTE: Whatever we couldn't send is retransmitted again once the retransmission timer expires.
+            dbgln("TCPSocket: Ran out of packet buffers while segmenting a retransmitted packet");
+            return;
+        }
+        adapter.fill_in_ipv4_header(*segment, local_address(), routing_decision.next_hop, peer_address(),
+            IPv4Protocol::TCP, buffer_size - ipv4_payload_offset, type_of_service(), ttl());
+
+        auto& tcp_packet = *(TCPPacket*)(segment->buffer->data() + ipv4_payload_offset);
+        memcpy(&tcp_packet, &original_tcp_packet, tcp_header_size);
+        memcpy(tcp_packet.payload(), (u8 const*)original_tcp_packet.payload() + offset, payload_size);
+        tcp_packet.set_sequence_number(original_tcp_packet.sequence_number() + offset);
+        // Only the last segment gets to push the data or close the connection.
+        if (offset + payload_size < packet.payload_size)
+            tcp_packet.set_flags(original_tcp_packet.flags() & ~(TCPFlags::PSH | TCPFlags::FIN));
+
+        tcp_packet.set_checksum(0);
+        if (offload.layer4_checksum)
+            tcp_packet.set_checksum(ipv4_pseudo_header_checksum(local_address(), peer_address(), IPv4Protocol::TCP, tcp_header_size + payload_size));
+        else
+            tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
+
+        adapter.send_packet(segment->bytes(), offload);
+        adapter.release_packet_buffer(*segment);
+        m_packets_out++;
+        m_bytes_out += buffer_size;
+    }
+}
+
+bool TCPSocket::queue_out_of_order_segment(ReadonlyBytes raw_ipv4_packet, TCPPacket const& packet, size_t payload_size, Time const& packet_timestamp)
+{
+    u32 sequence_number = packet.sequence_number();
+    i32 distance_from_next_expected = static_cast<i32>(sequence_number - m_ack_number);
+    if (distance_from_next_expected <= 0)
+        return false;
+    // Anything outside of the window we advertised would have been dropped by a well-behaved peer anyway.
+    if (static_cast<size_t>(distance_from_next_expected) + payload_size > receive_window_size())
+        return false;
+    // Overlapping segments could otherwise add up to more than the window.
+    if (m_out_of_order_segments.size() >= maximum_out_of_order_segments || m_out_of_order_bytes + payload_size > receive_window_size())
+        return false;
+
+    size_t index = 0;
+    for (; index < m_out_of_order_segments.size(); ++index) {
+        auto& segment = m_out_of_order_segments[index];
+        if (segment.sequence_number == sequence_number) {
+            m_last_out_of_order_sequence_number = sequence_number;
+            return true;
+        }
+        if (seq_lt(sequence_number, segment.sequence_number))
+            break;
+    }
+
+    auto buffer_or_error = KBuffer::try_create_with_bytes("TCPSocket: Out of order segment"sv, raw_ipv4_packet);
+    if (buffer_or_error.is_error())
+        return false;
+    if (m_out_of_order_segments.try_insert(index, { sequence_number, static_cast<u32>(payload_size), buffer_or_error.release_value(), packet_timestamp }).is_error())
+        return false;
+
+    m_out_of_order_bytes += payload_size;
+    m_last_out_of_order_sequence_number = sequence_number;
+    return true;
+}
+
+bool TCPSocket::deliver_out_of_order_segments()
+{
+    if (m_out_of_order_segments.is_empty())
+        return false;
+
+    while (!m_out_of_order_segments.is_empty()) {
+        auto& segment = m_out_of_order_segments.first();
+        i32 distance_from_next_expected = static_cast<i32>(segment.sequence_number - m_ack_number);
+        if (distance_from_next_expected > 0)
+            break;
+        if (distance_from_next_expected == 0) {
+            if (!did_receive(peer_address(), peer_port(), segment.raw_ipv4_packet->bytes(), segment.timestamp))
+                break;
+            m_ack_number += segment.payload_size;
+        }
+        // NOTE: Segments that overlap with data we already have are simply dropped, the peer will retransmit whatever is missing.
+        m_out_of_order_bytes -= segment.payload_size;
+        m_out_of_order_segments.remove(0);
+    }
+    return true;
+}
+
 bool TCPSocket::should_delay_next_ack() const
 {
-    // FIXME: We don't know the MSS here so make a reasonable guess.
-    const size_t mss = 1500;
+    const size_t mss = m_congestion_controller->maximum_segment_size();
 
     // RFC 1122 says we should send an ACK for every two full-sized segments.
     if (m_ack_number >= m_last_ack_number_sent + 2 * mss)
@@ -576,19 +1078,11 @@ void TCPSocket::dequeue_for_retransmit()
 void TCPSocket::retransmit_packets()
 {
     auto now = kgettimeofday();
-
-    // RFC6298 says we should have at least one second between retransmits. According to
-    // RFC1122 we must do exponential backoff - even for SYN packets.
-    i64 retransmit_interval = 1;
-    for (decltype(m_retransmit_attempts) i = 0; i < m_retransmit_attempts; i++)
-        retransmit_interval *= 2;
-
-    if (m_last_retransmit_time > now - Time::from_seconds(retransmit_interval))
+    if (now < m_retransmit_deadline)
         return;
 
     dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket({}) handling retransmit", this);
 
-    m_last_retransmit_time = now;
     ++m_retransmit_attempts;
 
     if (m_retransmit_attempts > maximum_retransmits) {
@@ -598,45 +1092,41 @@ void TCPSocket::retransmit_packets()
         return;
     }
 
+    // RFC 6298, 5.5: Back off the timer. According to RFC1122 we must do this even for SYN packets.
+    m_retransmission_timeout = min(m_retransmission_timeout + m_retransmission_timeout, maximum_retransmission_timeout);
+    m_retransmit_deadline = now + m_retransmission_timeout;
+
     auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
     if (routing_decision.is_zero())
         return;
 
     m_unacked_packets.with_exclusive([&](auto& unacked_packets) {
+        m_congestion_controller->did_time_out(unacked_packets.size, now);
+        m_in_loss_recovery = false;
+        m_duplicate_acks_received = 0;
+
+        // RFC 2018, 8 and RFC 6675, 5.1: After a timeout the SACK information is discarded, since the peer
+        // may have reneged on it, and everything that is still outstanding is considered lost.
+        unacked_packets.sacked_size = 0;
+        unacked_packets.lost_size = 0;
         for (auto& packet : unacked_packets.packets) {
-            packet.tx_counter++;
-
-            if constexpr (TCP_SOCKET_DEBUG) {
-                auto& tcp_packet = *(const TCPPacket*)(packet.buffer->buffer->data() + packet.ipv4_payload_offset);
-                dbgln("Sending TCP packet from {}:{} to {}:{} with ({}{}{}{}) seq_no={}, ack_no={}, tx_counter={}",
-                    local_address(), local_port(),
-                    peer_address(), peer_port(),
-                    (tcp_packet.has_syn() ? "SYN " : ""),
-                    (tcp_packet.has_ack() ? "ACK " : ""),
-                    (tcp_packet.has_fin() ? "FIN " : ""),
-                    (tcp_packet.has_rst() ? "RST " : ""),
-                    tcp_packet.sequence_number(),
-                    tcp_packet.ack_number(),
-                    packet.tx_counter);
-            }
-
-            size_t ipv4_payload_offset = routing_decision.adapter->ipv4_payload_offset();
-            if (ipv4_payload_offset != packet.ipv4_payload_offset) {
-                // FIXME: Add support for this. This can happen if after a route change
-                // we ended up on another adapter which doesn't have the same layer 2 type
-                // like the previous adapter.
-                VERIFY_NOT_REACHED();
-            }
-
-            auto packet_buffer = packet.buffer->bytes();
-
-            routing_decision.adapter->fill_in_ipv4_header(*packet.buffer,
-                local_address(), routing_decision.next_hop, peer_address(),
-                IPv4Protocol::TCP, packet_buffer.size() - ipv4_payload_offset, type_of_service(), ttl());
-            routing_decision.adapter->send_packet(packet_buffer);
-            m_packets_out++;
-            m_bytes_out += packet_buffer.size();
+            packet.sacked = false;
+            packet.retransmitted_after_loss = false;
+            packet.lost = true;
+            unacked_packets.lost_size += packet.payload_size;
         }
+
+        if (unacked_packets.packets.is_empty())
+            return;
+
+        // The first packet is always resent, even if it's a SYN or FIN without any payload. With the congestion
+        // window collapsed to one segment, the rest follows as ACKs for it come in.
+        auto& first_packet = unacked_packets.packets.first();
+        first_packet.lost = false;
+        first_packet.retransmitted_after_loss = true;
+        unacked_packets.lost_size -= first_packet.payload_size;
+        retransmit_packet(first_packet, routing_decision);
+        retransmit_lost_packets(unacked_packets, routing_decision);
     });
 }
 
@@ -652,7 +1142,64 @@ bool TCPSocket::can_write(OpenFileDescription const& file_description, u64 size)
         return true;
 
     return m_unacked_packets.with_shared([&](auto& unacked_packets) {
-        return unacked_packets.size + size <= m_send_window_size;
+        // NOTE: We always allow one segment, which then doubles as a probe for a zero window.
+        if (unacked_packets.size >= max(m_send_window_size, static_cast<u32>(m_peer_maximum_segment_size)))
+            return false;
+        // Lost packets are retransmitted before any new data is sent.
+        if (unacked_packets.lost_size > 0)
+            return false;
+        return unacked_packets.bytes_in_flight() < m_congestion_controller->congestion_window();
     });
 }
+
+ErrorOr<void> TCPSocket::setsockopt(int level, int option, Userspace<void const*> user_value, socklen_t user_value_size)
+{
+    if (level != IPPROTO_TCP)
+        return IPv4Socket::setsockopt(level, option, user_value, user_value_size);
+
+    MutexLocker locker(mutex());
+
+    switch (option) {
+    case TCP_CONGESTION: {
+        char name[TCP_CA_NAME_MAX] {};
+        TRY(copy_from_user(name, static_ptr_cast<char const*>(user_value), min(static_cast<size_t>(user_value_size), sizeof(name) - 1)));
+        auto algorithm = TCPCongestionController::algorithm_from_name({ name, strlen(name) });
+        if (!algorithm.has_value())
+            return ENOENT;
+        // NOTE: The controller is used without holding the socket's mutex by can_write(), so we don't swap it out on a live connection.
+        if (m_state != State::Closed && m_state != State::Listen)
+            return EISCONN;
+        if (algorithm.value() != m_congestion_controller->algorithm())
+            m_congestion_controller = TRY(TCPCongestionController::try_create(algorithm.value(), m_congestion_controller->maximum_segment_size()));
+        return {};
+    }
+    default:
+        return ENOPROTOOPT;
+    }
+}
+
+ErrorOr<void> TCPSocket::getsockopt(OpenFileDescription& description, int level, int option, Userspace<void*> value, Userspace<socklen_t*> value_size)
+{
+    if (level != IPPROTO_TCP)
+        return IPv4Socket::getsockopt(description, level, option, value, value_size);
+
+    MutexLocker locker(mutex());
+
+    socklen_t size;
+    TRY(copy_from_user(&size, value_size.unsafe_userspace_ptr()));
+
+    switch (option) {
+    case TCP_CONGESTION: {
+        char name[TCP_CA_NAME_MAX] {};
+        auto algorithm_name = m_congestion_controller->name();
+        VERIFY(algorithm_name.length() < sizeof(name));
+        memcpy(name, algorithm_name.characters_without_null_termination(), algorithm_name.length());
+        size = min(static_cast<size_t>(size), sizeof(name));
+        TRY(copy_to_user(static_ptr_cast<char*>(value), name, size));
+        return copy_to_user(value_size, &size);
+    }
+    default:
+        return ENOPROTOOPT;
+    }
+}
 }
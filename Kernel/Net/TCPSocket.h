@@ -13,6 +13,8 @@
 #include <Kernel/Library/LockWeakPtr.h>
 #include <Kernel/Locking/MutexProtected.h>
 #include <Kernel/Net/IPv4Socket.h>
+#include <Kernel/Net/TCP.h>
+#include <Kernel/Net/TCPCongestionControl.h>
 
 namespace Kernel {
 
@@ -20,7 +22,7 @@ class TCPSocket final : public IPv4Socket {
 public:
     static void for_each(Function<void(TCPSocket const&)>);
     static ErrorOr<void> try_for_each(Function<ErrorOr<void>(TCPSocket const&)>);
-    static ErrorOr<NonnullLockRefPtr<TCPSocket>> try_create(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer);
+    static ErrorOr<NonnullLockRefPtr<TCPSocket>> try_create(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, TCPCongestionController::Algorithm = TCPCongestionController::default_algorithm);
     virtual ~TCPSocket() override;
 
     virtual bool unref() const override;
@@ -133,6 +135,17 @@ public:
     u32 bytes_in() const { return m_bytes_in; }
     u32 packets_out() const { return m_packets_out; }
     u32 bytes_out() const { return m_bytes_out; }
+    u32 retransmits() const { return m_retransmits; }
+
+    TCPCongestionController const& congestion_controller() const { return *m_congestion_controller; }
+    Time smoothed_round_trip_time() const { return m_smoothed_round_trip_time.value_or(Time::zero()); }
+    Time round_trip_time_variance() const { return m_round_trip_time_variance; }
+    Time retransmission_timeout() const { return m_retransmission_timeout; }
+    u32 send_window_size() const { return m_send_window_size; }
+    u32 receive_window_size() const;
+    u8 send_window_scale() const { return m_send_window_scale; }
+    u8 receive_window_scale() const { return m_receive_window_scale; }
+    bool is_sack_permitted() const { return m_sack_permitted; }
 
     // FIXME: Make this configurable?
     static constexpr u32 maximum_duplicate_acks = 5;
@@ -142,6 +155,14 @@ public:
     ErrorOr<void> send_ack(bool allow_duplicate = false);
     ErrorOr<void> send_tcp_packet(u16 flags, UserOrKernelBuffer const* = nullptr, size_t = 0, RoutingDecision* = nullptr);
     void receive_tcp_packet(TCPPacket const&, u16 size);
+    void process_syn_options(TCPPacket const&);
+
+    // Holds on to a segment that arrived ahead of the next expected sequence number, so it doesn't
+    // have to be retransmitted once the gap before it is filled.
+    bool queue_out_of_order_segment(ReadonlyBytes raw_ipv4_packet, TCPPacket const&, size_t payload_size, Time const& packet_timestamp);
+    // Delivers queued segments that have become contiguous with the data received so far.
+    // Returns whether there were any queued segments, in which case the ACK shouldn't be delayed.
+    bool deliver_out_of_order_segments();
 
     bool should_delay_next_ack() const;
 
@@ -160,6 +181,9 @@ public:
 
     virtual ErrorOr<void> close() override;
 
+    virtual ErrorOr<void> setsockopt(int level, int option, Userspace<void const*>, socklen_t) override;
+    virtual ErrorOr<void> getsockopt(OpenFileDescription&, int level, int option, Userspace<void*>, Userspace<socklen_t*>) override;
+
     virtual bool can_write(OpenFileDescription const&, u64) const override;
 
     static NetworkOrdered<u16> compute_tcp_checksum(IPv4Address const& source, IPv4Address const& destination, TCPPacket const&, u16 payload_size);
@@ -168,7 +192,7 @@ protected:
     void set_direction(Direction direction) { m_direction = direction; }
 
 private:
-    explicit TCPSocket(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, NonnullOwnPtr<KBuffer> scratch_buffer);
+    explicit TCPSocket(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, NonnullOwnPtr<KBuffer> scratch_buffer, NonnullOwnPtr<TCPCongestionController>);
     virtual StringView class_name() const override { return "TCPSocket"sv; }
 
     virtual void shut_down_for_writing() override;
@@ -185,6 +209,21 @@ private:
     void enqueue_for_retransmit();
     void dequeue_for_retransmit();
 
+    struct OutgoingPacket;
+    struct UnackedPackets;
+
+    size_t options_size_for(u16 flags) const;
+    size_t maximum_segment_payload_size(NetworkAdapter const&, u16 flags) const;
+    void write_options(u16 flags, u8* options, u16 maximum_segment_size) const;
+    Vector<TCPSACKBlock, maximum_tcp_sack_blocks> sack_blocks_to_send() const;
+
+    void update_round_trip_time(Time const& sample);
+    void process_sack_blocks(UnackedPackets&, Span<TCPSACKBlock const>);
+    bool mark_lost_packets(UnackedPackets&);
+    void retransmit_lost_packets(UnackedPackets&, RoutingDecision&);
+    void retransmit_packet(OutgoingPacket&, RoutingDecision&);
+    void retransmit_packet_in_segments(OutgoingPacket const&, RoutingDecision&);
+
     LockWeakPtr<TCPSocket> m_originator;
     HashMap<IPv4SocketTuple, NonnullLockRefPtr<TCPSocket>> m_pending_release_for_accept;
     Direction m_direction { Direction::Unspecified };
@@ -204,15 +243,45 @@ private:
         size_t ipv4_payload_offset;
         LockWeakPtr<NetworkAdapter> adapter;
         int tx_counter { 0 };
+        u32 sequence_number { 0 };
+        u32 payload_size { 0 };
+        Time sent_time;
+        TransmitOffload offload;
+        // The peer told us it has this packet through a SACK block.
+        bool sacked { false };
+        // We consider this packet lost and haven't retransmitted it yet.
+        bool lost { false };
+        // We retransmitted this packet after it was considered lost, so it won't be marked lost again until the next timeout.
+        bool retransmitted_after_loss { false };
     };
 
     struct UnackedPackets {
         SinglyLinkedList<OutgoingPacket> packets;
         size_t size { 0 };
+        size_t sacked_size { 0 };
+        size_t lost_size { 0 };
+
+        // RFC 6675 calls this "pipe", the data that is still on its way to the peer.
+        size_t bytes_in_flight() const { return size - sacked_size - lost_size; }
     };
 
     MutexProtected<UnackedPackets> m_unacked_packets;
 
+    struct OutOfOrderSegment {
+        u32 sequence_number { 0 };
+        u32 payload_size { 0 };
+        NonnullOwnPtr<KBuffer> raw_ipv4_packet;
+        Time timestamp;
+    };
+
+    // NOTE: Every queued segment takes up a kernel region of its own, so there can't be too many of them.
+    static constexpr size_t maximum_out_of_order_segments = 64;
+
+    // Sorted by sequence number.
+    Vector<OutOfOrderSegment> m_out_of_order_segments;
+    size_t m_out_of_order_bytes { 0 };
+    u32 m_last_out_of_order_sequence_number { 0 };
+
     u32 m_duplicate_acks { 0 };
 
     u32 m_last_ack_number_sent { 0 };
@@ -220,11 +289,31 @@ private:
 
     // FIXME: Make this configurable (sysctl)
     static constexpr u32 maximum_retransmits = 5;
-    Time m_last_retransmit_time;
+    Time m_retransmit_deadline;
     u32 m_retransmit_attempts { 0 };
+    u32 m_retransmits { 0 };
+
+    // RFC 6298, 2. The Basic Algorithm
+    Optional<Time> m_smoothed_round_trip_time;
+    Time m_round_trip_time_variance;
+    Time m_retransmission_timeout { Time::from_seconds(1) };
+
+    NonnullOwnPtr<TCPCongestionController> m_congestion_controller;
+    // RFC 6675, 5. Algorithm Details: Loss recovery ends once everything sent before it started is acknowledged.
+    bool m_in_loss_recovery { false };
+    u32 m_recovery_point { 0 };
+    u32 m_duplicate_acks_received { 0 };
+
+    // RFC 9293 says to assume 536 bytes if the peer doesn't send an MSS option.
+    u16 m_peer_maximum_segment_size { 536 };
 
-    // FIXME: Parse window size TCP option from the peer
+    // The window the peer advertised, already scaled.
     u32 m_send_window_size { 64 * KiB };
+    // RFC 7323 window scaling, both are zero unless both sides sent the option.
+    u8 m_send_window_scale { 0 };
+    u8 m_receive_window_scale { 0 };
+    // RFC 2018, set if both sides sent the SACK-permitted option.
+    bool m_sack_permitted { false };
 
     IntrusiveListNode<TCPSocket> m_retransmit_list_node;
 
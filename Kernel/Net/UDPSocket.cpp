@@ -101,7 +101,13 @@ ErrorOr<size_t> UDPSocket::protocol_send(UserOrKernelBuffer const& data, size_t
     SOCKET_TRY(data.read(udp_packet.payload(), data_length));
     routing_decision.adapter->fill_in_ipv4_header(*packet, local_address(), routing_decision.next_hop,
         peer_address(), IPv4Protocol::UDP, udp_buffer_size, type_of_service(), ttl());
-    routing_decision.adapter->send_packet(packet->bytes());
+    // NOTE: The checksum is optional for UDP over IPv4, so we only add one if the adapter computes it for us.
+    TransmitOffload offload;
+    if (routing_decision.adapter->has_capability(NetworkAdapter::Capability::TransmitChecksum)) {
+        offload.layer4_checksum = true;
+        udp_packet.set_checksum(ipv4_pseudo_header_checksum(local_address(), peer_address(), IPv4Protocol::UDP, udp_buffer_size));
+    }
+    routing_decision.adapter->send_packet(packet->bytes(), offload);
     return data_length;
 }
 
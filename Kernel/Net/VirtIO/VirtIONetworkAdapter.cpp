@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/MACAddress.h>
+#include <Kernel/Bus/PCI/IDs.h>
+#include <Kernel/CommandLine.h>
+#include <Kernel/Debug.h>
+#include <Kernel/Net/NetworkingManagement.h>
+#include <Kernel/Net/VirtIO/VirtIONetworkAdapter.h>
+#include <Kernel/Random.h>
+#include <Kernel/Sections.h>
+#include <Kernel/WorkQueue.h>
+
+namespace Kernel {
+
+// virtio_net_config
+#define DEVICE_MAC 0x0
+#define DEVICE_STATUS 0x6
+
+UNMAP_AFTER_INIT ErrorOr<bool> VirtIONetworkAdapter::probe(PCI::DeviceIdentifier const& pci_device_identifier)
+{
+    if (kernel_command_line().disable_virtio())
+        return false;
+    if (pci_device_identifier.hardware_id().vendor_id != PCI::VendorID::VirtIO)
+        return false;
+    return pci_device_identifier.hardware_id().device_id == PCI::DeviceID::VirtIONetAdapter;
+}
+
+UNMAP_AFTER_INIT ErrorOr<NonnullLockRefPtr<NetworkAdapter>> VirtIONetworkAdapter::create(PCI::DeviceIdentifier const& pci_device_identifier)
+{
+    auto interface_name = TRY(NetworkingManagement::generate_interface_name_from_pci_address(pci_device_identifier));
+    auto receive_buffers_region = TRY(MM.allocate_contiguous_kernel_region(maximum_receive_buffers * buffer_size, "VirtIO Network RX buffers"sv, Memory::Region::Access::ReadWrite));
+    auto transmit_buffers_region = TRY(MM.allocate_contiguous_kernel_region(maximum_transmit_buffers * buffer_size, "VirtIO Network TX buffers"sv, Memory::Region::Access::ReadWrite));
+    auto merged_packet_region = TRY(MM.allocate_kernel_region(maximum_merged_packet_size, "VirtIO Network merged packet"sv, Memory::Region::Access::ReadWrite));
+    return TRY(adopt_nonnull_lock_ref_or_enomem(new (nothrow) VirtIONetworkAdapter(pci_device_identifier, move(interface_name),
+        move(receive_buffers_region), move(transmit_buffers_region), move(merged_packet_region))));
+}
+
+UNMAP_AFTER_INIT VirtIONetworkAdapter::VirtIONetworkAdapter(PCI::DeviceIdentifier const& pci_device_identifier, NonnullOwnPtr<KString> interface_name,
+    NonnullOwnPtr<Memory::Region> receive_buffers_region, NonnullOwnPtr<Memory::Region> transmit_buffers_region, NonnullOwnPtr<Memory::Region> merged_packet_region)
+    : NetworkAdapter(move(interface_name))
+    , VirtIO::Device(pci_device_identifier)
+    , m_receive_buffers_region(move(receive_buffers_region))
+    , m_transmit_buffers_region(move(transmit_buffers_region))
+    , m_merged_packet_region(move(merged_packet_region))
+{
+}
+
+UNMAP_AFTER_INIT ErrorOr<void> VirtIONetworkAdapter::initialize(Badge<NetworkingManagement>)
+{
+    VirtIO::Device::initialize();
+    m_device_configuration = get_config(VirtIO::ConfigurationType::Device);
+    if (!m_device_configuration) {
+        dmesgln_pci(*this, "Device has no configuration space");
+        return Error::from_errno(ENODEV);
+    }
+
+    bool success = negotiate_features([&](u64 supported_features) {
+        u64 negotiated = 0;
+        if (is_feature_set(supported_features, VIRTIO_NET_F_CSUM))
+            negotiated |= VIRTIO_NET_F_CSUM;
+        // Note: This lets the host skip computing checksums of packets that never leave it, we finish those ourselves.
+        if (is_feature_set(supported_features, VIRTIO_NET_F_GUEST_CSUM))
+            negotiated |= VIRTIO_NET_F_GUEST_CSUM;
+        if (is_feature_set(supported_features, VIRTIO_NET_F_MAC))
+            negotiated |= VIRTIO_NET_F_MAC;
+        if (is_feature_set(supported_features, VIRTIO_NET_F_MRG_RXBUF))
+            negotiated |= VIRTIO_NET_F_MRG_RXBUF;
+        if (is_feature_set(supported_features, VIRTIO_NET_F_STATUS))
+            negotiated |= VIRTIO_NET_F_STATUS;
+        return negotiated;
+    });
+    if (!success)
+        return Error::from_errno(ENODEV);
+    // Note: Legacy devices use a shorter packet header, and require it to be in a buffer of its own.
+    if (!is_feature_accepted(VIRTIO_F_VERSION_1)) {
+        dmesgln_pci(*this, "Legacy devices are not supported");
+        return Error::from_errno(ENOTSUP);
+    }
+    m_merged_receive_buffers = is_feature_accepted(VIRTIO_NET_F_MRG_RXBUF);
+
+    if (is_feature_accepted(VIRTIO_NET_F_MAC)) {
+        MACAddress mac;
+        read_config_atomic([&]() {
+            for (size_t i = 0; i < 6; i++)
+                mac[i] = config_read8(*m_device_configuration, DEVICE_MAC + i);
+        });
+        set_mac_address(mac);
+    } else {
+        // Note: Without an address from the device we have to make up a locally administered one.
+        MACAddress mac;
+        for (size_t i = 0; i < 6; i++)
+            mac[i] = get_fast_random<u8>();
+        mac[0] = (mac[0] & 0xfe) | 0x02;
+        set_mac_address(mac);
+    }
+    read_link_status();
+
+    if (!setup_queues(2))
+        return Error::from_errno(ENODEV);
+    m_receive_buffers_count = min<size_t>(maximum_receive_buffers, get_queue(receive_queue).size());
+    auto transmit_buffers_count = min<size_t>(maximum_transmit_buffers, get_queue(transmit_queue).size());
+    for (size_t index = 0; index < transmit_buffers_count; index++)
+        m_free_transmit_buffers.unchecked_append(index);
+    if (is_feature_accepted(VIRTIO_NET_F_CSUM))
+        set_capabilities(Capability::TransmitChecksum);
+
+    // We only ask for transmit interrupts once we run out of transmit buffers, everything else is cleaned up lazily.
+    get_queue(transmit_queue).disable_interrupts();
+    finish_init();
+
+    {
+        auto& queue = get_queue(receive_queue);
+        SpinlockLocker lock(queue.lock());
+        for (size_t index = 0; index < m_receive_buffers_count; index++)
+            supply_receive_buffer(index);
+        notify_queue_if_needed(receive_queue);
+    }
+
+    dmesgln_pci(*this, "MAC address: {}, {} receive and {} transmit buffers{}", mac_address().to_string(), m_receive_buffers_count,
+        transmit_buffers_count, m_merged_receive_buffers ? ", merging receive buffers"sv : ""sv);
+    return {};
+}
+
+void VirtIONetworkAdapter::read_link_status()
+{
+    if (!is_feature_accepted(VIRTIO_NET_F_STATUS)) {
+        m_link_up = true;
+        return;
+    }
+    u16 status = 0;
+    read_config_atomic([&]() {
+        status = config_read16(*m_device_configuration, DEVICE_STATUS);
+    });
+    m_link_up = (status & VIRTIO_NET_S_LINK_UP) != 0;
+}
+
+bool VirtIONetworkAdapter::handle_device_config_change()
+{
+    read_link_status();
+    dbgln_if(VIRTIO_DEBUG, "VirtIONetworkAdapter: Link is {}", m_link_up ? "up"sv : "down"sv);
+    return true;
+}
+
+void VirtIONetworkAdapter::handle_queue_update(u16 queue_index)
+{
+    if (queue_index == receive_queue)
+        schedule_receive_poll();
+    else if (queue_index == transmit_queue)
+        m_transmit_wait_queue.wake_all();
+}
+
+Optional<size_t> VirtIONetworkAdapter::take_used_buffer(u16 queue_index, PhysicalAddress buffers_address, size_t& used_length)
+{
+    auto& queue = get_queue(queue_index);
+    VERIFY(queue.lock().is_locked());
+    auto chain = queue.pop_used_buffer_chain(used_length);
+    if (chain.is_empty())
+        return {};
+    Optional<PhysicalAddress> buffer_address;
+    chain.for_each([&](PhysicalAddress address, size_t) {
+        buffer_address = address;
+    });
+    VERIFY(chain.length() == 1);
+    chain.release_buffer_slots_to_queue();
+    return (buffer_address.value().get() - buffers_address.get()) / buffer_size;
+}
+
+void VirtIONetworkAdapter::supply_receive_buffer(size_t index)
+{
+    auto& queue = get_queue(receive_queue);
+    VERIFY(queue.lock().is_locked());
+    VirtIO::QueueChain chain(queue);
+    // Note: The queue has at least as many descriptors as we have receive buffers.
+    bool success = chain.add_buffer_to_chain(receive_buffer_address(index), buffer_size, VirtIO::BufferType::DeviceWritable);
+    VERIFY(success);
+    supply_chain(receive_queue, chain);
+}
+
+// Finishes a checksum the device left for us: The field holds the checksum of the pseudo header,
+// and we add everything from checksum_start to the end of the packet to it.
+static void finish_partial_checksum(Bytes packet, size_t checksum_start, size_t checksum_offset)
+{
+    u32 checksum = 0;
+    size_t index = checksum_start;
+    for (; index + 1 < packet.size(); index += 2)
+        checksum += (packet[index] << 8) | packet[index + 1];
+    if (index < packet.size())
+        checksum += packet[index] << 8;
+    while (checksum >> 16)
+        checksum = (checksum & 0xffff) + (checksum >> 16);
+    u16 result = ~checksum & 0xffff;
+    // A UDP checksum of zero means there is none, but 0xffff is the same in ones' complement.
+    if (result == 0)
+        result = 0xffff;
+    packet[checksum_start + checksum_offset] = result >> 8;
+    packet[checksum_start + checksum_offset + 1] = result & 0xff;
+}
+
+size_t VirtIONetworkAdapter::receive()
+{
+    auto receive_buffers_address = m_receive_buffers_region->physical_page(0)->paddr();
+    Vector<ReadonlyBytes, receive_poll_budget> packets;
+    Vector<u16, receive_poll_budget + maximum_merged_buffers> used_buffers;
+    size_t count = 0;
+    auto& queue = get_queue(receive_queue);
+    {
+        SpinlockLocker lock(queue.lock());
+        while (count < receive_poll_budget) {
+            size_t used_length;
+            auto index = take_used_buffer(receive_queue, receive_buffers_address, used_length);
+            if (!index.has_value())
+                break;
+            ++count;
+            used_buffers.unchecked_append(index.value());
+            auto* buffer = receive_buffer(index.value());
+            if (used_length < sizeof(PacketHeader) || used_length > buffer_size) {
+                dbgln_if(VIRTIO_DEBUG, "VirtIONetworkAdapter: Dropping packet with bad length {}", used_length);
+                continue;
+            }
+            auto header = *reinterpret_cast<PacketHeader const*>(buffer);
+            Bytes packet { buffer + sizeof(PacketHeader), used_length - sizeof(PacketHeader) };
+
+            if (m_merged_receive_buffers && header.buffers_count > 1) {
+                // Note: The buffers of a merged packet have all been used by the time the device lets us see the first one.
+                bool fits = header.buffers_count <= maximum_merged_buffers;
+                size_t merged_size = 0;
+                auto* merged_packet = m_merged_packet_region->vaddr().as_ptr();
+                for (size_t i = 0; i < header.buffers_count; i++) {
+                    if (i > 0) {
+                        index = take_used_buffer(receive_queue, receive_buffers_address, used_length);
+                        if (!index.has_value()) {
+                            fits = false;
+                            break;
+                        }
+                        packet = { receive_buffer(index.value()), min(used_length, buffer_size) };
+                    }
+                    if (fits && merged_size + packet.size() <= maximum_merged_packet_size)
+                        memcpy(merged_packet + merged_size, packet.data(), packet.size());
+                    else
+                        fits = false;
+                    merged_size += packet.size();
+                    if (i == 0)
+                        continue;
+                    if (used_buffers.size() < used_buffers.capacity())
+                        used_buffers.unchecked_append(index.value());
+                    else
+                        supply_receive_buffer(index.value());
+                }
+                if (!fits) {
+                    dbgln_if(VIRTIO_DEBUG, "VirtIONetworkAdapter: Dropping merged packet of {} buffers", header.buffers_count);
+                    break;
+                }
+                packet = { merged_packet, merged_size };
+            }
+
+            if (header.flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+                if (static_cast<size_t>(header.checksum_start) + header.checksum_offset + sizeof(u16) > packet.size()) {
+                    dbgln_if(VIRTIO_DEBUG, "VirtIONetworkAdapter: Dropping packet with bad checksum location");
+                    continue;
+                }
+                finish_partial_checksum(packet, header.checksum_start, header.checksum_offset);
+            }
+            packets.unchecked_append(packet);
+
+            // Note: There is only one buffer for merged packets, so they always end the batch.
+            if (packet.data() == m_merged_packet_region->vaddr().as_ptr())
+                break;
+        }
+    }
+
+    if (count == 0)
+        return 0;
+
+    // NOTE: The packets are copied out of our buffers here, after that the device may have them back.
+    did_receive_batch(packets);
+    SpinlockLocker lock(queue.lock());
+    for (auto index : used_buffers)
+        supply_receive_buffer(index);
+    notify_queue_if_needed(receive_queue);
+    return count;
+}
+
+void VirtIONetworkAdapter::schedule_receive_poll()
+{
+    if (m_receive_poll_scheduled.exchange(true))
+        return;
+
+    // Receive interrupts stay off until a poll finds the queue empty, so a burst of packets only costs us one of them.
+    get_queue(receive_queue).disable_interrupts();
+    auto result = g_io_work->try_queue([this] { poll_receive(); });
+    if (result.is_error()) {
+        // NOTE: Without a work item we can't defer anything, so just empty the queue right away.
+        while (receive() == receive_poll_budget)
+            ;
+        m_receive_poll_scheduled = false;
+        get_queue(receive_queue).enable_interrupts();
+    }
+}
+
+void VirtIONetworkAdapter::poll_receive()
+{
+    if (receive() == receive_poll_budget) {
+        // There's probably more, but give the other work items a chance first.
+        if (!g_io_work->try_queue([this] { poll_receive(); }).is_error())
+            return;
+        while (receive() == receive_poll_budget)
+            ;
+    }
+
+    m_receive_poll_scheduled = false;
+    get_queue(receive_queue).enable_interrupts();
+    // NOTE: If a packet arrived after we last looked, the device might not have interrupted us for it.
+    if (get_queue(receive_queue).new_data_available())
+        schedule_receive_poll();
+}
+
+void VirtIONetworkAdapter::reclaim_transmit_buffers()
+{
+    VERIFY(m_transmit_lock.is_locked());
+    auto transmit_buffers_address = m_transmit_buffers_region->physical_page(0)->paddr();
+    auto& queue = get_queue(transmit_queue);
+    SpinlockLocker lock(queue.lock());
+    size_t used_length;
+    for (auto index = take_used_buffer(transmit_queue, transmit_buffers_address, used_length); index.has_value(); index = take_used_buffer(transmit_queue, transmit_buffers_address, used_length))
+        m_free_transmit_buffers.unchecked_append(index.value());
+}
+
+void VirtIONetworkAdapter::send_raw(ReadonlyBytes payload, TransmitOffload offload)
+{
+    dbgln_if(VIRTIO_DEBUG, "VirtIONetworkAdapter: Sending packet ({} bytes)", payload.size());
+    VERIFY(!offload.tcp_segment_size);
+    VERIFY(sizeof(PacketHeader) + payload.size() <= buffer_size);
+
+    MutexLocker locker(m_transmit_lock);
+    reclaim_transmit_buffers();
+    if (m_free_transmit_buffers.is_empty()) {
+        get_queue(transmit_queue).enable_interrupts();
+        while (m_free_transmit_buffers.is_empty()) {
+            dbgln_if(VIRTIO_DEBUG, "VirtIONetworkAdapter: No free transmit buffers, waiting for the device");
+            m_transmit_wait_queue.wait_forever("VirtIONetworkAdapter"sv);
+            reclaim_transmit_buffers();
+        }
+        get_queue(transmit_queue).disable_interrupts();
+    }
+    auto index = m_free_transmit_buffers.take_last();
+
+    auto* buffer = transmit_buffer(index);
+    auto& header = *reinterpret_cast<PacketHeader*>(buffer);
+    memset(&header, 0, sizeof(header));
+    if (offload.layer4_checksum) {
+        auto& ipv4 = *reinterpret_cast<IPv4Packet const*>(payload.data() + sizeof(EthernetFrameHeader));
+        bool is_tcp = ipv4.protocol() == (u8)IPv4Protocol::TCP;
+        VERIFY(is_tcp || ipv4.protocol() == (u8)IPv4Protocol::UDP);
+        // The checksum field already holds the checksum of the pseudo header, which is what the device expects to find there.
+        header.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+        header.checksum_start = sizeof(EthernetFrameHeader) + ipv4.internet_header_length() * sizeof(u32);
+        header.checksum_offset = is_tcp ? 16 : 6;
+    }
+    memcpy(buffer + sizeof(PacketHeader), payload.data(), payload.size());
+
+    auto& queue = get_queue(transmit_queue);
+    SpinlockLocker lock(queue.lock());
+    VirtIO::QueueChain chain(queue);
+    // Note: The queue has at least as many descriptors as we have transmit buffers.
+    bool success = chain.add_buffer_to_chain(transmit_buffer_address(index), sizeof(PacketHeader) + payload.size(), VirtIO::BufferType::DeviceReadable);
+    VERIFY(success);
+    supply_chain_and_notify(transmit_queue, chain);
+}
+
+}
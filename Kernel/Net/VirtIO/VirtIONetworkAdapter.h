@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/OwnPtr.h>
+#include <AK/Vector.h>
+#include <Kernel/Bus/VirtIO/Device.h>
+#include <Kernel/Locking/Mutex.h>
+#include <Kernel/Net/NetworkAdapter.h>
+
+namespace Kernel {
+
+#define VIRTIO_NET_F_CSUM (1 << 0)
+#define VIRTIO_NET_F_GUEST_CSUM (1 << 1)
+#define VIRTIO_NET_F_MAC (1 << 5)
+#define VIRTIO_NET_F_MRG_RXBUF (1 << 15)
+#define VIRTIO_NET_F_STATUS (1 << 16)
+
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM 1
+#define VIRTIO_NET_HDR_F_DATA_VALID 2
+
+#define VIRTIO_NET_S_LINK_UP 1
+
+class VirtIONetworkAdapter final
+    : public NetworkAdapter
+    , public VirtIO::Device {
+public:
+    static ErrorOr<bool> probe(PCI::DeviceIdentifier const&);
+    static ErrorOr<NonnullLockRefPtr<NetworkAdapter>> create(PCI::DeviceIdentifier const&);
+    virtual ErrorOr<void> initialize(Badge<NetworkingManagement>) override;
+
+    virtual ~VirtIONetworkAdapter() override = default;
+
+    virtual void send_raw(ReadonlyBytes, TransmitOffload) override;
+    virtual bool link_up() override { return m_link_up; }
+    virtual bool link_full_duplex() override { return true; }
+
+    virtual StringView purpose() const override { return class_name(); }
+    virtual StringView device_name() const override { return class_name(); }
+    virtual Type adapter_type() const override { return Type::Ethernet; }
+
+private:
+    // virtio_net_hdr, including the num_buffers field that every VirtIO 1.0 device uses.
+    struct [[gnu::packed]] PacketHeader {
+        u8 flags;
+        u8 gso_type;
+        u16 header_length;
+        u16 gso_size;
+        u16 checksum_start;
+        u16 checksum_offset;
+        u16 buffers_count;
+    };
+    static_assert(AssertSize<PacketHeader, 12>());
+
+    static constexpr u16 receive_queue = 0;
+    static constexpr u16 transmit_queue = 1;
+
+    // Two buffers share a page. A full sized frame and its header fit in one buffer, so the device only merges
+    // several buffers for a packet if it wants to.
+    static constexpr size_t buffer_size = 2048;
+    static constexpr size_t maximum_receive_buffers = 256;
+    static constexpr size_t maximum_transmit_buffers = 128;
+    // Merged packets are put back together in a separate buffer, which is why we don't accept larger ones.
+    static constexpr size_t maximum_merged_packet_size = 16 * KiB;
+    static constexpr size_t maximum_merged_buffers = maximum_merged_packet_size / (buffer_size - sizeof(PacketHeader)) + 1;
+    // The most packets we take off the receive queue in one go before letting everyone else run again.
+    static constexpr size_t receive_poll_budget = 64;
+
+    VirtIONetworkAdapter(PCI::DeviceIdentifier const&, NonnullOwnPtr<KString> interface_name, NonnullOwnPtr<Memory::Region> receive_buffers_region,
+        NonnullOwnPtr<Memory::Region> transmit_buffers_region, NonnullOwnPtr<Memory::Region> merged_packet_region);
+
+    virtual StringView class_name() const override { return "VirtIONetworkAdapter"sv; }
+    virtual bool handle_device_config_change() override;
+    virtual void handle_queue_update(u16 queue_index) override;
+
+    void read_link_status();
+
+    u8* receive_buffer(size_t index) { return m_receive_buffers_region->vaddr().offset(index * buffer_size).as_ptr(); }
+    PhysicalAddress receive_buffer_address(size_t index) const { return m_receive_buffers_region->physical_page(0)->paddr().offset(index * buffer_size); }
+    u8* transmit_buffer(size_t index) { return m_transmit_buffers_region->vaddr().offset(index * buffer_size).as_ptr(); }
+    PhysicalAddress transmit_buffer_address(size_t index) const { return m_transmit_buffers_region->physical_page(0)->paddr().offset(index * buffer_size); }
+
+    // Both of these expect the lock of the queue to be held.
+    Optional<size_t> take_used_buffer(u16 queue_index, PhysicalAddress buffers_address, size_t& used_length);
+    void supply_receive_buffer(size_t index);
+
+    // Takes up to receive_poll_budget packets off the receive queue, and returns how many there were.
+    size_t receive();
+    void schedule_receive_poll();
+    void poll_receive();
+
+    void reclaim_transmit_buffers();
+
+    NonnullOwnPtr<Memory::Region> m_receive_buffers_region;
+    NonnullOwnPtr<Memory::Region> m_transmit_buffers_region;
+    NonnullOwnPtr<Memory::Region> m_merged_packet_region;
+    VirtIO::Configuration const* m_device_configuration { nullptr };
+    size_t m_receive_buffers_count { 0 };
+    Atomic<bool> m_receive_poll_scheduled { false };
+    bool m_merged_receive_buffers { false };
+    bool m_link_up { false };
+
+    // Protects the transmit buffers, the device owns the ones that aren't free.
+    Mutex m_transmit_lock { "VirtIONetworkAdapter TX"sv };
+    Vector<u16, maximum_transmit_buffers> m_free_transmit_buffers;
+    WaitQueue m_transmit_wait_queue;
+};
+
+}
@@ -165,6 +165,23 @@ ErrorOr<void> PerformanceEventBuffer::append_with_ip_and_bp(ProcessID pid, Threa
         event.data.read.start_timestamp = arg5;
         event.data.read.success = !arg6.is_error();
         break;
+    case PERF_EVENT_LOCK_CONTENTION:
+        event.data.lock_contention.lock = arg1;
+        event.data.lock_contention.role = static_cast<LockContentionRole>(arg2);
+        event.data.lock_contention.holder_tid_or_waiter_count = arg4;
+        event.data.lock_contention.wait_time_ns = arg5;
+        memset(event.data.lock_contention.name, 0, sizeof(event.data.lock_contention.name));
+        if (!arg3.is_empty())
+            memcpy(event.data.lock_contention.name, arg3.characters_without_null_termination(), min(arg3.length(), sizeof(event.data.lock_contention.name) - 1));
+        break;
+    case PERF_EVENT_OFF_CPU:
+        event.data.off_cpu.reason = static_cast<OffCPUReason>(arg1);
+        event.data.off_cpu.runnable_ns = arg2;
+        event.data.off_cpu.blocked_ns = arg5;
+        memset(event.data.off_cpu.blocker, 0, sizeof(event.data.off_cpu.blocker));
+        if (!arg3.is_empty())
+            memcpy(event.data.off_cpu.blocker, arg3.characters_without_null_termination(), min(arg3.length(), sizeof(event.data.off_cpu.blocker) - 1));
+        break;
     default:
         return EINVAL;
     }
@@ -296,6 +313,39 @@ ErrorOr<void> PerformanceEventBuffer::to_json_impl(Serializer& object) const
             TRY(event_object.add("start_timestamp"sv, event.data.read.start_timestamp));
             TRY(event_object.add("success"sv, event.data.read.success));
             break;
+        case PERF_EVENT_LOCK_CONTENTION:
+            TRY(event_object.add("type"sv, "lock_contention"));
+            TRY(event_object.add("lock"sv, show_kernel_addresses ? static_cast<u64>(event.data.lock_contention.lock) : 0));
+            TRY(event_object.add("name"sv, event.data.lock_contention.name));
+            if (event.data.lock_contention.role == LockContentionRole::Waiter) {
+                TRY(event_object.add("role"sv, "waiter"));
+                TRY(event_object.add("holder_tid"sv, event.data.lock_contention.holder_tid_or_waiter_count));
+                TRY(event_object.add("wait_time_ns"sv, event.data.lock_contention.wait_time_ns));
+            } else {
+                TRY(event_object.add("role"sv, "holder"));
+                TRY(event_object.add("waiter_count"sv, event.data.lock_contention.holder_tid_or_waiter_count));
+            }
+            break;
+        case PERF_EVENT_OFF_CPU:
+            TRY(event_object.add("type"sv, "off_cpu"));
+            switch (event.data.off_cpu.reason) {
+            case OffCPUReason::IO:
+                TRY(event_object.add("reason"sv, "io"));
+                break;
+            case OffCPUReason::Lock:
+                TRY(event_object.add("reason"sv, "lock"));
+                break;
+            case OffCPUReason::Sleep:
+                TRY(event_object.add("reason"sv, "sleep"));
+                break;
+            case OffCPUReason::Other:
+                TRY(event_object.add("reason"sv, "other"));
+                break;
+            }
+            TRY(event_object.add("blocker"sv, event.data.off_cpu.blocker));
+            TRY(event_object.add("blocked_ns"sv, event.data.off_cpu.blocked_ns));
+            TRY(event_object.add("runnable_ns"sv, event.data.off_cpu.runnable_ns));
+            break;
         }
         TRY(event_object.add("pid"sv, event.pid));
         TRY(event_object.add("tid"sv, event.tid));
@@ -76,6 +76,41 @@ struct [[gnu::packed]] ReadPerformanceEvent {
     bool success;
 };
 
+enum class LockContentionRole : u8 {
+    // A thread that had to wait for the lock, recorded once it got it.
+    Waiter,
+    // The thread that held the lock, recorded when it released it to waiting threads.
+    Holder,
+};
+
+struct [[gnu::packed]] LockContentionPerformanceEvent {
+    FlatPtr lock;
+    u64 wait_time_ns;
+    // The thread holding the lock when a waiter started waiting, or the number of waiters for a holder.
+    u32 holder_tid_or_waiter_count;
+    LockContentionRole role;
+    char name[48];
+};
+
+enum class OffCPUReason : u8 {
+    // Waiting for a device, or for a file, socket or pipe to become ready.
+    IO,
+    // Waiting for a futex, a file lock or a kernel mutex.
+    Lock,
+    // Sleeping until a given time.
+    Sleep,
+    // Waiting for anything else, like a child process, a signal or a kernel wait queue.
+    Other,
+};
+
+struct [[gnu::packed]] OffCPUPerformanceEvent {
+    u64 blocked_ns;
+    // How long the thread had to wait for a processor after it was woken up.
+    u64 runnable_ns;
+    OffCPUReason reason;
+    char blocker[32];
+};
+
 struct [[gnu::packed]] PerformanceEvent {
     u32 type { 0 };
     u8 stack_size { 0 };
@@ -96,6 +131,8 @@ struct [[gnu::packed]] PerformanceEvent {
         KFreePerformanceEvent kfree;
         SignpostPerformanceEvent signpost;
         ReadPerformanceEvent read;
+        LockContentionPerformanceEvent lock_contention;
+        OffCPUPerformanceEvent off_cpu;
     } data;
     static constexpr size_t max_stack_frame_count = 64;
     FlatPtr stack[max_stack_frame_count];
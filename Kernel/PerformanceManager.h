@@ -161,6 +161,50 @@ public:
         [[maybe_unused]] auto rc = event_buffer->append(PERF_EVENT_READ, fd, size, {}, &thread, filepath_string_index, start_timestamp, result); // wrong arguments
     }
 
+    static bool is_tracing_lock_contention(Thread& thread)
+    {
+        if ((g_profiling_event_mask & PERF_EVENT_LOCK_CONTENTION) == 0 || thread.is_profiling_suppressed())
+            return false;
+        return thread.process().current_perf_events_buffer() != nullptr;
+    }
+
+    static void add_lock_waiter_event(Thread& thread, Mutex const& mutex, ThreadID holder_tid, Time wait_time)
+    {
+        if (thread.is_profiling_suppressed())
+            return;
+        if (auto* event_buffer = thread.process().current_perf_events_buffer()) {
+            [[maybe_unused]] auto rc = event_buffer->append(PERF_EVENT_LOCK_CONTENTION, reinterpret_cast<FlatPtr>(&mutex),
+                to_underlying(LockContentionRole::Waiter), mutex.name(), &thread, holder_tid.value(), wait_time.to_nanoseconds());
+        }
+    }
+
+    static void add_lock_holder_event(Thread& thread, Mutex const& mutex, size_t waiter_count)
+    {
+        if (thread.is_profiling_suppressed())
+            return;
+        if (auto* event_buffer = thread.process().current_perf_events_buffer()) {
+            [[maybe_unused]] auto rc = event_buffer->append(PERF_EVENT_LOCK_CONTENTION, reinterpret_cast<FlatPtr>(&mutex),
+                to_underlying(LockContentionRole::Holder), mutex.name(), &thread, waiter_count);
+        }
+    }
+
+    static bool is_tracing_off_cpu(Thread& thread)
+    {
+        if ((g_profiling_event_mask & PERF_EVENT_OFF_CPU) == 0 || thread.is_profiling_suppressed())
+            return false;
+        return thread.process().current_perf_events_buffer() != nullptr;
+    }
+
+    static void add_off_cpu_event(Thread& thread, OffCPUReason reason, StringView blocker, Time blocked_time, Time runnable_time)
+    {
+        if (thread.is_profiling_suppressed())
+            return;
+        if (auto* event_buffer = thread.process().current_perf_events_buffer()) {
+            [[maybe_unused]] auto rc = event_buffer->append(PERF_EVENT_OFF_CPU, to_underlying(reason), runnable_time.to_nanoseconds(),
+                blocker, &thread, 0, blocked_time.to_nanoseconds());
+        }
+    }
+
     static void timer_tick(RegisterState const& regs)
     {
         static Time last_wakeup;
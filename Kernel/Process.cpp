@@ -47,6 +47,8 @@ static void create_signal_trampoline();
 extern ProcessID g_init_pid;
 
 RecursiveSpinlock<LockRank::None> g_profiling_lock {};
+// NOTE: This starts at 1, so that 0 can mean "no previous snapshot".
+Atomic<u64> g_process_statistics_generation { 1 };
 static Atomic<pid_t> next_pid;
 static Singleton<SpinlockProtected<Process::List, LockRank::None>> s_all_instances;
 READONLY_AFTER_INIT Memory::Region* g_signal_trampoline_region;
@@ -803,6 +805,7 @@ void Process::finalize()
     unblock_waiters(Thread::WaitBlocker::UnblockFlags::Terminated);
 
     m_space.with([](auto& space) { space->remove_all_regions({}); });
+    release_vfork_parent();
 
     VERIFY(ref_count() > 0);
     // WaitBlockerSet::finalize will be in charge of dropping the last
@@ -1000,6 +1003,7 @@ bool Process::remove_thread(Thread& thread)
     u32 thread_count_before = 0;
     thread_list().with([&](auto& thread_list) {
         thread_list.remove(thread);
+        did_change_statistics();
         with_mutable_protected_data([&](auto& protected_data) {
             thread_count_before = protected_data.thread_count.fetch_sub(1, AK::MemoryOrder::memory_order_acq_rel);
             VERIFY(thread_count_before != 0);
@@ -1013,6 +1017,7 @@ bool Process::add_thread(Thread& thread)
     bool is_first = false;
     thread_list().with([&](auto& thread_list) {
         thread_list.append(thread);
+        did_change_statistics();
         with_mutable_protected_data([&](auto& protected_data) {
             is_first = protected_data.thread_count.fetch_add(1, AK::MemoryOrder::memory_order_relaxed) == 0;
         });
@@ -37,6 +37,7 @@
 #include <Kernel/StdLib.h>
 #include <Kernel/Thread.h>
 #include <Kernel/UnixTypes.h>
+#include <Kernel/WaitQueue.h>
 #include <LibC/elf.h>
 
 namespace Kernel {
@@ -105,6 +106,9 @@ static_assert(sizeof(GlobalFutexKey) == (sizeof(FlatPtr) * 2));
 
 struct LoadResult;
 
+// Bumped for every process statistics snapshot, see /sys/kernel/process_statistics.
+extern Atomic<u64> g_process_statistics_generation;
+
 class Process final
     : public ListedRefCounted<Process, LockType::Spinlock>
     , public LockWeakable<Process> {
@@ -216,6 +220,10 @@ public:
     bool is_kernel_process() const { return m_is_kernel_process; }
     bool is_user_process() const { return !m_is_kernel_process; }
 
+    // The statistics snapshot generation in which something about this process (or its threads) last changed.
+    u64 statistics_generation() const { return m_statistics_generation.load(AK::MemoryOrder::memory_order_relaxed); }
+    void did_change_statistics() { m_statistics_generation.store(g_process_statistics_generation.load(AK::MemoryOrder::memory_order_relaxed), AK::MemoryOrder::memory_order_relaxed); }
+
     static LockRefPtr<Process> from_pid_in_same_jail(ProcessID);
     static LockRefPtr<Process> from_pid_ignoring_jails(ProcessID);
     static SessionID get_sid_from_pgid(ProcessGroupID pgid);
@@ -330,6 +338,7 @@ public:
     ErrorOr<FlatPtr> sys$annotate_mapping(Userspace<void*>, int flags);
     ErrorOr<FlatPtr> sys$lseek(int fd, Userspace<off_t*>, int whence);
     ErrorOr<FlatPtr> sys$ftruncate(int fd, Userspace<off_t const*>);
+    ErrorOr<FlatPtr> sys$posix_fadvise(int fd, Userspace<off_t const*>, Userspace<off_t const*>, int advice);
     ErrorOr<FlatPtr> sys$posix_fallocate(int fd, Userspace<off_t const*>, Userspace<off_t const*>);
     ErrorOr<FlatPtr> sys$kill(pid_t pid_or_pgid, int sig);
     [[noreturn]] void sys$exit(int status);
@@ -344,6 +353,11 @@ public:
     ErrorOr<FlatPtr> sys$msync(Userspace<void*>, size_t, int flags);
     ErrorOr<FlatPtr> sys$purge(int mode);
     ErrorOr<FlatPtr> sys$poll(Userspace<Syscall::SC_poll_params const*>);
+    ErrorOr<FlatPtr> sys$epoll_create(int flags);
+    ErrorOr<FlatPtr> sys$epoll_ctl(int epfd, int op, int fd, Userspace<epoll_event const*>);
+    ErrorOr<FlatPtr> sys$epoll_wait(Userspace<Syscall::SC_epoll_wait_params const*>);
+    ErrorOr<FlatPtr> sys$io_ring_create(Userspace<IORingParams*>);
+    ErrorOr<FlatPtr> sys$io_ring_enter(int fd, u32 to_submit, u32 min_complete);
     ErrorOr<FlatPtr> sys$get_dir_entries(int fd, Userspace<void*>, size_t);
     ErrorOr<FlatPtr> sys$getcwd(Userspace<char*>, size_t);
     ErrorOr<FlatPtr> sys$chdir(Userspace<char const*>, size_t);
@@ -358,6 +372,7 @@ public:
     ErrorOr<FlatPtr> sys$uname(Userspace<utsname*>);
     ErrorOr<FlatPtr> sys$readlink(Userspace<Syscall::SC_readlink_params const*>);
     ErrorOr<FlatPtr> sys$fork(RegisterState&);
+    ErrorOr<FlatPtr> sys$vfork(RegisterState&);
     ErrorOr<FlatPtr> sys$execve(Userspace<Syscall::SC_execve_params const*>);
     ErrorOr<FlatPtr> sys$dup2(int old_fd, int new_fd);
     ErrorOr<FlatPtr> sys$sigaction(int signum, Userspace<sigaction const*> act, Userspace<sigaction*> old_act);
@@ -437,6 +452,8 @@ public:
     ErrorOr<FlatPtr> sys$get_stack_bounds(Userspace<FlatPtr*> stack_base, Userspace<size_t*> stack_size);
     ErrorOr<FlatPtr> sys$ptrace(Userspace<Syscall::SC_ptrace_params const*>);
     ErrorOr<FlatPtr> sys$sendfd(int sockfd, int fd);
+    ErrorOr<FlatPtr> sys$sendfile(int out_fd, int in_fd, Userspace<off_t*>, size_t count);
+    ErrorOr<FlatPtr> sys$splice(Userspace<Syscall::SC_splice_params const*>);
     ErrorOr<FlatPtr> sys$recvfd(int sockfd, int options);
     ErrorOr<FlatPtr> sys$sysconf(int name);
     ErrorOr<FlatPtr> sys$disown(ProcessID);
@@ -603,6 +620,13 @@ private:
     ErrorOr<void> attach_resources(NonnullOwnPtr<Memory::AddressSpace>&&, LockRefPtr<Thread>& first_thread, Process* fork_parent);
     static ProcessID allocate_pid();
 
+    enum class ShareMemoryWithParent {
+        No,
+        Yes,
+    };
+    ErrorOr<NonnullLockRefPtr<Process>> fork_child(RegisterState&, ShareMemoryWithParent);
+    void release_vfork_parent();
+
     void kill_threads_except_self();
     void kill_all_threads();
     ErrorOr<void> dump_core();
@@ -612,6 +636,7 @@ private:
 
     ErrorOr<void> do_exec(NonnullLockRefPtr<OpenFileDescription> main_program_description, NonnullOwnPtrVector<KString> arguments, NonnullOwnPtrVector<KString> environment, LockRefPtr<OpenFileDescription> interpreter_description, Thread*& new_main_thread, InterruptsState& previous_interrupts_state, const ElfW(Ehdr) & main_program_header);
     ErrorOr<FlatPtr> do_write(OpenFileDescription&, UserOrKernelBuffer const&, size_t, Optional<off_t> = {});
+    ErrorOr<FlatPtr> do_transfer(OpenFileDescription& in, Optional<off_t>& in_offset, OpenFileDescription& out, Optional<off_t>& out_offset, size_t count, bool nonblocking);
 
     ErrorOr<FlatPtr> do_statvfs(FileSystem const& path, Custody const*, statvfs* buf);
 
@@ -675,6 +700,12 @@ private:
 
     SpinlockProtected<OwnPtr<Memory::AddressSpace>, LockRank::None> m_space;
 
+    // A vfork() child runs on its parent's memory until it exec()s or dies, and the parent waits on this queue until then.
+    Atomic<bool> m_is_borrowing_parent_memory { false };
+    WaitQueue m_vfork_parent_wait_queue;
+
+    Atomic<u64> m_statistics_generation { g_process_statistics_generation.load(AK::MemoryOrder::memory_order_relaxed) };
+
     LockRefPtr<ProcessGroup> m_pg;
 
     RecursiveSpinlock<LockRank::None> mutable m_protected_data_lock;
@@ -286,6 +286,7 @@ ErrorOr<void> Process::procfs_get_virtual_memory_stats(KBufferBuilder& builder)
             TRY(region_object.add("size"sv, region.size()));
             TRY(region_object.add("amount_resident"sv, region.amount_resident()));
             TRY(region_object.add("amount_dirty"sv, region.amount_dirty()));
+            TRY(region_object.add("amount_large_page_backed"sv, region.amount_large_page_backed()));
             TRY(region_object.add("cow_pages"sv, region.cow_pages()));
             TRY(region_object.add("name"sv, region.name()));
             TRY(region_object.add("vmobject"sv, region.vmobject().class_name()));
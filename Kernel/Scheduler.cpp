@@ -44,9 +44,51 @@ struct ThreadReadyQueues {
     u32 mask {};
     static constexpr size_t count = sizeof(mask) * 8;
     Array<ThreadReadyQueue, count> queues;
+
+    Thread* find_runnable_thread(u32 affinity_mask)
+    {
+        auto priority_mask = mask;
+        while (priority_mask != 0) {
+            auto priority = bit_scan_forward(priority_mask);
+            VERIFY(priority > 0);
+            auto& ready_queue = queues[--priority];
+            for (auto& thread : ready_queue.thread_list) {
+                VERIFY(thread.m_runnable_priority == (int)priority);
+                if (thread.is_active())
+                    continue;
+                if (!(thread.affinity() & affinity_mask))
+                    continue;
+                return &thread;
+            }
+            priority_mask &= ~(1u << priority);
+        }
+        return nullptr;
+    }
+
+    void remove(Thread& thread)
+    {
+        auto priority = thread.m_runnable_priority;
+        VERIFY(priority >= 0);
+        VERIFY(mask & (1u << priority));
+        auto& ready_queue = queues[priority];
+        thread.m_runnable_priority = -1;
+        ready_queue.thread_list.remove(thread);
+        if (ready_queue.thread_list.is_empty())
+            mask &= ~(1u << priority);
+    }
+};
+
+struct ProcessorReadyQueues {
+    SpinlockProtected<ThreadReadyQueues, LockRank::None> ready_queues {};
+
+    // These are kept outside of the lock so that other processors looking for
+    // work to steal can skip empty queues without touching the lock.
+    Atomic<u32, AK::MemoryOrder::memory_order_relaxed> thread_count { 0 };
+    Atomic<u64, AK::MemoryOrder::memory_order_relaxed> steal_count { 0 };
+    Atomic<u64, AK::MemoryOrder::memory_order_relaxed> stolen_count { 0 };
 };
 
-static Singleton<SpinlockProtected<ThreadReadyQueues, LockRank::None>> g_ready_queues;
+static Singleton<Array<ProcessorReadyQueues, MAX_CPU_COUNT>> g_ready_queues;
 
 static SpinlockProtected<TotalTimeScheduled, LockRank::None> g_total_time_scheduled {};
 
@@ -55,7 +97,7 @@ static void dump_thread_list(bool = false);
 static inline u32 thread_priority_to_priority_index(u32 thread_priority)
 {
     // Converts the priority in the range of THREAD_PRIORITY_MIN...THREAD_PRIORITY_MAX
-    // to a index into g_ready_queues where 0 is the highest priority bucket
+    // to a index into ThreadReadyQueues::queues where 0 is the highest priority bucket
     VERIFY(thread_priority >= THREAD_PRIORITY_MIN && thread_priority <= THREAD_PRIORITY_MAX);
     constexpr u32 thread_priority_count = THREAD_PRIORITY_MAX - THREAD_PRIORITY_MIN + 1;
     static_assert(thread_priority_count > 0);
@@ -64,71 +106,94 @@ static inline u32 thread_priority_to_priority_index(u32 thread_priority)
     return priority_bucket;
 }
 
-Thread& Scheduler::pull_next_runnable_thread()
+static inline ProcessorReadyQueues& ready_queues_for_processor(u32 cpu)
 {
-    auto affinity_mask = 1u << Processor::current_id();
+    VERIFY(cpu < MAX_CPU_COUNT);
+    return g_ready_queues->at(cpu);
+}
 
-    return g_ready_queues->with([&](auto& ready_queues) -> Thread& {
-        auto priority_mask = ready_queues.mask;
-        while (priority_mask != 0) {
-            auto priority = bit_scan_forward(priority_mask);
-            VERIFY(priority > 0);
-            auto& ready_queue = ready_queues.queues[--priority];
-            for (auto& thread : ready_queue.thread_list) {
-                VERIFY(thread.m_runnable_priority == (int)priority);
-                if (thread.is_active())
-                    continue;
-                if (!(thread.affinity() & affinity_mask))
-                    continue;
-                thread.m_runnable_priority = -1;
-                ready_queue.thread_list.remove(thread);
-                if (ready_queue.thread_list.is_empty())
-                    ready_queues.mask &= ~(1u << priority);
-                // Mark it as active because we are using this thread. This is similar
-                // to comparing it with Processor::current_thread, but when there are
-                // multiple processors there's no easy way to check whether the thread
-                // is actually still needed. This prevents accidental finalization when
-                // a thread is no longer in Running state, but running on another core.
-
-                // We need to mark it active here so that this thread won't be
-                // scheduled on another core if it were to be queued before actually
-                // switching to it.
-                // FIXME: Figure out a better way maybe?
-                thread.set_active(true);
-                return thread;
-            }
-            priority_mask &= ~(1u << priority);
-        }
-        return *Processor::idle_thread();
+static Thread* take_runnable_thread(ProcessorReadyQueues& processor_queues, u32 affinity_mask)
+{
+    return processor_queues.ready_queues.with([&](auto& ready_queues) -> Thread* {
+        auto* thread = ready_queues.find_runnable_thread(affinity_mask);
+        if (!thread)
+            return nullptr;
+        ready_queues.remove(*thread);
+        processor_queues.thread_count.fetch_sub(1);
+        // Mark it as active because we are using this thread. This is similar
+        // to comparing it with Processor::current_thread, but when there are
+        // multiple processors there's no easy way to check whether the thread
+        // is actually still needed. This prevents accidental finalization when
+        // a thread is no longer in Running state, but running on another core.
+
+        // We need to mark it active here so that this thread won't be
+        // scheduled on another core if it were to be queued before actually
+        // switching to it.
+        // FIXME: Figure out a better way maybe?
+        thread->set_active(true);
+        return thread;
     });
 }
 
+Thread& Scheduler::pull_next_runnable_thread()
+{
+    auto current_id = Processor::current_id();
+    auto affinity_mask = 1u << current_id;
+
+    auto& local_queues = ready_queues_for_processor(current_id);
+    if (auto* thread = take_runnable_thread(local_queues, affinity_mask))
+        return *thread;
+
+    // Our own queue is empty, so try to steal a thread from another processor
+    // before going idle. Start with our neighbor so that thieves spread out
+    // over the victims instead of all piling onto processor 0.
+    auto processor_count = min(Processor::count(), static_cast<u32>(MAX_CPU_COUNT));
+    for (u32 i = 1; i < processor_count; i++) {
+        auto victim_id = (current_id + i) % processor_count;
+        auto& victim_queues = ready_queues_for_processor(victim_id);
+        if (victim_queues.thread_count.load() == 0)
+            continue;
+        auto* thread = take_runnable_thread(victim_queues, affinity_mask);
+        if (!thread)
+            continue;
+        victim_queues.stolen_count.fetch_add(1);
+        local_queues.steal_count.fetch_add(1);
+        dbgln_if(SCHEDULER_DEBUG, "Scheduler[{}]: Stole {} from processor {}", current_id, *thread, victim_id);
+        return *thread;
+    }
+
+    return *Processor::idle_thread();
+}
+
 Thread* Scheduler::peek_next_runnable_thread()
 {
-    auto affinity_mask = 1u << Processor::current_id();
+    auto current_id = Processor::current_id();
+    auto affinity_mask = 1u << current_id;
 
-    return g_ready_queues->with([&](auto& ready_queues) -> Thread* {
-        auto priority_mask = ready_queues.mask;
-        while (priority_mask != 0) {
-            auto priority = bit_scan_forward(priority_mask);
-            VERIFY(priority > 0);
-            auto& ready_queue = ready_queues.queues[--priority];
-            for (auto& thread : ready_queue.thread_list) {
-                VERIFY(thread.m_runnable_priority == (int)priority);
-                if (thread.is_active())
-                    continue;
-                if (!(thread.affinity() & affinity_mask))
-                    continue;
-                return &thread;
-            }
-            priority_mask &= ~(1u << priority);
-        }
+    auto peek = [&](ProcessorReadyQueues& processor_queues) -> Thread* {
+        return processor_queues.ready_queues.with([&](auto& ready_queues) {
+            return ready_queues.find_runnable_thread(affinity_mask);
+        });
+    };
 
-        // Unlike in pull_next_runnable_thread() we don't want to fall back to
-        // the idle thread. We just want to see if we have any other thread ready
-        // to be scheduled.
-        return nullptr;
-    });
+    if (auto* thread = peek(ready_queues_for_processor(current_id)))
+        return thread;
+
+    // Also consider threads we could steal, otherwise a busy processor would
+    // never give up its time slice to balance out a long queue elsewhere.
+    auto processor_count = min(Processor::count(), static_cast<u32>(MAX_CPU_COUNT));
+    for (u32 i = 1; i < processor_count; i++) {
+        auto& victim_queues = ready_queues_for_processor((current_id + i) % processor_count);
+        if (victim_queues.thread_count.load() == 0)
+            continue;
+        if (auto* thread = peek(victim_queues))
+            return thread;
+    }
+
+    // Unlike in pull_next_runnable_thread() we don't want to fall back to
+    // the idle thread. We just want to see if we have any other thread ready
+    // to be scheduled.
+    return nullptr;
 }
 
 bool Scheduler::dequeue_runnable_thread(Thread& thread, bool check_affinity)
@@ -136,24 +201,20 @@ bool Scheduler::dequeue_runnable_thread(Thread& thread, bool check_affinity)
     if (thread.is_idle_thread())
         return true;
 
-    return g_ready_queues->with([&](auto& ready_queues) {
-        auto priority = thread.m_runnable_priority;
-        if (priority < 0) {
-            VERIFY(!thread.m_ready_queue_node.is_in_list());
-            return false;
-        }
+    if (thread.m_runnable_priority < 0) {
+        VERIFY(!thread.m_ready_queue_node.is_in_list());
+        return false;
+    }
 
-        if (check_affinity && !(thread.affinity() & (1 << Processor::current_id())))
-            return false;
+    if (check_affinity && !(thread.affinity() & (1 << Processor::current_id())))
+        return false;
 
-        VERIFY(ready_queues.mask & (1u << priority));
-        auto& ready_queue = ready_queues.queues[priority];
-        thread.m_runnable_priority = -1;
-        ready_queue.thread_list.remove(thread);
-        if (ready_queue.thread_list.is_empty())
-            ready_queues.mask &= ~(1u << priority);
-        return true;
+    auto& processor_queues = ready_queues_for_processor(thread.m_runnable_cpu);
+    processor_queues.ready_queues.with([&](auto& ready_queues) {
+        ready_queues.remove(thread);
+        processor_queues.thread_count.fetch_sub(1);
     });
+    return true;
 }
 
 void Scheduler::enqueue_runnable_thread(Thread& thread)
@@ -162,19 +223,33 @@ void Scheduler::enqueue_runnable_thread(Thread& thread)
     if (thread.is_idle_thread())
         return;
     auto priority = thread_priority_to_priority_index(thread.priority());
+    auto cpu = thread.preferred_cpu();
 
-    g_ready_queues->with([&](auto& ready_queues) {
+    auto& processor_queues = ready_queues_for_processor(cpu);
+    processor_queues.ready_queues.with([&](auto& ready_queues) {
         VERIFY(thread.m_runnable_priority < 0);
         thread.m_runnable_priority = (int)priority;
+        thread.m_runnable_cpu = cpu;
         VERIFY(!thread.m_ready_queue_node.is_in_list());
         auto& ready_queue = ready_queues.queues[priority];
         bool was_empty = ready_queue.thread_list.is_empty();
         ready_queue.thread_list.append(thread);
         if (was_empty)
             ready_queues.mask |= (1u << priority);
+        processor_queues.thread_count.fetch_add(1);
     });
 }
 
+ProcessorReadyQueueStatistics Scheduler::ready_queue_statistics(u32 cpu)
+{
+    auto& processor_queues = ready_queues_for_processor(cpu);
+    return {
+        .ready_threads = processor_queues.thread_count.load(),
+        .steal_count = processor_queues.steal_count.load(),
+        .stolen_count = processor_queues.stolen_count.load(),
+    };
+}
+
 UNMAP_AFTER_INIT void Scheduler::start()
 {
     VERIFY_INTERRUPTS_DISABLED();
@@ -29,6 +29,12 @@ struct TotalTimeScheduled {
     u64 total_kernel { 0 };
 };
 
+struct ProcessorReadyQueueStatistics {
+    u32 ready_threads { 0 };
+    u64 steal_count { 0 };
+    u64 stolen_count { 0 };
+};
+
 class Scheduler {
 public:
     static void initialize();
@@ -55,6 +61,7 @@ public:
     static bool is_initialized();
     static TotalTimeScheduled get_total_time_scheduled();
     static void add_time_scheduled(u64, bool);
+    static ProcessorReadyQueueStatistics ready_queue_statistics(u32 cpu);
 };
 
 }
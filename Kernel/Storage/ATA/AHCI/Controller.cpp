@@ -93,6 +93,19 @@ void AHCIController::start_request(ATADevice const& device, AsyncBlockDeviceRequ
     port->start_request(request);
 }
 
+size_t AHCIController::max_transfer_size() const
+{
+    return AHCIPort::max_transfer_size;
+}
+
+size_t AHCIController::max_requests_in_flight(ATADevice const& device) const
+{
+    auto port = m_ports[device.ata_address().port];
+    if (!port)
+        return 1;
+    return port->command_queue_depth();
+}
+
 void AHCIController::complete_current_request(AsyncDeviceRequest::RequestResult)
 {
     VERIFY_NOT_REACHED();
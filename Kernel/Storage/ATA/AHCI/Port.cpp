@@ -38,14 +38,8 @@ ErrorOr<void> AHCIPort::allocate_resources_and_initialize_ports()
 
     m_fis_receive_page = TRY(MM.allocate_physical_page());
 
-    for (size_t index = 0; index < 1; index++) {
-        auto dma_page = TRY(MM.allocate_physical_page());
-        m_dma_buffers.append(move(dma_page));
-    }
-    for (size_t index = 0; index < 1; index++) {
-        auto command_table_page = TRY(MM.allocate_physical_page());
-        m_command_table_pages.append(move(command_table_page));
-    }
+    // Note: The first command slot is always needed, for identifying the device.
+    TRY(allocate_command_slot_resources(m_command_slots[0]));
 
     m_command_list_region = TRY(MM.allocate_dma_buffer_page("AHCI Port Command List"sv, Memory::Region::Access::ReadWrite, m_command_list_page));
 
@@ -55,6 +49,20 @@ ErrorOr<void> AHCIPort::allocate_resources_and_initialize_ports()
     return {};
 }
 
+ErrorOr<void> AHCIPort::allocate_command_slot_resources(CommandSlot& slot)
+{
+    if (slot.command_table_page)
+        return {};
+    auto command_table_page = TRY(MM.allocate_physical_page());
+    NonnullRefPtrVector<Memory::PhysicalPage> dma_buffers;
+    TRY(dma_buffers.try_ensure_capacity(dma_buffer_pages_count));
+    for (size_t index = 0; index < dma_buffer_pages_count; index++)
+        dma_buffers.unchecked_append(TRY(MM.allocate_physical_page()));
+    slot.command_table_page = move(command_table_page);
+    slot.dma_buffers = move(dma_buffers);
+    return {};
+}
+
 UNMAP_AFTER_INIT AHCIPort::AHCIPort(AHCIController const& controller, NonnullRefPtr<Memory::PhysicalPage> identify_buffer_page, AHCI::HBADefinedCapabilities hba_capabilities, volatile AHCI::PortRegisters& registers, u32 port_index)
     : m_port_index(port_index)
     , m_hba_capabilities(hba_capabilities)
@@ -86,20 +94,14 @@ void AHCIPort::handle_interrupt()
             auto work_item_creation_result = g_io_work->try_queue([this]() {
                 m_connected_device.clear();
             });
-            if (work_item_creation_result.is_error()) {
-                auto current_request = m_current_request;
-                m_current_request.clear();
-                current_request->complete(AsyncDeviceRequest::OutOfMemory);
-            }
+            if (work_item_creation_result.is_error())
+                fail_all_requests(AsyncDeviceRequest::OutOfMemory);
         } else {
             auto work_item_creation_result = g_io_work->try_queue([this]() {
                 reset();
             });
-            if (work_item_creation_result.is_error()) {
-                auto current_request = m_current_request;
-                m_current_request.clear();
-                current_request->complete(AsyncDeviceRequest::OutOfMemory);
-            }
+            if (work_item_creation_result.is_error())
+                fail_all_requests(AsyncDeviceRequest::OutOfMemory);
         }
         return;
     }
@@ -112,66 +114,134 @@ void AHCIPort::handle_interrupt()
         auto work_item_creation_result = g_io_work->try_queue([this]() {
             reset();
         });
-        if (work_item_creation_result.is_error()) {
-            auto current_request = m_current_request;
-            m_current_request.clear();
-            current_request->complete(AsyncDeviceRequest::OutOfMemory);
-        }
+        if (work_item_creation_result.is_error())
+            fail_all_requests(AsyncDeviceRequest::OutOfMemory);
         return;
     }
     if (m_interrupt_status.is_set(AHCI::PortInterruptFlag::IF) || m_interrupt_status.is_set(AHCI::PortInterruptFlag::TFE) || m_interrupt_status.is_set(AHCI::PortInterruptFlag::HBD) || m_interrupt_status.is_set(AHCI::PortInterruptFlag::HBF)) {
         auto work_item_creation_result = g_io_work->try_queue([this]() {
             recover_from_fatal_error();
         });
-        if (work_item_creation_result.is_error()) {
-            auto current_request = m_current_request;
-            m_current_request.clear();
-            current_request->complete(AsyncDeviceRequest::OutOfMemory);
-        }
+        if (work_item_creation_result.is_error())
+            fail_all_requests(AsyncDeviceRequest::OutOfMemory);
         return;
     }
-    if (m_interrupt_status.is_set(AHCI::PortInterruptFlag::DHR) || m_interrupt_status.is_set(AHCI::PortInterruptFlag::PS)) {
-        m_wait_for_completion = false;
+    if (m_interrupt_status.is_set(AHCI::PortInterruptFlag::DHR) || m_interrupt_status.is_set(AHCI::PortInterruptFlag::PS) || m_interrupt_status.is_set(AHCI::PortInterruptFlag::SDB)) {
+        // Note: Clear the interrupt status before looking at which commands are done, so that
+        // a command completing in the meantime raises another interrupt instead of being missed.
+        m_interrupt_status.clear();
+
+        u32 completed_slots = 0;
+        u32 requests_generation = 0;
+        {
+            SpinlockLocker lock(m_hard_lock);
+            // A queued command is done once the device cleared its bit in PxSACT with a Set Device Bits FIS,
+            // any other command once the HBA cleared its bit in PxCI.
+            completed_slots = m_issued_slots & ~(m_port_registers.ci | m_port_registers.sact);
+            m_issued_slots &= ~completed_slots;
+            requests_generation = m_requests_generation;
+        }
 
-        // Now schedule reading/writing the buffer as soon as we leave the irq handler.
+        // Now schedule reading/writing the buffers as soon as we leave the irq handler.
         // This is important so that we can safely access the buffers, which could
         // trigger page faults
-        if (!m_current_request) {
-            dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request handled, probably identify request", representative_port_index());
+        if (completed_slots == 0) {
+            dbgln_if(AHCI_DEBUG, "AHCI Port {}: No request completed, probably identify request", representative_port_index());
         } else {
-            auto work_item_creation_result = g_io_work->try_queue([this]() {
-                dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request handled", representative_port_index());
-                MutexLocker locker(m_lock);
-                VERIFY(m_current_request);
-                VERIFY(m_current_scatter_list);
-                if (!m_connected_device) {
-                    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request success", representative_port_index());
-                    complete_current_request(AsyncDeviceRequest::Failure);
-                    return;
-                }
-                if (m_current_request->request_type() == AsyncBlockDeviceRequest::Read) {
-                    if (auto result = m_current_request->write_to_buffer(m_current_request->buffer(), m_current_scatter_list->dma_region().as_ptr(), m_connected_device->block_size() * m_current_request->block_count()); result.is_error()) {
-                        dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure, memory fault occurred when reading in data.", representative_port_index());
-                        m_current_scatter_list = nullptr;
-                        complete_current_request(AsyncDeviceRequest::MemoryFault);
-                        return;
-                    }
-                }
-                m_current_scatter_list = nullptr;
-                dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request success", representative_port_index());
-                complete_current_request(AsyncDeviceRequest::Success);
+            auto work_item_creation_result = g_io_work->try_queue([this, completed_slots, requests_generation]() {
+                finish_completed_requests(completed_slots, requests_generation);
             });
-            if (work_item_creation_result.is_error()) {
-                auto current_request = m_current_request;
-                m_current_request.clear();
-                current_request->complete(AsyncDeviceRequest::OutOfMemory);
-            }
+            if (work_item_creation_result.is_error())
+                complete_requests_in_slots(completed_slots, AsyncDeviceRequest::Failure);
         }
+        return;
     }
 
     m_interrupt_status.clear();
 }
 
+void AHCIPort::finish_completed_requests(u32 completed_slots, u32 requests_generation)
+{
+    MutexLocker locker(m_lock);
+    for (u8 slot = 0; slot < max_command_slots_count; slot++) {
+        if (!(completed_slots & (1u << slot)))
+            continue;
+        {
+            // Note: A reset might have failed the request before we got here, and the slot might even
+            //       have been given to a new request since, which the device hasn't completed yet.
+            SpinlockLocker lock(m_hard_lock);
+            if (m_requests_generation != requests_generation || !(m_busy_slots & (1u << slot)))
+                continue;
+        }
+        auto& command_slot = m_command_slots[slot];
+        VERIFY(command_slot.request);
+        VERIFY(command_slot.scatter_list);
+        dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request in slot {} handled", representative_port_index(), slot);
+        if (!m_connected_device) {
+            dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure, device was removed", representative_port_index());
+            complete_request_in_slot(slot, AsyncDeviceRequest::Failure);
+            continue;
+        }
+        auto& request = *command_slot.request;
+        auto result = AsyncDeviceRequest::Success;
+        if (request.request_type() == AsyncBlockDeviceRequest::Read) {
+            if (auto read_result = request.write_to_buffer(request.buffer(), command_slot.scatter_list->dma_region().as_ptr(), m_connected_device->block_size() * request.block_count()); read_result.is_error()) {
+                dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure, memory fault occurred when reading in data.", representative_port_index());
+                result = AsyncDeviceRequest::MemoryFault;
+            }
+        }
+        command_slot.scatter_list = nullptr;
+        dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request in slot {} done", representative_port_index(), slot);
+        complete_request_in_slot(slot, result);
+    }
+}
+
+void AHCIPort::complete_request_in_slot(u8 slot, AsyncDeviceRequest::RequestResult result)
+{
+    LockRefPtr<AsyncBlockDeviceRequest> request;
+    {
+        SpinlockLocker lock(m_hard_lock);
+        VERIFY(m_busy_slots & (1u << slot));
+        request = move(m_command_slots[slot].request);
+        m_busy_slots &= ~(1u << slot);
+        m_issued_slots &= ~(1u << slot);
+    }
+    VERIFY(request);
+    // Note: The slot has to be free before completing the request, as this might start the next one.
+    request->complete(result);
+}
+
+void AHCIPort::complete_requests_in_slots(u32 slots, AsyncDeviceRequest::RequestResult result)
+{
+    for (u8 slot = 0; slot < max_command_slots_count; slot++) {
+        if (slots & (1u << slot))
+            complete_request_in_slot(slot, result);
+    }
+}
+
+AHCIPort::RequestsInFlight AHCIPort::take_all_requests()
+{
+    RequestsInFlight requests;
+    SpinlockLocker lock(m_hard_lock);
+    for (u8 slot = 0; slot < max_command_slots_count; slot++) {
+        if (m_busy_slots & (1u << slot))
+            requests[slot] = move(m_command_slots[slot].request);
+    }
+    m_busy_slots = 0;
+    m_issued_slots = 0;
+    m_requests_generation++;
+    return requests;
+}
+
+void AHCIPort::fail_all_requests(AsyncDeviceRequest::RequestResult result)
+{
+    auto requests = take_all_requests();
+    for (auto& request : requests) {
+        if (request)
+            request->complete(result);
+    }
+}
+
 bool AHCIPort::is_interrupts_enabled() const
 {
     return !m_interrupt_enable.is_cleared();
@@ -180,18 +250,21 @@ bool AHCIPort::is_interrupts_enabled() const
 void AHCIPort::recover_from_fatal_error()
 {
     MutexLocker locker(m_lock);
-    SpinlockLocker lock(m_hard_lock);
-    LockRefPtr<AHCIController> controller = m_parent_controller.strong_ref();
-    if (!controller) {
-        dmesgln("AHCI Port {}: fatal error, controller not available", representative_port_index());
-        return;
+    {
+        SpinlockLocker lock(m_hard_lock);
+        LockRefPtr<AHCIController> controller = m_parent_controller.strong_ref();
+        if (!controller) {
+            dmesgln("AHCI Port {}: fatal error, controller not available", representative_port_index());
+        } else {
+            dmesgln("{}: AHCI Port {} fatal error, shutting down!", controller->device_identifier().address(), representative_port_index());
+            dmesgln("{}: AHCI Port {} fatal error, SError {}", controller->device_identifier().address(), representative_port_index(), (u32)m_port_registers.serr);
+        }
+        stop_command_list_processing();
+        stop_fis_receiving();
+        m_interrupt_enable.clear();
     }
-
-    dmesgln("{}: AHCI Port {} fatal error, shutting down!", controller->device_identifier().address(), representative_port_index());
-    dmesgln("{}: AHCI Port {} fatal error, SError {}", controller->device_identifier().address(), representative_port_index(), (u32)m_port_registers.serr);
-    stop_command_list_processing();
-    stop_fis_receiving();
-    m_interrupt_enable.clear();
+    // Note: With NCQ, an error aborts every outstanding command, not just the one that failed.
+    fail_all_requests(AsyncDeviceRequest::Failure);
 }
 
 void AHCIPort::eject()
@@ -210,7 +283,7 @@ void AHCIPort::eject()
     auto unused_command_header = try_to_find_unused_command_header();
     VERIFY(unused_command_header.has_value());
     auto* command_list_entries = (volatile AHCI::CommandHeader*)m_command_list_region->vaddr().as_ptr();
-    command_list_entries[unused_command_header.value()].ctba = m_command_table_pages[unused_command_header.value()].paddr().get();
+    command_list_entries[unused_command_header.value()].ctba = m_command_slots[unused_command_header.value()].command_table_page->paddr().get();
     command_list_entries[unused_command_header.value()].ctbau = 0;
     command_list_entries[unused_command_header.value()].prdbc = 0;
     command_list_entries[unused_command_header.value()].prdtl = 0;
@@ -221,7 +294,7 @@ void AHCIPort::eject()
     // handshake error bit in PxSERR register if CFL is incorrect.
     command_list_entries[unused_command_header.value()].attributes = (size_t)FIS::DwordCount::RegisterHostToDevice | AHCI::CommandHeaderAttributes::P | AHCI::CommandHeaderAttributes::C | AHCI::CommandHeaderAttributes::A;
 
-    auto command_table_region = MM.allocate_kernel_region(m_command_table_pages[unused_command_header.value()].paddr().page_base(), Memory::page_round_up(sizeof(AHCI::CommandTable)).value(), "AHCI Command Table"sv, Memory::Region::Access::ReadWrite, Memory::Region::Cacheable::No).release_value();
+    auto command_table_region = MM.allocate_kernel_region(m_command_slots[unused_command_header.value()].command_table_page->paddr().page_base(), Memory::page_round_up(sizeof(AHCI::CommandTable)).value(), "AHCI Command Table"sv, Memory::Region::Access::ReadWrite, Memory::Region::Cacheable::No).release_value();
     auto& command_table = *(volatile AHCI::CommandTable*)command_table_region->vaddr().as_ptr();
     memset(const_cast<u8*>(command_table.command_fis), 0, 64);
     auto& fis = *(volatile FIS::HostToDevice::Register*)command_table.command_fis;
@@ -270,6 +343,20 @@ void AHCIPort::eject()
 bool AHCIPort::reset()
 {
     MutexLocker locker(m_lock);
+    // The commands that were issued before the reset are lost, so their requests are failed
+    // once the port is usable again, in case completing them starts new requests.
+    auto aborted_requests = take_all_requests();
+    bool success = reset_and_initialize();
+    for (auto& request : aborted_requests) {
+        if (request)
+            request->complete(AsyncDeviceRequest::Failure);
+    }
+    return success;
+}
+
+bool AHCIPort::reset_and_initialize()
+{
+    VERIFY(m_lock.is_locked());
     SpinlockLocker lock(m_hard_lock);
 
     dbgln_if(AHCI_DEBUG, "AHCI Port {}: Resetting", representative_port_index());
@@ -351,6 +438,7 @@ bool AHCIPort::initialize()
         if (is_atapi_attached()) {
             m_port_registers.cmd = m_port_registers.cmd | (1 << 24);
         }
+        configure_command_queuing(*identify_block);
 
         dmesgln("AHCI Port {}: Device found, Capacity={}, Bytes per logical sector={}, Bytes per physical sector={}", representative_port_index(), max_addressable_sector * logical_sector_size, logical_sector_size, physical_sector_size);
 
@@ -369,6 +457,27 @@ bool AHCIPort::initialize()
     return true;
 }
 
+void AHCIPort::configure_command_queuing(ATAIdentifyBlock const& identify_block)
+{
+    VERIFY(m_lock.is_locked());
+    m_native_command_queuing_enabled = false;
+    m_command_queue_depth = 1;
+
+    if (is_atapi_attached() || !m_hba_capabilities.native_command_queuing_supported)
+        return;
+    // Word 76, bit 8: The device supports the Native Command Queuing feature set.
+    if (!(identify_block.serial_ata_capabilities & (1 << 8)))
+        return;
+    // Word 75, bits 0 to 4: The maximum queue depth supported by the device, minus one.
+    size_t queue_depth = min<size_t>((identify_block.queue_depth & 0x1f) + 1, m_hba_capabilities.max_command_list_entries_count);
+    if (queue_depth < 2)
+        return;
+
+    m_native_command_queuing_enabled = true;
+    m_command_queue_depth = queue_depth;
+    dmesgln("AHCI Port {}: Native Command Queuing enabled, queue depth {}", representative_port_index(), m_command_queue_depth);
+}
+
 char const* AHCIPort::try_disambiguate_sata_status()
 {
     switch (m_port_registers.ssts & 0xf) {
@@ -488,65 +597,73 @@ size_t AHCIPort::calculate_descriptors_count(size_t block_count) const
 {
     VERIFY(m_connected_device);
     size_t needed_dma_regions_count = Memory::page_round_up((block_count * m_connected_device->block_size())).value() / PAGE_SIZE;
-    VERIFY(needed_dma_regions_count <= m_dma_buffers.size());
+    VERIFY(needed_dma_regions_count <= dma_buffer_pages_count);
     return needed_dma_regions_count;
 }
 
-Optional<AsyncDeviceRequest::RequestResult> AHCIPort::prepare_and_set_scatter_list(AsyncBlockDeviceRequest& request)
+Optional<AsyncDeviceRequest::RequestResult> AHCIPort::prepare_and_set_scatter_list(u8 slot, AsyncBlockDeviceRequest& request)
 {
     VERIFY(m_lock.is_locked());
     VERIFY(request.block_count() > 0);
 
+    auto& command_slot = m_command_slots[slot];
+    if (auto result = allocate_command_slot_resources(command_slot); result.is_error())
+        return AsyncDeviceRequest::Failure;
+
     NonnullRefPtrVector<Memory::PhysicalPage> allocated_dma_regions;
     for (size_t index = 0; index < calculate_descriptors_count(request.block_count()); index++) {
-        allocated_dma_regions.append(m_dma_buffers.at(index));
+        allocated_dma_regions.append(command_slot.dma_buffers.at(index));
     }
 
-    m_current_scatter_list = Memory::ScatterGatherList::try_create(request, allocated_dma_regions.span(), m_connected_device->block_size());
-    if (!m_current_scatter_list)
+    command_slot.scatter_list = Memory::ScatterGatherList::try_create(request, allocated_dma_regions.span(), m_connected_device->block_size());
+    if (!command_slot.scatter_list)
         return AsyncDeviceRequest::Failure;
     if (request.request_type() == AsyncBlockDeviceRequest::Write) {
-        if (auto result = request.read_from_buffer(request.buffer(), m_current_scatter_list->dma_region().as_ptr(), m_connected_device->block_size() * request.block_count()); result.is_error()) {
+        if (auto result = request.read_from_buffer(request.buffer(), command_slot.scatter_list->dma_region().as_ptr(), m_connected_device->block_size() * request.block_count()); result.is_error()) {
             return AsyncDeviceRequest::MemoryFault;
         }
     }
     return {};
 }
 
+Optional<u8> AHCIPort::try_to_allocate_command_slot(AsyncBlockDeviceRequest& request)
+{
+    VERIFY(m_lock.is_locked());
+    SpinlockLocker lock(m_hard_lock);
+    auto slot = try_to_find_unused_command_header();
+    if (!slot.has_value())
+        return {};
+    m_busy_slots |= 1u << slot.value();
+    m_command_slots[slot.value()].request = request;
+    return slot;
+}
+
 void AHCIPort::start_request(AsyncBlockDeviceRequest& request)
 {
     MutexLocker locker(m_lock);
     dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request start", representative_port_index());
-    VERIFY(!m_current_request);
-    VERIFY(!m_current_scatter_list);
 
-    m_current_request = request;
+    // Note: The block layer never has more requests in flight than our command queue depth.
+    auto slot = try_to_allocate_command_slot(request);
+    VERIFY(slot.has_value());
 
-    auto result = prepare_and_set_scatter_list(request);
+    auto result = prepare_and_set_scatter_list(slot.value(), request);
     if (result.has_value()) {
         dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure.", representative_port_index());
         locker.unlock();
-        complete_current_request(result.value());
+        complete_request_in_slot(slot.value(), result.value());
         return;
     }
 
-    auto success = access_device(request.request_type(), request.block_index(), request.block_count());
+    auto success = access_device(slot.value(), request.request_type(), request.block_index(), request.block_count());
     if (!success) {
         dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure.", representative_port_index());
         locker.unlock();
-        complete_current_request(AsyncDeviceRequest::Failure);
+        complete_request_in_slot(slot.value(), AsyncDeviceRequest::Failure);
         return;
     }
 }
 
-void AHCIPort::complete_current_request(AsyncDeviceRequest::RequestResult result)
-{
-    VERIFY(m_current_request);
-    auto current_request = m_current_request;
-    m_current_request.clear();
-    current_request->complete(result);
-}
-
 bool AHCIPort::spin_until_ready() const
 {
     VERIFY(m_lock.is_locked());
@@ -563,35 +680,34 @@ bool AHCIPort::spin_until_ready() const
     return true;
 }
 
-bool AHCIPort::access_device(AsyncBlockDeviceRequest::RequestType direction, u64 lba, u8 block_count)
+bool AHCIPort::access_device(u8 slot, AsyncBlockDeviceRequest::RequestType direction, u64 lba, u8 block_count)
 {
     VERIFY(m_connected_device);
     VERIFY(is_operable());
     VERIFY(m_lock.is_locked());
-    VERIFY(m_current_scatter_list);
+    auto& command_slot = m_command_slots[slot];
+    VERIFY(command_slot.scatter_list);
     SpinlockLocker lock(m_hard_lock);
 
-    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Do a {}, lba {}, block count {}", representative_port_index(), direction == AsyncBlockDeviceRequest::RequestType::Write ? "write" : "read", lba, block_count);
+    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Do a {}, lba {}, block count {}, slot {}", representative_port_index(), direction == AsyncBlockDeviceRequest::RequestType::Write ? "write" : "read", lba, block_count, slot);
     if (!spin_until_ready())
         return false;
 
-    auto unused_command_header = try_to_find_unused_command_header();
-    VERIFY(unused_command_header.has_value());
     auto* command_list_entries = (volatile AHCI::CommandHeader*)m_command_list_region->vaddr().as_ptr();
-    command_list_entries[unused_command_header.value()].ctba = m_command_table_pages[unused_command_header.value()].paddr().get();
-    command_list_entries[unused_command_header.value()].ctbau = 0;
-    command_list_entries[unused_command_header.value()].prdbc = 0;
-    command_list_entries[unused_command_header.value()].prdtl = m_current_scatter_list->scatters_count();
+    command_list_entries[slot].ctba = command_slot.command_table_page->paddr().get();
+    command_list_entries[slot].ctbau = 0;
+    command_list_entries[slot].prdbc = 0;
+    command_list_entries[slot].prdtl = command_slot.scatter_list->scatters_count();
 
     // Note: we must set the correct Dword count in this register. Real hardware
     // AHCI controllers do care about this field! QEMU doesn't care if we don't
     // set the correct CFL field in this register, real hardware will set an
     // handshake error bit in PxSERR register if CFL is incorrect.
-    command_list_entries[unused_command_header.value()].attributes = (size_t)FIS::DwordCount::RegisterHostToDevice | AHCI::CommandHeaderAttributes::P | (is_atapi_attached() ? AHCI::CommandHeaderAttributes::A : 0) | (direction == AsyncBlockDeviceRequest::RequestType::Write ? AHCI::CommandHeaderAttributes::W : 0);
+    command_list_entries[slot].attributes = (size_t)FIS::DwordCount::RegisterHostToDevice | AHCI::CommandHeaderAttributes::P | (is_atapi_attached() ? AHCI::CommandHeaderAttributes::A : 0) | (direction == AsyncBlockDeviceRequest::RequestType::Write ? AHCI::CommandHeaderAttributes::W : 0);
 
-    dbgln_if(AHCI_DEBUG, "AHCI Port {}: CLE: ctba={:#08x}, ctbau={:#08x}, prdbc={:#08x}, prdtl={:#04x}, attributes={:#04x}", representative_port_index(), (u32)command_list_entries[unused_command_header.value()].ctba, (u32)command_list_entries[unused_command_header.value()].ctbau, (u32)command_list_entries[unused_command_header.value()].prdbc, (u16)command_list_entries[unused_command_header.value()].prdtl, (u16)command_list_entries[unused_command_header.value()].attributes);
+    dbgln_if(AHCI_DEBUG, "AHCI Port {}: CLE: ctba={:#08x}, ctbau={:#08x}, prdbc={:#08x}, prdtl={:#04x}, attributes={:#04x}", representative_port_index(), (u32)command_list_entries[slot].ctba, (u32)command_list_entries[slot].ctbau, (u32)command_list_entries[slot].prdbc, (u16)command_list_entries[slot].prdtl, (u16)command_list_entries[slot].attributes);
 
-    auto command_table_region = MM.allocate_kernel_region(m_command_table_pages[unused_command_header.value()].paddr().page_base(), Memory::page_round_up(sizeof(AHCI::CommandTable)).value(), "AHCI Command Table"sv, Memory::Region::Access::ReadWrite, Memory::Region::Cacheable::No).release_value();
+    auto command_table_region = MM.allocate_kernel_region(command_slot.command_table_page->paddr().page_base(), Memory::page_round_up(sizeof(AHCI::CommandTable)).value(), "AHCI Command Table"sv, Memory::Region::Access::ReadWrite, Memory::Region::Cacheable::No).release_value();
     auto& command_table = *(volatile AHCI::CommandTable*)command_table_region->vaddr().as_ptr();
 
     dbgln_if(AHCI_DEBUG, "AHCI Port {}: Allocated command table at {}", representative_port_index(), command_table_region->vaddr());
@@ -600,7 +716,7 @@ bool AHCIPort::access_device(AsyncBlockDeviceRequest::RequestType direction, u64
 
     size_t scatter_entry_index = 0;
     size_t data_transfer_count = (block_count * m_connected_device->block_size());
-    for (auto scatter_page : m_current_scatter_list->vmobject().physical_pages()) {
+    for (auto scatter_page : command_slot.scatter_list->vmobject().physical_pages()) {
         VERIFY(data_transfer_count != 0);
         VERIFY(scatter_page);
         dbgln_if(AHCI_DEBUG, "AHCI Port {}: Add a transfer scatter entry @ {}", representative_port_index(), scatter_page->paddr());
@@ -624,6 +740,11 @@ bool AHCIPort::access_device(AsyncBlockDeviceRequest::RequestType direction, u64
     if (is_atapi_attached()) {
         fis.command = ATA_CMD_PACKET;
         TODO();
+    } else if (m_native_command_queuing_enabled) {
+        if (direction == AsyncBlockDeviceRequest::RequestType::Write)
+            fis.command = ATA_CMD_WRITE_FPDMA_QUEUED;
+        else
+            fis.command = ATA_CMD_READ_FPDMA_QUEUED;
     } else {
         if (direction == AsyncBlockDeviceRequest::RequestType::Write)
             fis.command = ATA_CMD_WRITE_DMA_EXT;
@@ -642,17 +763,28 @@ bool AHCIPort::access_device(AsyncBlockDeviceRequest::RequestType direction, u64
     fis.lba_low[0] = lba & 0xff;
     fis.lba_low[1] = (lba >> 8) & 0xff;
     fis.lba_low[2] = (lba >> 16) & 0xff;
-    fis.count = (block_count);
+    if (m_native_command_queuing_enabled) {
+        // Queued commands take the block count in the features registers, and the tag
+        // (which has to be the command slot) in bits 3 to 7 of the count register.
+        fis.features_low = block_count;
+        fis.features_high = 0;
+        fis.count = (slot << 3);
+    } else {
+        fis.count = (block_count);
+    }
 
     // The below loop waits until the port is no longer busy before issuing a new command
     if (!spin_until_ready())
         return false;
 
     full_memory_barrier();
-    mark_command_header_ready_to_process(unused_command_header.value());
+    // Note: The device has to know about a queued command before the HBA sends it.
+    if (m_native_command_queuing_enabled)
+        m_port_registers.sact = 1u << slot;
+    mark_command_header_ready_to_process(slot);
     full_memory_barrier();
 
-    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Do a {}, lba {}, block count {} @ {}, ended", representative_port_index(), direction == AsyncBlockDeviceRequest::RequestType::Write ? "write" : "read", lba, block_count, m_dma_buffers[0].paddr());
+    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Do a {}, lba {}, block count {} @ {}, ended", representative_port_index(), direction == AsyncBlockDeviceRequest::RequestType::Write ? "write" : "read", lba, block_count, command_slot.dma_buffers[0].paddr());
     return true;
 }
 
@@ -670,7 +802,7 @@ bool AHCIPort::identify_device()
     auto unused_command_header = try_to_find_unused_command_header();
     VERIFY(unused_command_header.has_value());
     auto* command_list_entries = (volatile AHCI::CommandHeader*)m_command_list_region->vaddr().as_ptr();
-    command_list_entries[unused_command_header.value()].ctba = m_command_table_pages[unused_command_header.value()].paddr().get();
+    command_list_entries[unused_command_header.value()].ctba = m_command_slots[unused_command_header.value()].command_table_page->paddr().get();
     command_list_entries[unused_command_header.value()].ctbau = 0;
     command_list_entries[unused_command_header.value()].prdbc = 512;
     command_list_entries[unused_command_header.value()].prdtl = 1;
@@ -679,7 +811,7 @@ bool AHCIPort::identify_device()
     // QEMU doesn't care if we don't set the correct CFL field in this register, real hardware will set an handshake error bit in PxSERR register.
     command_list_entries[unused_command_header.value()].attributes = (size_t)FIS::DwordCount::RegisterHostToDevice | AHCI::CommandHeaderAttributes::P;
 
-    auto command_table_region = MM.allocate_kernel_region(m_command_table_pages[unused_command_header.value()].paddr().page_base(), Memory::page_round_up(sizeof(AHCI::CommandTable)).value(), "AHCI Command Table"sv, Memory::Region::Access::ReadWrite).release_value();
+    auto command_table_region = MM.allocate_kernel_region(m_command_slots[unused_command_header.value()].command_table_page->paddr().page_base(), Memory::page_round_up(sizeof(AHCI::CommandTable)).value(), "AHCI Command Table"sv, Memory::Region::Access::ReadWrite).release_value();
     auto& command_table = *(volatile AHCI::CommandTable*)command_table_region->vaddr().as_ptr();
     memset(const_cast<u8*>(command_table.command_fis), 0, 64);
     command_table.descriptors[0].base_high = 0;
@@ -757,8 +889,11 @@ bool AHCIPort::shutdown()
 Optional<u8> AHCIPort::try_to_find_unused_command_header()
 {
     VERIFY(m_lock.is_locked());
-    u32 commands_issued = m_port_registers.ci;
-    for (size_t index = 0; index < 32; index++) {
+    VERIFY(m_hard_lock.is_locked());
+    // Note: We always pick the lowest free slot, so we only allocate resources for more slots
+    // when there are actually that many requests in flight.
+    u32 commands_issued = m_port_registers.ci | m_busy_slots;
+    for (size_t index = 0; index < m_command_queue_depth; index++) {
         if (!(commands_issued & 1)) {
             dbgln_if(AHCI_DEBUG, "AHCI Port {}: unused command header at index {}", representative_port_index(), index);
             return index;
@@ -777,13 +912,13 @@ void AHCIPort::start_command_list_processing() const
     m_port_registers.cmd = m_port_registers.cmd | 1;
 }
 
-void AHCIPort::mark_command_header_ready_to_process(u8 command_header_index) const
+void AHCIPort::mark_command_header_ready_to_process(u8 command_header_index)
 {
     VERIFY(m_lock.is_locked());
     VERIFY(m_hard_lock.is_locked());
     VERIFY(is_operable());
-    VERIFY(!m_wait_for_completion);
-    m_wait_for_completion = true;
+    VERIFY(!(m_issued_slots & (1u << command_header_index)));
+    m_issued_slots |= 1u << command_header_index;
     dbgln_if(AHCI_DEBUG, "AHCI Port {}: Marking command header at index {} as ready to process.", representative_port_index(), command_header_index);
     m_port_registers.ci = 1 << command_header_index;
 }
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <AK/Array.h>
 #include <AK/NonnullRefPtrVector.h>
 #include <AK/OwnPtr.h>
 #include <AK/RefPtr.h>
@@ -38,6 +39,12 @@ class AHCIPort
     friend class AHCIController;
 
 public:
+    // Each port owns enough DMA pages to transfer this much data in a single command,
+    // with one physical region descriptor per page.
+    static constexpr size_t dma_buffer_pages_count = 16;
+    static constexpr size_t max_transfer_size = dma_buffer_pages_count * PAGE_SIZE;
+    static constexpr size_t max_command_slots_count = 32;
+
     static ErrorOr<NonnullLockRefPtr<AHCIPort>> create(AHCIController const&, AHCI::HBADefinedCapabilities, volatile AHCI::PortRegisters&, u32 port_index);
 
     u32 port_index() const { return m_port_index; }
@@ -47,6 +54,10 @@ public:
 
     LockRefPtr<StorageDevice> connected_device() const { return m_connected_device; }
 
+    // How many commands we keep outstanding on this port. This is more than one only
+    // if both the HBA and the device support Native Command Queuing.
+    size_t command_queue_depth() const { return m_command_queue_depth; }
+
     bool reset();
     bool initialize_without_reset();
     void handle_interrupt();
@@ -73,11 +84,29 @@ private:
     ALWAYS_INLINE void spin_up() const;
     ALWAYS_INLINE void power_on() const;
 
+    struct CommandSlot {
+        LockRefPtr<AsyncBlockDeviceRequest> request;
+        LockRefPtr<Memory::ScatterGatherList> scatter_list;
+        RefPtr<Memory::PhysicalPage> command_table_page;
+        NonnullRefPtrVector<Memory::PhysicalPage> dma_buffers;
+    };
+
+    using RequestsInFlight = Array<LockRefPtr<AsyncBlockDeviceRequest>, max_command_slots_count>;
+
+    bool reset_and_initialize();
+    void configure_command_queuing(ATAIdentifyBlock const&);
+    ErrorOr<void> allocate_command_slot_resources(CommandSlot&);
+
     void start_request(AsyncBlockDeviceRequest&);
-    void complete_current_request(AsyncDeviceRequest::RequestResult);
-    bool access_device(AsyncBlockDeviceRequest::RequestType, u64 lba, u8 block_count);
+    Optional<u8> try_to_allocate_command_slot(AsyncBlockDeviceRequest&);
+    void finish_completed_requests(u32 completed_slots, u32 requests_generation);
+    void complete_request_in_slot(u8 slot, AsyncDeviceRequest::RequestResult);
+    void complete_requests_in_slots(u32 slots, AsyncDeviceRequest::RequestResult);
+    RequestsInFlight take_all_requests();
+    void fail_all_requests(AsyncDeviceRequest::RequestResult);
+    bool access_device(u8 slot, AsyncBlockDeviceRequest::RequestType, u64 lba, u8 block_count);
     size_t calculate_descriptors_count(size_t block_count) const;
-    [[nodiscard]] Optional<AsyncDeviceRequest::RequestResult> prepare_and_set_scatter_list(AsyncBlockDeviceRequest& request);
+    [[nodiscard]] Optional<AsyncDeviceRequest::RequestResult> prepare_and_set_scatter_list(u8 slot, AsyncBlockDeviceRequest& request);
 
     ALWAYS_INLINE bool is_interrupts_enabled() const;
 
@@ -86,7 +115,7 @@ private:
     bool identify_device();
 
     ALWAYS_INLINE void start_command_list_processing() const;
-    ALWAYS_INLINE void mark_command_header_ready_to_process(u8 command_header_index) const;
+    ALWAYS_INLINE void mark_command_header_ready_to_process(u8 command_header_index);
     ALWAYS_INLINE void stop_command_list_processing() const;
 
     ALWAYS_INLINE void start_fis_receiving() const;
@@ -106,14 +135,23 @@ private:
     // Data members
 
     EntropySource m_entropy_source;
-    LockRefPtr<AsyncBlockDeviceRequest> m_current_request;
     Spinlock<LockRank::None> m_hard_lock {};
     Mutex m_lock { "AHCIPort"sv };
 
-    mutable bool m_wait_for_completion { false };
+    // Note: A slot's command table and DMA buffers are only allocated once a request needs the slot,
+    // so ports that never see more than one request at a time don't use more memory than before.
+    Array<CommandSlot, max_command_slots_count> m_command_slots;
+    // Slots that are owned by a request, and the subset of them that the HBA still works on.
+    // Both are protected by m_hard_lock, because the interrupt handler updates them.
+    u32 m_busy_slots { 0 };
+    u32 m_issued_slots { 0 };
+    // Bumped whenever all requests are taken away from their slots (on a reset), so that completions
+    // which were noticed before that aren't taken for new requests in the same slots.
+    // Note: This is also protected by m_hard_lock.
+    u32 m_requests_generation { 0 };
+    size_t m_command_queue_depth { 1 };
+    bool m_native_command_queuing_enabled { false };
 
-    NonnullRefPtrVector<Memory::PhysicalPage> m_dma_buffers;
-    NonnullRefPtrVector<Memory::PhysicalPage> m_command_table_pages;
     RefPtr<Memory::PhysicalPage> m_command_list_page;
     OwnPtr<Memory::Region> m_command_list_region;
     RefPtr<Memory::PhysicalPage> m_fis_receive_page;
@@ -133,7 +171,6 @@ private:
     AHCI::PortInterruptStatusBitField m_interrupt_status;
     AHCI::PortInterruptEnableBitField m_interrupt_enable;
 
-    LockRefPtr<Memory::ScatterGatherList> m_current_scatter_list;
     bool m_disabled_by_firmware { false };
 };
 }
@@ -23,6 +23,12 @@ class ATAController
 public:
     virtual void start_request(ATADevice const&, AsyncBlockDeviceRequest&) = 0;
 
+    // Note: The IDE controllers use a single page for their DMA buffer.
+    virtual size_t max_transfer_size() const { return PAGE_SIZE; }
+
+    // Note: The IDE controllers can only have one command outstanding per channel.
+    virtual size_t max_requests_in_flight(ATADevice const&) const { return 1; }
+
 protected:
     ATAController();
 };
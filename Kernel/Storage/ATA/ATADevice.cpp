@@ -33,4 +33,20 @@ void ATADevice::start_request(AsyncBlockDeviceRequest& request)
     controller->start_request(*this, request);
 }
 
+size_t ATADevice::max_blocks_per_request() const
+{
+    auto controller = m_controller.strong_ref();
+    if (!controller)
+        return StorageDevice::max_blocks_per_request();
+    return max<size_t>(controller->max_transfer_size() / block_size(), 1);
+}
+
+size_t ATADevice::max_requests_in_flight() const
+{
+    auto controller = m_controller.strong_ref();
+    if (!controller)
+        return StorageDevice::max_requests_in_flight();
+    return max<size_t>(controller->max_requests_in_flight(*this), 1);
+}
+
 }
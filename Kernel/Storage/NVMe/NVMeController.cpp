@@ -34,8 +34,6 @@ UNMAP_AFTER_INIT NVMeController::NVMeController(const PCI::DeviceIdentifier& dev
 
 UNMAP_AFTER_INIT ErrorOr<void> NVMeController::initialize(bool is_queue_polled)
 {
-    // Nr of queues = one queue per core
-    auto nr_of_queues = Processor::count();
     auto irq = is_queue_polled ? Optional<u8> {} : device_identifier().interrupt_line().value();
 
     PCI::enable_memory_space(device_identifier());
@@ -58,11 +56,28 @@ UNMAP_AFTER_INIT ErrorOr<void> NVMeController::initialize(bool is_queue_polled)
     VERIFY(IO_QUEUE_SIZE < MQES(caps));
     dbgln_if(NVME_DEBUG, "NVMe: IO queue depth is: {}", IO_QUEUE_SIZE);
 
-    // Create an IO queue per core
-    for (u32 cpuid = 0; cpuid < nr_of_queues; ++cpuid) {
-        // qid is zero is used for admin queue
-        TRY(create_io_queue(cpuid + 1, irq));
+    // Ideally we want one IO queue per core, and another set of per-core polled queues
+    // if some namespaces are polled while the others use interrupts.
+    bool wants_poll_queues = !is_queue_polled && kernel_command_line().is_nvme_polling_enabled_for_any_namespace();
+    u32 wanted_queues = Processor::count() * (wants_poll_queues ? 2 : 1);
+    auto nr_of_queues = TRY(request_io_queue_count(min(wanted_queues, max_io_queue_count)));
+    dbgln_if(NVME_DEBUG, "NVMe: Controller granted {} IO queues out of {} requested", nr_of_queues, wanted_queues);
+
+    u32 nr_of_poll_queues = 0;
+    if (wants_poll_queues) {
+        if (nr_of_queues >= 2)
+            nr_of_poll_queues = min(nr_of_queues / 2, Processor::count());
+        else
+            dmesgln_pci(*this, "Not enough IO queues for polling, using interrupts for all namespaces");
     }
+    u32 nr_of_interrupt_queues = min(nr_of_queues - nr_of_poll_queues, Processor::count());
+
+    // qid is zero is used for admin queue
+    u16 qid = 1;
+    for (u32 i = 0; i < nr_of_interrupt_queues; ++i)
+        m_queues.append(TRY(create_io_queue(qid++, irq)));
+    for (u32 i = 0; i < nr_of_poll_queues; ++i)
+        m_poll_queues.append(TRY(create_io_queue(qid++, {})));
     TRY(identify_and_init_namespaces());
     return {};
 }
@@ -204,7 +219,9 @@ UNMAP_AFTER_INIT ErrorOr<void> NVMeController::identify_and_init_namespaces()
 
             dbgln_if(NVME_DEBUG, "NVMe: Block count is {} and Block size is {}", block_counts, block_size);
 
-            m_namespaces.append(TRY(NVMeNameSpace::try_create(*this, m_queues, nsid, block_counts, block_size)));
+            bool use_poll_queues = !m_poll_queues.is_empty() && kernel_command_line().is_nvme_polling_enabled_for_namespace(nsid);
+            dbgln_if(NVME_DEBUG, "NVMe: Namespace with NSID {} uses {} queues", nsid, use_poll_queues ? "polled" : "default");
+            m_namespaces.append(TRY(NVMeNameSpace::try_create(*this, use_poll_queues ? m_poll_queues : m_queues, nsid, block_counts, block_size)));
             m_device_count++;
             dbgln_if(NVME_DEBUG, "NVMe: Initialized namespace with NSID: {}", nsid);
         }
@@ -294,7 +311,27 @@ UNMAP_AFTER_INIT ErrorOr<void> NVMeController::create_admin_queue(Optional<u8> i
     return {};
 }
 
-UNMAP_AFTER_INIT ErrorOr<void> NVMeController::create_io_queue(u8 qid, Optional<u8> irq)
+UNMAP_AFTER_INIT ErrorOr<u32> NVMeController::request_io_queue_count(u32 count)
+{
+    VERIFY(count > 0);
+    NVMeSubmission sub {};
+    u32 result = 0;
+    sub.op = OP_ADMIN_SET_FEATURES;
+    sub.generic.cdw10 = FEATURE_NUMBER_OF_QUEUES;
+    // Both the number of submission and completion queues are 0 based
+    sub.generic.cdw11 = ((count - 1) << 16) | (count - 1);
+    auto status = submit_admin_command(sub, true, &result);
+    if (status) {
+        dmesgln_pci(*this, "Failed to set the number of IO queues");
+        return EFAULT;
+    }
+    // The controller may allocate more or fewer queues than we asked for.
+    u32 submission_queues = (result & 0xffff) + 1;
+    u32 completion_queues = (result >> 16) + 1;
+    return min(count, min(submission_queues, completion_queues));
+}
+
+UNMAP_AFTER_INIT ErrorOr<NonnullLockRefPtr<NVMeQueue>> NVMeController::create_io_queue(u16 qid, Optional<u8> irq)
 {
     OwnPtr<Memory::Region> cq_dma_region;
     NonnullRefPtrVector<Memory::PhysicalPage> cq_dma_pages;
@@ -348,8 +385,8 @@ UNMAP_AFTER_INIT ErrorOr<void> NVMeController::create_io_queue(u8 qid, Optional<
     auto queue_doorbell_offset = REG_SQ0TDBL_START + ((2 * qid) * (4 << m_dbl_stride));
     auto doorbell_regs = TRY(Memory::map_typed_writable<DoorbellRegister volatile>(PhysicalAddress(m_bar + queue_doorbell_offset)));
 
-    m_queues.append(TRY(NVMeQueue::try_create(qid, irq, IO_QUEUE_SIZE, move(cq_dma_region), cq_dma_pages, move(sq_dma_region), sq_dma_pages, move(doorbell_regs))));
-    dbgln_if(NVME_DEBUG, "NVMe: Created IO Queue with QID{}", m_queues.size());
-    return {};
+    auto queue = TRY(NVMeQueue::try_create(qid, irq, IO_QUEUE_SIZE, move(cq_dma_region), cq_dma_pages, move(sq_dma_region), sq_dma_pages, move(doorbell_regs)));
+    dbgln_if(NVME_DEBUG, "NVMe: Created {} IO Queue with QID{}", irq.has_value() ? "interrupt" : "polled", qid);
+    return queue;
 }
 }
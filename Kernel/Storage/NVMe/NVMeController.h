@@ -42,11 +42,11 @@ public:
     bool start_controller();
     u32 get_admin_q_dept();
 
-    u16 submit_admin_command(NVMeSubmission& sub, bool sync = false)
+    u16 submit_admin_command(NVMeSubmission& sub, bool sync = false, u32* command_specific_result = nullptr)
     {
         // First queue is always the admin queue
         if (sync) {
-            return m_admin_queue->submit_sync_sqe(sub);
+            return m_admin_queue->submit_sync_sqe(sub, command_specific_result);
         }
         m_admin_queue->submit_sqe(sub);
         return 0;
@@ -61,7 +61,8 @@ private:
     ErrorOr<void> identify_and_init_namespaces();
     Tuple<u64, u8> get_ns_features(IdentifyNamespace& identify_data_struct);
     ErrorOr<void> create_admin_queue(Optional<u8> irq);
-    ErrorOr<void> create_io_queue(u8 qid, Optional<u8> irq);
+    ErrorOr<u32> request_io_queue_count(u32 count);
+    ErrorOr<NonnullLockRefPtr<NVMeQueue>> create_io_queue(u16 qid, Optional<u8> irq);
     void calculate_doorbell_stride()
     {
         m_dbl_stride = (m_controller_regs->cap >> CAP_DBL_SHIFT) & CAP_DBL_MASK;
@@ -70,7 +71,9 @@ private:
 
 private:
     LockRefPtr<NVMeQueue> m_admin_queue;
+    // Note: Namespaces submit to the queue of the current processor within one of these sets.
     NonnullLockRefPtrVector<NVMeQueue> m_queues;
+    NonnullLockRefPtrVector<NVMeQueue> m_poll_queues;
     NonnullLockRefPtrVector<NVMeNameSpace> m_namespaces;
     Memory::TypedMapping<ControllerRegister volatile> m_controller_regs;
     bool m_admin_queue_ready { false };
@@ -79,5 +82,7 @@ private:
     u32 m_bar { 0 };
     u8 m_dbl_stride { 0 };
     static Atomic<u8> s_controller_id;
+    // Queue IDs are 16 bits, and qid 0 is the admin queue.
+    static constexpr u32 max_io_queue_count = 0xffff;
 };
 }
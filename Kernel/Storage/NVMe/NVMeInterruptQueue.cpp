@@ -37,18 +37,21 @@ void NVMeInterruptQueue::complete_current_request(u16 status)
         SpinlockLocker lock(m_request_lock);
         auto current_request = m_current_request;
         m_current_request.clear();
-        if (status) {
-            lock.unlock();
-            current_request->complete(AsyncBlockDeviceRequest::Failure);
-            return;
-        }
-        if (current_request->request_type() == AsyncBlockDeviceRequest::RequestType::Read) {
+        // Copy the data out of the DMA page before the next request gets to reuse it.
+        if (!status && current_request->request_type() == AsyncBlockDeviceRequest::RequestType::Read) {
             if (auto result = current_request->write_to_buffer(current_request->buffer(), m_rw_dma_region->vaddr().as_ptr(), current_request->buffer_size()); result.is_error()) {
+                start_next_pending_request();
                 lock.unlock();
                 current_request->complete(AsyncDeviceRequest::MemoryFault);
                 return;
             }
         }
+        start_next_pending_request();
+        if (status) {
+            lock.unlock();
+            current_request->complete(AsyncBlockDeviceRequest::Failure);
+            return;
+        }
         lock.unlock();
         current_request->complete(AsyncDeviceRequest::Success);
         return;
@@ -56,6 +59,7 @@ void NVMeInterruptQueue::complete_current_request(u16 status)
     if (work_item_creation_result.is_error()) {
         auto current_request = m_current_request;
         m_current_request.clear();
+        start_next_pending_request();
         current_request->complete(AsyncDeviceRequest::OutOfMemory);
     }
 }
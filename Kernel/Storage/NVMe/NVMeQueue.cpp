@@ -110,15 +110,15 @@ void NVMeQueue::submit_sqe(NVMeSubmission& sub)
     update_sq_doorbell();
 }
 
-u16 NVMeQueue::submit_sync_sqe(NVMeSubmission& sub)
+u16 NVMeQueue::submit_sync_sqe(NVMeSubmission& sub, u32* command_specific_result)
 {
     // For now let's use sq tail as a unique command id.
     u16 cqe_cid;
     u16 cid = m_sq_tail;
+    int index;
 
     submit_sqe(sub);
     do {
-        int index;
         {
             SpinlockLocker lock(m_cq_lock);
             index = m_cq_head - 1;
@@ -129,14 +129,47 @@ u16 NVMeQueue::submit_sync_sqe(NVMeSubmission& sub)
         microseconds_delay(1);
     } while (cid != cqe_cid);
 
-    auto status = CQ_STATUS_FIELD(m_cqe_array[m_cq_head].status);
+    if (command_specific_result)
+        *command_specific_result = m_cqe_array[index].cmd_spec;
+    auto status = CQ_STATUS_FIELD(m_cqe_array[index].status);
     return status;
 }
 
+void NVMeQueue::submit_request(AsyncBlockDeviceRequest& request, u16 nsid)
+{
+    SpinlockLocker lock(m_request_lock);
+    if (m_current_request) {
+        if (m_pending_requests.try_append({ request, nsid }).is_error()) {
+            lock.unlock();
+            request.complete(AsyncDeviceRequest::OutOfMemory);
+        }
+        return;
+    }
+    start_request(request, nsid);
+}
+
+void NVMeQueue::start_next_pending_request()
+{
+    VERIFY(m_request_lock.is_locked());
+    if (m_current_request || m_pending_requests.is_empty())
+        return;
+    auto pending = m_pending_requests.take_first();
+    start_request(*pending.request, pending.nsid);
+}
+
+void NVMeQueue::start_request(AsyncBlockDeviceRequest& request, u16 nsid)
+{
+    VERIFY(m_request_lock.is_locked());
+    if (request.request_type() == AsyncBlockDeviceRequest::Read)
+        read(request, nsid, request.block_index(), request.block_count());
+    else
+        write(request, nsid, request.block_index(), request.block_count());
+}
+
 void NVMeQueue::read(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count)
 {
     NVMeSubmission sub {};
-    SpinlockLocker m_lock(m_request_lock);
+    VERIFY(m_request_lock.is_locked());
     m_current_request = request;
 
     sub.op = OP_NVME_READ;
@@ -153,7 +186,7 @@ void NVMeQueue::read(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32
 void NVMeQueue::write(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count)
 {
     NVMeSubmission sub {};
-    SpinlockLocker m_lock(m_request_lock);
+    VERIFY(m_request_lock.is_locked());
     m_current_request = request;
 
     if (auto result = m_current_request->read_from_buffer(m_current_request->buffer(), m_rw_dma_region->vaddr().as_ptr(), m_current_request->buffer_size()); result.is_error()) {
@@ -32,9 +32,8 @@ class NVMeQueue : public AtomicRefCounted<NVMeQueue> {
 public:
     static ErrorOr<NonnullLockRefPtr<NVMeQueue>> try_create(u16 qid, Optional<u8> irq, u32 q_depth, OwnPtr<Memory::Region> cq_dma_region, NonnullRefPtrVector<Memory::PhysicalPage> cq_dma_page, OwnPtr<Memory::Region> sq_dma_region, NonnullRefPtrVector<Memory::PhysicalPage> sq_dma_page, Memory::TypedMapping<DoorbellRegister volatile> db_regs);
     bool is_admin_queue() { return m_admin_queue; };
-    u16 submit_sync_sqe(NVMeSubmission&);
-    void read(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count);
-    void write(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count);
+    u16 submit_sync_sqe(NVMeSubmission&, u32* command_specific_result = nullptr);
+    void submit_request(AsyncBlockDeviceRequest&, u16 nsid);
     virtual void submit_sqe(NVMeSubmission&);
     virtual ~NVMeQueue();
 
@@ -44,9 +43,18 @@ protected:
     {
         m_db_regs->sq_tail = m_sq_tail;
     }
+    void start_next_pending_request();
     NVMeQueue(NonnullOwnPtr<Memory::Region> rw_dma_region, Memory::PhysicalPage const& rw_dma_page, u16 qid, u32 q_depth, OwnPtr<Memory::Region> cq_dma_region, NonnullRefPtrVector<Memory::PhysicalPage> cq_dma_page, OwnPtr<Memory::Region> sq_dma_region, NonnullRefPtrVector<Memory::PhysicalPage> sq_dma_page, Memory::TypedMapping<DoorbellRegister volatile> db_regs);
 
 private:
+    struct PendingRequest {
+        NonnullLockRefPtr<AsyncBlockDeviceRequest> request;
+        u16 nsid;
+    };
+
+    void start_request(AsyncBlockDeviceRequest&, u16 nsid);
+    void read(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count);
+    void write(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count);
     bool cqe_available();
     void update_cqe_head();
     virtual void complete_current_request(u16 status) = 0;
@@ -60,6 +68,9 @@ protected:
     LockRefPtr<AsyncBlockDeviceRequest> m_current_request;
     NonnullOwnPtr<Memory::Region> m_rw_dma_region;
     Spinlock<LockRank::None> m_request_lock {};
+    // Note: All requests on a queue share m_rw_dma_region, so only one of them can be in
+    // flight at a time. Anything submitted in the meantime waits here, in order.
+    Vector<PendingRequest> m_pending_requests;
 
 private:
     u16 m_qid {};
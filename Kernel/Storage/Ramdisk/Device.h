@@ -32,6 +32,8 @@ private:
 
     // ^StorageDevice
     virtual CommandSet command_set() const override { return CommandSet::PlainMemory; }
+    // Note: Requests are served with a plain memcpy, so there is no reason to split them up.
+    virtual size_t max_blocks_per_request() const override { return max_addressable_block(); }
 
     Mutex m_lock { "RamdiskDevice"sv };
 
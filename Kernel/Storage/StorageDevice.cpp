@@ -77,6 +77,8 @@ StringView StorageDevice::command_set_to_string_view() const
         return "ata"sv;
     case CommandSet::NVMe:
         return "nvme"sv;
+    case CommandSet::VirtIO:
+        return "virtio"sv;
     default:
         break;
     }
@@ -90,10 +92,12 @@ ErrorOr<size_t> StorageDevice::read(OpenFileDescription&, u64 offset, UserOrKern
     size_t whole_blocks = len >> block_size_log();
     size_t remaining = len - (whole_blocks << block_size_log());
 
-    // PATAChannel will chuck a wobbly if we try to read more than PAGE_SIZE
-    // at a time, because it uses a single page for its DMA buffer.
-    if (whole_blocks >= m_blocks_per_page) {
-        whole_blocks = m_blocks_per_page;
+    // Most controllers can only transfer a limited amount of data per request
+    // (e.g. PATAChannel uses a single page for its DMA buffer), so we return a
+    // short read and let the caller come back for the rest.
+    auto max_blocks = max_blocks_per_request();
+    if (whole_blocks >= max_blocks) {
+        whole_blocks = max_blocks;
         remaining = 0;
     }
 
@@ -156,10 +160,12 @@ ErrorOr<size_t> StorageDevice::write(OpenFileDescription&, u64 offset, UserOrKer
     size_t whole_blocks = len >> block_size_log();
     size_t remaining = len - (whole_blocks << block_size_log());
 
-    // PATAChannel will chuck a wobbly if we try to write more than PAGE_SIZE
-    // at a time, because it uses a single page for its DMA buffer.
-    if (whole_blocks >= m_blocks_per_page) {
-        whole_blocks = m_blocks_per_page;
+    // Most controllers can only transfer a limited amount of data per request
+    // (e.g. PATAChannel uses a single page for its DMA buffer), so we return a
+    // short write and let the caller come back for the rest.
+    auto max_blocks = max_blocks_per_request();
+    if (whole_blocks >= max_blocks) {
+        whole_blocks = max_blocks;
         remaining = 0;
     }
 
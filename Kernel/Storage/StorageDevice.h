@@ -38,6 +38,7 @@ public:
         SCSI,
         ATA,
         NVMe,
+        VirtIO,
     };
 
     // Note: The most reliable way to address this device from userspace interfaces,
@@ -57,6 +58,7 @@ public:
     virtual u64 max_addressable_block() const { return m_max_addressable_block; }
 
     // ^BlockDevice
+    virtual size_t max_blocks_per_request() const override { return m_blocks_per_page; }
     virtual ErrorOr<size_t> read(OpenFileDescription&, u64, UserOrKernelBuffer&, size_t) override;
     virtual bool can_read(OpenFileDescription const&, u64) const override;
     virtual ErrorOr<size_t> write(OpenFileDescription&, u64, UserOrKernelBuffer const&, size_t) override;
@@ -16,6 +16,7 @@
 #include <Kernel/Bus/PCI/API.h>
 #include <Kernel/Bus/PCI/Access.h>
 #include <Kernel/Bus/PCI/Controller/VolumeManagementDevice.h>
+#include <Kernel/Bus/PCI/IDs.h>
 #include <Kernel/CommandLine.h>
 #include <Kernel/Devices/BlockDevice.h>
 #include <Kernel/Devices/DeviceManagement.h>
@@ -27,6 +28,7 @@
 #include <Kernel/Storage/NVMe/NVMeController.h>
 #include <Kernel/Storage/Ramdisk/Controller.h>
 #include <Kernel/Storage/StorageManagement.h>
+#include <Kernel/Storage/VirtIO/VirtIOBlockController.h>
 #include <LibPartition/EBRPartitionTable.h>
 #include <LibPartition/GUIDPartitionTable.h>
 #include <LibPartition/MBRPartitionTable.h>
@@ -40,6 +42,7 @@ static Atomic<u32> s_controller_id;
 
 static Atomic<u32> s_relative_ata_controller_id;
 static Atomic<u32> s_relative_nvme_controller_id;
+static Atomic<u32> s_relative_virtio_controller_id;
 
 static constexpr StringView partition_uuid_prefix = "PARTUUID:"sv;
 
@@ -49,6 +52,7 @@ static constexpr StringView block_device_prefix = "block"sv;
 static constexpr StringView ata_device_prefix = "ata"sv;
 static constexpr StringView nvme_device_prefix = "nvme"sv;
 static constexpr StringView ramdisk_device_prefix = "ramdisk"sv;
+static constexpr StringView virtio_device_prefix = "virtio"sv;
 static constexpr StringView logical_unit_number_device_prefix = "lun"sv;
 
 UNMAP_AFTER_INIT StorageManagement::StorageManagement()
@@ -67,6 +71,12 @@ u32 StorageManagement::generate_relative_ata_controller_id(Badge<ATAController>)
     s_relative_ata_controller_id++;
     return controller_id;
 }
+u32 StorageManagement::generate_relative_virtio_controller_id(Badge<VirtIOBlockController>)
+{
+    auto controller_id = s_relative_virtio_controller_id.load();
+    s_relative_virtio_controller_id++;
+    return controller_id;
+}
 
 void StorageManagement::remove_device(StorageDevice& device)
 {
@@ -94,6 +104,17 @@ UNMAP_AFTER_INIT void StorageManagement::enumerate_pci_controllers(bool force_pi
                 return;
             }
 
+            if (device_identifier.hardware_id().vendor_id == PCI::VendorID::VirtIO) {
+                if (device_identifier.hardware_id().device_id != PCI::DeviceID::VirtIOBlockDevice || kernel_command_line().disable_virtio())
+                    return;
+                auto controller = VirtIOBlockController::try_initialize(device_identifier);
+                if (controller.is_error())
+                    dmesgln("Unable to initialize VirtIO block device: {}", controller.error());
+                else
+                    m_controllers.append(controller.release_value());
+                return;
+            }
+
             auto subclass_code = static_cast<SubclassID>(device_identifier.subclass_code().value());
 #if ARCH(X86_64)
             if (subclass_code == SubclassID::IDEController && kernel_command_line().is_ide_enabled()) {
@@ -288,6 +309,13 @@ UNMAP_AFTER_INIT void StorageManagement::determine_nvme_boot_device()
     });
 }
 
+UNMAP_AFTER_INIT void StorageManagement::determine_virtio_boot_device()
+{
+    determine_hardware_relative_boot_device(virtio_device_prefix, [](StorageDevice const& device) -> bool {
+        return device.command_set() == StorageDevice::CommandSet::VirtIO;
+    });
+}
+
 UNMAP_AFTER_INIT void StorageManagement::determine_ramdisk_boot_device()
 {
     determine_hardware_relative_boot_device(ramdisk_device_prefix, [](StorageDevice const& device) -> bool {
@@ -363,6 +391,11 @@ UNMAP_AFTER_INIT void StorageManagement::determine_boot_device()
         determine_nvme_boot_device();
         return;
     }
+
+    if (m_boot_argument.starts_with(virtio_device_prefix)) {
+        determine_virtio_boot_device();
+        return;
+    }
     PANIC("StorageManagement: Invalid root boot parameter.");
 }
 
@@ -20,6 +20,7 @@ namespace Kernel {
 
 class ATAController;
 class NVMeController;
+class VirtIOBlockController;
 class StorageManagement {
 
 public:
@@ -38,6 +39,7 @@ public:
 
     static u32 generate_relative_nvme_controller_id(Badge<NVMeController>);
     static u32 generate_relative_ata_controller_id(Badge<ATAController>);
+    static u32 generate_relative_virtio_controller_id(Badge<VirtIOBlockController>);
 
     void remove_device(StorageDevice&);
 
@@ -54,6 +56,7 @@ private:
     void determine_block_boot_device();
     void determine_ramdisk_boot_device();
     void determine_nvme_boot_device();
+    void determine_virtio_boot_device();
     void determine_ata_boot_device();
     void determine_hardware_relative_boot_device(StringView relative_hardware_prefix, Function<bool(StorageDevice const&)> filter_device_callback);
     Array<unsigned, 3> extract_boot_device_address_parameters(StringView device_prefix);
@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Arch/Processor.h>
+#include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Sections.h>
+#include <Kernel/Storage/StorageManagement.h>
+#include <Kernel/Storage/VirtIO/VirtIOBlockController.h>
+#include <Kernel/Storage/VirtIO/VirtIOBlockDevice.h>
+#include <Kernel/WorkQueue.h>
+
+namespace Kernel {
+
+// virtio_blk_config
+#define DEVICE_CAPACITY 0x0
+#define DEVICE_SIZE_MAX 0x8
+#define DEVICE_BLK_SIZE 0x14
+#define DEVICE_NUM_QUEUES 0x22
+
+// Note: The capacity and the sector of a request are always given in units of 512 bytes,
+// no matter which logical block size the device reports.
+static constexpr size_t virtio_block_sector_size = 512;
+
+UNMAP_AFTER_INIT ErrorOr<NonnullLockRefPtr<VirtIOBlockController>> VirtIOBlockController::try_initialize(PCI::DeviceIdentifier const& device_identifier)
+{
+    auto controller = TRY(adopt_nonnull_lock_ref_or_enomem(new (nothrow) VirtIOBlockController(device_identifier)));
+    controller->initialize();
+    TRY(controller->initialize_controller());
+    return controller;
+}
+
+UNMAP_AFTER_INIT VirtIOBlockController::VirtIOBlockController(PCI::DeviceIdentifier const& device_identifier)
+    : StorageController(StorageManagement::generate_relative_virtio_controller_id({}))
+    , VirtIO::Device(device_identifier)
+{
+}
+
+UNMAP_AFTER_INIT ErrorOr<void> VirtIOBlockController::initialize_controller()
+{
+    auto const* config = get_config(VirtIO::ConfigurationType::Device);
+    if (!config) {
+        dbgln("VirtIOBlockDevice: Device has no configuration space");
+        return Error::from_errno(ENODEV);
+    }
+
+    bool success = negotiate_features([&](u64 supported_features) {
+        u64 negotiated = 0;
+        if (is_feature_set(supported_features, VIRTIO_BLK_F_SIZE_MAX))
+            negotiated |= VIRTIO_BLK_F_SIZE_MAX;
+        if (is_feature_set(supported_features, VIRTIO_BLK_F_RO))
+            negotiated |= VIRTIO_BLK_F_RO;
+        if (is_feature_set(supported_features, VIRTIO_BLK_F_BLK_SIZE))
+            negotiated |= VIRTIO_BLK_F_BLK_SIZE;
+        if (is_feature_set(supported_features, VIRTIO_BLK_F_MQ))
+            negotiated |= VIRTIO_BLK_F_MQ;
+        return negotiated;
+    });
+    if (!success)
+        return Error::from_errno(ENODEV);
+
+    u64 capacity = 0;
+    u32 size_max = 0;
+    u32 logical_block_size = virtio_block_sector_size;
+    u16 queue_count = 1;
+    read_config_atomic([&]() {
+        capacity = config_read32(*config, DEVICE_CAPACITY) | (static_cast<u64>(config_read32(*config, DEVICE_CAPACITY + 4)) << 32);
+        if (is_feature_accepted(VIRTIO_BLK_F_SIZE_MAX))
+            size_max = config_read32(*config, DEVICE_SIZE_MAX);
+        if (is_feature_accepted(VIRTIO_BLK_F_BLK_SIZE))
+            logical_block_size = config_read32(*config, DEVICE_BLK_SIZE);
+        if (is_feature_accepted(VIRTIO_BLK_F_MQ))
+            queue_count = config_read16(*config, DEVICE_NUM_QUEUES);
+    });
+
+    if (logical_block_size < virtio_block_sector_size || logical_block_size > PAGE_SIZE || !is_power_of_two(logical_block_size)) {
+        dbgln("VirtIOBlockDevice: Ignoring unsupported logical block size {}", logical_block_size);
+        logical_block_size = virtio_block_sector_size;
+    }
+    m_logical_block_size = logical_block_size;
+    m_read_only = is_feature_accepted(VIRTIO_BLK_F_RO);
+
+    // Note: The data of a request is a single buffer, so it can't be larger than the largest segment the device accepts.
+    if (size_max != 0)
+        m_max_transfer_size = max<size_t>(min<size_t>(m_max_transfer_size, size_max) & ~(m_logical_block_size - 1), m_logical_block_size);
+
+    // Note: There is no point in having more queues than processors, as each processor submits to its own queue.
+    queue_count = clamp<u16>(queue_count, 1, min<size_t>(Processor::count(), NumericLimits<u16>::max()));
+    if (!setup_queues(queue_count))
+        return Error::from_errno(ENODEV);
+    TRY(m_request_queues.try_ensure_capacity(queue_count));
+    for (u16 queue_index = 0; queue_index < queue_count; queue_index++)
+        TRY(create_request_queue(queue_index));
+    finish_init();
+
+    dmesgln("{}: {} sectors, {} byte blocks, {} queues with {} request slots{}", device_identifier().address(), capacity, m_logical_block_size,
+        queue_count, m_request_slots_count, m_read_only ? ", read-only"sv : ""sv);
+
+    m_device = TRY(VirtIOBlockDevice::try_create(*this, m_logical_block_size, capacity * virtio_block_sector_size / m_logical_block_size));
+    return {};
+}
+
+UNMAP_AFTER_INIT ErrorOr<void> VirtIOBlockController::create_request_queue(u16 queue_index)
+{
+    // Note: Every request takes one descriptor for its header, data and status each, so the queue never runs out of them.
+    auto slots_count = min(max_request_slots_per_queue, get_queue(queue_index).size() / descriptors_per_request);
+    if (slots_count == 0)
+        return Error::from_errno(ENODEV);
+
+    static_assert(max_request_slots_per_queue * request_slot_stride <= PAGE_SIZE);
+    auto headers_region = TRY(MM.allocate_contiguous_kernel_region(PAGE_SIZE, "VirtIO Block Requests"sv, Memory::Region::Access::ReadWrite));
+    Vector<RequestSlot> slots;
+    TRY(slots.try_ensure_capacity(slots_count));
+    auto data_buffer_size = TRY(Memory::page_round_up(m_max_transfer_size));
+    for (size_t slot_index = 0; slot_index < slots_count; slot_index++) {
+        auto data_buffer = TRY(MM.allocate_contiguous_kernel_region(data_buffer_size, "VirtIO Block Data"sv, Memory::Region::Access::ReadWrite));
+        slots.unchecked_append(RequestSlot { nullptr, move(data_buffer) });
+    }
+
+    m_request_queues.unchecked_append(RequestQueue { move(slots), move(headers_region) });
+    m_request_slots_count += slots_count;
+    return {};
+}
+
+LockRefPtr<StorageDevice> VirtIOBlockController::device(u32 index) const
+{
+    if (index != 0)
+        return {};
+    return m_device;
+}
+
+bool VirtIOBlockController::reset()
+{
+    // FIXME: Reset the device and fail the requests that were in flight.
+    return false;
+}
+
+bool VirtIOBlockController::shutdown()
+{
+    TODO();
+}
+
+void VirtIOBlockController::complete_current_request(AsyncDeviceRequest::RequestResult)
+{
+    VERIFY_NOT_REACHED();
+}
+
+bool VirtIOBlockController::handle_device_config_change()
+{
+    // FIXME: The capacity might have changed because the disk was resized on the host.
+    dbgln_if(VIRTIO_DEBUG, "VirtIOBlockDevice: Ignoring device config change");
+    return true;
+}
+
+VirtIOBlockController::RequestHeader& VirtIOBlockController::request_header(u16 queue_index, size_t slot_index)
+{
+    auto& request_queue = m_request_queues[queue_index];
+    return *reinterpret_cast<RequestHeader*>(request_queue.headers_region->vaddr().offset(slot_index * request_slot_stride).as_ptr());
+}
+
+u8 volatile& VirtIOBlockController::request_status(u16 queue_index, size_t slot_index)
+{
+    auto& request_queue = m_request_queues[queue_index];
+    return *reinterpret_cast<u8 volatile*>(request_queue.headers_region->vaddr().offset(slot_index * request_slot_stride + request_status_offset).as_ptr());
+}
+
+PhysicalAddress VirtIOBlockController::request_header_address(u16 queue_index, size_t slot_index) const
+{
+    auto const& request_queue = m_request_queues[queue_index];
+    return request_queue.headers_region->physical_page(0)->paddr().offset(slot_index * request_slot_stride);
+}
+
+Optional<size_t> VirtIOBlockController::try_to_allocate_request_slot(u16 queue_index, AsyncBlockDeviceRequest& request)
+{
+    auto& request_queue = m_request_queues[queue_index];
+    SpinlockLocker lock(get_queue(queue_index).lock());
+    for (size_t slot_index = 0; slot_index < request_queue.slots.size(); slot_index++) {
+        if (request_queue.busy_slots & (1u << slot_index))
+            continue;
+        request_queue.busy_slots |= 1u << slot_index;
+        request_queue.slots[slot_index].request = request;
+        return slot_index;
+    }
+    return {};
+}
+
+void VirtIOBlockController::start_request(AsyncBlockDeviceRequest& request)
+{
+    if (request.request_type() == AsyncBlockDeviceRequest::Write && m_read_only) {
+        request.complete(AsyncDeviceRequest::Failure);
+        return;
+    }
+    size_t data_size = request.block_count() * m_logical_block_size;
+    VERIFY(data_size <= m_max_transfer_size);
+
+    // Note: Requests go to the queue of the current processor first, so processors don't contend for the same queue lock.
+    // If that queue is full, any other queue with a free slot will do.
+    auto preferred_queue_index = Processor::current_id() % m_request_queues.size();
+    u16 queue_index = 0;
+    Optional<size_t> slot_index;
+    for (size_t offset = 0; offset < m_request_queues.size() && !slot_index.has_value(); offset++) {
+        queue_index = (preferred_queue_index + offset) % m_request_queues.size();
+        slot_index = try_to_allocate_request_slot(queue_index, request);
+    }
+    // Note: The block layer never has more requests in flight than we have request slots.
+    VERIFY(slot_index.has_value());
+
+    auto& slot = m_request_queues[queue_index].slots[slot_index.value()];
+    if (request.request_type() == AsyncBlockDeviceRequest::Write) {
+        if (auto result = request.read_from_buffer(request.buffer(), slot.data_buffer->vaddr().as_ptr(), data_size); result.is_error()) {
+            complete_request_in_slot(queue_index, slot_index.value(), AsyncDeviceRequest::MemoryFault);
+            return;
+        }
+    }
+
+    auto& header = request_header(queue_index, slot_index.value());
+    header.type = request.request_type() == AsyncBlockDeviceRequest::Read ? VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT;
+    header.reserved = 0;
+    header.sector = request.block_index() * (m_logical_block_size / virtio_block_sector_size);
+    request_status(queue_index, slot_index.value()) = 0xff;
+
+    if (!submit_request_in_slot(queue_index, slot_index.value())) {
+        dbgln("VirtIOBlockDevice: Failed to submit request to queue {}", queue_index);
+        complete_request_in_slot(queue_index, slot_index.value(), AsyncDeviceRequest::Failure);
+    }
+}
+
+bool VirtIOBlockController::submit_request_in_slot(u16 queue_index, size_t slot_index)
+{
+    auto& slot = m_request_queues[queue_index].slots[slot_index];
+    auto& request = *slot.request;
+    auto data_buffer_type = request.request_type() == AsyncBlockDeviceRequest::Read ? VirtIO::BufferType::DeviceWritable : VirtIO::BufferType::DeviceReadable;
+    auto header_address = request_header_address(queue_index, slot_index);
+
+    auto& queue = get_queue(queue_index);
+    SpinlockLocker lock(queue.lock());
+    VirtIO::QueueChain chain(queue);
+    bool success = chain.add_buffer_to_chain(header_address, sizeof(RequestHeader), VirtIO::BufferType::DeviceReadable)
+        && chain.add_buffer_to_chain(slot.data_buffer->physical_page(0)->paddr(), request.block_count() * m_logical_block_size, data_buffer_type)
+        && chain.add_buffer_to_chain(header_address.offset(request_status_offset), sizeof(u8), VirtIO::BufferType::DeviceWritable);
+    if (!success) {
+        chain.release_buffer_slots_to_queue();
+        return false;
+    }
+    supply_chain_and_notify(queue_index, chain);
+    return true;
+}
+
+void VirtIOBlockController::handle_queue_update(u16 queue_index)
+{
+    auto& request_queue = m_request_queues[queue_index];
+    auto headers_address = request_queue.headers_region->physical_page(0)->paddr();
+    u32 completed_slots = 0;
+    {
+        auto& queue = get_queue(queue_index);
+        SpinlockLocker lock(queue.lock());
+        size_t used;
+        for (auto chain = queue.pop_used_buffer_chain(used); !chain.is_empty(); chain = queue.pop_used_buffer_chain(used)) {
+            Optional<PhysicalAddress> header_address;
+            chain.for_each([&](PhysicalAddress address, size_t) {
+                if (!header_address.has_value())
+                    header_address = address;
+            });
+            chain.release_buffer_slots_to_queue();
+            auto slot_index = (header_address.value().get() - headers_address.get()) / request_slot_stride;
+            VERIFY(slot_index < request_queue.slots.size());
+            completed_slots |= 1u << slot_index;
+        }
+    }
+    if (completed_slots == 0)
+        return;
+
+    auto work_item_creation_result = g_io_work->try_queue([this, queue_index, completed_slots]() {
+        finish_completed_requests(queue_index, completed_slots);
+    });
+    if (work_item_creation_result.is_error()) {
+        for (size_t slot_index = 0; slot_index < request_queue.slots.size(); slot_index++) {
+            if (completed_slots & (1u << slot_index))
+                complete_request_in_slot(queue_index, slot_index, AsyncDeviceRequest::Failure);
+        }
+    }
+}
+
+void VirtIOBlockController::finish_completed_requests(u16 queue_index, u32 completed_slots)
+{
+    auto& request_queue = m_request_queues[queue_index];
+    for (size_t slot_index = 0; slot_index < request_queue.slots.size(); slot_index++) {
+        if (!(completed_slots & (1u << slot_index)))
+            continue;
+        auto& slot = request_queue.slots[slot_index];
+        VERIFY(slot.request);
+        auto& request = *slot.request;
+        auto result = AsyncDeviceRequest::Success;
+        if (auto status = request_status(queue_index, slot_index); status != VIRTIO_BLK_S_OK) {
+            dbgln("VirtIOBlockDevice: Request for block {} failed with status {}", request.block_index(), status);
+            result = AsyncDeviceRequest::Failure;
+        } else if (request.request_type() == AsyncBlockDeviceRequest::Read) {
+            if (auto read_result = request.write_to_buffer(request.buffer(), slot.data_buffer->vaddr().as_ptr(), request.block_count() * m_logical_block_size); read_result.is_error())
+                result = AsyncDeviceRequest::MemoryFault;
+        }
+        complete_request_in_slot(queue_index, slot_index, result);
+    }
+}
+
+void VirtIOBlockController::complete_request_in_slot(u16 queue_index, size_t slot_index, AsyncDeviceRequest::RequestResult result)
+{
+    auto& request_queue = m_request_queues[queue_index];
+    LockRefPtr<AsyncBlockDeviceRequest> request;
+    {
+        SpinlockLocker lock(get_queue(queue_index).lock());
+        VERIFY(request_queue.busy_slots & (1u << slot_index));
+        request = move(request_queue.slots[slot_index].request);
+        request_queue.busy_slots &= ~(1u << slot_index);
+    }
+    VERIFY(request);
+    // Note: The slot has to be free before completing the request, as this might start the next one.
+    request->complete(result);
+}
+
+}
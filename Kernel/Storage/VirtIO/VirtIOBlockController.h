@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <Kernel/Bus/VirtIO/Device.h>
+#include <Kernel/Devices/BlockDevice.h>
+#include <Kernel/Library/LockRefPtr.h>
+#include <Kernel/Library/LockWeakable.h>
+#include <Kernel/Storage/StorageController.h>
+
+namespace Kernel {
+
+#define VIRTIO_BLK_F_SIZE_MAX (1 << 1)
+#define VIRTIO_BLK_F_SEG_MAX (1 << 2)
+#define VIRTIO_BLK_F_RO (1 << 5)
+#define VIRTIO_BLK_F_BLK_SIZE (1 << 6)
+#define VIRTIO_BLK_F_MQ (1 << 12)
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+
+#define VIRTIO_BLK_S_OK 0
+
+class VirtIOBlockDevice;
+class VirtIOBlockController final
+    : public StorageController
+    , public LockWeakable<VirtIOBlockController>
+    , public VirtIO::Device {
+public:
+    static ErrorOr<NonnullLockRefPtr<VirtIOBlockController>> try_initialize(PCI::DeviceIdentifier const&);
+
+    // ^StorageController
+    virtual LockRefPtr<StorageDevice> device(u32 index) const override;
+    virtual size_t devices_count() const override { return m_device ? 1 : 0; }
+
+    // ^PCI::Device
+    virtual StringView device_name() const override { return class_name(); }
+
+    // ^IRQHandler
+    virtual StringView purpose() const override { return class_name(); }
+
+    void start_request(AsyncBlockDeviceRequest&);
+    size_t max_transfer_size() const { return m_max_transfer_size; }
+    size_t max_requests_in_flight() const { return m_request_slots_count; }
+
+protected:
+    virtual bool reset() override;
+    virtual bool shutdown() override;
+    virtual void complete_current_request(AsyncDeviceRequest::RequestResult) override;
+
+private:
+    // virtio_blk_req, without the data buffer and the status byte that follow it.
+    struct [[gnu::packed]] RequestHeader {
+        u32 type;
+        u32 reserved;
+        u64 sector;
+    };
+
+    // Note: The header and status byte of each request slot live next to each other in one page per queue,
+    // so the slot a used buffer chain belongs to can be found from the address of its first buffer.
+    static constexpr size_t request_slot_stride = 32;
+    static_assert(sizeof(RequestHeader) < request_slot_stride);
+    static constexpr size_t request_status_offset = sizeof(RequestHeader);
+    static constexpr size_t max_request_slots_per_queue = 16;
+    static constexpr size_t descriptors_per_request = 3;
+    static constexpr size_t default_max_transfer_size = 16 * PAGE_SIZE;
+
+    struct RequestSlot {
+        LockRefPtr<AsyncBlockDeviceRequest> request;
+        OwnPtr<Memory::Region> data_buffer;
+    };
+
+    struct RequestQueue {
+        Vector<RequestSlot> slots;
+        NonnullOwnPtr<Memory::Region> headers_region;
+        // Guarded by the lock of the VirtIO::Queue.
+        u32 busy_slots { 0 };
+    };
+
+    explicit VirtIOBlockController(PCI::DeviceIdentifier const&);
+
+    ErrorOr<void> initialize_controller();
+    ErrorOr<void> create_request_queue(u16 queue_index);
+
+    virtual StringView class_name() const override { return "VirtIOBlockDevice"sv; }
+    virtual bool handle_device_config_change() override;
+    virtual void handle_queue_update(u16 queue_index) override;
+
+    Optional<size_t> try_to_allocate_request_slot(u16 queue_index, AsyncBlockDeviceRequest&);
+    bool submit_request_in_slot(u16 queue_index, size_t slot_index);
+    void finish_completed_requests(u16 queue_index, u32 completed_slots);
+    void complete_request_in_slot(u16 queue_index, size_t slot_index, AsyncDeviceRequest::RequestResult);
+
+    RequestHeader& request_header(u16 queue_index, size_t slot_index);
+    u8 volatile& request_status(u16 queue_index, size_t slot_index);
+    PhysicalAddress request_header_address(u16 queue_index, size_t slot_index) const;
+
+    LockRefPtr<VirtIOBlockDevice> m_device;
+    Vector<RequestQueue> m_request_queues;
+    size_t m_request_slots_count { 0 };
+    size_t m_max_transfer_size { default_max_transfer_size };
+    size_t m_logical_block_size { 512 };
+    bool m_read_only { false };
+};
+
+}
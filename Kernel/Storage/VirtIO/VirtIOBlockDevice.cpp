@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Devices/DeviceManagement.h>
+#include <Kernel/Sections.h>
+#include <Kernel/Storage/VirtIO/VirtIOBlockDevice.h>
+
+namespace Kernel {
+
+UNMAP_AFTER_INIT ErrorOr<NonnullLockRefPtr<VirtIOBlockDevice>> VirtIOBlockDevice::try_create(VirtIOBlockController const& controller, size_t logical_block_size, u64 max_addressable_block)
+{
+    return TRY(DeviceManagement::try_create_device<VirtIOBlockDevice>(controller, logical_block_size, max_addressable_block));
+}
+
+UNMAP_AFTER_INIT VirtIOBlockDevice::VirtIOBlockDevice(VirtIOBlockController const& controller, size_t logical_block_size, u64 max_addressable_block)
+    : StorageDevice(LUNAddress { controller.controller_id(), 0, 0 }, controller.hardware_relative_controller_id(), logical_block_size, max_addressable_block)
+    , m_controller(controller)
+{
+}
+
+VirtIOBlockDevice::~VirtIOBlockDevice() = default;
+
+StringView VirtIOBlockDevice::class_name() const
+{
+    return "VirtIOBlockDevice"sv;
+}
+
+void VirtIOBlockDevice::start_request(AsyncBlockDeviceRequest& request)
+{
+    auto controller = m_controller.strong_ref();
+    VERIFY(controller);
+    controller->start_request(request);
+}
+
+size_t VirtIOBlockDevice::max_blocks_per_request() const
+{
+    auto controller = m_controller.strong_ref();
+    if (!controller)
+        return StorageDevice::max_blocks_per_request();
+    return max<size_t>(controller->max_transfer_size() / block_size(), 1);
+}
+
+size_t VirtIOBlockDevice::max_requests_in_flight() const
+{
+    auto controller = m_controller.strong_ref();
+    if (!controller)
+        return StorageDevice::max_requests_in_flight();
+    return max<size_t>(controller->max_requests_in_flight(), 1);
+}
+
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/Library/LockWeakPtr.h>
+#include <Kernel/Storage/StorageDevice.h>
+#include <Kernel/Storage/VirtIO/VirtIOBlockController.h>
+
+namespace Kernel {
+
+class VirtIOBlockDevice final : public StorageDevice {
+    friend class DeviceManagement;
+
+public:
+    static ErrorOr<NonnullLockRefPtr<VirtIOBlockDevice>> try_create(VirtIOBlockController const&, size_t logical_block_size, u64 max_addressable_block);
+    virtual ~VirtIOBlockDevice() override;
+
+    // ^BlockDevice
+    virtual void start_request(AsyncBlockDeviceRequest&) override;
+
+    // ^StorageDevice
+    virtual CommandSet command_set() const override { return CommandSet::VirtIO; }
+    virtual size_t max_blocks_per_request() const override;
+    virtual size_t max_requests_in_flight() const override;
+
+private:
+    VirtIOBlockDevice(VirtIOBlockController const&, size_t logical_block_size, u64 max_addressable_block);
+
+    // ^DiskDevice
+    virtual StringView class_name() const override;
+
+    LockWeakPtr<VirtIOBlockController> m_controller;
+};
+
+}
@@ -35,7 +35,8 @@ ErrorOr<FlatPtr> Process::sys$alarm(unsigned seconds)
         }
         auto timer_was_added = TimerQueue::the().add_timer_without_id(*m_alarm_timer, CLOCK_REALTIME_COARSE, deadline, [this]() {
             MUST(send_signal(SIGALRM, nullptr));
-        });
+        },
+            TimerQueue::default_slack(Time::from_seconds(seconds)));
         if (!timer_was_added)
             return ENOMEM;
     }
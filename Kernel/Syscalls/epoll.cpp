@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/ScopeGuard.h>
+#include <Kernel/FileSystem/EPoll.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+// Arbitrary limit on how many events a single wait hands back, the rest are picked up by the next one.
+static constexpr size_t max_events_per_wait = 1024;
+
+ErrorOr<FlatPtr> Process::sys$epoll_create(int flags)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::stdio));
+    if (flags & ~EPOLL_CLOEXEC)
+        return EINVAL;
+
+    auto epoll = TRY(EPoll::try_create());
+    auto description = TRY(OpenFileDescription::try_create(move(epoll)));
+    description->set_readable(true);
+
+    return m_fds.with_exclusive([&](auto& fds) -> ErrorOr<FlatPtr> {
+        auto fd_allocation = TRY(fds.allocate());
+        fds[fd_allocation.fd].set(move(description));
+
+        if (flags & EPOLL_CLOEXEC)
+            fds[fd_allocation.fd].set_flags(fds[fd_allocation.fd].flags() | FD_CLOEXEC);
+
+        return fd_allocation.fd;
+    });
+}
+
+ErrorOr<FlatPtr> Process::sys$epoll_ctl(int epfd, int op, int fd, Userspace<epoll_event const*> user_event)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::stdio));
+
+    auto epoll_description = TRY(open_file_description(epfd));
+    auto* epoll = epoll_description->epoll();
+    if (!epoll)
+        return EINVAL;
+
+    auto description = TRY(open_file_description(fd));
+    // NOTE: Nesting is not supported, so an EPoll can't watch itself or any other EPoll.
+    if (description->is_epoll())
+        return EINVAL;
+
+    switch (op) {
+    case EPOLL_CTL_ADD: {
+        auto event = TRY(copy_typed_from_user(user_event));
+        TRY(epoll->add_interest(fd, *description, event));
+        return 0;
+    }
+    case EPOLL_CTL_MOD: {
+        auto event = TRY(copy_typed_from_user(user_event));
+        TRY(epoll->modify_interest(fd, *description, event));
+        return 0;
+    }
+    case EPOLL_CTL_DEL:
+        TRY(epoll->remove_interest(fd, *description));
+        return 0;
+    default:
+        return EINVAL;
+    }
+}
+
+ErrorOr<FlatPtr> Process::sys$epoll_wait(Userspace<Syscall::SC_epoll_wait_params const*> user_params)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::stdio));
+
+    auto params = TRY(copy_typed_from_user(user_params));
+    if (params.maxevents <= 0)
+        return EINVAL;
+
+    bool should_block = true;
+    Thread::BlockTimeout timeout;
+    if (params.timeout) {
+        auto timeout_time = TRY(copy_time_from_user(params.timeout));
+        should_block = timeout_time > Time::zero();
+        timeout = Thread::BlockTimeout(false, &timeout_time);
+    }
+
+    sigset_t sigmask = {};
+    if (params.sigmask)
+        TRY(copy_from_user(&sigmask, params.sigmask));
+
+    auto epoll_description = TRY(open_file_description(params.epfd));
+    auto* epoll = epoll_description->epoll();
+    if (!epoll)
+        return EINVAL;
+
+    Vector<epoll_event, 32> events;
+    TRY(events.try_resize(min(static_cast<size_t>(params.maxevents), max_events_per_wait)));
+
+    auto* current_thread = Thread::current();
+
+    u32 previous_signal_mask = 0;
+    if (params.sigmask)
+        previous_signal_mask = current_thread->update_signal_mask(sigmask);
+    ScopeGuard rollback_signal_mask([&]() {
+        if (params.sigmask)
+            current_thread->update_signal_mask(previous_signal_mask);
+    });
+
+    for (;;) {
+        auto count = TRY(epoll->collect_ready_events(events.span()));
+        if (count > 0) {
+            TRY(copy_n_to_user(params.events, events.data(), count));
+            return count;
+        }
+        if (!should_block)
+            return 0;
+
+        // The EPoll is readable while its ready list is not empty, so we can simply wait for that.
+        auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+        auto result = current_thread->block<Thread::ReadBlocker>(timeout, *epoll_description, unblock_flags);
+        if (result.was_interrupted())
+            return EINTR;
+        if (result == Thread::BlockResult::InterruptedByTimeout)
+            return 0;
+    }
+}
+
+}
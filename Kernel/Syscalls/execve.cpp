@@ -573,6 +573,9 @@ ErrorOr<void> Process::do_exec(NonnullLockRefPtr<OpenFileDescription> main_progr
 
     m_space.with([&](auto& space) { space = load_result.space.release_nonnull(); });
 
+    // If we were vfork()ed, the old address space was borrowed from our parent, who can now continue.
+    release_vfork_parent();
+
     m_executable.with([&](auto& executable) { executable = main_program_description->custody(); });
     m_arguments = move(arguments);
     m_attached_jail.with([&](auto& jail) {
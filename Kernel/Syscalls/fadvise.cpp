@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Checked.h>
+#include <Kernel/FileSystem/Inode.h>
+#include <Kernel/FileSystem/InodeFile.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+// https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_fadvise.html
+ErrorOr<FlatPtr> Process::sys$posix_fadvise(int fd, Userspace<off_t const*> userspace_offset, Userspace<off_t const*> userspace_length, int advice)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::stdio));
+
+    auto offset = TRY(copy_typed_from_user(userspace_offset));
+    auto length = TRY(copy_typed_from_user(userspace_length));
+
+    // [EINVAL] The value of advice is invalid, or the value of len is less than zero.
+    if (offset < 0 || length < 0)
+        return EINVAL;
+    if (Checked<off_t>::addition_would_overflow(offset, length))
+        return EINVAL;
+
+    auto description = TRY(open_file_description(fd));
+
+    // [ESPIPE] The fd argument is associated with a pipe or FIFO.
+    if (description->is_fifo())
+        return ESPIPE;
+
+    switch (advice) {
+    case POSIX_FADV_NORMAL:
+        description->set_access_pattern(OpenFileDescription::AccessPattern::Normal);
+        return 0;
+    case POSIX_FADV_SEQUENTIAL:
+        description->set_access_pattern(OpenFileDescription::AccessPattern::Sequential);
+        return 0;
+    case POSIX_FADV_RANDOM:
+        description->set_access_pattern(OpenFileDescription::AccessPattern::Random);
+        return 0;
+    case POSIX_FADV_WILLNEED: {
+        if (!description->file().is_regular_file() || description->is_direct())
+            return 0;
+        VERIFY(description->file().is_inode());
+        auto& inode = static_cast<InodeFile&>(description->file()).inode();
+        // A length of zero means "until the end of the file".
+        auto size = inode.size();
+        if (static_cast<u64>(offset) >= size)
+            return 0;
+        auto end = length == 0 ? size : min(static_cast<u64>(offset + length), size);
+        inode.read_ahead(offset, end - offset);
+        return 0;
+    }
+    case POSIX_FADV_DONTNEED:
+    case POSIX_FADV_NOREUSE:
+        // FIXME: Use these to let go of cached blocks early.
+        return 0;
+    default:
+        return EINVAL;
+    }
+}
+
+}
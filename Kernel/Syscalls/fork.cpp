@@ -17,6 +17,34 @@ ErrorOr<FlatPtr> Process::sys$fork(RegisterState& regs)
 {
     VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
     TRY(require_promise(Pledge::proc));
+    auto child = TRY(fork_child(regs, ShareMemoryWithParent::No));
+    return child->pid().value();
+}
+
+ErrorOr<FlatPtr> Process::sys$vfork(RegisterState& regs)
+{
+    VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
+    TRY(require_promise(Pledge::proc));
+    auto child = TRY(fork_child(regs, ShareMemoryWithParent::Yes));
+
+    // The child runs on our memory (including this thread's stack), so we can't continue until it's done with it.
+    // NOTE: If the child exec()s or dies before we get to wait, the wake-up is remembered by the wait queue.
+    while (child->m_is_borrowing_parent_memory.load()) {
+        child->m_vfork_parent_wait_queue.wait_forever("vfork"sv);
+        if (Thread::current()->should_die())
+            break;
+    }
+    return child->pid().value();
+}
+
+void Process::release_vfork_parent()
+{
+    if (m_is_borrowing_parent_memory.exchange(false))
+        m_vfork_parent_wait_queue.wake_all();
+}
+
+ErrorOr<NonnullLockRefPtr<Process>> Process::fork_child(RegisterState& regs, ShareMemoryWithParent share_memory_with_parent)
+{
     LockRefPtr<Thread> child_first_thread;
 
     ArmedScopeGuard thread_finalizer_guard = [&child_first_thread]() {
@@ -137,8 +165,13 @@ ErrorOr<FlatPtr> Process::sys$fork(RegisterState& regs)
             child_space->set_enforces_syscall_regions(parent_space->enforces_syscall_regions());
             for (auto& region : parent_space->region_tree().regions()) {
                 dbgln_if(FORK_DEBUG, "fork: cloning Region '{}' @ {}", region.name(), region.vaddr());
-                auto region_clone = TRY(region.try_clone());
-                TRY(region_clone->map(child_space->page_directory(), Memory::ShouldFlushTLB::No));
+                auto region_clone = TRY(share_memory_with_parent == ShareMemoryWithParent::Yes ? region.try_clone_sharing_vmobject() : region.try_clone());
+                // NOTE: Anonymous and file-backed regions fault their pages into the child's page tables on first access.
+                //       Most children exec() soon anyway, so copying every page table entry up front is mostly wasted.
+                if (region_clone->vmobject().is_anonymous() || region_clone->vmobject().is_inode())
+                    region_clone->set_page_directory(child_space->page_directory());
+                else
+                    TRY(region_clone->map(child_space->page_directory(), Memory::ShouldFlushTLB::No));
                 TRY(child_space->region_tree().place_specifically(*region_clone, region.range()));
                 auto* child_region = region_clone.leak_ptr();
 
@@ -151,6 +184,9 @@ ErrorOr<FlatPtr> Process::sys$fork(RegisterState& regs)
 
     thread_finalizer_guard.disarm();
 
+    if (share_memory_with_parent == ShareMemoryWithParent::Yes)
+        child->m_is_borrowing_parent_memory.store(true);
+
     Process::register_new(*child);
 
     PerformanceManager::add_process_created_event(*child);
@@ -159,8 +195,6 @@ ErrorOr<FlatPtr> Process::sys$fork(RegisterState& regs)
     child_first_thread->set_affinity(Thread::current()->affinity());
     child_first_thread->set_state(Thread::State::Runnable);
 
-    auto child_pid = child->pid().value();
-
-    return child_pid;
+    return child;
 }
 }
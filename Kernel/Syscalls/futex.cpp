@@ -13,23 +13,34 @@
 
 namespace Kernel {
 
-static Singleton<SpinlockProtected<HashMap<GlobalFutexKey, NonnullLockRefPtr<FutexQueue>>, LockRank::None>> s_global_futex_queues;
+// Futex queues are spread over a number of buckets by their key, so that threads
+// using unrelated futexes don't all contend on the same lock.
+static constexpr size_t futex_bucket_count = 64;
+using FutexQueueBucket = SpinlockProtected<HashMap<GlobalFutexKey, NonnullLockRefPtr<FutexQueue>>, LockRank::None>;
+static Singleton<Array<FutexQueueBucket, futex_bucket_count>> s_futex_queue_buckets;
+
+static FutexQueueBucket& futex_queue_bucket(GlobalFutexKey const& futex_key)
+{
+    return (*s_futex_queue_buckets)[int_hash(Traits<GlobalFutexKey>::hash(futex_key)) % futex_bucket_count];
+}
 
 void Process::clear_futex_queues_on_exec()
 {
-    s_global_futex_queues->with([this](auto& queues) {
-        auto const* address_space = this->address_space().with([](auto& space) { return space.ptr(); });
-        queues.remove_all_matching([address_space](auto& futex_key, auto& futex_queue) {
-            if ((futex_key.raw.offset & futex_key_private_flag) == 0)
-                return false;
-            if (futex_key.private_.address_space != address_space)
-                return false;
-            bool did_wake_all;
-            futex_queue->wake_all(did_wake_all);
-            VERIFY(did_wake_all); // No one should be left behind...
-            return true;
+    auto const* address_space = this->address_space().with([](auto& space) { return space.ptr(); });
+    for (auto& bucket : *s_futex_queue_buckets) {
+        bucket.with([address_space](auto& queues) {
+            queues.remove_all_matching([address_space](auto& futex_key, auto& futex_queue) {
+                if ((futex_key.raw.offset & futex_key_private_flag) == 0)
+                    return false;
+                if (futex_key.private_.address_space != address_space)
+                    return false;
+                bool did_wake_all;
+                futex_queue->wake_all(did_wake_all);
+                VERIFY(did_wake_all); // No one should be left behind...
+                return true;
+            });
         });
-    });
+    }
 }
 
 ErrorOr<GlobalFutexKey> Process::get_futex_key(FlatPtr user_address, bool shared)
@@ -88,6 +99,30 @@ ErrorOr<GlobalFutexKey> Process::get_futex_key(FlatPtr user_address, bool shared
     });
 }
 
+// The owner of a priority inheritance futex is whoever userspace wrote into the futex word, so make sure
+// that it's a thread we could actually be sharing the futex with before lending it our priority.
+static ErrorOr<NonnullLockRefPtr<Thread>> find_pi_futex_owner(Process& process, ThreadID owner_tid, bool shared)
+{
+    auto owner = Thread::from_tid(owner_tid);
+    if (!owner)
+        return ESRCH;
+    auto& owner_process = owner->process();
+    if (&owner_process == &process)
+        return owner.release_nonnull();
+    if (!shared)
+        return ESRCH;
+    if (owner_process.is_kernel_process())
+        return EPERM;
+    bool is_in_same_jail = process.jail().with([&](auto const& my_jail) {
+        return owner_process.jail().with([&](auto const& their_jail) {
+            return my_jail.ptr() == their_jail.ptr();
+        });
+    });
+    if (!is_in_same_jail)
+        return ESRCH;
+    return owner.release_nonnull();
+}
+
 ErrorOr<FlatPtr> Process::sys$futex(Userspace<Syscall::SC_futex_params const*> user_params)
 {
     VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
@@ -97,7 +132,7 @@ ErrorOr<FlatPtr> Process::sys$futex(Userspace<Syscall::SC_futex_params const*> u
     u32 cmd = params.futex_op & FUTEX_CMD_MASK;
 
     bool use_realtime_clock = (params.futex_op & FUTEX_CLOCK_REALTIME) != 0;
-    if (use_realtime_clock && cmd != FUTEX_WAIT && cmd != FUTEX_WAIT_BITSET) {
+    if (use_realtime_clock && cmd != FUTEX_WAIT && cmd != FUTEX_WAIT_BITSET && cmd != FUTEX_LOCK_PI) {
         return ENOSYS;
     }
 
@@ -106,8 +141,8 @@ ErrorOr<FlatPtr> Process::sys$futex(Userspace<Syscall::SC_futex_params const*> u
     switch (cmd) {
     case FUTEX_WAIT:
     case FUTEX_WAIT_BITSET:
-    case FUTEX_REQUEUE:
-    case FUTEX_CMP_REQUEUE: {
+    case FUTEX_LOCK_PI: {
+        // NOTE: FUTEX_REQUEUE and FUTEX_CMP_REQUEUE use the timeout as val2 instead.
         if (params.timeout) {
             auto timeout_time = TRY(copy_time_from_user(params.timeout));
             bool is_absolute = cmd != FUTEX_WAIT;
@@ -126,28 +161,47 @@ ErrorOr<FlatPtr> Process::sys$futex(Userspace<Syscall::SC_futex_params const*> u
 
     auto find_futex_queue = [&](GlobalFutexKey futex_key, bool create_if_not_found, bool* did_create = nullptr) -> ErrorOr<LockRefPtr<FutexQueue>> {
         VERIFY(!create_if_not_found || did_create != nullptr);
-        return s_global_futex_queues->with([&](auto& queues) -> ErrorOr<LockRefPtr<FutexQueue>> {
+        // Waiting usually needs a new queue, so every thread keeps a spare one around instead of
+        // allocating one each time. It gets one back when a queue that nobody uses anymore is removed.
+        auto& spare_futex_queue = Thread::current()->spare_futex_queue();
+        if (create_if_not_found && !spare_futex_queue)
+            spare_futex_queue = TRY(adopt_nonnull_lock_ref_or_enomem(new (nothrow) FutexQueue));
+        return futex_queue_bucket(futex_key).with([&](auto& queues) -> ErrorOr<LockRefPtr<FutexQueue>> {
             auto it = queues.find(futex_key);
             if (it != queues.end())
                 return it->value;
             if (!create_if_not_found)
                 return nullptr;
             *did_create = true;
-            auto futex_queue = TRY(adopt_nonnull_lock_ref_or_enomem(new (nothrow) FutexQueue));
-            auto result = TRY(queues.try_set(futex_key, futex_queue));
-            VERIFY(result == AK::HashSetResult::InsertedNewEntry);
+            auto futex_queue = spare_futex_queue.release_nonnull();
+            auto result = queues.try_set(futex_key, futex_queue);
+            if (result.is_error()) {
+                spare_futex_queue = move(futex_queue);
+                return result.release_error();
+            }
+            VERIFY(result.value() == AK::HashSetResult::InsertedNewEntry);
             return futex_queue;
         });
     };
 
     auto remove_futex_queue = [&](GlobalFutexKey futex_key) {
-        return s_global_futex_queues->with([&](auto& queues) {
+        auto removed_queue = futex_queue_bucket(futex_key).with([&](auto& queues) -> LockRefPtr<FutexQueue> {
             auto it = queues.find(futex_key);
             if (it == queues.end())
-                return;
-            if (it->value->try_remove())
-                queues.remove(it);
+                return nullptr;
+            if (!it->value->try_remove())
+                return nullptr;
+            LockRefPtr<FutexQueue> futex_queue = it->value;
+            queues.remove(it);
+            return futex_queue;
         });
+        // If nobody else holds on to the queue, nobody can find it anymore either,
+        // so we can keep it for our next wait.
+        auto& spare_futex_queue = Thread::current()->spare_futex_queue();
+        if (removed_queue && removed_queue->ref_count() == 1 && !spare_futex_queue) {
+            removed_queue->prepare_for_reuse();
+            spare_futex_queue = move(removed_queue);
+        }
     };
 
     auto do_wake = [&](FlatPtr user_address, u32 count, Optional<u32> const& bitmask) -> ErrorOr<int> {
@@ -159,6 +213,7 @@ ErrorOr<FlatPtr> Process::sys$futex(Userspace<Syscall::SC_futex_params const*> u
             return 0;
         bool is_empty;
         u32 woke_count = futex_queue->wake_n(count, bitmask, is_empty);
+        futex_queue = nullptr;
         if (is_empty) {
             // If there are no more waiters, we want to get rid of the futex!
             remove_futex_queue(futex_key);
@@ -195,7 +250,9 @@ ErrorOr<FlatPtr> Process::sys$futex(Userspace<Syscall::SC_futex_params const*> u
 
         Thread::BlockResult block_result = futex_queue->wait_on(timeout, bitset);
 
-        if (futex_queue->is_empty_and_no_imminent_waits()) {
+        bool is_empty = futex_queue->is_empty_and_no_imminent_waits();
+        futex_queue = nullptr;
+        if (is_empty) {
             // If there are no more waiters, we want to get rid of the futex!
             remove_futex_queue(futex_key);
         }
@@ -218,26 +275,180 @@ ErrorOr<FlatPtr> Process::sys$futex(Userspace<Syscall::SC_futex_params const*> u
         if (!futex_queue)
             return 0;
 
+        // NOTE: The target queue has to be looked up before we take the lock of the source queue, as looking it up
+        //       takes a bucket lock, and removing a queue takes the bucket lock before the queue lock.
+        //       Our imminent wait keeps anyone from removing the target before we've moved the waiters over.
         LockRefPtr<FutexQueue> target_futex_queue;
-        bool is_empty = false;
-        bool is_target_empty = false;
         auto futex_key2 = TRY(get_futex_key(user_address2, shared));
-        auto woken_or_requeued = TRY(futex_queue->wake_n_requeue(
-            params.val, [&]() -> ErrorOr<FutexQueue*> {
-                // NOTE: futex_queue's lock is being held while this callback is called
-                // The reason we're doing this in a callback is that we don't want to always
-                // create a target queue, only if we actually have anything to move to it!
-                target_futex_queue = TRY(find_futex_queue(futex_key2, true));
-                return target_futex_queue.ptr();
-            },
-            params.val2, is_empty, is_target_empty));
+        if (params.val2 > 0) {
+            bool did_create;
+            do {
+                did_create = false;
+                target_futex_queue = TRY(find_futex_queue(futex_key2, true, &did_create));
+                VERIFY(target_futex_queue);
+            } while (!did_create && !target_futex_queue->queue_imminent_wait());
+        }
+
+        bool is_empty = false;
+        auto woken_or_requeued = futex_queue->wake_n_requeue(params.val, target_futex_queue.ptr(), params.val2, is_empty);
+        futex_queue = nullptr;
         if (is_empty)
             remove_futex_queue(futex_key);
-        if (is_target_empty && target_futex_queue)
-            remove_futex_queue(futex_key2);
+        if (target_futex_queue) {
+            target_futex_queue->cancel_imminent_wait();
+            bool is_target_empty = target_futex_queue->is_empty_and_no_imminent_waits();
+            target_futex_queue = nullptr;
+            if (is_target_empty)
+                remove_futex_queue(futex_key2);
+        }
         return woken_or_requeued;
     };
 
+    auto current_tid = static_cast<u32>(Thread::current()->tid().value());
+
+    // Tries to take an unowned priority inheritance futex, returns whether we own it now.
+    auto try_take_pi_futex = [&](u32& value) -> ErrorOr<bool> {
+        for (;;) {
+            if ((value & FUTEX_TID_MASK) != 0)
+                return false;
+            // Keep the waiters bit, so we go through the kernel when unlocking if there's anyone to hand it to.
+            auto did_exchange = user_atomic_compare_exchange_relaxed(params.userspace_address, value, current_tid | (value & FUTEX_WAITERS));
+            if (!did_exchange.has_value())
+                return EFAULT;
+            if (did_exchange.value()) {
+                atomic_thread_fence(AK::MemoryOrder::memory_order_acquire);
+                return true;
+            }
+        }
+    };
+
+    auto do_lock_pi = [&]() -> ErrorOr<FlatPtr> {
+        auto futex_key = TRY(get_futex_key(user_address, shared));
+        for (;;) {
+            bool did_create;
+            LockRefPtr<FutexQueue> futex_queue;
+            do {
+                did_create = false;
+                futex_queue = TRY(find_futex_queue(futex_key, true, &did_create));
+                VERIFY(futex_queue);
+            } while (!did_create && !futex_queue->queue_imminent_wait());
+
+            auto generation = futex_queue->pi_generation();
+            auto give_up_waiting = [&]() {
+                futex_queue->cancel_imminent_wait();
+                bool is_empty = futex_queue->is_empty_and_no_imminent_waits();
+                futex_queue = nullptr;
+                if (is_empty)
+                    remove_futex_queue(futex_key);
+            };
+
+            auto user_value = user_atomic_load_relaxed(params.userspace_address);
+            if (!user_value.has_value()) {
+                give_up_waiting();
+                return EFAULT;
+            }
+            u32 value = user_value.value();
+            auto took_futex = try_take_pi_futex(value);
+            if (took_futex.is_error()) {
+                give_up_waiting();
+                return took_futex.release_error();
+            }
+            if (took_futex.value()) {
+                give_up_waiting();
+                return 0;
+            }
+
+            auto owner_tid = value & FUTEX_TID_MASK;
+            if (owner_tid == current_tid) {
+                give_up_waiting();
+                return EDEADLK;
+            }
+            auto owner_or_error = find_pi_futex_owner(*this, owner_tid, shared);
+            if (owner_or_error.is_error()) {
+                give_up_waiting();
+                return owner_or_error.release_error();
+            }
+            LockRefPtr<Thread> owner = owner_or_error.release_value();
+            if (!(value & FUTEX_WAITERS)) {
+                // Make sure the owner comes to us when unlocking.
+                auto did_exchange = user_atomic_compare_exchange_relaxed(params.userspace_address, value, value | FUTEX_WAITERS);
+                if (!did_exchange.has_value()) {
+                    give_up_waiting();
+                    return EFAULT;
+                }
+                if (!did_exchange.value()) {
+                    give_up_waiting();
+                    continue;
+                }
+            }
+
+            futex_queue->lend_priority_to_pi_owner(*owner, Thread::current()->priority());
+            owner = nullptr;
+
+            auto block_result = futex_queue->wait_on_pi(timeout, generation);
+
+            bool is_empty = futex_queue->is_empty_and_no_imminent_waits();
+            futex_queue = nullptr;
+            if (is_empty)
+                remove_futex_queue(futex_key);
+
+            // The futex may have been handed to us even if we timed out or were interrupted.
+            user_value = user_atomic_load_relaxed(params.userspace_address);
+            if (!user_value.has_value())
+                return EFAULT;
+            if ((user_value.value() & FUTEX_TID_MASK) == current_tid) {
+                atomic_thread_fence(AK::MemoryOrder::memory_order_acquire);
+                return 0;
+            }
+            if (block_result == Thread::BlockResult::InterruptedByTimeout)
+                return ETIMEDOUT;
+            if (block_result.was_interrupted())
+                return EINTR;
+        }
+    };
+
+    auto do_trylock_pi = [&]() -> ErrorOr<FlatPtr> {
+        auto user_value = user_atomic_load_relaxed(params.userspace_address);
+        if (!user_value.has_value())
+            return EFAULT;
+        u32 value = user_value.value();
+        if (TRY(try_take_pi_futex(value)))
+            return 0;
+        if ((value & FUTEX_TID_MASK) == current_tid)
+            return EDEADLK;
+        return EAGAIN;
+    };
+
+    auto do_unlock_pi = [&]() -> ErrorOr<FlatPtr> {
+        atomic_thread_fence(AK::MemoryOrder::memory_order_release);
+        auto futex_key = TRY(get_futex_key(user_address, shared));
+        auto futex_queue = TRY(find_futex_queue(futex_key, false));
+        if (futex_queue) {
+            TRY(futex_queue->unlock_pi(params.userspace_address, Thread::current()->tid()));
+            bool is_empty = futex_queue->is_empty_and_no_imminent_waits();
+            futex_queue = nullptr;
+            if (is_empty)
+                remove_futex_queue(futex_key);
+            return 0;
+        }
+
+        // Nobody is waiting in the kernel, so simply release the futex.
+        auto user_value = user_atomic_load_relaxed(params.userspace_address);
+        for (;;) {
+            if (!user_value.has_value())
+                return EFAULT;
+            u32 value = user_value.value();
+            if ((value & FUTEX_TID_MASK) != current_tid)
+                return EPERM;
+            auto did_exchange = user_atomic_compare_exchange_relaxed(params.userspace_address, value, 0);
+            if (!did_exchange.has_value())
+                return EFAULT;
+            if (did_exchange.value())
+                return 0;
+            user_value = value;
+        }
+    };
+
     switch (cmd) {
     case FUTEX_WAIT:
         return do_wait(0);
@@ -313,6 +524,15 @@ ErrorOr<FlatPtr> Process::sys$futex(Userspace<Syscall::SC_futex_params const*> u
     case FUTEX_CMP_REQUEUE:
         return do_requeue(params.val3);
 
+    case FUTEX_LOCK_PI:
+        return do_lock_pi();
+
+    case FUTEX_TRYLOCK_PI:
+        return do_trylock_pi();
+
+    case FUTEX_UNLOCK_PI:
+        return do_unlock_pi();
+
     case FUTEX_WAIT_BITSET:
         VERIFY(params.val3 != FUTEX_BITSET_MATCH_ANY); // we should have turned it into FUTEX_WAIT
         if (params.val3 == 0)
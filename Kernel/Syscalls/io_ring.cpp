@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/API/IORing.h>
+#include <Kernel/FileSystem/IORing.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+ErrorOr<FlatPtr> Process::sys$io_ring_create(Userspace<IORingParams*> user_params)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::stdio));
+    auto params = TRY(copy_typed_from_user(user_params));
+    if (params.flags & ~IO_RING_CLOEXEC)
+        return EINVAL;
+
+    auto ring = TRY(IORing::try_create(*this, params.submission_entries));
+    params.submission_entries = ring->submission_entries();
+    params.completion_entries = ring->completion_entries();
+    params.mapping_size = ring->mapping_size();
+    TRY(copy_to_user(user_params, &params));
+
+    auto description = TRY(OpenFileDescription::try_create(move(ring)));
+    description->set_readable(true);
+    // NOTE: This is what allows the queues to be mapped writable, there's nothing to write() to.
+    description->set_writable(true);
+
+    return m_fds.with_exclusive([&](auto& fds) -> ErrorOr<FlatPtr> {
+        auto fd_allocation = TRY(fds.allocate());
+        fds[fd_allocation.fd].set(move(description));
+
+        if (params.flags & IO_RING_CLOEXEC)
+            fds[fd_allocation.fd].set_flags(fds[fd_allocation.fd].flags() | FD_CLOEXEC);
+
+        return fd_allocation.fd;
+    });
+}
+
+ErrorOr<FlatPtr> Process::sys$io_ring_enter(int fd, u32 to_submit, u32 min_complete)
+{
+    VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
+    TRY(require_promise(Pledge::stdio));
+
+    auto description = TRY(open_file_description(fd));
+    auto* ring = description->io_ring();
+    if (!ring)
+        return EINVAL;
+    return TRY(ring->enter(*description, to_submit, min_complete));
+}
+
+}
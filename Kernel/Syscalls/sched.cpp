@@ -105,7 +105,7 @@ ErrorOr<FlatPtr> Process::sys$scheduler_get_parameters(Userspace<Syscall::SC_sch
         if (!credentials->is_superuser() && credentials->euid() != peer_credentials->uid() && credentials->uid() != peer_credentials->uid())
             return EPERM;
 
-        priority = (int)peer->priority();
+        priority = (int)peer->base_priority();
     }
 
     parameters.parameters.sched_priority = priority;
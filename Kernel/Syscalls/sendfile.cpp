@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/NumericLimits.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/KBuffer.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+static constexpr size_t transfer_chunk_size = 64 * KiB;
+
+// Data that was taken out of a pipe or socket can't be put back, so once it has been
+// read it has to be written out in full, even if the destination is non-blocking.
+static ErrorOr<size_t> write_consumed_data(OpenFileDescription& description, UserOrKernelBuffer const& data, size_t nwritten, size_t size, Optional<off_t> offset)
+{
+    while (nwritten < size) {
+        if (!description.can_write()) {
+            auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+            if (Thread::current()->block<Thread::WriteBlocker>({}, description, unblock_flags).was_interrupted())
+                return EINTR;
+        }
+        auto nwritten_or_error = offset.has_value()
+            ? description.write(offset.value() + nwritten, data.offset(nwritten), size - nwritten)
+            : description.write(data.offset(nwritten), size - nwritten);
+        if (nwritten_or_error.is_error()) {
+            if (nwritten_or_error.error().code() == EAGAIN)
+                continue;
+            return nwritten_or_error.release_error();
+        }
+        nwritten += nwritten_or_error.value();
+    }
+    return nwritten;
+}
+
+ErrorOr<FlatPtr> Process::do_transfer(OpenFileDescription& in, Optional<off_t>& in_offset, OpenFileDescription& out, Optional<off_t>& out_offset, size_t count, bool nonblocking)
+{
+    // NOTE: The data makes a single trip through a kernel buffer instead of being copied
+    //       into userspace and back, and it is moved in large chunks to keep the number of
+    //       round trips through the file system and network layers low.
+    auto buffer = TRY(KBuffer::try_create_with_size("Transfer buffer"sv, min(count, transfer_chunk_size)));
+    auto kernel_buffer = UserOrKernelBuffer::for_kernel_buffer(buffer->data());
+    bool input_is_seekable = in.file().is_seekable();
+
+    size_t total_transferred = 0;
+    while (total_transferred < count) {
+        if (!in.can_read()) {
+            if (total_transferred > 0)
+                break;
+            if (nonblocking || !in.is_blocking())
+                return EAGAIN;
+            auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+            if (Thread::current()->block<Thread::ReadBlocker>({}, in, unblock_flags).was_interrupted())
+                return EINTR;
+            if (!has_flag(unblock_flags, Thread::FileBlocker::BlockFlags::Read))
+                return EAGAIN;
+        }
+        if (nonblocking && !out.can_write()) {
+            if (total_transferred > 0)
+                break;
+            return EAGAIN;
+        }
+
+        auto chunk_size = min(count - total_transferred, buffer->size());
+        auto nread_or_error = in_offset.has_value()
+            ? in.read(kernel_buffer, in_offset.value(), chunk_size)
+            : in.read(kernel_buffer, chunk_size);
+        if (nread_or_error.is_error()) {
+            if (total_transferred > 0)
+                break;
+            return nread_or_error.release_error();
+        }
+        auto nread = nread_or_error.value();
+        if (nread == 0)
+            break;
+
+        auto nwritten_or_error = do_write(out, kernel_buffer, nread, out_offset);
+        if (!input_is_seekable) {
+            if (nwritten_or_error.is_error() && nwritten_or_error.error().code() != EAGAIN) {
+                if (total_transferred > 0)
+                    return total_transferred;
+                return nwritten_or_error.release_error();
+            }
+            auto nwritten = nwritten_or_error.is_error() ? 0 : nwritten_or_error.value();
+            auto result = write_consumed_data(out, kernel_buffer, nwritten, nread, out_offset);
+            if (result.is_error()) {
+                if (total_transferred > 0)
+                    return total_transferred;
+                return result.release_error();
+            }
+            nwritten_or_error = result.value();
+        }
+
+        size_t nwritten = nwritten_or_error.is_error() ? 0 : nwritten_or_error.value();
+        if (in_offset.has_value())
+            in_offset.value() += nwritten;
+        if (out_offset.has_value())
+            out_offset.value() += nwritten;
+        total_transferred += nwritten;
+
+        if (nwritten < nread && !in_offset.has_value()) {
+            // Give back what we read but couldn't pass on, so the next read picks it up again.
+            if (auto result = in.seek(-static_cast<off_t>(nread - nwritten), SEEK_CUR); result.is_error()) {
+                if (total_transferred > 0)
+                    break;
+                return result.release_error();
+            }
+        }
+        if (nwritten_or_error.is_error()) {
+            if (total_transferred > 0)
+                break;
+            return nwritten_or_error.release_error();
+        }
+        if (nwritten < nread)
+            break;
+    }
+    return total_transferred;
+}
+
+// NOTE: The offset is passed by pointer because off_t is 64bit,
+// hence it can't be passed by register on 32bit platforms.
+ErrorOr<FlatPtr> Process::sys$sendfile(int out_fd, int in_fd, Userspace<off_t*> userspace_offset, size_t count)
+{
+    VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
+    TRY(require_promise(Pledge::stdio));
+    if (count == 0)
+        return 0;
+    if (count > NumericLimits<ssize_t>::max())
+        return EINVAL;
+
+    auto in_description = TRY(open_file_description(in_fd));
+    auto out_description = TRY(open_file_description(out_fd));
+    if (!in_description->is_readable() || !out_description->is_writable())
+        return EBADF;
+    if (in_description->is_directory())
+        return EISDIR;
+    // The source has to be something that can be read at an arbitrary offset, e.g. a regular file.
+    if (!in_description->file().is_seekable())
+        return EINVAL;
+
+    Optional<off_t> in_offset;
+    if (userspace_offset) {
+        auto offset = TRY(copy_typed_from_user(userspace_offset));
+        if (offset < 0)
+            return EINVAL;
+        in_offset = offset;
+    }
+
+    Optional<off_t> out_offset;
+    auto nsent = TRY(do_transfer(*in_description, in_offset, *out_description, out_offset, count, false));
+    if (in_offset.has_value())
+        TRY(copy_to_user(userspace_offset, &in_offset.value()));
+    return nsent;
+}
+
+static ErrorOr<Optional<off_t>> copy_splice_offset_from_user(OpenFileDescription& description, Userspace<off_t*> userspace_offset)
+{
+    if (!userspace_offset)
+        return Optional<off_t> {};
+    if (description.is_fifo())
+        return ESPIPE;
+    if (!description.file().is_seekable())
+        return EINVAL;
+    auto offset = TRY(copy_typed_from_user(userspace_offset));
+    if (offset < 0)
+        return EINVAL;
+    return Optional<off_t> { offset };
+}
+
+ErrorOr<FlatPtr> Process::sys$splice(Userspace<Syscall::SC_splice_params const*> user_params)
+{
+    VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
+    TRY(require_promise(Pledge::stdio));
+    auto params = TRY(copy_typed_from_user(user_params));
+
+    // NOTE: SPLICE_F_MOVE and SPLICE_F_MORE are only hints, and are ignored for now.
+    if (params.flags & ~(SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE))
+        return EINVAL;
+    if (params.length == 0)
+        return 0;
+    if (params.length > NumericLimits<ssize_t>::max())
+        return EINVAL;
+
+    auto in_description = TRY(open_file_description(params.fd_in));
+    auto out_description = TRY(open_file_description(params.fd_out));
+    if (!in_description->is_readable() || !out_description->is_writable())
+        return EBADF;
+    // At least one end of the transfer has to be a pipe, and it can't be spliced into itself.
+    if (!in_description->is_fifo() && !out_description->is_fifo())
+        return EINVAL;
+    if (&in_description->file() == &out_description->file())
+        return EINVAL;
+    if (in_description->is_directory() || out_description->is_directory())
+        return EINVAL;
+
+    Userspace<off_t*> userspace_in_offset((FlatPtr)params.off_in);
+    Userspace<off_t*> userspace_out_offset((FlatPtr)params.off_out);
+    auto in_offset = TRY(copy_splice_offset_from_user(*in_description, userspace_in_offset));
+    auto out_offset = TRY(copy_splice_offset_from_user(*out_description, userspace_out_offset));
+
+    auto ntransferred = TRY(do_transfer(*in_description, in_offset, *out_description, out_offset, params.length, params.flags & SPLICE_F_NONBLOCK));
+    if (in_offset.has_value())
+        TRY(copy_to_user(userspace_in_offset, &in_offset.value()));
+    if (out_offset.has_value())
+        TRY(copy_to_user(userspace_out_offset, &out_offset.value()));
+    return ntransferred;
+}
+
+}
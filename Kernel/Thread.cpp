@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/BuiltinWrappers.h>
 #include <AK/ScopeGuard.h>
 #include <AK/Singleton.h>
 #include <AK/StringBuilder.h>
@@ -21,13 +22,14 @@
 #include <Kernel/Memory/MemoryManager.h>
 #include <Kernel/Memory/ScopedAddressSpaceSwitcher.h>
 #include <Kernel/Panic.h>
-#include <Kernel/PerformanceEventBuffer.h>
+#include <Kernel/PerformanceManager.h>
 #include <Kernel/Process.h>
 #include <Kernel/ProcessExposed.h>
 #include <Kernel/Scheduler.h>
 #include <Kernel/Sections.h>
 #include <Kernel/Thread.h>
 #include <Kernel/ThreadTracer.h>
+#include <Kernel/Time/TimeManagement.h>
 #include <Kernel/TimerQueue.h>
 #include <Kernel/kstdio.h>
 
@@ -104,6 +106,55 @@ Thread::~Thread()
     VERIFY(m_runnable_priority < 0);
 }
 
+static OffCPUReason off_cpu_reason_for(Thread::Blocker& blocker)
+{
+    switch (blocker.blocker_type()) {
+    case Thread::Blocker::Type::File:
+    case Thread::Blocker::Type::Plan9FS:
+    case Thread::Blocker::Type::Routing:
+        return OffCPUReason::IO;
+    case Thread::Blocker::Type::Futex:
+    case Thread::Blocker::Type::Flock:
+        return OffCPUReason::Lock;
+    case Thread::Blocker::Type::Sleep:
+        return OffCPUReason::Sleep;
+    case Thread::Blocker::Type::Queue:
+        if (static_cast<Thread::WaitQueueBlocker&>(blocker).is_waiting_for_io())
+            return OffCPUReason::IO;
+        return OffCPUReason::Other;
+    default:
+        return OffCPUReason::Other;
+    }
+}
+
+void Thread::start_off_cpu_interval_if_profiling()
+{
+    VERIFY(g_scheduler_lock.is_locked_by_current_processor());
+    // NOTE: Relocking the big lock may block again before the outer block has ended, that time belongs to the outer interval.
+    if (m_off_cpu_interval_depth++ > 0)
+        return;
+    // NOTE: Reading the clock isn't free, so this is only timed while someone is profiling it.
+    if (!PerformanceManager::is_tracing_off_cpu(*this))
+        return;
+    m_off_cpu_blocked_at = TimeManagement::the().monotonic_time();
+    m_off_cpu_woken_at.clear();
+}
+
+void Thread::end_off_cpu_interval(OffCPUReason reason, StringView blocker)
+{
+    VERIFY(m_off_cpu_interval_depth > 0);
+    if (--m_off_cpu_interval_depth > 0)
+        return;
+    if (!m_off_cpu_blocked_at.has_value())
+        return;
+    auto now = TimeManagement::the().monotonic_time();
+    auto blocked_at = m_off_cpu_blocked_at.release_value();
+    // If nobody woke us up through set_state(), we were only stopped and resumed, count that as blocked time.
+    auto woken_at = m_off_cpu_woken_at.value_or(now);
+    m_off_cpu_woken_at.clear();
+    PerformanceManager::add_off_cpu_event(*this, reason, blocker, woken_at - blocked_at, now - woken_at);
+}
+
 Thread::BlockResult Thread::block_impl(BlockTimeout const& timeout, Blocker& blocker)
 {
     VERIFY(!Processor::current_in_irq());
@@ -146,6 +197,7 @@ Thread::BlockResult Thread::block_impl(BlockTimeout const& timeout, Blocker& blo
     if (auto& block_timeout = blocker.override_timeout(timeout); !block_timeout.is_infinite()) {
         // Process::kill_all_threads may be called at any time, which will mark all
         // threads to die. In that case
+        auto slack = TimerQueue::default_slack(block_timeout.absolute_time() - *block_timeout.start_time());
         timer_was_added = TimerQueue::the().add_timer_without_id(*m_block_timer, block_timeout.clock_id(), block_timeout.absolute_time(), [&]() {
             VERIFY(!Processor::current_in_irq());
             VERIFY(!g_scheduler_lock.is_locked_by_current_processor());
@@ -155,7 +207,8 @@ Thread::BlockResult Thread::block_impl(BlockTimeout const& timeout, Blocker& blo
             SpinlockLocker block_lock(m_block_lock);
             if (m_blocker && !timeout_unblocked.exchange(true))
                 unblock();
-        });
+        },
+            slack);
         if (!timer_was_added) {
             // Timeout is already in the past
             blocker.will_unblock_immediately_without_blocking(Blocker::UnblockImmediatelyReason::TimeoutInThePast);
@@ -166,6 +219,7 @@ Thread::BlockResult Thread::block_impl(BlockTimeout const& timeout, Blocker& blo
 
     blocker.begin_blocking({});
 
+    start_off_cpu_interval_if_profiling();
     set_state(Thread::State::Blocked);
 
     block_lock.unlock();
@@ -201,6 +255,8 @@ Thread::BlockResult Thread::block_impl(BlockTimeout const& timeout, Blocker& blo
         break;
     }
 
+    end_off_cpu_interval(off_cpu_reason_for(blocker), blocker.state_string());
+
     // Notify the blocker that we are no longer blocking. It may need
     // to clean up now while we're still holding m_lock
     auto result = blocker.end_blocking({}, did_timeout); // calls was_unblocked internally
@@ -249,6 +305,7 @@ void Thread::block(Kernel::Mutex& lock, SpinlockLocker<Spinlock<LockRank::None>>
     m_blocking_mutex = &lock;
     m_lock_requested_count = lock_count;
 
+    start_off_cpu_interval_if_profiling();
     set_state(Thread::State::Blocked);
 
     block_lock.unlock();
@@ -280,6 +337,8 @@ void Thread::block(Kernel::Mutex& lock, SpinlockLocker<Spinlock<LockRank::None>>
         break;
     }
 
+    end_off_cpu_interval(OffCPUReason::Lock, lock.name());
+
     lock_lock.lock();
 }
 
@@ -1228,6 +1287,23 @@ ErrorOr<NonnullLockRefPtr<Thread>> Thread::try_clone(Process& process)
     return clone;
 }
 
+u32 Thread::preferred_cpu() const
+{
+    // Prefer the processor that last ran this thread, as its caches are most
+    // likely to still be warm. Idle processors will steal the thread if that
+    // processor happens to be busy.
+    auto processor_count = min(Processor::count(), static_cast<u32>(sizeof(m_cpu_affinity) * 8));
+    auto last_cpu = cpu();
+    if (last_cpu < processor_count && (m_cpu_affinity & (1u << last_cpu)))
+        return last_cpu;
+
+    u32 online_mask = processor_count < sizeof(m_cpu_affinity) * 8 ? (1u << processor_count) - 1 : ~0u;
+    auto allowed_mask = m_cpu_affinity & online_mask;
+    if (allowed_mask == 0)
+        return 0;
+    return bit_scan_forward(allowed_mask) - 1;
+}
+
 void Thread::set_state(State new_state, u8 stop_signal)
 {
     State previous_state;
@@ -1249,6 +1325,11 @@ void Thread::set_state(State new_state, u8 stop_signal)
         dbgln_if(THREAD_DEBUG, "Set thread {} state to {}", *this, state_string());
     }
 
+    m_process->did_change_statistics();
+
+    if (previous_state == Thread::State::Blocked && new_state == Thread::State::Runnable && m_off_cpu_blocked_at.has_value())
+        m_off_cpu_woken_at = TimeManagement::the().monotonic_time();
+
     if (previous_state == Thread::State::Runnable) {
         Scheduler::dequeue_runnable_thread(*this);
     } else if (previous_state == Thread::State::Stopped) {
@@ -1411,6 +1492,35 @@ LockRefPtr<Thread> Thread::from_tid(ThreadID tid)
     });
 }
 
+void Thread::begin_priority_inheritance(u32 priority)
+{
+    SpinlockLocker lock(g_scheduler_lock);
+    ++m_priority_inheritance_count;
+    raise_inherited_priority(priority);
+}
+
+void Thread::raise_inherited_priority(u32 priority)
+{
+    SpinlockLocker lock(g_scheduler_lock);
+    if (priority <= m_inherited_priority)
+        return;
+    m_inherited_priority = priority;
+    // Move us to the ready queue for our new priority if we're waiting to be scheduled.
+    if (Scheduler::dequeue_runnable_thread(*this))
+        Scheduler::enqueue_runnable_thread(*this);
+}
+
+void Thread::end_priority_inheritance()
+{
+    SpinlockLocker lock(g_scheduler_lock);
+    VERIFY(m_priority_inheritance_count > 0);
+    if (--m_priority_inheritance_count > 0)
+        return;
+    m_inherited_priority = 0;
+    if (Scheduler::dequeue_runnable_thread(*this))
+        Scheduler::enqueue_runnable_thread(*this);
+}
+
 void Thread::reset_fpu_state()
 {
     memcpy(&m_fpu_state, &Processor::clean_fpu_state(), sizeof(FPUState));
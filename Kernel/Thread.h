@@ -36,6 +36,7 @@
 namespace Kernel {
 
 class Timer;
+enum class OffCPUReason : u8;
 
 enum class DispatchSignalResult {
     Deferred = 0,
@@ -60,6 +61,7 @@ class Thread
     friend class Process;
     friend class Scheduler;
     friend struct ThreadReadyQueue;
+    friend struct ThreadReadyQueues;
 
 public:
     static Thread* current()
@@ -77,7 +79,19 @@ public:
     ProcessID pid() const;
 
     void set_priority(u32 p) { m_priority = p; }
-    u32 priority() const { return m_priority; }
+    // The priority the scheduler uses, which may have been raised by threads waiting for us.
+    u32 priority() const { return max(m_priority, m_inherited_priority); }
+    u32 base_priority() const { return m_priority; }
+
+    // Priority inheritance, see FutexQueue. Every priority inheritance futex that lends
+    // us its waiters' priority begins once, and ends once we release it. We keep the
+    // highest priority we were lent until we released all of them.
+    void begin_priority_inheritance(u32 priority);
+    void raise_inherited_priority(u32 priority);
+    void end_priority_inheritance();
+
+    // A FutexQueue that a futex wait can use instead of allocating a new one.
+    LockRefPtr<FutexQueue>& spare_futex_queue() { return m_spare_futex_queue; }
 
     void detach()
     {
@@ -408,6 +422,14 @@ public:
             blockers_to_append.clear();
         }
 
+        template<typename Callback>
+        void for_each_blocker_locked(Callback callback) const
+        {
+            VERIFY(m_lock.is_locked());
+            for (auto& info : m_blockers)
+                callback(*info.blocker, info.data);
+        }
+
         // FIXME: Check whether this can be Thread.
         mutable Spinlock<LockRank::None> m_lock {};
 
@@ -437,25 +459,33 @@ public:
 
     class WaitQueueBlocker final : public Blocker {
     public:
-        explicit WaitQueueBlocker(WaitQueue&, StringView block_reason = {});
+        enum class IsWaitingForIO {
+            No,
+            Yes,
+        };
+
+        explicit WaitQueueBlocker(WaitQueue&, StringView block_reason = {}, IsWaitingForIO = IsWaitingForIO::No);
         virtual ~WaitQueueBlocker();
 
         virtual Type blocker_type() const override { return Type::Queue; }
-        virtual StringView state_string() const override { return m_block_reason.is_null() ? m_block_reason : "Queue"sv; }
+        virtual StringView state_string() const override { return m_block_reason.is_null() ? "Queue"sv : m_block_reason; }
         virtual void will_unblock_immediately_without_blocking(UnblockImmediatelyReason) override { }
         virtual bool setup_blocker() override;
 
+        bool is_waiting_for_io() const { return m_is_waiting_for_io == IsWaitingForIO::Yes; }
+
         bool unblock();
 
     protected:
         WaitQueue& m_wait_queue;
         StringView m_block_reason;
+        IsWaitingForIO m_is_waiting_for_io { IsWaitingForIO::No };
         bool m_did_unblock { false };
     };
 
     class FutexBlocker final : public Blocker {
     public:
-        explicit FutexBlocker(FutexQueue&, u32);
+        FutexBlocker(FutexQueue&, u32, Optional<u32> pi_generation = {});
         virtual ~FutexBlocker();
 
         virtual Type blocker_type() const override { return Type::Futex; }
@@ -464,6 +494,8 @@ public:
         virtual bool setup_blocker() override;
 
         u32 bitset() const { return m_bitset; }
+        bool is_waiting_for_pi_owner() const { return m_pi_generation.has_value(); }
+        Optional<u32> pi_generation() const { return m_pi_generation; }
 
         void begin_requeue()
         {
@@ -478,6 +510,7 @@ public:
     protected:
         FutexQueue& m_futex_queue;
         u32 m_bitset { 0 };
+        Optional<u32> m_pi_generation;
         InterruptsState m_previous_interrupts_state { InterruptsState::Disabled };
         bool m_did_unblock { false };
     };
@@ -770,6 +803,7 @@ public:
     void set_cpu(u32 cpu) { m_cpu.store(cpu, AK::MemoryOrder::memory_order_release); }
     u32 affinity() const { return m_cpu_affinity; }
     void set_affinity(u32 affinity) { m_cpu_affinity = affinity; }
+    u32 preferred_cpu() const;
 
     RegisterState& get_register_dump_from_stack();
     RegisterState const& get_register_dump_from_stack() const { return const_cast<Thread*>(this)->get_register_dump_from_stack(); }
@@ -1089,6 +1123,7 @@ private:
 
     IntrusiveListNode<Thread> m_process_thread_list_node;
     int m_runnable_priority { -1 };
+    u32 m_runnable_cpu { 0 };
 
     friend class WaitQueue;
 
@@ -1223,6 +1258,9 @@ private:
     State m_state { Thread::State::Invalid };
     SpinlockProtected<NonnullOwnPtr<KString>, LockRank::None> m_name;
     u32 m_priority { THREAD_PRIORITY_NORMAL };
+    u32 m_inherited_priority { 0 };
+    u32 m_priority_inheritance_count { 0 };
+    LockRefPtr<FutexQueue> m_spare_futex_queue;
 
     State m_stop_state { Thread::State::Invalid };
 
@@ -1239,6 +1277,14 @@ private:
 
     bool m_is_profiling_suppressed { false };
 
+    // Only set while the time this thread spends off-CPU is being profiled.
+    Optional<Time> m_off_cpu_blocked_at;
+    Optional<Time> m_off_cpu_woken_at;
+    u32 m_off_cpu_interval_depth { 0 };
+
+    void start_off_cpu_interval_if_profiling();
+    void end_off_cpu_interval(OffCPUReason, StringView blocker);
+
     void yield_and_release_relock_big_lock();
 
     enum class VerifyLockNotHeld {
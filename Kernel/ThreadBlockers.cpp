@@ -120,9 +120,10 @@ bool Thread::JoinBlocker::unblock(void* value, bool from_add_blocker)
     return true;
 }
 
-Thread::WaitQueueBlocker::WaitQueueBlocker(WaitQueue& wait_queue, StringView block_reason)
+Thread::WaitQueueBlocker::WaitQueueBlocker(WaitQueue& wait_queue, StringView block_reason, IsWaitingForIO is_waiting_for_io)
     : m_wait_queue(wait_queue)
     , m_block_reason(block_reason)
+    , m_is_waiting_for_io(is_waiting_for_io)
 {
 }
 
@@ -146,9 +147,10 @@ bool Thread::WaitQueueBlocker::unblock()
     return true;
 }
 
-Thread::FutexBlocker::FutexBlocker(FutexQueue& futex_queue, u32 bitset)
+Thread::FutexBlocker::FutexBlocker(FutexQueue& futex_queue, u32 bitset, Optional<u32> pi_generation)
     : m_futex_queue(futex_queue)
     , m_bitset(bitset)
+    , m_pi_generation(pi_generation)
 {
 }
 
@@ -103,10 +103,14 @@ bool TimeManagement::is_system_timer(HardwareTimerBase const& timer) const
 
 void TimeManagement::set_epoch_time(Time ts)
 {
-    InterruptDisabler disabler;
-    // FIXME: Should use AK::Time internally
-    m_epoch_time = ts.to_timespec();
-    m_remaining_epoch_time_adjustment = { 0, 0 };
+    {
+        InterruptDisabler disabler;
+        // FIXME: Should use AK::Time internally
+        m_epoch_time = ts.to_timespec();
+        m_remaining_epoch_time_adjustment = { 0, 0 };
+    }
+    // Realtime timers were put on the timer wheels according to the old time.
+    TimerQueue::the().realtime_clock_was_changed();
 }
 
 Time TimeManagement::monotonic_time(TimePrecision precision) const
@@ -196,6 +200,7 @@ UNMAP_AFTER_INIT void TimeManagement::initialize([[maybe_unused]] u32 cpu)
             dmesgln("Time: Enable APIC timer on CPU #{}", cpu);
             apic_timer->enable_local_timer();
         }
+        TimerQueue::the().initialize_processor(cpu);
     }
 #elif ARCH(AARCH64)
     if (cpu == 0) {
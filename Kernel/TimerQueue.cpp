@@ -14,7 +14,6 @@
 namespace Kernel {
 
 static Singleton<TimerQueue> s_the;
-static Spinlock<LockRank::None> g_timerqueue_lock {};
 
 Time Timer::remaining() const
 {
@@ -52,10 +51,63 @@ TimerQueue& TimerQueue::the()
 
 UNMAP_AFTER_INIT TimerQueue::TimerQueue()
 {
-    m_ticks_per_second = TimeManagement::the().ticks_per_second();
+    // NOTE: Timers may be added before the other processors have been started,
+    //       those end up on the wheel of the bootstrap processor.
+    auto* wheel = new Wheel;
+    wheel->current_tick = TimeManagement::the().monotonic_time().to_nanoseconds() / nanoseconds_per_tick;
+    m_wheels[0] = wheel;
 }
 
-bool TimerQueue::add_timer_without_id(NonnullLockRefPtr<Timer> timer, clockid_t clock_id, Time const& deadline, Function<void()>&& callback)
+UNMAP_AFTER_INIT void TimerQueue::initialize_processor(u32 cpu)
+{
+    if (cpu == 0 || this->wheel(cpu))
+        return;
+    auto* wheel = new Wheel;
+    wheel->current_tick = TimeManagement::the().monotonic_time().to_nanoseconds() / nanoseconds_per_tick;
+    AK::atomic_store(&m_wheels[cpu], wheel, AK::memory_order_release);
+}
+
+Time TimerQueue::default_slack(Time const& timeout)
+{
+    // Allow timers to expire about 0.4% late, but never more than 100ms.
+    auto slack_ns = clamp<i64>(timeout.to_nanoseconds() / 256, 0, 100'000'000);
+    return Time::from_nanoseconds(slack_ns);
+}
+
+TimerQueue::Wheel& TimerQueue::wheel_for_current_processor(u32& index)
+{
+    index = Processor::current_id();
+    if (auto* wheel = this->wheel(index))
+        return *wheel;
+    index = 0;
+    return *this->wheel(0);
+}
+
+u64 TimerQueue::expiration_tick(Timer const& timer) const
+{
+    // Realtime timers are put on the wheel according to how far away their deadline
+    // currently is. If the clock is changed, realtime_clock_was_changed() moves them.
+    auto deadline = timer.m_expires + timer.m_slack;
+    auto now_monotonic = TimeManagement::the().monotonic_time(TimePrecision::Coarse);
+    if (timer.is_realtime())
+        deadline = deadline - timer.now(false) + now_monotonic;
+    if (deadline <= now_monotonic)
+        return 0;
+
+    // A timer expires on the first tick *after* its deadline, just like we
+    // only ever fire timers whose deadline has passed.
+    auto earliest_tick = (deadline - timer.m_slack).to_nanoseconds() / nanoseconds_per_tick + 1;
+    auto latest_tick = deadline.to_nanoseconds() / nanoseconds_per_tick + 1;
+
+    // Round the tick up to the largest power of two that still fits into the slack,
+    // so timers with similar deadlines end up expiring together.
+    u64 granularity = 1;
+    while (granularity * 2 <= static_cast<u64>(latest_tick - earliest_tick))
+        granularity *= 2;
+    return align_up_to(static_cast<u64>(earliest_tick), granularity);
+}
+
+bool TimerQueue::add_timer_without_id(NonnullLockRefPtr<Timer> timer, clockid_t clock_id, Time const& deadline, Function<void()>&& callback, Time slack)
 {
     if (deadline <= TimeManagement::the().current_time(clock_id))
         return false;
@@ -65,9 +117,8 @@ bool TimerQueue::add_timer_without_id(NonnullLockRefPtr<Timer> timer, clockid_t
     // *must* be a LockRefPtr<Timer>. Otherwise, calling cancel_timer() could
     // inadvertently cancel another timer that has been created between
     // returning from the timer handler and a call to cancel_timer().
-    timer->setup(clock_id, deadline, move(callback));
+    timer->setup(clock_id, deadline, move(callback), slack);
 
-    SpinlockLocker lock(g_timerqueue_lock);
     timer->m_id = 0; // Don't generate a timer id
     add_timer_locked(move(timer));
     return true;
@@ -75,9 +126,7 @@ bool TimerQueue::add_timer_without_id(NonnullLockRefPtr<Timer> timer, clockid_t
 
 TimerId TimerQueue::add_timer(NonnullLockRefPtr<Timer>&& timer)
 {
-    SpinlockLocker lock(g_timerqueue_lock);
-
-    timer->m_id = ++m_timer_id_count;
+    timer->m_id = m_timer_id_count.fetch_add(1, AK::memory_order_relaxed) + 1;
     VERIFY(timer->m_id != 0); // wrapped
     auto id = timer->m_id;
     add_timer_locked(move(timer));
@@ -86,33 +135,40 @@ TimerId TimerQueue::add_timer(NonnullLockRefPtr<Timer>&& timer)
 
 void TimerQueue::add_timer_locked(NonnullLockRefPtr<Timer> timer)
 {
-    Time timer_expiration = timer->m_expires;
-
     timer->clear_cancelled();
     timer->clear_callback_finished();
     timer->set_in_use();
-
-    auto& queue = queue_for_timer(*timer);
-    if (queue.list.is_empty()) {
-        queue.list.append(timer.leak_ref());
-        queue.next_timer_due = timer_expiration;
-    } else {
-        Timer* following_timer = nullptr;
-        for (auto& t : queue.list) {
-            if (t.m_expires > timer_expiration) {
-                following_timer = &t;
-                break;
-            }
-        }
-        if (following_timer) {
-            bool next_timer_needs_update = queue.list.first() == following_timer;
-            queue.list.insert_before(*following_timer, timer.leak_ref());
-            if (next_timer_needs_update)
-                queue.next_timer_due = timer_expiration;
-        } else {
-            queue.list.append(timer.leak_ref());
-        }
+    timer->m_expiration_tick = expiration_tick(*timer);
+
+    u32 index = 0;
+    auto& wheel = wheel_for_current_processor(index);
+    SpinlockLocker lock(wheel.lock);
+    timer->m_wheel_index = index;
+    timer->m_is_executing = false;
+    if (wheel.timer_count.load(AK::memory_order_relaxed) == 0) {
+        // Nobody advances an empty wheel, so catch up before we work out the slot.
+        auto now_tick = static_cast<u64>(TimeManagement::the().monotonic_time(TimePrecision::Coarse).to_nanoseconds() / nanoseconds_per_tick);
+        wheel.current_tick = max(wheel.current_tick, now_tick);
     }
+    wheel.timer_count.fetch_add(1, AK::memory_order_relaxed);
+    add_to_wheel_locked(wheel, timer.leak_ref());
+}
+
+void TimerQueue::add_to_wheel_locked(Wheel& wheel, Timer& timer)
+{
+    VERIFY(wheel.lock.is_locked());
+
+    // Timers that are already due expire on the next tick, and ones that are too far in
+    // the future for the wheel are put into the last slot they can reach and cascaded
+    // down once the wheel gets there.
+    auto tick = clamp(timer.m_expiration_tick, wheel.current_tick, wheel.current_tick + Wheel::maximum_ticks_ahead);
+    auto ticks_ahead = tick - wheel.current_tick;
+
+    size_t level = 0;
+    while (level < Wheel::level_count - 1 && ticks_ahead >= (1ull << (Wheel::bits_per_level * (level + 1))))
+        ++level;
+    auto slot = (tick >> (Wheel::bits_per_level * level)) & (Wheel::slots_per_level - 1);
+    wheel.levels[level][slot].append(timer);
 }
 
 bool TimerQueue::cancel_timer(Timer& timer, bool* was_in_use)
@@ -128,25 +184,26 @@ bool TimerQueue::cancel_timer(Timer& timer, bool* was_in_use)
     }
 
     bool did_already_run = timer.set_cancelled();
-    auto& timer_queue = queue_for_timer(timer);
     if (!did_already_run) {
         timer.clear_in_use();
 
-        SpinlockLocker lock(g_timerqueue_lock);
-        if (timer_queue.list.contains(timer)) {
+        auto& wheel = *this->wheel(timer.m_wheel_index);
+        SpinlockLocker lock(wheel.lock);
+        if (!timer.m_is_executing) {
             // The timer has not fired, remove it
+            VERIFY(timer.is_queued());
             VERIFY(timer.ref_count() > 1);
-            remove_timer_locked(timer_queue, timer);
+            remove_timer_locked(wheel, timer);
             return true;
         }
 
         // The timer was queued to execute but hasn't had a chance
-        // to run. In this case, it should still be in m_timers_executing
-        // and we don't need to spin. It still holds a reference
+        // to run. In this case, it should still be in the executing
+        // list and we don't need to spin. It still holds a reference
         // that will be dropped when it does get a chance to run,
         // but since we called set_cancelled it will only drop its reference
-        VERIFY(m_timers_executing.contains(timer));
-        m_timers_executing.remove(timer);
+        wheel.executing.remove(timer);
+        timer.m_is_executing = false;
         return true;
     }
 
@@ -158,75 +215,138 @@ bool TimerQueue::cancel_timer(Timer& timer, bool* was_in_use)
     return false;
 }
 
-void TimerQueue::remove_timer_locked(Queue& queue, Timer& timer)
+void TimerQueue::remove_timer_locked(Wheel& wheel, Timer& timer)
 {
-    bool was_next_timer = (queue.list.first() == &timer);
-    queue.list.remove(timer);
+    VERIFY(wheel.lock.is_locked());
+
+    timer.m_list_node.remove();
+    wheel.timer_count.fetch_sub(1, AK::memory_order_relaxed);
     auto now = timer.now(false);
     if (timer.m_expires > now)
         timer.m_remaining = timer.m_expires - now;
 
-    if (was_next_timer)
-        update_next_timer_due(queue);
     // Whenever we remove a timer that was still queued (but hasn't been
     // fired) we added a reference to it. So, when removing it from the
     // queue we need to drop that reference.
     timer.unref();
 }
 
-void TimerQueue::fire()
+void TimerQueue::cascade_locked(Wheel& wheel, size_t level, size_t slot)
 {
-    SpinlockLocker lock(g_timerqueue_lock);
-
-    auto fire_timers = [&](Queue& queue) {
-        auto* timer = queue.list.first();
-        VERIFY(timer);
-        VERIFY(queue.next_timer_due == timer->m_expires);
-
-        while (timer && timer->now(true) > timer->m_expires) {
-            queue.list.remove(*timer);
-
-            m_timers_executing.append(*timer);
+    Timer::List timers;
+    auto& list = wheel.levels[level][slot];
+    while (auto* timer = list.take_first())
+        timers.append(*timer);
+    while (auto* timer = timers.take_first())
+        add_to_wheel_locked(wheel, *timer);
+}
 
-            update_next_timer_due(queue);
+void TimerQueue::process_tick_locked(Wheel& wheel, SpinlockLocker<Spinlock<LockRank::None>>& lock)
+{
+    auto tick = wheel.current_tick;
+    constexpr auto slot_mask = Wheel::slots_per_level - 1;
+
+    // Whenever a level wraps around, the next slot of the level above it is due.
+    if ((tick & slot_mask) == 0) {
+        for (size_t level = 1; level < Wheel::level_count; ++level) {
+            auto slot = (tick >> (Wheel::bits_per_level * level)) & slot_mask;
+            cascade_locked(wheel, level, slot);
+            if (slot != 0)
+                break;
+        }
+    }
 
-            lock.unlock();
+    // NOTE: We advance the wheel before expiring anything, so that realtime timers
+    //       which turn out not to be due yet are re-added for one of the next ticks.
+    ++wheel.current_tick;
+
+    Timer::List expired;
+    auto& list = wheel.levels[0][tick & slot_mask];
+    while (auto* timer = list.take_first())
+        expired.append(*timer);
+
+    while (auto* timer = expired.take_first()) {
+        VERIFY(timer->m_expiration_tick <= tick);
+        if (timer->is_realtime() && timer->now(true) <= timer->m_expires) {
+            // The realtime clock was moved back since the timer was added.
+            timer->m_expiration_tick = expiration_tick(*timer);
+            add_to_wheel_locked(wheel, *timer);
+            continue;
+        }
+        expire_timer_locked(wheel, *timer, lock);
+    }
+}
 
-            // Defer executing the timer outside of the irq handler
-            Processor::deferred_call_queue([this, timer]() {
-                // Check if we were cancelled in between being triggered
-                // by the timer irq handler and now. If so, just drop
-                // our reference and don't execute the callback.
-                if (!timer->set_cancelled()) {
-                    timer->m_callback();
-                    SpinlockLocker lock(g_timerqueue_lock);
-                    m_timers_executing.remove(*timer);
-                }
-                timer->clear_in_use();
-                timer->set_callback_finished();
-                // Drop the reference we added when queueing the timer
-                timer->unref();
-            });
-
-            lock.lock();
-            timer = queue.list.first();
+void TimerQueue::expire_timer_locked(Wheel& wheel, Timer& timer, SpinlockLocker<Spinlock<LockRank::None>>& lock)
+{
+    wheel.timer_count.fetch_sub(1, AK::memory_order_relaxed);
+    wheel.executing.append(timer);
+    timer.m_is_executing = true;
+
+    lock.unlock();
+
+    // Defer executing the timer outside of the irq handler
+    Processor::deferred_call_queue([this, timer = &timer]() {
+        // Check if we were cancelled in between being triggered
+        // by the timer irq handler and now. If so, just drop
+        // our reference and don't execute the callback.
+        if (!timer->set_cancelled()) {
+            timer->m_callback();
+            auto& wheel = *this->wheel(timer->m_wheel_index);
+            SpinlockLocker lock(wheel.lock);
+            wheel.executing.remove(*timer);
+            timer->m_is_executing = false;
         }
-    };
+        timer->clear_in_use();
+        timer->set_callback_finished();
+        // Drop the reference we added when queueing the timer
+        timer->unref();
+    });
 
-    if (!m_timer_queue_monotonic.list.is_empty())
-        fire_timers(m_timer_queue_monotonic);
-    if (!m_timer_queue_realtime.list.is_empty())
-        fire_timers(m_timer_queue_realtime);
+    lock.lock();
 }
 
-void TimerQueue::update_next_timer_due(Queue& queue)
+void TimerQueue::fire()
 {
-    VERIFY(g_timerqueue_lock.is_locked());
+    auto now_tick = static_cast<u64>(TimeManagement::the().monotonic_time(TimePrecision::Coarse).to_nanoseconds() / nanoseconds_per_tick);
+
+    // NOTE: We may only be called on the bootstrap processor, so we have to
+    //       look at the wheels of all processors.
+    for (u32 index = 0; index < m_wheels.size(); ++index) {
+        auto* wheel = this->wheel(index);
+        if (!wheel || wheel->timer_count.load(AK::memory_order_relaxed) == 0)
+            continue;
+
+        SpinlockLocker lock(wheel->lock);
+        while (wheel->current_tick <= now_tick && wheel->timer_count.load(AK::memory_order_relaxed) != 0)
+            process_tick_locked(*wheel, lock);
+    }
+}
 
-    if (auto* next_timer = queue.list.first())
-        queue.next_timer_due = next_timer->m_expires;
-    else
-        queue.next_timer_due = {};
+void TimerQueue::realtime_clock_was_changed()
+{
+    for (u32 index = 0; index < m_wheels.size(); ++index) {
+        auto* wheel = this->wheel(index);
+        if (!wheel)
+            continue;
+
+        SpinlockLocker lock(wheel->lock);
+        Timer::List realtime_timers;
+        for (auto& level : wheel->levels) {
+            for (auto& list : level) {
+                for (auto it = list.begin(); it != list.end();) {
+                    auto& timer = *it;
+                    ++it;
+                    if (timer.is_realtime())
+                        realtime_timers.append(timer);
+                }
+            }
+        }
+        while (auto* timer = realtime_timers.take_first()) {
+            timer->m_expiration_tick = expiration_tick(*timer);
+            add_to_wheel_locked(*wheel, *timer);
+        }
+    }
 }
 
 }
@@ -6,12 +6,15 @@
 
 #pragma once
 
+#include <AK/Array.h>
 #include <AK/AtomicRefCounted.h>
 #include <AK/Function.h>
 #include <AK/IntrusiveList.h>
 #include <AK/OwnPtr.h>
 #include <AK/Time.h>
+#include <Kernel/Arch/Processor.h>
 #include <Kernel/Library/NonnullLockRefPtr.h>
+#include <Kernel/Locking/Spinlock.h>
 #include <Kernel/Time/TimeManagement.h>
 
 namespace Kernel {
@@ -22,11 +25,13 @@ class Timer final : public AtomicRefCounted<Timer> {
     friend class TimerQueue;
 
 public:
-    void setup(clockid_t clock_id, Time expires, Function<void()>&& callback)
+    // A timer with slack may expire up to that much later than requested, see TimerQueue::default_slack().
+    void setup(clockid_t clock_id, Time expires, Function<void()>&& callback, Time slack = {})
     {
         VERIFY(!is_queued());
         m_clock_id = clock_id;
         m_expires = expires;
+        m_slack = slack;
         m_callback = move(callback);
     }
 
@@ -41,8 +46,13 @@ private:
     TimerId m_id;
     clockid_t m_clock_id;
     Time m_expires;
+    Time m_slack {};
     Time m_remaining {};
     Function<void()> m_callback;
+    // These are protected by the lock of the wheel the timer was added to.
+    u32 m_wheel_index { 0 };
+    u64 m_expiration_tick { 0 };
+    bool m_is_executing { false };
     Atomic<bool> m_cancelled { false };
     Atomic<bool> m_callback_finished { false };
     Atomic<bool> m_in_use { false };
@@ -72,6 +82,7 @@ private:
     void set_callback_finished() { m_callback_finished.store(true, AK::memory_order_release); }
 
     Time now(bool) const;
+    bool is_realtime() const { return m_clock_id == CLOCK_REALTIME || m_clock_id == CLOCK_REALTIME_COARSE; }
 
     bool is_queued() const { return m_list_node.is_in_list(); }
 
@@ -88,39 +99,52 @@ public:
     static TimerQueue& the();
 
     TimerId add_timer(NonnullLockRefPtr<Timer>&&);
-    bool add_timer_without_id(NonnullLockRefPtr<Timer>, clockid_t, Time const&, Function<void()>&&);
+    bool add_timer_without_id(NonnullLockRefPtr<Timer>, clockid_t, Time const&, Function<void()>&&, Time slack = {});
     bool cancel_timer(Timer& timer, bool* was_in_use = nullptr);
     void fire();
 
+    void initialize_processor(u32 cpu);
+    void realtime_clock_was_changed();
+
+    // The slack we allow for timeouts that aren't urgent, which lets timers with
+    // nearby deadlines expire on the same tick instead of each on their own.
+    static Time default_slack(Time const& timeout);
+
 private:
-    struct Queue {
-        Timer::List list;
-        Time next_timer_due {};
+    // Each processor adds its timers to its own hierarchical timing wheel, so adding
+    // and cancelling timers is O(1) and usually only touches a processor-local lock.
+    // Level 0 has a slot for each of the next 64 ticks, and every following level
+    // has slots that are 64 times as wide. Timers are moved ("cascaded") down a level
+    // whenever the wheel reaches their slot, until they expire from level 0.
+    struct Wheel {
+        static constexpr size_t bits_per_level = 6;
+        static constexpr size_t slots_per_level = 1 << bits_per_level;
+        static constexpr size_t level_count = 5;
+        static constexpr u64 maximum_ticks_ahead = (1ull << (bits_per_level * level_count)) - 1;
+
+        Spinlock<LockRank::None> lock {};
+        // The next tick that hasn't been processed yet.
+        u64 current_tick { 0 };
+        Atomic<size_t> timer_count { 0 };
+        Array<Array<Timer::List, slots_per_level>, level_count> levels;
+        Timer::List executing;
     };
-    void remove_timer_locked(Queue&, Timer&);
-    void update_next_timer_due(Queue&);
-    void add_timer_locked(NonnullLockRefPtr<Timer>);
 
-    Queue& queue_for_timer(Timer& timer)
-    {
-        switch (timer.m_clock_id) {
-        case CLOCK_MONOTONIC:
-        case CLOCK_MONOTONIC_COARSE:
-        case CLOCK_MONOTONIC_RAW:
-            return m_timer_queue_monotonic;
-        case CLOCK_REALTIME:
-        case CLOCK_REALTIME_COARSE:
-            return m_timer_queue_realtime;
-        default:
-            VERIFY_NOT_REACHED();
-        }
-    }
+    static constexpr i64 nanoseconds_per_tick = 1'000'000;
+
+    Wheel& wheel_for_current_processor(u32& index);
+    Wheel* wheel(u32 index) { return AK::atomic_load(&m_wheels[index], AK::memory_order_acquire); }
 
-    u64 m_timer_id_count { 0 };
-    u64 m_ticks_per_second { 0 };
-    Queue m_timer_queue_monotonic;
-    Queue m_timer_queue_realtime;
-    Timer::List m_timers_executing;
+    u64 expiration_tick(Timer const&) const;
+    void add_timer_locked(NonnullLockRefPtr<Timer>);
+    void add_to_wheel_locked(Wheel&, Timer&);
+    void remove_timer_locked(Wheel&, Timer&);
+    void cascade_locked(Wheel&, size_t level, size_t slot);
+    void process_tick_locked(Wheel&, SpinlockLocker<Spinlock<LockRank::None>>&);
+    void expire_timer_locked(Wheel&, Timer&, SpinlockLocker<Spinlock<LockRank::None>>&);
+
+    Atomic<u64> m_timer_id_count { 0 };
+    Array<Wheel*, MAX_CPU_COUNT> m_wheels {};
 };
 
 }
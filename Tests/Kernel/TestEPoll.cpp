@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/OwnPtr.h>
+#include <LibTest/TestCase.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+struct Pipe {
+    Pipe()
+    {
+        int fds[2];
+        EXPECT_EQ(pipe(fds), 0);
+        read_fd = fds[0];
+        write_fd = fds[1];
+    }
+    ~Pipe()
+    {
+        close(read_fd);
+        close(write_fd);
+    }
+
+    void write_byte() const { EXPECT_EQ(write(write_fd, "x", 1), 1); }
+    void read_byte() const
+    {
+        char byte;
+        EXPECT_EQ(read(read_fd, &byte, 1), 1);
+    }
+
+    int read_fd { -1 };
+    int write_fd { -1 };
+};
+
+static int add(int epoll_fd, int fd, u32 events, u64 data)
+{
+    epoll_event event { events, { .u64 = data } };
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+static int modify(int epoll_fd, int fd, u32 events, u64 data)
+{
+    epoll_event event { events, { .u64 = data } };
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+}
+
+// Returns how many events a wait without a timeout reports, and checks that they are the ones we expect.
+static int ready_count(int epoll_fd, u32 expected_events = EPOLLIN, u64 expected_data = 42)
+{
+    epoll_event events[4];
+    int count = epoll_wait(epoll_fd, events, 4, 0);
+    for (int i = 0; i < count; ++i) {
+        EXPECT_EQ(events[i].events, expected_events);
+        EXPECT_EQ(events[i].data.u64, expected_data);
+    }
+    return count;
+}
+
+TEST_CASE(level_triggered)
+{
+    Pipe pipe;
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    EXPECT(epoll_fd >= 0);
+    EXPECT_EQ(add(epoll_fd, pipe.read_fd, EPOLLIN, 42), 0);
+    EXPECT_EQ(ready_count(epoll_fd), 0);
+
+    pipe.write_byte();
+    EXPECT_EQ(ready_count(epoll_fd), 1);
+    // Nothing has been read yet, so it's still ready.
+    EXPECT_EQ(ready_count(epoll_fd), 1);
+
+    pipe.read_byte();
+    EXPECT_EQ(ready_count(epoll_fd), 0);
+
+    // A blocking wait sees data that arrives later on.
+    pipe.write_byte();
+    epoll_event event;
+    EXPECT_EQ(epoll_wait(epoll_fd, &event, 1, -1), 1);
+    EXPECT_EQ(event.events, static_cast<u32>(EPOLLIN));
+    close(epoll_fd);
+}
+
+TEST_CASE(edge_triggered)
+{
+    Pipe pipe;
+    int epoll_fd = epoll_create1(0);
+    EXPECT(epoll_fd >= 0);
+    EXPECT_EQ(add(epoll_fd, pipe.read_fd, EPOLLIN | EPOLLET, 42), 0);
+    EXPECT_EQ(ready_count(epoll_fd), 0);
+
+    pipe.write_byte();
+    EXPECT_EQ(ready_count(epoll_fd), 1);
+    // The data is still there, but there's no new edge.
+    EXPECT_EQ(ready_count(epoll_fd), 0);
+
+    pipe.write_byte();
+    EXPECT_EQ(ready_count(epoll_fd), 1);
+    EXPECT_EQ(ready_count(epoll_fd), 0);
+    close(epoll_fd);
+}
+
+TEST_CASE(oneshot)
+{
+    Pipe pipe;
+    int epoll_fd = epoll_create1(0);
+    EXPECT(epoll_fd >= 0);
+    EXPECT_EQ(add(epoll_fd, pipe.read_fd, EPOLLIN | EPOLLONESHOT, 42), 0);
+
+    pipe.write_byte();
+    EXPECT_EQ(ready_count(epoll_fd), 1);
+    EXPECT_EQ(ready_count(epoll_fd), 0);
+    // It stays disarmed when there's more data, too.
+    pipe.write_byte();
+    EXPECT_EQ(ready_count(epoll_fd), 0);
+
+    // Modifying the interest arms it again, with the new data.
+    EXPECT_EQ(modify(epoll_fd, pipe.read_fd, EPOLLIN | EPOLLONESHOT, 1337), 0);
+    EXPECT_EQ(ready_count(epoll_fd, EPOLLIN, 1337), 1);
+    EXPECT_EQ(ready_count(epoll_fd, EPOLLIN, 1337), 0);
+    close(epoll_fd);
+}
+
+TEST_CASE(write_readiness)
+{
+    Pipe pipe;
+    int epoll_fd = epoll_create1(0);
+    EXPECT(epoll_fd >= 0);
+    EXPECT_EQ(add(epoll_fd, pipe.write_fd, EPOLLOUT, 7), 0);
+    EXPECT_EQ(ready_count(epoll_fd, EPOLLOUT, 7), 1);
+    close(epoll_fd);
+}
+
+TEST_CASE(ctl_errors)
+{
+    Pipe pipe;
+    int epoll_fd = epoll_create1(0);
+    EXPECT(epoll_fd >= 0);
+
+    EXPECT_EQ(add(epoll_fd, pipe.read_fd, EPOLLIN, 42), 0);
+    EXPECT_EQ(add(epoll_fd, pipe.read_fd, EPOLLIN, 42), -1);
+    EXPECT_EQ(errno, EEXIST);
+
+    EXPECT_EQ(modify(epoll_fd, pipe.write_fd, EPOLLOUT, 42), -1);
+    EXPECT_EQ(errno, ENOENT);
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pipe.write_fd, nullptr), -1);
+    EXPECT_EQ(errno, ENOENT);
+
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pipe.read_fd, nullptr), 0);
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pipe.read_fd, nullptr), -1);
+    EXPECT_EQ(errno, ENOENT);
+    EXPECT_EQ(modify(epoll_fd, pipe.read_fd, EPOLLIN, 42), -1);
+    EXPECT_EQ(errno, ENOENT);
+
+    epoll_event event { EPOLLIN, { .u64 = 42 } };
+    EXPECT_EQ(epoll_ctl(epoll_fd, 1234, pipe.read_fd, &event), -1);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_EQ(add(epoll_fd, -1, EPOLLIN, 42), -1);
+    EXPECT_EQ(errno, EBADF);
+    EXPECT_EQ(add(pipe.read_fd, pipe.write_fd, EPOLLOUT, 42), -1);
+    EXPECT_EQ(errno, EINVAL);
+    // Nesting isn't supported.
+    EXPECT_EQ(add(epoll_fd, epoll_fd, EPOLLIN, 42), -1);
+    EXPECT_EQ(errno, EINVAL);
+
+    EXPECT_EQ(epoll_create1(1234), -1);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_EQ(epoll_create(0), -1);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_EQ(epoll_wait(epoll_fd, &event, 0, 0), -1);
+    EXPECT_EQ(errno, EINVAL);
+    close(epoll_fd);
+}
+
+TEST_CASE(closing_the_last_descriptor_drops_the_interest)
+{
+    int epoll_fd = epoll_create1(0);
+    EXPECT(epoll_fd >= 0);
+
+    OwnPtr<Pipe> first_pipe = make<Pipe>();
+    int fd = first_pipe->read_fd;
+    EXPECT_EQ(add(epoll_fd, fd, EPOLLIN, 42), 0);
+    first_pipe->write_byte();
+    first_pipe = nullptr;
+    EXPECT_EQ(ready_count(epoll_fd), 0);
+
+    // The lowest free number is handed out again, so this pipe should reuse it.
+    Pipe second_pipe;
+    EXPECT_EQ(second_pipe.read_fd, fd);
+    EXPECT_EQ(add(epoll_fd, second_pipe.read_fd, EPOLLIN, 42), 0);
+    close(epoll_fd);
+}
+
+TEST_CASE(reused_fd_number_with_a_live_description)
+{
+    Pipe first_pipe;
+    Pipe second_pipe;
+    int epoll_fd = epoll_create1(0);
+    EXPECT(epoll_fd >= 0);
+    EXPECT_EQ(add(epoll_fd, first_pipe.read_fd, EPOLLIN, 1), 0);
+
+    // Keep the first description alive through another number, and put a different one in its old place.
+    int first_read_fd_copy = dup(first_pipe.read_fd);
+    EXPECT(first_read_fd_copy >= 0);
+    EXPECT_EQ(dup2(second_pipe.read_fd, first_pipe.read_fd), first_pipe.read_fd);
+
+    // That's a different description, so it is a new interest rather than the existing one.
+    EXPECT_EQ(add(epoll_fd, first_pipe.read_fd, EPOLLIN, 2), 0);
+    EXPECT_EQ(add(epoll_fd, first_pipe.read_fd, EPOLLIN, 2), -1);
+    EXPECT_EQ(errno, EEXIST);
+
+    // The old interest's description is readable now, but its number refers to the second pipe.
+    first_pipe.write_byte();
+    EXPECT_EQ(ready_count(epoll_fd, EPOLLIN, 2), 0);
+
+    second_pipe.write_byte();
+    EXPECT_EQ(ready_count(epoll_fd, EPOLLIN, 2), 1);
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_DEL, first_pipe.read_fd, nullptr), 0);
+    EXPECT_EQ(ready_count(epoll_fd, EPOLLIN, 2), 0);
+
+    close(first_read_fd_copy);
+    close(epoll_fd);
+}
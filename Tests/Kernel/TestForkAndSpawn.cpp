@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/DeprecatedString.h>
+#include <LibTest/TestCase.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Forked children only get their page tables populated on first access, and posix_spawn()
+// children borrow our memory until they exec. Both have to see exactly what we wrote.
+
+static constexpr size_t memory_size = 16 * MiB;
+
+static u8 byte_at(size_t page_index)
+{
+    return static_cast<u8>(page_index % 251);
+}
+
+static size_t page_size()
+{
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+static u8* map_touched_memory()
+{
+    auto* memory = static_cast<u8*>(mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0));
+    EXPECT(memory != MAP_FAILED);
+    for (size_t page_index = 0; page_index < memory_size / page_size(); ++page_index)
+        memory[page_index * page_size()] = byte_at(page_index);
+    return memory;
+}
+
+static bool has_pattern(u8 const* memory)
+{
+    for (size_t page_index = 0; page_index < memory_size / page_size(); ++page_index) {
+        if (memory[page_index * page_size()] != byte_at(page_index))
+            return false;
+    }
+    return true;
+}
+
+static int wait_for_exit_status(pid_t pid)
+{
+    int status = 0;
+    EXPECT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT(WIFEXITED(status));
+    return WEXITSTATUS(status);
+}
+
+TEST_CASE(fork_child_sees_parent_memory)
+{
+    auto* memory = map_touched_memory();
+    pid_t pid = fork();
+    EXPECT(pid >= 0);
+    if (pid == 0) {
+        if (!has_pattern(memory))
+            _exit(1);
+        // This has to copy the pages instead of writing to the parent's ones.
+        memset(memory, 0, memory_size);
+        _exit(0);
+    }
+    EXPECT_EQ(wait_for_exit_status(pid), 0);
+    EXPECT(has_pattern(memory));
+    munmap(memory, memory_size);
+}
+
+TEST_CASE(vfork_child_sees_parent_memory)
+{
+    auto* memory = map_touched_memory();
+    pid_t pid = vfork();
+    EXPECT(pid >= 0);
+    if (pid == 0)
+        _exit(has_pattern(memory) ? 0 : 1);
+    EXPECT_EQ(wait_for_exit_status(pid), 0);
+    EXPECT(has_pattern(memory));
+    munmap(memory, memory_size);
+}
+
+TEST_CASE(posix_spawn_child_runs_file_actions_on_parent_memory)
+{
+    char path[] = "/tmp/TestForkAndSpawn.XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT(fd >= 0);
+    close(fd);
+
+    // The file action and the path it opens live in our memory, which the child borrows to run them.
+    auto* memory = map_touched_memory();
+    auto* path_in_memory = reinterpret_cast<char*>(memory + page_size() + 1);
+    strcpy(path_in_memory, path);
+
+    posix_spawn_file_actions_t file_actions;
+    EXPECT_EQ(posix_spawn_file_actions_init(&file_actions), 0);
+    EXPECT_EQ(posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, path_in_memory, O_WRONLY | O_TRUNC, 0), 0);
+
+    pid_t pid = -1;
+    char const* argv[] = { "/bin/sh", "-c", "echo $$", nullptr };
+    EXPECT_EQ(posix_spawn(&pid, argv[0], &file_actions, nullptr, const_cast<char**>(argv), environ), 0);
+    EXPECT(pid > 0);
+    EXPECT_EQ(wait_for_exit_status(pid), 0);
+    EXPECT_EQ(posix_spawn_file_actions_destroy(&file_actions), 0);
+
+    // The child must not have changed any of our memory.
+    EXPECT_EQ(strcmp(path_in_memory, path), 0);
+    EXPECT(has_pattern(memory));
+    munmap(memory, memory_size);
+
+    // The shell printed its own pid, which has to be the one we were given.
+    fd = open(path, O_RDONLY);
+    EXPECT(fd >= 0);
+    char output[32] {};
+    EXPECT(read(fd, output, sizeof(output) - 1) > 0);
+    close(fd);
+    unlink(path);
+    EXPECT_EQ(DeprecatedString(output).trim_whitespace(), DeprecatedString::number(pid));
+}
+
+TEST_CASE(posix_spawn_exit_status)
+{
+    pid_t pid = -1;
+    char const* true_argv[] = { "/bin/true", nullptr };
+    EXPECT_EQ(posix_spawn(&pid, true_argv[0], nullptr, nullptr, const_cast<char**>(true_argv), environ), 0);
+    EXPECT_EQ(wait_for_exit_status(pid), 0);
+
+    char const* false_argv[] = { "false", nullptr };
+    EXPECT_EQ(posix_spawnp(&pid, false_argv[0], nullptr, nullptr, const_cast<char**>(false_argv), environ), 0);
+    EXPECT_EQ(wait_for_exit_status(pid), 1);
+
+    // Failing to exec is only noticed by the child.
+    char const* missing_argv[] = { "/bin/this-program-does-not-exist", nullptr };
+    EXPECT_EQ(posix_spawn(&pid, missing_argv[0], nullptr, nullptr, const_cast<char**>(missing_argv), environ), 0);
+    EXPECT_EQ(wait_for_exit_status(pid), 127);
+}
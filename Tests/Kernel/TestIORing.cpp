@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Vector.h>
+#include <Kernel/API/IORing.h>
+#include <LibCore/ElapsedTimer.h>
+#include <LibTest/TestCase.h>
+#include <errno.h>
+#include <serenity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+class Ring {
+public:
+    explicit Ring(u32 submission_entries)
+    {
+        IORingParams params {};
+        params.submission_entries = submission_entries;
+        m_fd = io_ring_create(&params);
+        EXPECT(m_fd >= 0);
+        EXPECT_EQ(params.completion_entries, 2 * params.submission_entries);
+        m_mapping_size = params.mapping_size;
+        m_mapping = static_cast<u8*>(mmap(nullptr, m_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0));
+        EXPECT(m_mapping != MAP_FAILED);
+    }
+
+    ~Ring()
+    {
+        munmap(m_mapping, m_mapping_size);
+        close(m_fd);
+    }
+
+    int fd() const { return m_fd; }
+
+    void queue(IORingSubmission const& submission)
+    {
+        auto& header = this->header();
+        auto tail = AK::atomic_load(&header.submission_tail, AK::memory_order_relaxed);
+        auto* entries = reinterpret_cast<IORingSubmission*>(m_mapping + header.submission_entries_offset);
+        entries[tail & header.submission_mask] = submission;
+        AK::atomic_store(&header.submission_tail, tail + 1, AK::memory_order_release);
+    }
+
+    Vector<IORingCompletion> reap()
+    {
+        auto& header = this->header();
+        auto head = AK::atomic_load(&header.completion_head, AK::memory_order_relaxed);
+        auto tail = AK::atomic_load(&header.completion_tail, AK::memory_order_acquire);
+        auto* entries = reinterpret_cast<IORingCompletion*>(m_mapping + header.completion_entries_offset);
+        Vector<IORingCompletion> completions;
+        for (; head != tail; ++head)
+            completions.append(entries[head & header.completion_mask]);
+        AK::atomic_store(&header.completion_head, head, AK::memory_order_release);
+        return completions;
+    }
+
+private:
+    IORingHeader& header() { return *reinterpret_cast<IORingHeader*>(m_mapping); }
+
+    int m_fd { -1 };
+    u8* m_mapping { nullptr };
+    size_t m_mapping_size { 0 };
+};
+
+static IORingSubmission nop(u64 user_data)
+{
+    IORingSubmission submission {};
+    submission.opcode = IORingOpcode::Nop;
+    submission.user_data = user_data;
+    return submission;
+}
+
+static IORingSubmission read_or_write(IORingOpcode opcode, int fd, void const* buffer, size_t length, i64 offset, u64 user_data)
+{
+    IORingSubmission submission {};
+    submission.opcode = opcode;
+    submission.fd = fd;
+    submission.offset = offset;
+    submission.address = reinterpret_cast<FlatPtr>(buffer);
+    submission.length = length;
+    submission.user_data = user_data;
+    return submission;
+}
+
+TEST_CASE(create_errors)
+{
+    IORingParams params {};
+    EXPECT_EQ(io_ring_create(&params), -1);
+    EXPECT_EQ(errno, EINVAL);
+
+    params.submission_entries = IO_RING_MAX_ENTRIES + 1;
+    EXPECT_EQ(io_ring_create(&params), -1);
+    EXPECT_EQ(errno, EINVAL);
+
+    params.submission_entries = 4;
+    params.flags = 1234;
+    EXPECT_EQ(io_ring_create(&params), -1);
+    EXPECT_EQ(errno, EINVAL);
+
+    // The number of entries is rounded up to a power of two.
+    params.submission_entries = 5;
+    params.flags = IO_RING_CLOEXEC;
+    int fd = io_ring_create(&params);
+    EXPECT(fd >= 0);
+    EXPECT_EQ(params.submission_entries, 8u);
+    EXPECT_EQ(params.completion_entries, 16u);
+    close(fd);
+}
+
+TEST_CASE(nop_write_and_read_through_a_pipe_complete_in_order)
+{
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+
+    Ring ring(8);
+    char const message[] = "Hello, ring!";
+    char buffer[sizeof(message)] {};
+    ring.queue(nop(1));
+    ring.queue(read_or_write(IORingOpcode::Write, fds[1], message, sizeof(message), -1, 2));
+    ring.queue(read_or_write(IORingOpcode::Read, fds[0], buffer, sizeof(buffer), -1, 3));
+    EXPECT_EQ(io_ring_enter(ring.fd(), 3, 3), 3);
+
+    auto completions = ring.reap();
+    EXPECT_EQ(completions.size(), 3u);
+    if (completions.size() == 3) {
+        EXPECT_EQ(completions[0].user_data, 1u);
+        EXPECT_EQ(completions[0].result, 0);
+        EXPECT_EQ(completions[1].user_data, 2u);
+        EXPECT_EQ(completions[1].result, static_cast<i32>(sizeof(message)));
+        EXPECT_EQ(completions[2].user_data, 3u);
+        EXPECT_EQ(completions[2].result, static_cast<i32>(sizeof(message)));
+    }
+    EXPECT_EQ(memcmp(buffer, message, sizeof(message)), 0);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE(read_and_write_at_offsets)
+{
+    char path[] = "/tmp/TestIORing.XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT(fd >= 0);
+    unlink(path);
+
+    Ring ring(4);
+    char const first[] = "first";
+    char const second[] = "second";
+    ring.queue(read_or_write(IORingOpcode::Write, fd, first, 5, 0, 10));
+    ring.queue(read_or_write(IORingOpcode::Write, fd, second, 6, 5, 11));
+    EXPECT_EQ(io_ring_enter(ring.fd(), 2, 2), 2);
+
+    // Operations on regular files may complete in any order, so only match them up by their user data.
+    auto completions = ring.reap();
+    EXPECT_EQ(completions.size(), 2u);
+    for (auto& completion : completions) {
+        EXPECT(completion.user_data == 10 || completion.user_data == 11);
+        EXPECT_EQ(completion.result, completion.user_data == 10 ? 5 : 6);
+    }
+
+    char buffer[11] {};
+    ring.queue(read_or_write(IORingOpcode::Read, fd, buffer, sizeof(buffer), 0, 12));
+    EXPECT_EQ(io_ring_enter(ring.fd(), 1, 1), 1);
+    completions = ring.reap();
+    EXPECT_EQ(completions.size(), 1u);
+    if (completions.size() == 1) {
+        EXPECT_EQ(completions[0].user_data, 12u);
+        EXPECT_EQ(completions[0].result, 11);
+    }
+    EXPECT_EQ(memcmp(buffer, "firstsecond", 11), 0);
+
+    // Reading with a negative offset uses and advances the file offset, which the writes above didn't touch.
+    EXPECT_EQ(lseek(fd, 5, SEEK_SET), 5);
+    memset(buffer, 0, sizeof(buffer));
+    ring.queue(read_or_write(IORingOpcode::Read, fd, buffer, 6, -1, 13));
+    EXPECT_EQ(io_ring_enter(ring.fd(), 1, 1), 1);
+    completions = ring.reap();
+    EXPECT_EQ(completions.size(), 1u);
+    if (completions.size() == 1)
+        EXPECT_EQ(completions[0].result, 6);
+    EXPECT_EQ(memcmp(buffer, "second", 6), 0);
+    EXPECT_EQ(lseek(fd, 0, SEEK_CUR), 11);
+
+    // Errors are reported in the completion rather than by io_ring_enter().
+    ring.queue(read_or_write(IORingOpcode::Read, -1, buffer, sizeof(buffer), 0, 14));
+    EXPECT_EQ(io_ring_enter(ring.fd(), 1, 1), 1);
+    completions = ring.reap();
+    EXPECT_EQ(completions.size(), 1u);
+    if (completions.size() == 1) {
+        EXPECT_EQ(completions[0].user_data, 14u);
+        EXPECT_EQ(completions[0].result, -EBADF);
+    }
+
+    close(fd);
+}
+
+TEST_CASE(timeout)
+{
+    Ring ring(4);
+    timespec timeout { 0, 100'000'000 };
+    IORingSubmission submission {};
+    submission.opcode = IORingOpcode::Timeout;
+    submission.address = reinterpret_cast<FlatPtr>(&timeout);
+    submission.user_data = 20;
+    ring.queue(submission);
+    ring.queue(nop(21));
+
+    auto timer = Core::ElapsedTimer::start_new();
+    // The nop completes right away, the timeout only once it has elapsed.
+    EXPECT_EQ(io_ring_enter(ring.fd(), 2, 1), 2);
+    auto completions = ring.reap();
+    EXPECT_EQ(completions.size(), 1u);
+    if (completions.size() == 1)
+        EXPECT_EQ(completions[0].user_data, 21u);
+
+    EXPECT_EQ(io_ring_enter(ring.fd(), 0, 1), 0);
+    EXPECT(timer.elapsed_time() >= Time::from_milliseconds(100));
+    completions = ring.reap();
+    EXPECT_EQ(completions.size(), 1u);
+    if (completions.size() == 1) {
+        EXPECT_EQ(completions[0].user_data, 20u);
+        EXPECT_EQ(completions[0].result, -ETIMEDOUT);
+    }
+}
+
+TEST_CASE(full_completion_queue)
+{
+    // A single submission entry means there's room for two completions.
+    Ring ring(1);
+    ring.queue(nop(30));
+    EXPECT_EQ(io_ring_enter(ring.fd(), 1, 0), 1);
+    ring.queue(nop(31));
+    EXPECT_EQ(io_ring_enter(ring.fd(), 1, 0), 1);
+
+    ring.queue(nop(32));
+    EXPECT_EQ(io_ring_enter(ring.fd(), 1, 0), -1);
+    EXPECT_EQ(errno, EBUSY);
+
+    // Reaping the completions makes room again, and the submission is still waiting for us.
+    EXPECT_EQ(ring.reap().size(), 2u);
+    EXPECT_EQ(io_ring_enter(ring.fd(), 1, 1), 1);
+    auto completions = ring.reap();
+    EXPECT_EQ(completions.size(), 1u);
+    if (completions.size() == 1)
+        EXPECT_EQ(completions[0].user_data, 32u);
+}
+
+TEST_CASE(only_the_creator_may_enter)
+{
+    Ring ring(4);
+    pid_t pid = fork();
+    EXPECT(pid >= 0);
+    if (pid == 0) {
+        // Buffers would be looked up in our address space instead of the creator's one.
+        bool is_rejected = io_ring_enter(ring.fd(), 0, 0) == -1 && errno == EPERM;
+        _exit(is_rejected ? 0 : 1);
+    }
+    int status = 0;
+    EXPECT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+
+    EXPECT_EQ(io_ring_enter(ring.fd(), 0, 0), 0);
+}
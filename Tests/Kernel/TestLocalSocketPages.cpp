@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Vector.h>
+#include <LibTest/TestCase.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Large writes from private anonymous memory are handed over to the socket as pages,
+// so these tests make sure that the reader always gets what was sent, no matter what
+// the sender does with its memory afterwards.
+
+static constexpr size_t message_size = 1 * MiB;
+
+static u8 byte_at(size_t offset, u8 seed)
+{
+    return static_cast<u8>((offset + seed) % 251);
+}
+
+static u8* map_message(int flags = MAP_PRIVATE)
+{
+    auto* message = static_cast<u8*>(mmap(nullptr, message_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | flags, 0, 0));
+    EXPECT(message != MAP_FAILED);
+    return message;
+}
+
+static void fill(u8* data, size_t size, u8 seed)
+{
+    for (size_t i = 0; i < size; ++i)
+        data[i] = byte_at(i, seed);
+}
+
+static void write_all(int fd, u8 const* data, size_t size)
+{
+    size_t nwritten = 0;
+    while (nwritten < size) {
+        auto rc = write(fd, data + nwritten, size - nwritten);
+        EXPECT(rc > 0);
+        if (rc <= 0)
+            return;
+        nwritten += rc;
+    }
+}
+
+// Reads exactly `size` bytes, and returns how many of them differ from the pattern.
+static size_t read_and_count_mismatches(int fd, size_t size, u8 seed)
+{
+    Vector<u8> data;
+    data.resize(size);
+    size_t nread = 0;
+    while (nread < size) {
+        auto rc = read(fd, data.data() + nread, size - nread);
+        EXPECT(rc > 0);
+        if (rc <= 0)
+            return size - nread;
+        nread += rc;
+    }
+    size_t mismatches = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (data[i] != byte_at(i, seed))
+            ++mismatches;
+    }
+    return mismatches;
+}
+
+static void test_data_survives_rewrite(int flags, size_t offset_in_mapping)
+{
+    int fds[2];
+    EXPECT_EQ(socketpair(AF_LOCAL, SOCK_STREAM, 0, fds), 0);
+    auto* message = map_message(flags);
+    size_t size = message_size - offset_in_mapping;
+
+    fill(message + offset_in_mapping, size, 1);
+    write_all(fds[0], message + offset_in_mapping, size);
+
+    // Nobody has read anything yet, so the socket must not show us any of this.
+    fill(message, message_size, 2);
+    EXPECT_EQ(read_and_count_mismatches(fds[1], size, 1), 0u);
+
+    // Unmapping the memory doesn't take it away from the socket either.
+    fill(message, message_size, 3);
+    write_all(fds[0], message, message_size);
+    munmap(message, message_size);
+    EXPECT_EQ(read_and_count_mismatches(fds[1], message_size, 3), 0u);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE(donated_pages_keep_the_sent_data)
+{
+    test_data_survives_rewrite(MAP_PRIVATE, 0);
+}
+
+TEST_CASE(unaligned_writes_keep_the_sent_data)
+{
+    // The part before the first page boundary is copied, and only the rest is handed over as pages.
+    test_data_survives_rewrite(MAP_PRIVATE, 100);
+}
+
+TEST_CASE(shared_memory_writes_keep_the_sent_data)
+{
+    // Shared memory can't be handed over, so it has to be copied.
+    test_data_survives_rewrite(MAP_SHARED, 0);
+}
+
+struct StreamState {
+    int fd { -1 };
+    size_t message_count { 0 };
+    size_t mismatches { 0 };
+};
+
+TEST_CASE(rewriting_between_messages_while_reading)
+{
+    int fds[2];
+    EXPECT_EQ(socketpair(AF_LOCAL, SOCK_STREAM, 0, fds), 0);
+    StreamState state { fds[1], 32, 0 };
+
+    pthread_t reader;
+    EXPECT_EQ(pthread_create(
+                  &reader, nullptr, [](void* argument) -> void* {
+                      auto& state = *static_cast<StreamState*>(argument);
+                      for (size_t i = 0; i < state.message_count; ++i)
+                          state.mismatches += read_and_count_mismatches(state.fd, message_size, static_cast<u8>(i));
+                      return nullptr;
+                  },
+                  &state),
+        0);
+
+    // Every message goes out from the same memory, which the reader may not have read yet.
+    auto* message = map_message();
+    for (size_t i = 0; i < state.message_count; ++i) {
+        fill(message, message_size, static_cast<u8>(i));
+        write_all(fds[0], message, message_size);
+    }
+
+    EXPECT_EQ(pthread_join(reader, nullptr), 0);
+    EXPECT_EQ(state.mismatches, 0u);
+    munmap(message, message_size);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE(writes_succeed_once_every_socket_has_donated_its_share)
+{
+    // This leaves much more data unread than the kernel lets all sockets keep as donated pages,
+    // so some of these writes have to be copied instead.
+    static constexpr size_t socket_count = 96;
+    Vector<int> fds;
+    Vector<size_t> sizes;
+    auto* message = map_message();
+    fill(message, message_size, 4);
+
+    for (size_t i = 0; i < socket_count; ++i) {
+        int pair[2];
+        EXPECT_EQ(socketpair(AF_LOCAL, SOCK_STREAM | SOCK_NONBLOCK, 0, pair), 0);
+        fds.append(pair[0]);
+        fds.append(pair[1]);
+
+        // Copying may not fit the whole message into the socket buffer, but it must not fail outright.
+        auto rc = write(pair[0], message, message_size);
+        EXPECT(rc > 0);
+        sizes.append(max(rc, static_cast<ssize_t>(0)));
+    }
+
+    fill(message, message_size, 5);
+    for (size_t i = 0; i < socket_count; ++i)
+        EXPECT_EQ(read_and_count_mismatches(fds[i * 2 + 1], sizes[i], 4), 0u);
+
+    munmap(message, message_size);
+    for (auto fd : fds)
+        close(fd);
+}
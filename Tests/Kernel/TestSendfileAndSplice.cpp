@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/ByteBuffer.h>
+#include <LibTest/TestCase.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static u8 byte_at(size_t offset)
+{
+    return static_cast<u8>(offset % 251);
+}
+
+// Creates an unlinked temporary file that holds `size` bytes of a known pattern.
+static int create_file(size_t size)
+{
+    char path[] = "/tmp/TestSendfileAndSplice.XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT(fd >= 0);
+    unlink(path);
+
+    auto data = MUST(ByteBuffer::create_uninitialized(size));
+    for (size_t i = 0; i < size; ++i)
+        data[i] = byte_at(i);
+    EXPECT_EQ(write(fd, data.data(), size), static_cast<ssize_t>(size));
+    EXPECT_EQ(lseek(fd, 0, SEEK_SET), 0);
+    return fd;
+}
+
+// Reads exactly `size` bytes, and checks that they are the pattern starting at `offset`.
+static void expect_pattern(int fd, size_t offset, size_t size)
+{
+    auto data = MUST(ByteBuffer::create_uninitialized(size));
+    size_t nread = 0;
+    while (nread < size) {
+        auto rc = read(fd, data.data() + nread, size - nread);
+        EXPECT(rc > 0);
+        if (rc <= 0)
+            return;
+        nread += rc;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        if (data[i] != byte_at(offset + i)) {
+            EXPECT_EQ(data[i], byte_at(offset + i));
+            return;
+        }
+    }
+}
+
+TEST_CASE(sendfile_file_to_socket)
+{
+    static constexpr size_t file_size = 200 * KiB;
+    int file_fd = create_file(file_size);
+    int sockets[2];
+    EXPECT_EQ(socketpair(AF_LOCAL, SOCK_STREAM, 0, sockets), 0);
+
+    // Without an offset, the file offset is used and advanced.
+    size_t total_sent = 0;
+    while (total_sent < file_size) {
+        auto nsent = sendfile(sockets[0], file_fd, nullptr, file_size - total_sent);
+        EXPECT(nsent > 0);
+        if (nsent <= 0)
+            break;
+        total_sent += nsent;
+    }
+    EXPECT_EQ(lseek(file_fd, 0, SEEK_CUR), static_cast<off_t>(file_size));
+    expect_pattern(sockets[1], 0, file_size);
+
+    // With an offset, that is used and advanced instead, and the file offset is left alone.
+    EXPECT_EQ(lseek(file_fd, 10, SEEK_SET), 10);
+    off_t offset = 1000;
+    EXPECT_EQ(sendfile(sockets[0], file_fd, &offset, 5000), 5000);
+    EXPECT_EQ(offset, 6000);
+    EXPECT_EQ(lseek(file_fd, 0, SEEK_CUR), 10);
+    expect_pattern(sockets[1], 1000, 5000);
+
+    // There's nothing left to send at the end of the file.
+    offset = file_size;
+    EXPECT_EQ(sendfile(sockets[0], file_fd, &offset, 100), 0);
+
+    close(sockets[0]);
+    close(sockets[1]);
+    close(file_fd);
+}
+
+TEST_CASE(sendfile_short_write_to_non_blocking_pipe)
+{
+    static constexpr size_t file_size = 1 * MiB;
+    int file_fd = create_file(file_size);
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+    EXPECT_EQ(fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+
+    // The pipe can't take all of it, so we get a short count, and only that much of the file is consumed.
+    auto nsent = sendfile(fds[1], file_fd, nullptr, file_size);
+    EXPECT(nsent > 0);
+    EXPECT(static_cast<size_t>(nsent) < file_size);
+    EXPECT_EQ(lseek(file_fd, 0, SEEK_CUR), static_cast<off_t>(nsent));
+
+    // Now the pipe is full.
+    EXPECT_EQ(sendfile(fds[1], file_fd, nullptr, file_size), -1);
+    EXPECT_EQ(errno, EAGAIN);
+    EXPECT_EQ(lseek(file_fd, 0, SEEK_CUR), static_cast<off_t>(nsent));
+
+    expect_pattern(fds[0], 0, nsent);
+
+    // After draining the pipe, the next transfer picks up exactly where the last one stopped.
+    auto next_nsent = sendfile(fds[1], file_fd, nullptr, 1000);
+    EXPECT_EQ(next_nsent, 1000);
+    expect_pattern(fds[0], nsent, 1000);
+
+    close(fds[0]);
+    close(fds[1]);
+    close(file_fd);
+}
+
+TEST_CASE(sendfile_errors)
+{
+    int file_fd = create_file(100);
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+
+    // The source has to be seekable.
+    EXPECT_EQ(sendfile(file_fd, fds[0], nullptr, 10), -1);
+    EXPECT_EQ(errno, EINVAL);
+    off_t offset = -1;
+    EXPECT_EQ(sendfile(fds[1], file_fd, &offset, 10), -1);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_EQ(sendfile(fds[0], file_fd, nullptr, 10), -1);
+    EXPECT_EQ(errno, EBADF);
+
+    close(fds[0]);
+    close(fds[1]);
+    close(file_fd);
+}
+
+TEST_CASE(splice_pipe_to_file)
+{
+    static constexpr size_t size = 32 * KiB;
+    int source_fd = create_file(size);
+    int file_fd = create_file(0);
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+
+    // Fill the pipe from the file, without an offset.
+    EXPECT_EQ(splice(source_fd, nullptr, fds[1], nullptr, size, 0), static_cast<ssize_t>(size));
+    EXPECT_EQ(lseek(source_fd, 0, SEEK_CUR), static_cast<off_t>(size));
+
+    // Without an offset, the data goes to the file offset and advances it.
+    EXPECT_EQ(splice(fds[0], nullptr, file_fd, nullptr, 1000, 0), 1000);
+    EXPECT_EQ(lseek(file_fd, 0, SEEK_CUR), 1000);
+
+    // With an offset, that is used and advanced instead, and the file offset is left alone.
+    off_t offset = 1000;
+    EXPECT_EQ(splice(fds[0], nullptr, file_fd, &offset, size - 1000, 0), static_cast<ssize_t>(size - 1000));
+    EXPECT_EQ(offset, static_cast<off_t>(size));
+    EXPECT_EQ(lseek(file_fd, 0, SEEK_CUR), 1000);
+
+    EXPECT_EQ(lseek(file_fd, 0, SEEK_SET), 0);
+    expect_pattern(file_fd, 0, size);
+
+    // There's nothing left in the pipe.
+    EXPECT_EQ(splice(fds[0], nullptr, file_fd, nullptr, 1000, SPLICE_F_NONBLOCK), -1);
+    EXPECT_EQ(errno, EAGAIN);
+
+    close(fds[0]);
+    close(fds[1]);
+    close(file_fd);
+    close(source_fd);
+}
+
+TEST_CASE(splice_file_to_pipe_at_offset)
+{
+    int file_fd = create_file(10 * KiB);
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+
+    off_t offset = 4000;
+    EXPECT_EQ(splice(file_fd, &offset, fds[1], nullptr, 3000, 0), 3000);
+    EXPECT_EQ(offset, 7000);
+    EXPECT_EQ(lseek(file_fd, 0, SEEK_CUR), 0);
+    expect_pattern(fds[0], 4000, 3000);
+
+    close(fds[0]);
+    close(fds[1]);
+    close(file_fd);
+}
+
+TEST_CASE(splice_errors)
+{
+    int first_file_fd = create_file(100);
+    int second_file_fd = create_file(100);
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+
+    // One end has to be a pipe.
+    EXPECT_EQ(splice(first_file_fd, nullptr, second_file_fd, nullptr, 10, 0), -1);
+    EXPECT_EQ(errno, EINVAL);
+    // A pipe can't be spliced into itself.
+    EXPECT_EQ(splice(fds[0], nullptr, fds[1], nullptr, 10, 0), -1);
+    EXPECT_EQ(errno, EINVAL);
+    // Pipes don't have offsets.
+    off_t offset = 0;
+    EXPECT_EQ(splice(fds[0], &offset, first_file_fd, nullptr, 10, 0), -1);
+    EXPECT_EQ(errno, ESPIPE);
+    EXPECT_EQ(splice(fds[0], nullptr, first_file_fd, nullptr, 10, 1234), -1);
+    EXPECT_EQ(errno, EINVAL);
+
+    close(fds[0]);
+    close(fds[1]);
+    close(first_file_fd);
+    close(second_file_fd);
+}
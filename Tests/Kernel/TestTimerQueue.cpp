@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Array.h>
+#include <AK/Atomic.h>
+#include <AK/Random.h>
+#include <AK/Time.h>
+#include <LibCore/ElapsedTimer.h>
+#include <LibTest/TestCase.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+// Timers may expire late (they have slack, and the thread has to be scheduled), but never early.
+// How late depends on the load of the machine, so these tests only check that nothing expires early.
+static Time sleep_for(Time duration)
+{
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    auto duration_spec = duration.to_timespec();
+    EXPECT_EQ(clock_nanosleep(CLOCK_MONOTONIC, 0, &duration_spec, nullptr), 0);
+    return timer.elapsed_time();
+}
+
+TEST_CASE(sleeps_expire_on_time)
+{
+    // These cover the first wheel level, its last slot, and timers that are cascaded down from the next levels.
+    static constexpr Array durations_in_milliseconds { 1, 10, 63, 64, 65, 200, 1000 };
+    for (auto milliseconds : durations_in_milliseconds) {
+        auto duration = Time::from_milliseconds(milliseconds);
+        EXPECT(sleep_for(duration) >= duration);
+    }
+}
+
+static Atomic<size_t> s_finish_position;
+
+struct OrderedSleep {
+    Time duration;
+    size_t finish_position { 0 };
+};
+
+TEST_CASE(sleeps_expire_in_order)
+{
+    // The longest sleep starts first, and the deadlines are far enough apart that scheduling delays don't matter.
+    Array sleeps { OrderedSleep { Time::from_milliseconds(2000) }, OrderedSleep { Time::from_milliseconds(200) }, OrderedSleep { Time::from_milliseconds(20) } };
+    Array<pthread_t, sleeps.size()> threads;
+    for (size_t i = 0; i < sleeps.size(); ++i) {
+        EXPECT_EQ(pthread_create(
+                      &threads[i], nullptr, [](void* argument) -> void* {
+                          auto& sleep = *static_cast<OrderedSleep*>(argument);
+                          EXPECT(sleep_for(sleep.duration) >= sleep.duration);
+                          sleep.finish_position = s_finish_position++;
+                          return nullptr;
+                      },
+                      &sleeps[i]),
+            0);
+    }
+    for (auto thread : threads)
+        EXPECT_EQ(pthread_join(thread, nullptr), 0);
+
+    EXPECT_EQ(sleeps[0].finish_position, 2u);
+    EXPECT_EQ(sleeps[1].finish_position, 1u);
+    EXPECT_EQ(sleeps[2].finish_position, 0u);
+}
+
+static constexpr size_t sleeping_thread_count = 16;
+static constexpr size_t sleeps_per_thread = 50;
+static Atomic<size_t> s_early_sleeps;
+static Atomic<size_t> s_finished_sleeps;
+
+TEST_CASE(concurrent_sleeps_all_expire)
+{
+    Array<pthread_t, sleeping_thread_count> threads;
+    for (auto& thread : threads) {
+        EXPECT_EQ(pthread_create(
+                      &thread, nullptr, [](void*) -> void* {
+                          for (size_t i = 0; i < sleeps_per_thread; ++i) {
+                              auto duration = Time::from_microseconds(1 + get_random_uniform(2000));
+                              if (sleep_for(duration) < duration)
+                                  ++s_early_sleeps;
+                              ++s_finished_sleeps;
+                          }
+                          return nullptr;
+                      },
+                      nullptr),
+            0);
+    }
+    for (auto thread : threads)
+        EXPECT_EQ(pthread_join(thread, nullptr), 0);
+
+    EXPECT_EQ(s_finished_sleeps.load(), sleeping_thread_count * sleeps_per_thread);
+    EXPECT_EQ(s_early_sleeps.load(), 0u);
+}
+
+struct TimedWaitState {
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond;
+    bool signalled { false };
+};
+
+static timespec monotonic_deadline(Time timeout)
+{
+    return (Time::now_monotonic() + timeout).to_timespec();
+}
+
+static void init_monotonic_cond(pthread_cond_t& cond)
+{
+    pthread_condattr_t attributes;
+    EXPECT_EQ(pthread_condattr_init(&attributes), 0);
+    EXPECT_EQ(pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC), 0);
+    EXPECT_EQ(pthread_cond_init(&cond, &attributes), 0);
+    EXPECT_EQ(pthread_condattr_destroy(&attributes), 0);
+}
+
+TEST_CASE(cancelled_timed_wait_does_not_expire_later)
+{
+    TimedWaitState state;
+    init_monotonic_cond(state.cond);
+
+    pthread_t thread;
+    EXPECT_EQ(pthread_create(
+                  &thread, nullptr, [](void* argument) -> void* {
+                      auto& state = *static_cast<TimedWaitState*>(argument);
+                      usleep(10000);
+                      pthread_mutex_lock(&state.mutex);
+                      state.signalled = true;
+                      pthread_cond_signal(&state.cond);
+                      pthread_mutex_unlock(&state.mutex);
+                      return nullptr;
+                  },
+                  &state),
+        0);
+
+    // The signal comes long before the timeout, so the timer of this wait is cancelled.
+    auto deadline = monotonic_deadline(Time::from_milliseconds(200));
+    pthread_mutex_lock(&state.mutex);
+    int rc = 0;
+    while (!state.signalled && rc == 0)
+        rc = pthread_cond_timedwait(&state.cond, &state.mutex, &deadline);
+    EXPECT_EQ(rc, 0);
+    EXPECT(state.signalled);
+
+    // If the cancelled timer still expired, it would cut this wait short.
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    auto timeout = Time::from_milliseconds(500);
+    deadline = monotonic_deadline(timeout);
+    while (rc == 0)
+        rc = pthread_cond_timedwait(&state.cond, &state.mutex, &deadline);
+    EXPECT_EQ(rc, ETIMEDOUT);
+    EXPECT(timer.elapsed_time() >= timeout);
+    pthread_mutex_unlock(&state.mutex);
+
+    EXPECT_EQ(pthread_join(thread, nullptr), 0);
+    EXPECT_EQ(pthread_cond_destroy(&state.cond), 0);
+}
+
+TEST_CASE(past_deadline_times_out_right_away)
+{
+    TimedWaitState state;
+    init_monotonic_cond(state.cond);
+
+    auto deadline = monotonic_deadline(Time::from_milliseconds(-10));
+    pthread_mutex_lock(&state.mutex);
+    EXPECT_EQ(pthread_cond_timedwait(&state.cond, &state.mutex, &deadline), ETIMEDOUT);
+    pthread_mutex_unlock(&state.mutex);
+    EXPECT_EQ(pthread_cond_destroy(&state.cond), 0);
+}
+
+static Atomic<bool> s_alarm_fired;
+
+TEST_CASE(cancelled_alarm_does_not_fire)
+{
+    signal(SIGALRM, [](int) { s_alarm_fired = true; });
+
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    EXPECT_EQ(alarm(1), 0u);
+    EXPECT_EQ(alarm(0), 1u);
+
+    // Wait until well after the alarm would have gone off, no matter how long it took to get here.
+    auto wait_until = Time::from_seconds(3);
+    while (!s_alarm_fired) {
+        auto remaining = wait_until - timer.elapsed_time();
+        if (remaining <= Time::zero())
+            break;
+        sleep_for(remaining);
+    }
+    EXPECT(!s_alarm_fired);
+
+    signal(SIGALRM, SIG_DFL);
+}
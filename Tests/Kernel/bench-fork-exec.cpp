@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Format.h>
+#include <AK/NumberFormat.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Measures how long it takes to start a program with fork() + execve() and with posix_spawn(),
+// while the parent has an ever larger amount of touched anonymous memory mapped.
+// The fork() children also check a few pages of that memory before they exec, since they
+// see it through page tables that only get populated on first access.
+
+static constexpr size_t smallest_address_space_size = 0;
+static constexpr size_t largest_address_space_size = 256 * MiB;
+
+static u8 expected_byte(size_t page_index)
+{
+    return static_cast<u8>(page_index % 251);
+}
+
+static bool wait_for_success(pid_t pid)
+{
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0) {
+        perror("waitpid");
+        return false;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        warnln("Child {} did not exit successfully", pid);
+        return false;
+    }
+    return true;
+}
+
+static bool fork_and_exec(char const* program, u8 const* memory, size_t page_count, size_t page_size)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return false;
+    }
+    if (pid == 0) {
+        for (size_t page_index = 0; page_index < page_count; page_index += max(page_count / 16, static_cast<size_t>(1))) {
+            if (memory[page_index * page_size] != expected_byte(page_index))
+                _exit(1);
+        }
+        char const* argv[] = { program, nullptr };
+        execv(program, const_cast<char**>(argv));
+        perror("execv");
+        _exit(1);
+    }
+    return wait_for_success(pid);
+}
+
+static bool spawn(char const* program)
+{
+    pid_t pid;
+    char const* argv[] = { program, nullptr };
+    if (int rc = posix_spawn(&pid, program, nullptr, nullptr, const_cast<char**>(argv), environ); rc != 0) {
+        warnln("posix_spawn: {}", strerror(rc));
+        return false;
+    }
+    return wait_for_success(pid);
+}
+
+static bool run(char const* program, size_t address_space_size, size_t iterations)
+{
+    auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto page_count = address_space_size / page_size;
+
+    u8* memory = nullptr;
+    if (address_space_size > 0) {
+        memory = static_cast<u8*>(mmap(nullptr, address_space_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0));
+        if (memory == MAP_FAILED) {
+            perror("mmap");
+            return false;
+        }
+        for (size_t page_index = 0; page_index < page_count; ++page_index)
+            memory[page_index * page_size] = expected_byte(page_index);
+    }
+
+    bool success = true;
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    for (size_t i = 0; i < iterations && success; ++i)
+        success = fork_and_exec(program, memory, page_count, page_size);
+    auto fork_elapsed_us = max(static_cast<u64>(timer.elapsed_time().to_microseconds()), static_cast<u64>(1));
+
+    timer.start();
+    for (size_t i = 0; i < iterations && success; ++i)
+        success = spawn(program);
+    auto spawn_elapsed_us = max(static_cast<u64>(timer.elapsed_time().to_microseconds()), static_cast<u64>(1));
+
+    // Neither the COW children nor the ones that borrowed our memory may have changed it.
+    for (size_t page_index = 0; page_index < page_count && success; ++page_index) {
+        if (memory[page_index * page_size] != expected_byte(page_index)) {
+            warnln("Page {} changed while starting children", page_index);
+            success = false;
+        }
+    }
+
+    if (memory)
+        munmap(memory, address_space_size);
+
+    if (success) {
+        outln("{:>10}: fork+exec {:>6} us, posix_spawn {:>6} us", human_readable_size(address_space_size),
+            fork_elapsed_us / iterations, spawn_elapsed_us / iterations);
+    }
+    return success;
+}
+
+int main(int argc, char** argv)
+{
+    char const* program = "/bin/true";
+    size_t iterations = 100;
+
+    Core::ArgsParser args_parser;
+    args_parser.add_option(program, "Program to start", "program", 'p', "path");
+    args_parser.add_option(iterations, "How many times to start it for every address space size", "iterations", 'n', "number");
+    args_parser.parse(argc, argv);
+
+    if (iterations == 0) {
+        warnln("Need to start the program at least once");
+        return 1;
+    }
+
+    bool success = run(program, smallest_address_space_size, iterations);
+    for (size_t size = 16 * MiB; size <= largest_address_space_size && success; size *= 4)
+        success = run(program, size, iterations);
+    return success ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Format.h>
+#include <AK/NumberFormat.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Measures how fast a LocalSocket moves data from one thread to another, for message sizes
+// from 64 bytes to 16 MiB. Messages are sent from page aligned memory, so large ones can be
+// handed over as pages instead of being copied into the socket buffer.
+
+static constexpr size_t smallest_message_size = 64;
+static constexpr size_t largest_message_size = 16 * MiB;
+
+struct ReaderState {
+    int fd { -1 };
+    size_t message_size { 0 };
+    size_t bytes_to_read { 0 };
+    bool verify { false };
+    size_t mismatches { 0 };
+};
+
+static u8 expected_byte(size_t offset_in_message)
+{
+    return static_cast<u8>(offset_in_message % 251);
+}
+
+static void* reader(void* argument)
+{
+    auto& state = *static_cast<ReaderState*>(argument);
+    auto* buffer = static_cast<u8*>(mmap(nullptr, largest_message_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0));
+    if (buffer == MAP_FAILED) {
+        perror("mmap");
+        return nullptr;
+    }
+
+    size_t bytes_read = 0;
+    while (bytes_read < state.bytes_to_read) {
+        auto nread = read(state.fd, buffer, min(state.message_size, state.bytes_to_read - bytes_read));
+        if (nread < 0) {
+            perror("read");
+            break;
+        }
+        if (nread == 0) {
+            warnln("Unexpected end of stream after {} bytes", bytes_read);
+            break;
+        }
+        if (state.verify) {
+            for (ssize_t i = 0; i < nread; ++i) {
+                if (buffer[i] != expected_byte((bytes_read + i) % state.message_size))
+                    ++state.mismatches;
+            }
+        }
+        bytes_read += nread;
+    }
+
+    munmap(buffer, largest_message_size);
+    return nullptr;
+}
+
+static bool run(size_t message_size, size_t bytes_per_size, bool rewrite_messages, bool verify)
+{
+    int fds[2];
+    if (socketpair(AF_LOCAL, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return false;
+    }
+
+    auto* message = static_cast<u8*>(mmap(nullptr, message_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0));
+    if (message == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    for (size_t i = 0; i < message_size; ++i)
+        message[i] = expected_byte(i);
+
+    size_t message_count = max(bytes_per_size / message_size, static_cast<size_t>(1));
+    ReaderState state { fds[1], message_size, message_count * message_size, verify, 0 };
+
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    pthread_t reader_thread;
+    if (int rc = pthread_create(&reader_thread, nullptr, reader, &state); rc != 0) {
+        warnln("pthread_create: {}", strerror(rc));
+        return false;
+    }
+
+    auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    bool success = true;
+    for (size_t i = 0; i < message_count && success; ++i) {
+        // Writing to the message makes the kernel copy any pages that it still shares with the socket.
+        if (rewrite_messages) {
+            for (size_t offset = 0; offset < message_size; offset += page_size)
+                message[offset] = expected_byte(offset);
+        }
+        size_t bytes_written = 0;
+        while (bytes_written < message_size) {
+            auto nwritten = write(fds[0], message + bytes_written, message_size - bytes_written);
+            if (nwritten < 0) {
+                perror("write");
+                success = false;
+                break;
+            }
+            bytes_written += nwritten;
+        }
+    }
+
+    // If writing failed, this lets the reader know that nothing else is coming.
+    close(fds[0]);
+    pthread_join(reader_thread, nullptr);
+    auto elapsed_us = max(static_cast<u64>(timer.elapsed_time().to_microseconds()), static_cast<u64>(1));
+
+    close(fds[1]);
+    munmap(message, message_size);
+
+    auto bytes_per_second = state.bytes_to_read * 1'000'000 / elapsed_us;
+    outln("{:>10} x {:>7}: {:>6} ms, {}/s, {} messages/s", human_readable_size(message_size), message_count, elapsed_us / 1000,
+        human_readable_size(bytes_per_second), message_count * 1'000'000 / elapsed_us);
+    if (state.mismatches > 0) {
+        warnln("{} bytes were received with the wrong contents", state.mismatches);
+        success = false;
+    }
+    return success;
+}
+
+int main(int argc, char** argv)
+{
+    size_t megabytes_per_size = 64;
+    bool rewrite_messages = false;
+    bool verify = false;
+
+    Core::ArgsParser args_parser;
+    args_parser.add_option(megabytes_per_size, "How many MiB to send for every message size", "megabytes", 'm', "number");
+    args_parser.add_option(rewrite_messages, "Write to the message before sending it again", "rewrite", 'r');
+    args_parser.add_option(verify, "Check the contents of every message", "verify", 'v');
+    args_parser.parse(argc, argv);
+
+    if (megabytes_per_size == 0) {
+        warnln("Need to send at least one MiB");
+        return 1;
+    }
+
+    bool success = true;
+    for (size_t message_size = smallest_message_size; message_size <= largest_message_size; message_size *= 4)
+        success &= run(message_size, megabytes_per_size * MiB, rewrite_messages, verify);
+    return success ? 0 : 1;
+}
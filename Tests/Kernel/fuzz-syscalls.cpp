@@ -20,7 +20,7 @@
 
 static bool is_deadly_syscall(int fn)
 {
-    return fn == SC_exit || fn == SC_fork || fn == SC_sigreturn || fn == SC_exit_thread;
+    return fn == SC_exit || fn == SC_fork || fn == SC_vfork || fn == SC_sigreturn || fn == SC_exit_thread;
 }
 
 static bool is_unfuzzable_syscall(int fn)
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Atomic.h>
+#include <AK/Random.h>
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Hammers the kernel timer queue from many threads at once: every thread either sleeps
+// for a short, random amount of time (which adds a timer that expires), or waits on a
+// condition variable with a timeout that gets signalled before it expires (which adds
+// a timer that is cancelled again).
+
+static int s_iterations = 1000;
+static int s_max_sleep_us = 2000;
+
+static Atomic<u64> s_sleeps;
+static Atomic<u64> s_cancelled_waits;
+static Atomic<u64> s_total_lateness_us;
+static Atomic<u64> s_max_lateness_us;
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+
+static void sleep_once()
+{
+    u64 duration_us = 1 + get_random_uniform(s_max_sleep_us);
+    timespec duration { .tv_sec = static_cast<time_t>(duration_us / 1'000'000), .tv_nsec = static_cast<long>(duration_us % 1'000'000) * 1000 };
+
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    clock_nanosleep(CLOCK_MONOTONIC, 0, &duration, nullptr);
+    auto elapsed = static_cast<u64>(timer.elapsed_time().to_microseconds());
+
+    auto lateness = elapsed > duration_us ? elapsed - duration_us : 0;
+    s_total_lateness_us += lateness;
+    auto max_lateness = s_max_lateness_us.load();
+    while (lateness > max_lateness && !s_max_lateness_us.compare_exchange_strong(max_lateness, lateness))
+        ;
+    ++s_sleeps;
+}
+
+static void wait_and_cancel_once()
+{
+    // This timeout is long enough that the broadcast below always comes first.
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += 10;
+
+    pthread_mutex_lock(&s_mutex);
+    pthread_cond_timedwait(&s_cond, &s_mutex, &deadline);
+    pthread_mutex_unlock(&s_mutex);
+    ++s_cancelled_waits;
+}
+
+static void* worker(void*)
+{
+    for (int i = 0; i < s_iterations; ++i) {
+        if (get_random_uniform(2) == 0)
+            sleep_once();
+        else
+            wait_and_cancel_once();
+    }
+    return nullptr;
+}
+
+static Atomic<bool> s_done;
+
+static void* waker(void*)
+{
+    while (!s_done) {
+        pthread_mutex_lock(&s_mutex);
+        pthread_cond_broadcast(&s_cond);
+        pthread_mutex_unlock(&s_mutex);
+        usleep(500);
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+    int thread_count = 16;
+
+    Core::ArgsParser args_parser;
+    args_parser.add_option(thread_count, "Number of threads", "threads", 't', "number");
+    args_parser.add_option(s_iterations, "Number of timers each thread adds", "iterations", 'n', "number");
+    args_parser.add_option(s_max_sleep_us, "Longest sleep in microseconds", "max-sleep", 's', "microseconds");
+    args_parser.parse(argc, argv);
+
+    if (thread_count <= 0 || s_iterations <= 0 || s_max_sleep_us <= 0) {
+        warnln("All arguments must be positive");
+        return 1;
+    }
+
+    pthread_t waker_thread;
+    if (int rc = pthread_create(&waker_thread, nullptr, waker, nullptr); rc != 0) {
+        warnln("pthread_create: {}", strerror(rc));
+        return 1;
+    }
+
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    Vector<pthread_t> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        pthread_t thread;
+        if (int rc = pthread_create(&thread, nullptr, worker, nullptr); rc != 0) {
+            warnln("pthread_create: {}", strerror(rc));
+            return 1;
+        }
+        threads.append(thread);
+    }
+    for (auto thread : threads)
+        pthread_join(thread, nullptr);
+    auto elapsed_us = max(static_cast<u64>(timer.elapsed_time().to_microseconds()), static_cast<u64>(1));
+
+    s_done = true;
+    pthread_join(waker_thread, nullptr);
+
+    u64 timers = s_sleeps + s_cancelled_waits;
+    outln("{} threads added {} timers in {} ms ({} timers/s)", thread_count, timers, elapsed_us / 1000, timers * 1'000'000 / elapsed_us);
+    outln("{} sleeps expired, {} timed waits were cancelled", s_sleeps.load(), s_cancelled_waits.load());
+    if (s_sleeps > 0)
+        outln("Sleeps were late by {} us on average, and by {} us at most", s_total_lateness_us / s_sleeps, s_max_lateness_us.load());
+    return 0;
+}
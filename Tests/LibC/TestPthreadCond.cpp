@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Array.h>
+#include <LibTest/TestCase.h>
+#include <pthread.h>
+#include <unistd.h>
+
+static constexpr size_t waiter_count = 8;
+static constexpr size_t broadcast_rounds = 16;
+
+struct BroadcastState {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    size_t waiting { 0 };
+    size_t woken { 0 };
+    size_t round { 0 };
+};
+
+static void* wait_for_broadcasts(void* argument)
+{
+    auto& state = *static_cast<BroadcastState*>(argument);
+    pthread_mutex_lock(&state.mutex);
+    for (size_t round = 0; round < broadcast_rounds; ++round) {
+        ++state.waiting;
+        while (state.round == round)
+            pthread_cond_wait(&state.cond, &state.mutex);
+        ++state.woken;
+    }
+    pthread_mutex_unlock(&state.mutex);
+    return nullptr;
+}
+
+// Waits until `counter` reaches `expected`, giving up after a few seconds so that a lost
+// wakeup fails the test instead of hanging it.
+static bool wait_until_counter_reaches(BroadcastState& state, size_t& counter, size_t expected)
+{
+    for (size_t attempt = 0; attempt < 5000; ++attempt) {
+        pthread_mutex_lock(&state.mutex);
+        bool reached = counter == expected;
+        pthread_mutex_unlock(&state.mutex);
+        if (reached)
+            return true;
+        usleep(1000);
+    }
+    return false;
+}
+
+static void test_broadcast_wakes_every_waiter(int protocol)
+{
+    BroadcastState state;
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    EXPECT_EQ(pthread_mutexattr_setprotocol(&attributes, protocol), 0);
+    EXPECT_EQ(pthread_mutex_init(&state.mutex, &attributes), 0);
+    pthread_mutexattr_destroy(&attributes);
+    EXPECT_EQ(pthread_cond_init(&state.cond, nullptr), 0);
+
+    Array<pthread_t, waiter_count> threads;
+    for (auto& thread : threads)
+        EXPECT_EQ(pthread_create(&thread, nullptr, wait_for_broadcasts, &state), 0);
+
+    for (size_t round = 0; round < broadcast_rounds; ++round) {
+        // The waiters only let go of the mutex while waiting on the condition variable.
+        if (!wait_until_counter_reaches(state, state.waiting, (round + 1) * waiter_count)) {
+            FAIL("Waiters did not start waiting");
+            return;
+        }
+
+        pthread_mutex_lock(&state.mutex);
+        ++state.round;
+        EXPECT_EQ(pthread_cond_broadcast(&state.cond), 0);
+        pthread_mutex_unlock(&state.mutex);
+
+        if (!wait_until_counter_reaches(state, state.woken, (round + 1) * waiter_count)) {
+            FAIL("Broadcast did not wake every waiter");
+            return;
+        }
+    }
+
+    for (auto& thread : threads)
+        EXPECT_EQ(pthread_join(thread, nullptr), 0);
+    EXPECT_EQ(pthread_cond_destroy(&state.cond), 0);
+    EXPECT_EQ(pthread_mutex_destroy(&state.mutex), 0);
+}
+
+TEST_CASE(cond_broadcast_wakes_every_waiter)
+{
+    test_broadcast_wakes_every_waiter(PTHREAD_PRIO_NONE);
+}
+
+TEST_CASE(cond_broadcast_wakes_every_waiter_with_priority_inheriting_mutex)
+{
+    test_broadcast_wakes_every_waiter(PTHREAD_PRIO_INHERIT);
+}
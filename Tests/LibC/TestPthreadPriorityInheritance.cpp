@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Atomic.h>
+#include <LibTest/TestCase.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+static void init_priority_inheriting_mutex(pthread_mutex_t& mutex, int type = PTHREAD_MUTEX_NORMAL)
+{
+    pthread_mutexattr_t attributes;
+    EXPECT_EQ(pthread_mutexattr_init(&attributes), 0);
+    EXPECT_EQ(pthread_mutexattr_settype(&attributes, type), 0);
+    EXPECT_EQ(pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT), 0);
+    EXPECT_EQ(pthread_mutex_init(&mutex, &attributes), 0);
+    EXPECT_EQ(pthread_mutexattr_destroy(&attributes), 0);
+}
+
+TEST_CASE(mutexattr_protocol)
+{
+    pthread_mutexattr_t attributes;
+    EXPECT_EQ(pthread_mutexattr_init(&attributes), 0);
+
+    int protocol = -1;
+    EXPECT_EQ(pthread_mutexattr_getprotocol(&attributes, &protocol), 0);
+    EXPECT_EQ(protocol, PTHREAD_PRIO_NONE);
+
+    EXPECT_EQ(pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT), 0);
+    EXPECT_EQ(pthread_mutexattr_getprotocol(&attributes, &protocol), 0);
+    EXPECT_EQ(protocol, PTHREAD_PRIO_INHERIT);
+
+    EXPECT_EQ(pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_PROTECT), ENOTSUP);
+    EXPECT_EQ(pthread_mutexattr_setprotocol(&attributes, 1234), EINVAL);
+    EXPECT_EQ(pthread_mutexattr_destroy(&attributes), 0);
+}
+
+TEST_CASE(lock_unlock_trylock)
+{
+    pthread_mutex_t mutex;
+    init_priority_inheriting_mutex(mutex);
+
+    EXPECT_EQ(pthread_mutex_lock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_trylock(&mutex), EBUSY);
+    EXPECT_EQ(pthread_mutex_unlock(&mutex), 0);
+
+    EXPECT_EQ(pthread_mutex_trylock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_unlock(&mutex), 0);
+
+    EXPECT_EQ(pthread_mutex_lock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_unlock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_destroy(&mutex), 0);
+}
+
+TEST_CASE(relocking_is_a_deadlock)
+{
+    pthread_mutex_t mutex;
+    init_priority_inheriting_mutex(mutex);
+
+    EXPECT_EQ(pthread_mutex_lock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_lock(&mutex), EDEADLK);
+    EXPECT_EQ(pthread_mutex_unlock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_destroy(&mutex), 0);
+}
+
+TEST_CASE(recursive_lock)
+{
+    pthread_mutex_t mutex;
+    init_priority_inheriting_mutex(mutex, PTHREAD_MUTEX_RECURSIVE);
+
+    EXPECT_EQ(pthread_mutex_lock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_lock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_trylock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_unlock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_unlock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_unlock(&mutex), 0);
+
+    // It has to be unlocked now, or this would be a deadlock.
+    EXPECT_EQ(pthread_mutex_trylock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_unlock(&mutex), 0);
+    EXPECT_EQ(pthread_mutex_destroy(&mutex), 0);
+}
+
+struct ContendedState {
+    pthread_mutex_t mutex;
+    Atomic<bool> tried_to_lock { false };
+    Atomic<bool> holds_lock { false };
+    int trylock_result { -1 };
+    int lock_result { -1 };
+};
+
+TEST_CASE(contended_lock_is_handed_over)
+{
+    ContendedState state;
+    init_priority_inheriting_mutex(state.mutex);
+    EXPECT_EQ(pthread_mutex_lock(&state.mutex), 0);
+
+    pthread_t thread;
+    EXPECT_EQ(pthread_create(
+                  &thread, nullptr, [](void* argument) -> void* {
+                      auto& state = *static_cast<ContendedState*>(argument);
+                      state.trylock_result = pthread_mutex_trylock(&state.mutex);
+                      state.tried_to_lock = true;
+                      // This has to wait in the kernel until the main thread unlocks the mutex.
+                      state.lock_result = pthread_mutex_lock(&state.mutex);
+                      state.holds_lock = true;
+                      pthread_mutex_unlock(&state.mutex);
+                      return nullptr;
+                  },
+                  &state),
+        0);
+
+    while (!state.tried_to_lock)
+        usleep(1000);
+    // Give the thread some time to block on the mutex.
+    usleep(50000);
+    EXPECT(!state.holds_lock);
+    EXPECT_EQ(pthread_mutex_unlock(&state.mutex), 0);
+
+    EXPECT_EQ(pthread_join(thread, nullptr), 0);
+    EXPECT_EQ(state.trylock_result, EBUSY);
+    EXPECT_EQ(state.lock_result, 0);
+    EXPECT(state.holds_lock);
+
+    // The thread unlocked it again before exiting.
+    EXPECT_EQ(pthread_mutex_trylock(&state.mutex), 0);
+    EXPECT_EQ(pthread_mutex_unlock(&state.mutex), 0);
+    EXPECT_EQ(pthread_mutex_destroy(&state.mutex), 0);
+}
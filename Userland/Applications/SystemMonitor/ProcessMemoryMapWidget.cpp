@@ -102,6 +102,7 @@ ProcessMemoryMapWidget::ProcessMemoryMapWidget()
             return pagemap;
         });
     pid_vm_fields.empend("cow_pages", "# CoW", Gfx::TextAlignment::CenterRight);
+    pid_vm_fields.empend("amount_large_page_backed", "Large pages", Gfx::TextAlignment::CenterRight);
     pid_vm_fields.empend("name", "Name", Gfx::TextAlignment::CenterLeft);
     m_json_model = GUI::JsonArrayModel::create({}, move(pid_vm_fields));
     m_table_view->set_model(MUST(GUI::SortingProxyModel::create(*m_json_model)));
@@ -425,23 +425,37 @@ static DeprecatedString read_command_line(pid_t pid)
     return string_or_error.release_value();
 }
 
+ErrorOr<void> ProcessModel::update_all_processes()
+{
+    if (!m_proc_all)
+        m_proc_all = TRY(Core::File::open("/sys/kernel/process_statistics"sv, Core::File::OpenMode::Read));
+    if (auto result = Core::ProcessStatisticsReader::update(*m_proc_all, m_all_processes); result.is_error()) {
+        // Start over with a complete snapshot next time.
+        m_proc_all = nullptr;
+        m_all_processes = {};
+        return result.release_error();
+    }
+    return {};
+}
+
 void ProcessModel::update()
 {
     auto previous_tid_count = m_threads.size();
-    auto all_processes = Core::ProcessStatisticsReader::get_all(m_proc_all);
+    auto update_result = update_all_processes();
 
     HashTable<int> live_tids;
     u64 total_time_scheduled_diff = 0;
-    if (!all_processes.is_error()) {
+    if (!update_result.is_error()) {
+        auto const& all_processes = m_all_processes;
         if (m_has_total_scheduled_time)
-            total_time_scheduled_diff = all_processes.value().total_time_scheduled - m_total_time_scheduled;
+            total_time_scheduled_diff = all_processes.total_time_scheduled - m_total_time_scheduled;
 
-        m_total_time_scheduled = all_processes.value().total_time_scheduled;
-        m_total_time_scheduled_kernel = all_processes.value().total_time_scheduled_kernel;
+        m_total_time_scheduled = all_processes.total_time_scheduled;
+        m_total_time_scheduled_kernel = all_processes.total_time_scheduled_kernel;
         m_has_total_scheduled_time = true;
 
-        for (size_t i = 0; i < all_processes.value().processes.size(); ++i) {
-            auto const& process = all_processes.value().processes[i];
+        for (size_t i = 0; i < all_processes.processes.size(); ++i) {
+            auto const& process = all_processes.processes[i];
             NonnullOwnPtr<Process>* process_state = nullptr;
             for (size_t i = 0; i < m_processes.size(); ++i) {
                 auto* other_process = &m_processes.ptr_at(i);
@@ -548,7 +562,7 @@ void ProcessModel::update()
         on_cpu_info_change(m_cpus);
 
     if (on_state_update)
-        on_state_update(!all_processes.is_error() ? all_processes.value().processes.size() : 0, m_threads.size());
+        on_state_update(!update_result.is_error() ? m_all_processes.processes.size() : 0, m_threads.size());
 
     // FIXME: This is a rather hackish way of invalidating indices.
     //        It would be good if GUI::Model had a way to orchestrate removal/insertion while preserving indices.
@@ -11,6 +11,8 @@
 #include <AK/HashMap.h>
 #include <AK/NonnullOwnPtrVector.h>
 #include <AK/Vector.h>
+#include <LibCore/File.h>
+#include <LibCore/ProcessStatisticsReader.h>
 #include <LibGUI/Icon.h>
 #include <LibGUI/Model.h>
 #include <LibGUI/ModelIndex.h>
@@ -241,11 +243,15 @@ private:
 
     int thread_model_row(Thread const& thread) const;
 
+    ErrorOr<void> update_all_processes();
+
     // The thread list contains the same threads as the Process structs.
     HashMap<int, NonnullRefPtr<Thread>> m_threads;
     NonnullOwnPtrVector<Process> m_processes;
     NonnullOwnPtrVector<CpuInfo> m_cpus;
-    RefPtr<Core::DeprecatedFile> m_proc_all;
+    // Kept open between updates, so that only the processes that changed have to be read again.
+    OwnPtr<Core::File> m_proc_all;
+    Core::AllProcessesStatistics m_all_processes;
     GUI::Icon m_kernel_process_icon;
     u64 m_total_time_scheduled { 0 };
     u64 m_total_time_scheduled_kernel { 0 };
@@ -6,8 +6,6 @@
  */
 
 #include "CatDog.h"
-#include <LibCore/File.h>
-#include <LibCore/ProcessStatisticsReader.h>
 #include <LibGUI/Painter.h>
 #include <LibGUI/Window.h>
 
@@ -56,7 +54,6 @@ ErrorOr<NonnullRefPtr<CatDog>> CatDog::create()
 }
 
 CatDog::CatDog()
-    : m_proc_all(MUST(Core::File::open("/sys/kernel/processes"sv, Core::File::OpenMode::Read)))
 {
     m_idle_sleep_timer.start();
 }
@@ -69,11 +66,19 @@ void CatDog::set_roaming(bool roaming)
 
 CatDog::State CatDog::special_application_states() const
 {
-    auto maybe_proc_info = Core::ProcessStatisticsReader::get_all(*m_proc_all);
-    if (maybe_proc_info.is_error())
+    auto update_proc_info = [&]() -> ErrorOr<void> {
+        if (!m_proc_all)
+            m_proc_all = TRY(Core::File::open("/sys/kernel/process_statistics"sv, Core::File::OpenMode::Read));
+        return Core::ProcessStatisticsReader::update(*m_proc_all, m_proc_info);
+    };
+    if (update_proc_info().is_error()) {
+        // Start over with a complete snapshot next time.
+        m_proc_all = nullptr;
+        m_proc_info = {};
         return State::GenericCatDog;
+    }
 
-    auto proc_info = maybe_proc_info.release_value();
+    auto& proc_info = m_proc_info;
     auto maybe_paint_program = proc_info.processes.first_matching([](auto& process) {
         return process.name.equals_ignoring_case("pixelpaint"sv) || process.name.equals_ignoring_case("fonteditor"sv);
     });
@@ -12,6 +12,8 @@
 #include <AK/RefPtr.h>
 #include <AK/Types.h>
 #include <LibCore/ElapsedTimer.h>
+#include <LibCore/File.h>
+#include <LibCore/ProcessStatisticsReader.h>
 #include <LibGUI/Menu.h>
 #include <LibGUI/MouseTracker.h>
 #include <LibGUI/Widget.h>
@@ -73,7 +75,9 @@ private:
     Gfx::IntPoint m_mouse_offset {};
     Core::ElapsedTimer m_idle_sleep_timer;
 
-    NonnullOwnPtr<Core::File> m_proc_all;
+    // Kept open so that only the processes that changed have to be read again.
+    mutable OwnPtr<Core::File> m_proc_all;
+    mutable Core::AllProcessesStatistics m_proc_info;
 
     State m_state { State::Roaming };
     State m_frame { State::Frame1 };
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "LockContentionModel.h"
+#include "Profile.h"
+
+namespace Profiler {
+
+LockContentionModel::LockContentionModel(Profile& profile)
+    : m_profile(profile)
+{
+}
+
+int LockContentionModel::row_count(GUI::ModelIndex const&) const
+{
+    return m_profile.lock_contention_sites().size();
+}
+
+int LockContentionModel::column_count(GUI::ModelIndex const&) const
+{
+    return Column::__Count;
+}
+
+DeprecatedString LockContentionModel::column_name(int column) const
+{
+    switch (column) {
+    case Column::LockName:
+        return "Lock";
+    case Column::Role:
+        return "Role";
+    case Column::Site:
+        return "Site";
+    case Column::Count:
+        return "Count";
+    case Column::TotalWaitTime:
+        return "Total wait (us)";
+    case Column::MaxWaitTime:
+        return "Max wait (us)";
+    default:
+        VERIFY_NOT_REACHED();
+    }
+}
+
+GUI::Variant LockContentionModel::data(GUI::ModelIndex const& index, GUI::ModelRole role) const
+{
+    auto const& site = m_profile.lock_contention_sites()[index.row()];
+
+    if (role == GUI::ModelRole::Custom)
+        return site.example_event_index;
+
+    if (role == GUI::ModelRole::TextAlignment) {
+        if (index.column() == Column::Count || index.column() == Column::TotalWaitTime || index.column() == Column::MaxWaitTime)
+            return Gfx::TextAlignment::CenterRight;
+        return {};
+    }
+
+    if (role == GUI::ModelRole::Display) {
+        switch (index.column()) {
+        case Column::LockName:
+            if (site.lock == 0)
+                return site.lock_name;
+            return DeprecatedString::formatted("{} ({:p})", site.lock_name, site.lock);
+        case Column::Role:
+            return site.is_holder ? "Holder" : "Waiter";
+        case Column::Site:
+            return site.symbol;
+        case Column::Count:
+            return site.count;
+        case Column::TotalWaitTime:
+            if (site.is_holder)
+                return "";
+            return site.total_wait_time_ns / 1000;
+        case Column::MaxWaitTime:
+            if (site.is_holder)
+                return "";
+            return site.max_wait_time_ns / 1000;
+        default:
+            return {};
+        }
+    }
+    return {};
+}
+
+}
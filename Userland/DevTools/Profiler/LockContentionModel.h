@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <LibGUI/Model.h>
+
+namespace Profiler {
+
+class Profile;
+
+// Lists the places where kernel mutexes were contended, with the places where they were held
+// by the threads that made others wait.
+class LockContentionModel final : public GUI::Model {
+public:
+    static NonnullRefPtr<LockContentionModel> create(Profile& profile)
+    {
+        return adopt_ref(*new LockContentionModel(profile));
+    }
+
+    enum Column {
+        LockName,
+        Role,
+        Site,
+        Count,
+        TotalWaitTime,
+        MaxWaitTime,
+        __Count
+    };
+
+    virtual ~LockContentionModel() override = default;
+
+    virtual int row_count(GUI::ModelIndex const& = GUI::ModelIndex()) const override;
+    virtual int column_count(GUI::ModelIndex const& = GUI::ModelIndex()) const override;
+    virtual DeprecatedString column_name(int) const override;
+    virtual GUI::Variant data(GUI::ModelIndex const&, GUI::ModelRole) const override;
+    virtual bool is_column_sortable(int) const override { return false; }
+
+private:
+    explicit LockContentionModel(Profile&);
+
+    Profile& m_profile;
+};
+
+}
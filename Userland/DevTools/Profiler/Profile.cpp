@@ -9,6 +9,9 @@
 #include "ProfileModel.h"
 #include "SamplesModel.h"
 #include "SourceModel.h"
+#include <AK/AnyOf.h>
+#include <AK/Array.h>
+#include <AK/HashMap.h>
 #include <AK/HashTable.h>
 #include <AK/LexicalPath.h>
 #include <AK/NonnullOwnPtrVector.h>
@@ -48,6 +51,8 @@ Profile::Profile(Vector<Process> processes, Vector<Event> events)
     m_model = ProfileModel::create(*this);
     m_samples_model = SamplesModel::create(*this);
     m_signposts_model = SignpostsModel::create(*this);
+    m_lock_contention_model = LockContentionModel::create(*this);
+    m_off_cpu_model = ProfileModel::create(*this, ProfileModel::Kind::OffCPU);
     m_file_event_model = FileEventModel::create(*this);
 
     rebuild_tree();
@@ -68,11 +73,65 @@ GUI::Model& Profile::signposts_model()
     return *m_signposts_model;
 }
 
+GUI::Model& Profile::lock_contention_model()
+{
+    return *m_lock_contention_model;
+}
+
+GUI::Model& Profile::off_cpu_model()
+{
+    return *m_off_cpu_model;
+}
+
+// The frame that took or released the lock, skipping over the locking and profiling machinery itself.
+static Profile::Frame const* lock_contention_site(Profile::Event const& event)
+{
+    static constexpr Array ignored_prefixes {
+        "Kernel::Mutex"sv,
+        "Kernel::MutexLocker"sv,
+        "Kernel::PerformanceEventBuffer"sv,
+        "Kernel::PerformanceManager"sv,
+        "Kernel::Thread::block"sv,
+    };
+    for (ssize_t i = event.frames.size() - 1; i >= 0; --i) {
+        auto const& frame = event.frames[i];
+        if (!any_of(ignored_prefixes, [&](auto prefix) { return frame.symbol.starts_with(prefix); }))
+            return &frame;
+    }
+    return nullptr;
+}
+
+static DeprecatedString off_cpu_reason_frame(Profile::Event::OffCPUData const& data)
+{
+    if (data.reason == "io"sv)
+        return DeprecatedString::formatted("[I/O] {}", data.blocker);
+    if (data.reason == "lock"sv)
+        return DeprecatedString::formatted("[Lock] {}", data.blocker);
+    if (data.reason == "sleep"sv)
+        return DeprecatedString::formatted("[Sleep] {}", data.blocker);
+    return DeprecatedString::formatted("[Wait] {}", data.blocker);
+}
+
+// The number of frames of an off-CPU event's backtrace to show, leaving out the profiler itself at the innermost end.
+static size_t off_cpu_frame_count(Profile::Event const& event)
+{
+    static constexpr Array ignored_prefixes {
+        "Kernel::PerformanceEventBuffer"sv,
+        "Kernel::PerformanceManager"sv,
+        "Kernel::Thread::end_off_cpu_interval"sv,
+    };
+    size_t frame_count = event.frames.size();
+    while (frame_count > 0 && any_of(ignored_prefixes, [&](auto prefix) { return event.frames[frame_count - 1].symbol.starts_with(prefix); }))
+        --frame_count;
+    return frame_count;
+}
+
 void Profile::rebuild_tree()
 {
     Vector<NonnullRefPtr<ProfileNode>> roots;
+    Vector<NonnullRefPtr<ProfileNode>> off_cpu_roots;
 
-    auto find_or_create_process_node = [this, &roots](pid_t pid, EventSerialNumber serial) -> ProfileNode& {
+    auto find_or_create_process_node_in = [this](Vector<NonnullRefPtr<ProfileNode>>& roots, pid_t pid, EventSerialNumber serial) -> ProfileNode& {
         auto const* process = find_process(pid, serial);
         if (!process) {
             dbgln("Profile contains event for unknown process with pid={}, serial={}", pid, serial.to_number());
@@ -86,6 +145,9 @@ void Profile::rebuild_tree()
         roots.append(new_root);
         return new_root;
     };
+    auto find_or_create_process_node = [&](pid_t pid, EventSerialNumber serial) -> ProfileNode& {
+        return find_or_create_process_node_in(roots, pid, serial);
+    };
 
     HashTable<FlatPtr> live_allocations;
 
@@ -102,8 +164,12 @@ void Profile::rebuild_tree()
 
     m_filtered_event_indices.clear();
     m_filtered_signpost_indices.clear();
+    m_lock_contention_sites.clear();
+    m_total_off_cpu_time_us = 0;
     m_file_event_nodes->children().clear();
 
+    HashMap<DeprecatedString, size_t> lock_contention_site_indices;
+
     for (size_t event_index = 0; event_index < m_events.size(); ++event_index) {
         auto& event = m_events.at(event_index);
 
@@ -121,6 +187,51 @@ void Profile::rebuild_tree()
             continue;
         }
 
+        if (auto* contention = event.data.get_pointer<Event::LockContentionData>()) {
+            auto const* site_frame = lock_contention_site(event);
+            auto symbol = site_frame ? site_frame->symbol : DeprecatedString("??");
+            auto key = DeprecatedString::formatted("{:p} {} {} {}", contention->lock, contention->name, contention->is_holder, symbol);
+            auto site_index = lock_contention_site_indices.ensure(key, [&] {
+                m_lock_contention_sites.append({ contention->name, contention->lock, contention->is_holder, symbol, 0, 0, 0, event_index });
+                return m_lock_contention_sites.size() - 1;
+            });
+            auto& site = m_lock_contention_sites[site_index];
+            ++site.count;
+            site.total_wait_time_ns += contention->wait_time_ns;
+            if (contention->wait_time_ns > site.max_wait_time_ns) {
+                site.max_wait_time_ns = contention->wait_time_ns;
+                site.example_event_index = event_index;
+            }
+            continue;
+        }
+
+        if (auto* off_cpu = event.data.get_pointer<Event::OffCPUData>()) {
+            auto frame_count = off_cpu_frame_count(event);
+            // Blocked time goes below a frame for what the thread waited for, the time it then took to get a processor
+            // again below a frame of its own, so that flame graphs split the latency up by its cause right at the bottom.
+            auto add_off_cpu_time = [&](DeprecatedString reason_frame, u64 time_ns) {
+                auto time_us = time_ns / 1000;
+                if (time_us == 0)
+                    return;
+                m_total_off_cpu_time_us += time_us;
+                auto& process_node = find_or_create_process_node_in(off_cpu_roots, event.pid, event.serial);
+                process_node.add_to_event_count(time_us);
+                auto* node = &process_node.find_or_create_child({}, move(reason_frame), 0, 0, event.timestamp, event.pid);
+                node->add_to_event_count(time_us);
+                for (size_t i = 0; i < frame_count; ++i) {
+                    auto const& frame = event.frames.at(i);
+                    if (frame.symbol.is_empty())
+                        break;
+                    node = &node->find_or_create_child(frame.object_name, frame.symbol, frame.address, frame.offset, event.timestamp, event.pid);
+                    node->add_to_event_count(time_us);
+                }
+                node->add_to_self_count(time_us);
+            };
+            add_off_cpu_time(off_cpu_reason_frame(*off_cpu), off_cpu->blocked_ns);
+            add_off_cpu_time("[Scheduling delay]", off_cpu->runnable_ns);
+            continue;
+        }
+
         m_filtered_event_indices.append(event_index);
 
         if (auto* malloc_data = event.data.get_pointer<Event::MallocData>(); malloc_data && !live_allocations.contains(malloc_data->ptr))
@@ -225,9 +336,19 @@ void Profile::rebuild_tree()
     }
 
     sort_profile_nodes(roots);
+    sort_profile_nodes(off_cpu_roots);
+
+    quick_sort(m_lock_contention_sites, [](auto& a, auto& b) {
+        if (a.total_wait_time_ns != b.total_wait_time_ns)
+            return a.total_wait_time_ns > b.total_wait_time_ns;
+        return a.count > b.count;
+    });
 
     m_roots = move(roots);
+    m_off_cpu_roots = move(off_cpu_roots);
     m_model->invalidate();
+    m_off_cpu_model->invalidate();
+    m_lock_contention_model->invalidate();
 }
 
 Optional<MappedObject> g_kernel_debuginfo_object;
@@ -395,6 +516,23 @@ ErrorOr<NonnullOwnPtr<Profile>> Profile::load_from_perfcore_file(StringView path
                 .start_timestamp = perf_event.get_integer<size_t>("start_timestamp"sv).value_or(0),
                 .success = perf_event.get_bool("success"sv).value_or(false)
             };
+        } else if (type_string == "lock_contention"sv) {
+            auto is_holder = perf_event.get_deprecated_string("role"sv).value_or({}) == "holder"sv;
+            event.data = Event::LockContentionData {
+                .lock = perf_event.get_addr("lock"sv).value_or(0),
+                .name = perf_event.get_deprecated_string("name"sv).value_or({}),
+                .is_holder = is_holder,
+                .holder_tid = perf_event.get_integer<pid_t>("holder_tid"sv).value_or(0),
+                .waiter_count = perf_event.get_u32("waiter_count"sv).value_or(0),
+                .wait_time_ns = perf_event.get_u64("wait_time_ns"sv).value_or(0),
+            };
+        } else if (type_string == "off_cpu"sv) {
+            event.data = Event::OffCPUData {
+                .reason = perf_event.get_deprecated_string("reason"sv).value_or("other"),
+                .blocker = perf_event.get_deprecated_string("blocker"sv).value_or({}),
+                .blocked_ns = perf_event.get_u64("blocked_ns"sv).value_or(0),
+                .runnable_ns = perf_event.get_u64("runnable_ns"sv).value_or(0),
+            };
         } else {
             dbgln("Unknown event type '{}'", type_string);
             VERIFY_NOT_REACHED();
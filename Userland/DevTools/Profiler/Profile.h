@@ -8,6 +8,7 @@
 
 #include "DisassemblyModel.h"
 #include "FilesystemEventModel.h"
+#include "LockContentionModel.h"
 #include "Process.h"
 #include "Profile.h"
 #include "ProfileModel.h"
@@ -59,8 +60,8 @@ public:
     u32 offset() const { return m_offset; }
     u64 timestamp() const { return m_timestamp; }
 
-    u32 event_count() const { return m_event_count; }
-    u32 self_count() const { return m_self_count; }
+    u64 event_count() const { return m_event_count; }
+    u64 self_count() const { return m_self_count; }
 
     int child_count() const { return m_children.size(); }
     Vector<NonnullRefPtr<ProfileNode>> const& children() const { return m_children; }
@@ -92,6 +93,8 @@ public:
 
     void increment_event_count() { ++m_event_count; }
     void increment_self_count() { ++m_self_count; }
+    void add_to_event_count(u64 count) { m_event_count += count; }
+    void add_to_self_count(u64 count) { m_self_count += count; }
 
     void sort_children();
 
@@ -122,8 +125,8 @@ private:
     pid_t m_pid { 0 };
     FlatPtr m_address { 0 };
     u32 m_offset { 0 };
-    u32 m_event_count { 0 };
-    u32 m_self_count { 0 };
+    u64 m_event_count { 0 };
+    u64 m_self_count { 0 };
     u64 m_timestamp { 0 };
     Vector<NonnullRefPtr<ProfileNode>> m_children;
     HashMap<FlatPtr, size_t> m_events_per_address;
@@ -148,6 +151,8 @@ public:
     GUI::Model& model();
     GUI::Model& samples_model();
     GUI::Model& signposts_model();
+    GUI::Model& lock_contention_model();
+    GUI::Model& off_cpu_model();
     GUI::Model* disassembly_model();
     GUI::Model* source_model();
     GUI::Model* file_event_model();
@@ -164,6 +169,9 @@ public:
     void set_source_index(GUI::ModelIndex const&);
 
     Vector<NonnullRefPtr<ProfileNode>> const& roots() const { return m_roots; }
+    // The same call trees, but weighed by the microseconds that threads spent off-CPU instead of by samples.
+    Vector<NonnullRefPtr<ProfileNode>> const& off_cpu_roots() const { return m_off_cpu_roots; }
+    u64 total_off_cpu_time_us() const { return m_total_off_cpu_time_us; }
 
     struct Frame {
         DeprecatedFlyString object_name;
@@ -231,12 +239,44 @@ public:
             bool success;
         };
 
-        Variant<nullptr_t, SampleData, MallocData, FreeData, SignpostData, MmapData, MunmapData, ProcessCreateData, ProcessExecData, ThreadCreateData, ReadData> data { nullptr };
+        struct LockContentionData {
+            FlatPtr lock {};
+            DeprecatedString name;
+            bool is_holder { false };
+            pid_t holder_tid {};
+            u32 waiter_count {};
+            u64 wait_time_ns {};
+        };
+
+        struct OffCPUData {
+            // One of "io", "lock", "sleep" or "other".
+            DeprecatedString reason;
+            DeprecatedString blocker;
+            u64 blocked_ns {};
+            u64 runnable_ns {};
+        };
+
+        Variant<nullptr_t, SampleData, MallocData, FreeData, SignpostData, MmapData, MunmapData, ProcessCreateData, ProcessExecData, ThreadCreateData, ReadData, LockContentionData, OffCPUData> data { nullptr };
+    };
+
+    // All contention events for one lock that were recorded at the same place, either by threads
+    // waiting for the lock or by the threads that made them wait.
+    struct LockContentionSite {
+        DeprecatedString lock_name;
+        FlatPtr lock { 0 };
+        bool is_holder { false };
+        DeprecatedString symbol;
+        u64 count { 0 };
+        u64 total_wait_time_ns { 0 };
+        u64 max_wait_time_ns { 0 };
+        // The event with the longest wait, or the first holder event.
+        size_t example_event_index { 0 };
     };
 
     Vector<Event> const& events() const { return m_events; }
     Vector<size_t> const& filtered_event_indices() const { return m_filtered_event_indices; }
     Vector<size_t> const& filtered_signpost_indices() const { return m_filtered_signpost_indices; }
+    Vector<LockContentionSite> const& lock_contention_sites() const { return m_lock_contention_sites; }
     NonnullRefPtr<FileEventNode> const& file_event_nodes() { return m_file_event_nodes; }
 
     u64 length_in_ms() const { return m_last_timestamp - m_first_timestamp; }
@@ -294,6 +334,8 @@ private:
     RefPtr<ProfileModel> m_model;
     RefPtr<SamplesModel> m_samples_model;
     RefPtr<SignpostsModel> m_signposts_model;
+    RefPtr<LockContentionModel> m_lock_contention_model;
+    RefPtr<ProfileModel> m_off_cpu_model;
     RefPtr<DisassemblyModel> m_disassembly_model;
     RefPtr<SourceModel> m_source_model;
     RefPtr<FileEventModel> m_file_event_model;
@@ -302,6 +344,8 @@ private:
     GUI::ModelIndex m_source_index;
 
     Vector<NonnullRefPtr<ProfileNode>> m_roots;
+    Vector<NonnullRefPtr<ProfileNode>> m_off_cpu_roots;
+    u64 m_total_off_cpu_time_us { 0 };
     Vector<size_t> m_filtered_event_indices;
     u64 m_first_timestamp { 0 };
     u64 m_last_timestamp { 0 };
@@ -310,6 +354,7 @@ private:
     Vector<Event> m_events;
     Vector<size_t> m_signpost_indices;
     Vector<size_t> m_filtered_signpost_indices;
+    Vector<LockContentionSite> m_lock_contention_sites;
 
     bool m_has_timestamp_filter_range { false };
     u64 m_timestamp_filter_range_start { 0 };
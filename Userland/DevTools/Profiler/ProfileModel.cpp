@@ -15,19 +15,34 @@
 
 namespace Profiler {
 
-ProfileModel::ProfileModel(Profile& profile)
+ProfileModel::ProfileModel(Profile& profile, Kind kind)
     : m_profile(profile)
+    , m_kind(kind)
 {
     m_user_frame_icon.set_bitmap_for_size(16, Gfx::Bitmap::load_from_file("/res/icons/16x16/inspector-object.png"sv).release_value_but_fixme_should_propagate_errors());
     m_kernel_frame_icon.set_bitmap_for_size(16, Gfx::Bitmap::load_from_file("/res/icons/16x16/inspector-object-red.png"sv).release_value_but_fixme_should_propagate_errors());
 }
 
+Vector<NonnullRefPtr<ProfileNode>> const& ProfileModel::roots() const
+{
+    if (m_kind == Kind::OffCPU)
+        return m_profile.off_cpu_roots();
+    return m_profile.roots();
+}
+
+u64 ProfileModel::total_weight() const
+{
+    if (m_kind == Kind::OffCPU)
+        return m_profile.total_off_cpu_time_us();
+    return m_profile.filtered_event_indices().size();
+}
+
 GUI::ModelIndex ProfileModel::index(int row, int column, GUI::ModelIndex const& parent) const
 {
     if (!parent.is_valid()) {
-        if (m_profile.roots().is_empty())
+        if (roots().is_empty())
             return {};
-        return create_index(row, column, m_profile.roots().at(row).ptr());
+        return create_index(row, column, roots().at(row).ptr());
     }
     auto& remote_parent = *static_cast<ProfileNode*>(parent.internal_data());
     return create_index(row, column, remote_parent.children().at(row).ptr());
@@ -43,8 +58,8 @@ GUI::ModelIndex ProfileModel::parent_index(GUI::ModelIndex const& index) const
 
     // NOTE: If the parent has no parent, it's a root, so we have to look among the roots.
     if (!node.parent()->parent()) {
-        for (size_t row = 0; row < m_profile.roots().size(); ++row) {
-            if (m_profile.roots()[row].ptr() == node.parent()) {
+        for (size_t row = 0; row < roots().size(); ++row) {
+            if (roots()[row].ptr() == node.parent()) {
                 return create_index(row, index.column(), node.parent());
             }
         }
@@ -64,7 +79,7 @@ GUI::ModelIndex ProfileModel::parent_index(GUI::ModelIndex const& index) const
 int ProfileModel::row_count(GUI::ModelIndex const& index) const
 {
     if (!index.is_valid())
-        return m_profile.roots().size();
+        return roots().size();
     auto& node = *static_cast<ProfileNode*>(index.internal_data());
     return node.children().size();
 }
@@ -78,8 +93,12 @@ DeprecatedString ProfileModel::column_name(int column) const
 {
     switch (column) {
     case Column::SampleCount:
+        if (m_kind == Kind::OffCPU)
+            return m_profile.show_percentages() ? "% Off-CPU" : "Off-CPU (us)";
         return m_profile.show_percentages() ? "% Samples" : "# Samples";
     case Column::SelfCount:
+        if (m_kind == Kind::OffCPU)
+            return m_profile.show_percentages() ? "% Self" : "Self (us)";
         return m_profile.show_percentages() ? "% Self" : "# Self";
     case Column::ObjectName:
         return "Object";
@@ -115,12 +134,12 @@ GUI::Variant ProfileModel::data(GUI::ModelIndex const& index, GUI::ModelRole rol
     if (role == GUI::ModelRole::Display) {
         if (index.column() == Column::SampleCount) {
             if (m_profile.show_percentages())
-                return format_percentage(node->event_count(), m_profile.filtered_event_indices().size());
+                return format_percentage(node->event_count(), total_weight());
             return node->event_count();
         }
         if (index.column() == Column::SelfCount) {
             if (m_profile.show_percentages())
-                return format_percentage(node->self_count(), m_profile.filtered_event_indices().size());
+                return format_percentage(node->self_count(), total_weight());
             return node->self_count();
         }
         if (index.column() == Column::ObjectName)
@@ -146,10 +165,10 @@ GUI::Variant ProfileModel::data(GUI::ModelIndex const& index, GUI::ModelRole rol
 
 Vector<GUI::ModelIndex> ProfileModel::matches(StringView searching, unsigned flags, GUI::ModelIndex const& parent)
 {
-    RemoveReference<decltype(m_profile.roots())>* nodes { nullptr };
+    RemoveReference<decltype(roots())>* nodes { nullptr };
 
     if (!parent.is_valid())
-        nodes = &m_profile.roots();
+        nodes = &roots();
     else
         nodes = &static_cast<ProfileNode*>(parent.internal_data())->children();
 
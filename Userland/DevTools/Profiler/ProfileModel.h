@@ -13,12 +13,20 @@
 namespace Profiler {
 
 class Profile;
+class ProfileNode;
 
 class ProfileModel final : public GUI::Model {
 public:
-    static NonnullRefPtr<ProfileModel> create(Profile& profile)
+    enum class Kind {
+        // Nodes are weighed by the number of events (usually samples) in them.
+        Events,
+        // Nodes are weighed by the microseconds that threads spent blocked or waiting for a processor in them.
+        OffCPU,
+    };
+
+    static NonnullRefPtr<ProfileModel> create(Profile& profile, Kind kind = Kind::Events)
     {
-        return adopt_ref(*new ProfileModel(profile));
+        return adopt_ref(*new ProfileModel(profile, kind));
     }
 
     enum Column {
@@ -44,9 +52,13 @@ public:
     virtual Vector<GUI::ModelIndex> matches(StringView, unsigned flags, GUI::ModelIndex const&) override;
 
 private:
-    explicit ProfileModel(Profile&);
+    ProfileModel(Profile&, Kind);
+
+    Vector<NonnullRefPtr<ProfileNode>> const& roots() const;
+    u64 total_weight() const;
 
     Profile& m_profile;
+    Kind m_kind { Kind::Events };
 
     GUI::Icon m_user_frame_icon;
     GUI::Icon m_kernel_frame_icon;
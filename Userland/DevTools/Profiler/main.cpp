@@ -211,12 +211,33 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
         individual_signpost_view->set_model(move(model));
     };
 
+    auto lock_contention_tab = TRY(tab_widget->try_add_tab<GUI::Widget>("Lock Contention"));
+    lock_contention_tab->set_layout<GUI::VerticalBoxLayout>();
+    lock_contention_tab->layout()->set_margins(4);
+
+    auto lock_contention_splitter = TRY(lock_contention_tab->try_add<GUI::HorizontalSplitter>());
+    auto lock_contention_table_view = TRY(lock_contention_splitter->try_add<GUI::TableView>());
+    lock_contention_table_view->set_model(profile->lock_contention_model());
+
+    auto individual_lock_contention_view = TRY(lock_contention_splitter->try_add<GUI::TableView>());
+    lock_contention_table_view->on_selection_change = [&] {
+        auto const& index = lock_contention_table_view->selection().first();
+        auto model = IndividualSampleModel::create(*profile, index.data(GUI::ModelRole::Custom).to_integer<size_t>());
+        individual_lock_contention_view->set_model(move(model));
+    };
+
     auto flamegraph_tab = TRY(tab_widget->try_add_tab<GUI::Widget>("Flame Graph"));
     flamegraph_tab->set_layout<GUI::VerticalBoxLayout>();
     flamegraph_tab->layout()->set_margins({ 4, 4, 4, 4 });
 
     auto flamegraph_view = TRY(flamegraph_tab->try_add<FlameGraphView>(profile->model(), ProfileModel::Column::StackFrame, ProfileModel::Column::SampleCount));
 
+    auto off_cpu_flamegraph_tab = TRY(tab_widget->try_add_tab<GUI::Widget>("Off-CPU Flame Graph"));
+    off_cpu_flamegraph_tab->set_layout<GUI::VerticalBoxLayout>();
+    off_cpu_flamegraph_tab->layout()->set_margins({ 4, 4, 4, 4 });
+
+    auto off_cpu_flamegraph_view = TRY(off_cpu_flamegraph_tab->try_add<FlameGraphView>(profile->off_cpu_model(), ProfileModel::Column::StackFrame, ProfileModel::Column::SampleCount));
+
     u64 const start_of_trace = profile->first_timestamp();
     u64 const end_of_trace = start_of_trace + profile->length_in_ms();
     auto const clamp_timestamp = [start_of_trace, end_of_trace](u64 timestamp) -> u64 {
@@ -230,6 +251,12 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
         return DeprecatedString::formatted("{} Samples", sample_count.to_i32());
     };
 
+    auto const format_off_cpu_time = [&profile](auto const time_us) {
+        if (profile->show_percentages())
+            return DeprecatedString::formatted("{}%", time_us.as_string());
+        return DeprecatedString::formatted("{} us", time_us.template to_integer<u64>());
+    };
+
     auto statusbar = TRY(main_widget->try_add<GUI::Statusbar>());
     auto statusbar_update = [&] {
         auto& view = *timeline_view;
@@ -243,6 +270,13 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
             builder.appendff("{}, ", stack);
             builder.appendff("Samples: {}, ", format_sample_count(sample_count));
             builder.appendff("Self: {}", format_sample_count(self_count));
+        } else if (auto off_cpu_hovered_index = off_cpu_flamegraph_view->hovered_index(); off_cpu_hovered_index.is_valid()) {
+            auto stack = profile->off_cpu_model().data(off_cpu_hovered_index.sibling_at_column(ProfileModel::Column::StackFrame)).to_deprecated_string();
+            auto off_cpu_time = profile->off_cpu_model().data(off_cpu_hovered_index.sibling_at_column(ProfileModel::Column::SampleCount));
+            auto self_time = profile->off_cpu_model().data(off_cpu_hovered_index.sibling_at_column(ProfileModel::Column::SelfCount));
+            builder.appendff("{}, ", stack);
+            builder.appendff("Off-CPU: {}, ", format_off_cpu_time(off_cpu_time));
+            builder.appendff("Self: {}", format_off_cpu_time(self_time));
         } else {
             u64 normalized_start_time = clamp_timestamp(min(view.select_start_time(), view.select_end_time()));
             u64 normalized_end_time = clamp_timestamp(max(view.select_start_time(), view.select_end_time()));
@@ -259,6 +293,7 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
     };
     timeline_view->on_selection_change = [&] { statusbar_update(); };
     flamegraph_view->on_hover_change = [&] { statusbar_update(); };
+    off_cpu_flamegraph_view->on_hover_change = [&] { statusbar_update(); };
 
     auto filesystem_events_tab = TRY(tab_widget->try_add_tab<GUI::Widget>("Filesystem events"));
     filesystem_events_tab->set_layout<GUI::VerticalBoxLayout>();
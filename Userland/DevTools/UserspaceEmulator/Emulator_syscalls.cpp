@@ -92,6 +92,9 @@ u32 Emulator::virt_syscall(u32 function, u32 arg1, u32 arg2, u32 arg3)
         return virt$fcntl(arg1, arg2, arg3);
     case SC_fork:
         return virt$fork();
+    case SC_vfork:
+        // NOTE: The emulated child gets its own copy of the emulator either way, which vfork() allows.
+        return virt$fork();
     case SC_fstat:
         return virt$fstat(arg1, arg2);
     case SC_ftruncate:
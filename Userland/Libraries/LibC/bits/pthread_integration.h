@@ -26,14 +26,19 @@ void __pthread_key_destroy_for_current_thread(void);
 
 #define __PTHREAD_MUTEX_NORMAL 0
 #define __PTHREAD_MUTEX_RECURSIVE 1
-#define __PTHREAD_MUTEX_INITIALIZER     \
-    {                                   \
-        0, 0, 0, __PTHREAD_MUTEX_NORMAL \
+
+#define __PTHREAD_PRIO_NONE 0
+#define __PTHREAD_PRIO_INHERIT 1
+#define __PTHREAD_PRIO_PROTECT 2
+
+#define __PTHREAD_MUTEX_INITIALIZER                          \
+    {                                                        \
+        0, 0, 0, __PTHREAD_MUTEX_NORMAL, __PTHREAD_PRIO_NONE \
     }
 
-#define __PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP \
-    {                                            \
-        0, 0, 0, __PTHREAD_MUTEX_RECURSIVE       \
+#define __PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP                \
+    {                                                           \
+        0, 0, 0, __PTHREAD_MUTEX_RECURSIVE, __PTHREAD_PRIO_NONE \
     }
 
 __END_DECLS
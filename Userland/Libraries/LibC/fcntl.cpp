@@ -98,19 +98,18 @@ int openat(int dirfd, char const* path, int options, ...)
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
 
+ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t length, unsigned flags)
+{
+    Syscall::SC_splice_params params { fd_in, off_in, fd_out, off_out, length, flags };
+    int rc = syscall(SC_splice, &params);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_fadvise.html
 int posix_fadvise(int fd, off_t offset, off_t len, int advice)
 {
-    // Per POSIX:
-    // "The posix_fadvise() function shall have no effect on the semantics of other operations on the specified data,
-    // although it may affect the performance of other operations."
-
-    // For now, we simply ignore posix_fadvise() requests. In the future we may use them to optimize performance.
-    (void)fd;
-    (void)offset;
-    (void)len;
-    (void)advice;
-    return 0;
+    // posix_fadvise does not set errno.
+    return -static_cast<int>(syscall(SC_posix_fadvise, fd, &offset, &len, advice));
 }
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_fallocate.html
@@ -13,13 +13,6 @@
 
 __BEGIN_DECLS
 
-#define POSIX_FADV_DONTNEED 1
-#define POSIX_FADV_NOREUSE 2
-#define POSIX_FADV_NORMAL 3
-#define POSIX_FADV_RANDOM 4
-#define POSIX_FADV_SEQUENTIAL 5
-#define POSIX_FADV_WILLNEED 6
-
 int creat(char const* path, mode_t);
 int open(char const* path, int options, ...);
 int openat(int dirfd, char const* path, int options, ...);
@@ -29,6 +22,8 @@ int create_inode_watcher(unsigned flags);
 int inode_watcher_add_watch(int fd, char const* path, size_t path_length, unsigned event_mask);
 int inode_watcher_remove_watch(int fd, int wd);
 
+ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t length, unsigned flags);
+
 int posix_fadvise(int fd, off_t offset, off_t len, int advice);
 int posix_fallocate(int fd, off_t offset, off_t len);
 
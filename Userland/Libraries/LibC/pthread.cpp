@@ -229,6 +229,7 @@ int pthread_mutex_destroy(pthread_mutex_t*)
 int pthread_mutexattr_init(pthread_mutexattr_t* attr)
 {
     attr->type = PTHREAD_MUTEX_NORMAL;
+    attr->protocol = PTHREAD_PRIO_NONE;
     return 0;
 }
 
@@ -255,6 +256,30 @@ int pthread_mutexattr_gettype(pthread_mutexattr_t* attr, int* type)
     return 0;
 }
 
+// https://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_mutexattr_setprotocol.html
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t* attr, int protocol)
+{
+    if (!attr)
+        return EINVAL;
+    switch (protocol) {
+    case PTHREAD_PRIO_NONE:
+    case PTHREAD_PRIO_INHERIT:
+        attr->protocol = protocol;
+        return 0;
+    case PTHREAD_PRIO_PROTECT:
+        return ENOTSUP;
+    default:
+        return EINVAL;
+    }
+}
+
+// https://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_mutexattr_getprotocol.html
+int pthread_mutexattr_getprotocol(pthread_mutexattr_t const* attr, int* protocol)
+{
+    *protocol = attr->protocol;
+    return 0;
+}
+
 // https://pubs.opengroup.org/onlinepubs/009695399/functions/pthread_attr_init.html
 int pthread_attr_init(pthread_attr_t* attributes)
 {
@@ -106,7 +106,7 @@ int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const s
         return errno;
 
     // We might have been re-queued onto the mutex while we were sleeping. Take
-    // the pessimistic locking path.
+    // the pessimistic locking path, so that we wake the next requeued waiter.
     __pthread_mutex_lock_pessimistic_np(mutex);
     return 0;
 }
@@ -150,12 +150,28 @@ int pthread_cond_broadcast(pthread_cond_t* cond)
     if (!(value & NEED_TO_WAKE_ALL)) [[likely]]
         return 0;
 
-    AK::atomic_fetch_and(&cond->value, ~(NEED_TO_WAKE_ONE | NEED_TO_WAKE_ALL), AK::memory_order_acquire);
+    value = AK::atomic_fetch_and(&cond->value, ~(NEED_TO_WAKE_ONE | NEED_TO_WAKE_ALL), AK::memory_order_acquire);
+    value &= ~(NEED_TO_WAKE_ONE | NEED_TO_WAKE_ALL);
 
     pthread_mutex_t* mutex = AK::atomic_load(&cond->mutex, AK::memory_order_relaxed);
     VERIFY(mutex);
 
-    int rc = futex(&cond->value, FUTEX_REQUEUE | FUTEX_PRIVATE_FLAG, 1, nullptr, &mutex->lock, INT_MAX);
+    // Waking everyone up at once would only have them all fight over the mutex. So
+    // wake one of them and move the rest over to wait for the mutex instead, it wakes
+    // the next one whenever it is unlocked since they lock it pessimistically.
+    // The kernel hands priority inheriting mutexes over to specific threads, so we
+    // can't just put our waiters onto those.
+    if (mutex->protocol != __PTHREAD_PRIO_INHERIT) {
+        // NOTE: The requeue count is passed in place of the timeout.
+        int rc = futex(&cond->value, FUTEX_CMP_REQUEUE | FUTEX_PRIVATE_FLAG, 1, reinterpret_cast<timespec const*>(INT_MAX), &mutex->lock, value);
+        if (rc >= 0)
+            return 0;
+        // Someone else changed the value in the meantime, so we don't know whether
+        // all of our waiters were requeued. Just wake everybody instead.
+        VERIFY(errno == EAGAIN);
+    }
+
+    int rc = futex_wake(&cond->value, INT_MAX, false);
     VERIFY(rc >= 0);
     return 0;
 }
@@ -104,12 +104,77 @@ int pthread_mutex_init(pthread_mutex_t* mutex, pthread_mutexattr_t const* attrib
     mutex->owner = 0;
     mutex->level = 0;
     mutex->type = attributes ? attributes->type : __PTHREAD_MUTEX_NORMAL;
+    mutex->protocol = attributes ? attributes->protocol : __PTHREAD_PRIO_NONE;
     return 0;
 }
 
+// Priority inheriting mutexes store the owner's thread ID in the lock, so the kernel
+// knows whose priority to raise while we wait. Uncontended locking and unlocking still
+// happens entirely in userspace, see FUTEX_LOCK_PI.
+static bool is_priority_inheriting(pthread_mutex_t const* mutex)
+{
+    return mutex->protocol == __PTHREAD_PRIO_INHERIT;
+}
+
+static void did_lock_priority_inheriting_mutex(pthread_mutex_t* mutex)
+{
+    AK::atomic_store(&mutex->owner, pthread_self(), AK::memory_order_relaxed);
+    mutex->level = 0;
+}
+
+static int priority_inheriting_mutex_trylock(pthread_mutex_t* mutex)
+{
+    u32 expected = MUTEX_UNLOCKED;
+    if (AK::atomic_compare_exchange_strong(&mutex->lock, expected, static_cast<u32>(pthread_self()), AK::memory_order_acquire)) {
+        did_lock_priority_inheriting_mutex(mutex);
+        return 0;
+    }
+    if (mutex->type == __PTHREAD_MUTEX_RECURSIVE && AK::atomic_load(&mutex->owner, AK::memory_order_relaxed) == pthread_self()) {
+        mutex->level++;
+        return 0;
+    }
+    return EBUSY;
+}
+
+static int priority_inheriting_mutex_lock(pthread_mutex_t* mutex)
+{
+    if (priority_inheriting_mutex_trylock(mutex) == 0)
+        return 0;
+
+    for (;;) {
+        int rc = futex(&mutex->lock, FUTEX_LOCK_PI | FUTEX_PRIVATE_FLAG, 0, nullptr, nullptr, 0);
+        if (rc == 0)
+            break;
+        if (errno != EINTR)
+            return errno;
+    }
+    did_lock_priority_inheriting_mutex(mutex);
+    return 0;
+}
+
+static int priority_inheriting_mutex_unlock(pthread_mutex_t* mutex)
+{
+    if (mutex->type == __PTHREAD_MUTEX_RECURSIVE && mutex->level > 0) {
+        mutex->level--;
+        return 0;
+    }
+
+    AK::atomic_store(&mutex->owner, 0, AK::memory_order_relaxed);
+    u32 expected = static_cast<u32>(pthread_self());
+    if (AK::atomic_compare_exchange_strong(&mutex->lock, expected, MUTEX_UNLOCKED, AK::memory_order_release)) [[likely]]
+        return 0;
+
+    // Someone is waiting in the kernel, let it hand the mutex over.
+    int rc = futex(&mutex->lock, FUTEX_UNLOCK_PI | FUTEX_PRIVATE_FLAG, 0, nullptr, nullptr, 0);
+    return rc < 0 ? errno : 0;
+}
+
 // https://pubs.opengroup.org/onlinepubs/009695399/functions/pthread_mutex_trylock.html
 int pthread_mutex_trylock(pthread_mutex_t* mutex)
 {
+    if (is_priority_inheriting(mutex))
+        return priority_inheriting_mutex_trylock(mutex);
+
     u32 expected = MUTEX_UNLOCKED;
     bool exchanged = AK::atomic_compare_exchange_strong(&mutex->lock, expected, MUTEX_LOCKED_NO_NEED_TO_WAKE, AK::memory_order_acquire);
 
@@ -132,6 +197,9 @@ int pthread_mutex_trylock(pthread_mutex_t* mutex)
 // https://pubs.opengroup.org/onlinepubs/009695399/functions/pthread_mutex_lock.html
 int pthread_mutex_lock(pthread_mutex_t* mutex)
 {
+    if (is_priority_inheriting(mutex))
+        return priority_inheriting_mutex_lock(mutex);
+
     // Fast path: attempt to claim the mutex without waiting.
     u32 value = MUTEX_UNLOCKED;
     bool exchanged = AK::atomic_compare_exchange_strong(&mutex->lock, value, MUTEX_LOCKED_NO_NEED_TO_WAKE, AK::memory_order_acquire);
@@ -170,6 +238,9 @@ int __pthread_mutex_lock_pessimistic_np(pthread_mutex_t* mutex)
     // Same as pthread_mutex_lock(), but always set MUTEX_LOCKED_NEED_TO_WAKE,
     // and also don't bother checking for already owning the mutex recursively,
     // because we know we don't. Used in the condition variable implementation.
+    if (is_priority_inheriting(mutex))
+        return priority_inheriting_mutex_lock(mutex);
+
     u32 value = AK::atomic_exchange(&mutex->lock, MUTEX_LOCKED_NEED_TO_WAKE, AK::memory_order_acquire);
     while (value != MUTEX_UNLOCKED) {
         futex_wait(&mutex->lock, value, nullptr, 0, false);
@@ -185,6 +256,9 @@ int __pthread_mutex_lock_pessimistic_np(pthread_mutex_t* mutex)
 // https://pubs.opengroup.org/onlinepubs/009695399/functions/pthread_mutex_unlock.html
 int pthread_mutex_unlock(pthread_mutex_t* mutex)
 {
+    if (is_priority_inheriting(mutex))
+        return priority_inheriting_mutex_unlock(mutex);
+
     if (mutex->type == __PTHREAD_MUTEX_RECURSIVE && mutex->level > 0) {
         mutex->level--;
         return 0;
@@ -13,13 +13,19 @@
 
 #include <spawn.h>
 
+#include <AK/DeprecatedString.h>
 #include <AK/Function.h>
+#include <AK/Span.h>
 #include <AK/Vector.h>
+#include <LibCore/DeprecatedFile.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <syscall.h>
 #include <unistd.h>
 
 struct posix_spawn_file_actions_state {
@@ -28,8 +34,23 @@ struct posix_spawn_file_actions_state {
 
 extern "C" {
 
-[[noreturn]] static void posix_spawn_child(char const* path, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, char* const argv[], char* const envp[], int (*exec)(char const*, char* const[], char* const[]))
+// NOTE: This runs in a vfork() child, which borrows our memory (and our stack, below the frame of spawn()) until it
+//       execs or exits. So it must not return, allocate or leave anything behind that the parent would trip over.
+//       It also must not be inlined, as its locals would then live in the stack frame of spawn().
+[[noreturn]] static NEVER_INLINE void posix_spawn_child(Span<char const*> paths, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, sigset_t const* parent_signal_mask, char* const argv[], char* const envp[])
 {
+    // Our signal handlers are the parent's, and they must not run on memory the parent is still using.
+    struct sigaction default_action;
+    default_action.sa_flags = 0;
+    sigemptyset(&default_action.sa_mask);
+    default_action.sa_handler = SIG_DFL;
+    for (int i = 1; i < NSIG; ++i) {
+        struct sigaction action;
+        if (sigaction(i, nullptr, &action) == 0 && action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN)
+            (void)sigaction(i, &default_action, nullptr);
+    }
+
+    sigset_t const* signal_mask = parent_signal_mask;
     if (attr) {
         short flags = attr->flags;
         if (flags & POSIX_SPAWN_RESETIDS) {
@@ -55,11 +76,6 @@ extern "C" {
             }
         }
         if (flags & POSIX_SPAWN_SETSIGDEF) {
-            struct sigaction default_action;
-            default_action.sa_flags = 0;
-            sigemptyset(&default_action.sa_mask);
-            default_action.sa_handler = SIG_DFL;
-
             sigset_t sigdefault = attr->sigdefault;
             for (int i = 0; i < NSIG; ++i) {
                 if (sigismember(&sigdefault, i) && sigaction(i, &default_action, nullptr) < 0) {
@@ -68,12 +84,8 @@ extern "C" {
                 }
             }
         }
-        if (flags & POSIX_SPAWN_SETSIGMASK) {
-            if (sigprocmask(SIG_SETMASK, &attr->sigmask, nullptr) < 0) {
-                perror("posix_spawn sigprocmask");
-                _exit(127);
-            }
-        }
+        if (flags & POSIX_SPAWN_SETSIGMASK)
+            signal_mask = &attr->sigmask;
         if (flags & POSIX_SPAWN_SETSID) {
             if (setsid() < 0) {
                 perror("posix_spawn setsid");
@@ -93,39 +105,66 @@ extern "C" {
         }
     }
 
-    exec(path, argv, envp);
+    if (sigprocmask(SIG_SETMASK, signal_mask, nullptr) < 0) {
+        perror("posix_spawn sigprocmask");
+        _exit(127);
+    }
+
+    // Like execvpe(), keep looking along the PATH only as long as the program isn't there.
+    for (auto const* path : paths) {
+        if (execve(path, argv, envp) < 0 && errno != ENOENT)
+            break;
+    }
     perror("posix_spawn exec");
     _exit(127);
 }
 
-// https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawn.html
-int posix_spawn(pid_t* out_pid, char const* path, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, char* const argv[], char* const envp[])
+static int spawn(pid_t* out_pid, Span<char const*> paths, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, char* const argv[], char* const envp[])
 {
-    pid_t child_pid = fork();
-    if (child_pid < 0)
+    // No signal handler may run in the child before it has reset them, see posix_spawn_child().
+    sigset_t all_signals;
+    sigset_t signal_mask;
+    sigfillset(&all_signals);
+    if (sigprocmask(SIG_BLOCK, &all_signals, &signal_mask) < 0)
         return errno;
 
-    if (child_pid != 0) {
-        *out_pid = child_pid;
-        return 0;
-    }
+    // We're suspended until the child has exec()ed or exited, which saves copying our address space for it.
+    // NOTE: The syscall has to be made right here: the child must never return from the function that made it.
+    auto rc = static_cast<pid_t>(Syscall::invoke(Syscall::SC_vfork));
+    if (rc == 0)
+        posix_spawn_child(paths, file_actions, attr, &signal_mask, argv, envp);
 
-    posix_spawn_child(path, file_actions, attr, argv, envp, execve);
+    sigprocmask(SIG_SETMASK, &signal_mask, nullptr);
+    if (rc < 0)
+        return -rc;
+    *out_pid = rc;
+    return 0;
+}
+
+// https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawn.html
+int posix_spawn(pid_t* out_pid, char const* path, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, char* const argv[], char* const envp[])
+{
+    return spawn(out_pid, { &path, 1 }, file_actions, attr, argv, envp);
 }
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawnp.html
 int posix_spawnp(pid_t* out_pid, char const* file, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, char* const argv[], char* const envp[])
 {
-    pid_t child_pid = fork();
-    if (child_pid < 0)
-        return errno;
-
-    if (child_pid != 0) {
-        *out_pid = child_pid;
-        return 0;
-    }
-
-    posix_spawn_child(file, file_actions, attr, argv, envp, execvpe);
+    if (strchr(file, '/'))
+        return spawn(out_pid, { &file, 1 }, file_actions, attr, argv, envp);
+
+    // The child can't allocate, so the PATH search has to be prepared here.
+    DeprecatedString path = getenv("PATH");
+    if (path.is_empty())
+        path = DEFAULT_PATH;
+    Vector<DeprecatedString> candidates;
+    for (auto& part : path.split(':'))
+        candidates.append(DeprecatedString::formatted("{}/{}", part, file));
+    Vector<char const*> candidate_paths;
+    for (auto& candidate : candidates)
+        candidate_paths.append(candidate.characters());
+
+    return spawn(out_pid, candidate_paths.span(), file_actions, attr, argv, envp);
 }
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawn_file_actions_addchdir.html
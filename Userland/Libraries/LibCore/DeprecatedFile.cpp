@@ -20,6 +20,9 @@
 #include <utime.h>
 
 #ifdef AK_OS_SERENITY
+#    include <AK/Array.h>
+#    include <AK/ByteBuffer.h>
+#    include <LibCore/IORing.h>
 #    include <serenity.h>
 #endif
 
@@ -435,6 +438,88 @@ ErrorOr<void, DeprecatedFile::CopyError> DeprecatedFile::copy_file_or_directory(
     return copy_file(dst_path, src_stat, source, preserve_mode);
 }
 
+#ifdef AK_OS_SERENITY
+// Copies the first `size` bytes with several chunks in flight in an I/O ring, so that a single
+// trip into the kernel reads and writes a whole batch of them.
+static ErrorOr<void> copy_file_contents_with_io_ring(int src_fd, int dst_fd, u64 size)
+{
+    static constexpr size_t chunk_size = 64 * KiB;
+    static constexpr size_t chunks_in_flight = 8;
+
+    struct Chunk {
+        u64 offset { 0 };
+        size_t length { 0 };
+        size_t filled { 0 };
+        size_t flushed { 0 };
+        bool is_writing { false };
+    };
+
+    auto ring = TRY(IORing::create(chunks_in_flight));
+    auto buffer = TRY(ByteBuffer::create_uninitialized(chunk_size * chunks_in_flight));
+    Array<Chunk, chunks_in_flight> chunks;
+    u64 next_offset = 0;
+
+    auto chunk_buffer = [&](size_t index) { return buffer.bytes().slice(index * chunk_size, chunk_size); };
+    auto start_reading = [&](size_t index) -> ErrorOr<bool> {
+        auto& chunk = chunks[index];
+        if (chunk.length == 0) {
+            if (next_offset >= size)
+                return false;
+            chunk.offset = next_offset;
+            chunk.length = min<u64>(chunk_size, size - next_offset);
+            next_offset += chunk.length;
+        }
+        chunk.filled = 0;
+        chunk.flushed = 0;
+        chunk.is_writing = false;
+        TRY(ring->queue_read(src_fd, chunk_buffer(index).trim(chunk.length), chunk.offset, index));
+        return true;
+    };
+
+    size_t busy_chunks = 0;
+    for (size_t index = 0; index < chunks_in_flight; ++index) {
+        if (TRY(start_reading(index)))
+            ++busy_chunks;
+    }
+
+    while (busy_chunks > 0) {
+        auto completion = TRY(ring->wait_for_completion());
+        auto index = completion.user_data;
+        auto& chunk = chunks[index];
+        auto nprocessed = TRY(IORing::result_of(completion));
+
+        if (!chunk.is_writing) {
+            // The file got shorter while we were copying it, so there's nothing left to read.
+            if (nprocessed == 0) {
+                chunk.length = 0;
+                next_offset = size;
+                --busy_chunks;
+                continue;
+            }
+            chunk.filled = nprocessed;
+            chunk.is_writing = true;
+        } else {
+            if (nprocessed == 0)
+                return Error::from_errno(EIO);
+            chunk.flushed += nprocessed;
+        }
+
+        if (chunk.flushed < chunk.filled) {
+            auto unflushed = chunk_buffer(index).slice(chunk.flushed, chunk.filled - chunk.flushed);
+            TRY(ring->queue_write(dst_fd, unflushed, chunk.offset + chunk.flushed, index));
+            continue;
+        }
+
+        // Everything we've read has been written, move on to the rest of the chunk or the next one.
+        chunk.offset += chunk.filled;
+        chunk.length -= chunk.filled;
+        if (!TRY(start_reading(index)))
+            --busy_chunks;
+    }
+    return {};
+}
+#endif
+
 ErrorOr<void, DeprecatedFile::CopyError> DeprecatedFile::copy_file(DeprecatedString const& dst_path, struct stat const& src_stat, DeprecatedFile& source, PreserveMode preserve_mode)
 {
     int dst_fd = creat(dst_path.characters(), 0666);
@@ -455,6 +540,17 @@ ErrorOr<void, DeprecatedFile::CopyError> DeprecatedFile::copy_file(DeprecatedStr
             return CopyError { errno, false };
     }
 
+#ifdef AK_OS_SERENITY
+    // NOTE: Files that don't know their size up front, like the ones in /proc, are left to the loop below.
+    if (S_ISREG(src_stat.st_mode) && src_stat.st_size > 0) {
+        if (auto result = copy_file_contents_with_io_ring(source.fd(), dst_fd, src_stat.st_size); result.is_error())
+            return CopyError { result.error().code(), false };
+        // Anything that was appended in the meantime is picked up by the loop below.
+        if (lseek(source.fd(), src_stat.st_size, SEEK_SET) < 0 || lseek(dst_fd, src_stat.st_size, SEEK_SET) < 0)
+            return CopyError { errno, false };
+    }
+#endif
+
     for (;;) {
         char buffer[32768];
         ssize_t nread = ::read(source.fd(), buffer, sizeof(buffer));
@@ -39,6 +39,7 @@
 
 #ifdef AK_OS_SERENITY
 #    include <LibCore/Account.h>
+#    include <sys/epoll.h>
 
 extern bool s_global_initializers_ran;
 #endif
@@ -72,6 +73,13 @@ static Threading::MutexProtected<RefPtr<InspectorServerConnection>> s_inspector_
 static thread_local Vector<EventLoop&>* s_event_loop_stack;
 static thread_local HashMap<int, NonnullOwnPtr<EventLoopTimer>>* s_timers;
 static thread_local HashTable<Notifier*>* s_notifiers;
+#ifdef AK_OS_SERENITY
+// The kernel keeps a persistent interest set for us, so we don't have to hand it every notifier each time we wait.
+// It only knows about one interest per fd though, so the notifiers are also grouped by fd.
+static thread_local HashMap<int, Vector<Notifier*, 1>>* s_notifiers_by_fd;
+static thread_local int s_epoll_fd { -1 };
+static constexpr size_t max_epoll_events_per_wait = 64;
+#endif
 // The wake pipe is both responsible for notifying us when someone calls wake(), as well as POSIX signals.
 // While wake() pushes zero into the pipe, signal numbers (by defintion nonzero, see signal_numbers.h) are pushed into the pipe verbatim.
 thread_local int EventLoop::s_wake_pipe_fds[2];
@@ -90,6 +98,19 @@ void EventLoop::initialize_wake_pipes()
 #endif
         VERIFY(rc == 0);
         s_wake_pipe_initialized = true;
+
+#ifdef AK_OS_SERENITY
+        // After a fork, the inherited epoll fd still refers to the parent's interest set.
+        if (s_epoll_fd >= 0)
+            close(s_epoll_fd);
+        s_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        VERIFY(s_epoll_fd >= 0);
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = s_wake_pipe_fds[0];
+        rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, s_wake_pipe_fds[0], &event);
+        VERIFY(rc == 0);
+#endif
     }
 }
 
@@ -331,6 +352,9 @@ EventLoop::EventLoop([[maybe_unused]] MakeInspectable make_inspectable)
         s_event_loop_stack = new Vector<EventLoop&>;
         s_timers = new HashMap<int, NonnullOwnPtr<EventLoopTimer>>;
         s_notifiers = new HashTable<Notifier*>;
+#ifdef AK_OS_SERENITY
+        s_notifiers_by_fd = new HashMap<int, Vector<Notifier*, 1>>;
+#endif
     }
 
     if (s_event_loop_stack->is_empty()) {
@@ -666,6 +690,9 @@ void EventLoop::notify_forked(ForkEvent event)
         s_event_loop_stack->clear();
         s_timers->clear();
         s_notifiers->clear();
+#ifdef AK_OS_SERENITY
+        s_notifiers_by_fd->clear();
+#endif
         s_wake_pipe_initialized = false;
         initialize_wake_pipes();
         if (auto* info = signals_info<false>()) {
@@ -681,10 +708,15 @@ void EventLoop::notify_forked(ForkEvent event)
 
 void EventLoop::wait_for_event(WaitMode mode)
 {
+#ifdef AK_OS_SERENITY
+    epoll_event ready_events[max_epoll_events_per_wait];
+#else
     fd_set rfds;
     fd_set wfds;
+#endif
 retry:
 
+#ifndef AK_OS_SERENITY
     // Set up the file descriptors for select().
     // Basically, we translate high-level event information into low-level selectable file descriptors.
     FD_ZERO(&rfds);
@@ -710,6 +742,7 @@ retry:
         if (notifier->event_mask() & Notifier::Exceptional)
             VERIFY_NOT_REACHED();
     }
+#endif
 
     bool queued_events_is_empty;
     {
@@ -721,6 +754,7 @@ retry:
     // This mainly depends on the WaitMode and whether we have pending events, but also the next expiring timer.
     Time now;
     struct timeval timeout = { 0, 0 };
+    [[maybe_unused]] int timeout_ms = 0;
     bool should_wait_forever = false;
     if (mode == WaitMode::WaitForEvents && queued_events_is_empty) {
         auto next_timer_expiration = get_next_timer_expiration();
@@ -730,14 +764,26 @@ retry:
             if (computed_timeout.is_negative())
                 computed_timeout = Time::zero();
             timeout = computed_timeout.to_timeval();
+            timeout_ms = static_cast<int>(min<i64>(computed_timeout.to_milliseconds(), NumericLimits<int>::max()));
         } else {
             should_wait_forever = true;
         }
     }
 
 try_select_again:
+#ifdef AK_OS_SERENITY
+    // Wait for file system events, calls to wake(), POSIX signals, or timer expirations.
+    int marked_fd_count = epoll_wait(s_epoll_fd, ready_events, max_epoll_events_per_wait, should_wait_forever ? -1 : timeout_ms);
+    bool wake_pipe_is_readable = false;
+    for (int i = 0; i < marked_fd_count; ++i) {
+        if (ready_events[i].data.fd == s_wake_pipe_fds[0])
+            wake_pipe_is_readable = true;
+    }
+#else
     // select() and wait for file system events, calls to wake(), POSIX signals, or timer expirations.
     int marked_fd_count = select(max_fd + 1, &rfds, &wfds, nullptr, should_wait_forever ? nullptr : &timeout);
+    bool wake_pipe_is_readable = marked_fd_count > 0 && FD_ISSET(s_wake_pipe_fds[0], &rfds);
+#endif
     // Because POSIX, we might spuriously return from select() with EINTR; just select again.
     if (marked_fd_count < 0) {
         int saved_errno = errno;
@@ -752,7 +798,7 @@ try_select_again:
 
     // We woke up due to a call to wake() or a POSIX signal.
     // Handle signals and see whether we need to handle events as well.
-    if (FD_ISSET(s_wake_pipe_fds[0], &rfds)) {
+    if (wake_pipe_is_readable) {
         int wake_events[8];
         ssize_t nread;
         // We might receive another signal while read()ing here. The signal will go to the handle_signal properly,
@@ -812,6 +858,23 @@ try_select_again:
         return;
 
     // Handle file system notifiers by making them normal events.
+#ifdef AK_OS_SERENITY
+    for (int i = 0; i < marked_fd_count; ++i) {
+        auto& ready_event = ready_events[i];
+        auto it = s_notifiers_by_fd->find(ready_event.data.fd);
+        if (it == s_notifiers_by_fd->end())
+            continue;
+        // Just like with select(), errors and hang-ups are reported as the fd being ready.
+        bool is_readable = ready_event.events & (EPOLLIN | EPOLLHUP | EPOLLERR);
+        bool is_writable = ready_event.events & (EPOLLOUT | EPOLLERR);
+        for (auto* notifier : it->value) {
+            if (is_readable && (notifier->event_mask() & Notifier::Event::Read))
+                post_event(*notifier, make<NotifierReadEvent>(notifier->fd()));
+            if (is_writable && (notifier->event_mask() & Notifier::Event::Write))
+                post_event(*notifier, make<NotifierWriteEvent>(notifier->fd()));
+        }
+    }
+#else
     for (auto& notifier : *s_notifiers) {
         if (FD_ISSET(notifier->fd(), &rfds)) {
             if (notifier->event_mask() & Notifier::Event::Read)
@@ -822,6 +885,7 @@ try_select_again:
                 post_event(*notifier, make<NotifierWriteEvent>(notifier->fd()));
         }
     }
+#endif
 }
 
 bool EventLoopTimer::has_expired(Time const& now) const
@@ -882,16 +946,70 @@ bool EventLoop::unregister_timer(int timer_id)
     return true;
 }
 
+#ifdef AK_OS_SERENITY
+static void update_epoll_interest(int fd, Vector<Notifier*, 1> const& notifiers, int operation)
+{
+    epoll_event event {};
+    event.data.fd = fd;
+    for (auto* notifier : notifiers) {
+        if (notifier->event_mask() & Notifier::Read)
+            event.events |= EPOLLIN;
+        if (notifier->event_mask() & Notifier::Write)
+            event.events |= EPOLLOUT;
+        if (notifier->event_mask() & Notifier::Exceptional)
+            VERIFY_NOT_REACHED();
+    }
+    if (epoll_ctl(s_epoll_fd, operation, fd, &event) == 0)
+        return;
+    // NOTE: The kernel drops an interest once its fd is closed, and the fd may have been reused since,
+    //       so our idea of whether it's registered can be out of date.
+    if (errno == EEXIST)
+        (void)epoll_ctl(s_epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    else if (errno == ENOENT)
+        (void)epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+#endif
+
 void EventLoop::register_notifier(Badge<Notifier>, Notifier& notifier)
 {
     VERIFY_EVENT_LOOP_INITIALIZED();
-    s_notifiers->set(&notifier);
+    if (s_notifiers->set(&notifier) == HashSetResult::KeptExistingEntry)
+        return;
+#ifdef AK_OS_SERENITY
+    auto& notifiers = s_notifiers_by_fd->ensure(notifier.fd());
+    notifiers.append(&notifier);
+    update_epoll_interest(notifier.fd(), notifiers, notifiers.size() == 1 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD);
+#endif
 }
 
 void EventLoop::unregister_notifier(Badge<Notifier>, Notifier& notifier)
 {
     VERIFY_EVENT_LOOP_INITIALIZED();
-    s_notifiers->remove(&notifier);
+    if (!s_notifiers->remove(&notifier))
+        return;
+#ifdef AK_OS_SERENITY
+    auto it = s_notifiers_by_fd->find(notifier.fd());
+    if (it == s_notifiers_by_fd->end())
+        return;
+    it->value.remove_first_matching([&](auto* other) { return other == &notifier; });
+    if (it->value.is_empty()) {
+        s_notifiers_by_fd->remove(it);
+        (void)epoll_ctl(s_epoll_fd, EPOLL_CTL_DEL, notifier.fd(), nullptr);
+    } else {
+        update_epoll_interest(notifier.fd(), it->value, EPOLL_CTL_MOD);
+    }
+#endif
+}
+
+void EventLoop::notifier_event_mask_changed(Badge<Notifier>, [[maybe_unused]] Notifier& notifier)
+{
+    VERIFY_EVENT_LOOP_INITIALIZED();
+#ifdef AK_OS_SERENITY
+    auto it = s_notifiers_by_fd->find(notifier.fd());
+    if (it == s_notifiers_by_fd->end() || !it->value.contains_slow(&notifier))
+        return;
+    update_epoll_interest(notifier.fd(), it->value, EPOLL_CTL_MOD);
+#endif
 }
 
 void EventLoop::wake_current()
@@ -74,7 +74,7 @@ public:
 
     // Process events, generally called by exec() in a loop.
     // This should really only be used for integrating with other event loops.
-    // The wait mode determines whether pump() uses select() to wait for the next event.
+    // The wait mode determines whether pump() waits for the next event.
     size_t pump(WaitMode = WaitMode::WaitForEvents);
 
     // Pump the event loop until some condition is met.
@@ -102,6 +102,7 @@ public:
 
     static void register_notifier(Badge<Notifier>, Notifier&);
     static void unregister_notifier(Badge<Notifier>, Notifier&);
+    static void notifier_event_mask_changed(Badge<Notifier>, Notifier&);
 
     static int register_signal(int signo, Function<void(int)> handler);
     static void unregister_signal(int handler_id);
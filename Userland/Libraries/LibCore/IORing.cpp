@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Atomic.h>
+#include <LibCore/IORing.h>
+#include <LibCore/System.h>
+#include <sys/mman.h>
+
+namespace Core {
+
+ErrorOr<NonnullOwnPtr<IORing>> IORing::create(u32 entries)
+{
+    IORingParams params {};
+    params.submission_entries = entries;
+    params.flags = IO_RING_CLOEXEC;
+    int fd = TRY(System::io_ring_create(params));
+
+    auto mapping_or_error = System::mmap(nullptr, params.mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0, 0, "IORing"sv);
+    if (mapping_or_error.is_error()) {
+        (void)System::close(fd);
+        return mapping_or_error.release_error();
+    }
+    auto* mapping = static_cast<u8*>(mapping_or_error.release_value());
+
+    auto ring = adopt_nonnull_own_or_enomem(new (nothrow) IORing(fd, params, mapping));
+    if (ring.is_error()) {
+        (void)System::munmap(mapping, params.mapping_size);
+        (void)System::close(fd);
+    }
+    return ring;
+}
+
+IORing::IORing(int fd, IORingParams const& params, u8* mapping)
+    : m_fd(fd)
+    , m_submission_entries(params.submission_entries)
+    , m_completion_entries(params.completion_entries)
+    , m_mapping_size(params.mapping_size)
+    , m_mapping(mapping)
+    , m_header(reinterpret_cast<IORingHeader*>(mapping))
+    , m_submission_queue(reinterpret_cast<IORingSubmission*>(mapping + m_header->submission_entries_offset))
+    , m_completion_queue(reinterpret_cast<IORingCompletion*>(mapping + m_header->completion_entries_offset))
+{
+}
+
+IORing::~IORing()
+{
+    (void)System::munmap(m_mapping, m_mapping_size);
+    (void)System::close(m_fd);
+}
+
+ErrorOr<void> IORing::queue(IORingSubmission const& submission)
+{
+    // Make room by handing what we have to the kernel first.
+    if (m_submission_tail - AK::atomic_load(&m_header->submission_head, AK::memory_order_acquire) >= m_submission_entries)
+        TRY(submit());
+    if (m_submission_tail - AK::atomic_load(&m_header->submission_head, AK::memory_order_acquire) >= m_submission_entries)
+        return Error::from_errno(EBUSY);
+
+    m_submission_queue[m_submission_tail & (m_submission_entries - 1)] = submission;
+    ++m_submission_tail;
+    AK::atomic_store(&m_header->submission_tail, m_submission_tail, AK::memory_order_release);
+    return {};
+}
+
+ErrorOr<void> IORing::queue_read(int fd, Bytes buffer, i64 offset, u64 user_data)
+{
+    return queue({ IORingOpcode::Read, 0, 0, fd, offset, reinterpret_cast<FlatPtr>(buffer.data()), static_cast<u32>(buffer.size()), 0, user_data });
+}
+
+ErrorOr<void> IORing::queue_write(int fd, ReadonlyBytes buffer, i64 offset, u64 user_data)
+{
+    return queue({ IORingOpcode::Write, 0, 0, fd, offset, reinterpret_cast<FlatPtr>(buffer.data()), static_cast<u32>(buffer.size()), 0, user_data });
+}
+
+ErrorOr<void> IORing::queue_fsync(int fd, u64 user_data)
+{
+    return queue({ IORingOpcode::Fsync, 0, 0, fd, 0, 0, 0, 0, user_data });
+}
+
+ErrorOr<void> IORing::queue_accept(int fd, int flags, u64 user_data)
+{
+    return queue({ IORingOpcode::Accept, 0, 0, fd, 0, 0, 0, static_cast<u32>(flags), user_data });
+}
+
+ErrorOr<void> IORing::queue_timeout(timespec const& timeout, u64 user_data)
+{
+    return queue({ IORingOpcode::Timeout, 0, 0, -1, 0, reinterpret_cast<FlatPtr>(&timeout), 0, 0, user_data });
+}
+
+ErrorOr<void> IORing::queue_nop(u64 user_data)
+{
+    return queue({ IORingOpcode::Nop, 0, 0, -1, 0, 0, 0, 0, user_data });
+}
+
+ErrorOr<size_t> IORing::submit(u32 min_complete)
+{
+    auto submitted = TRY(System::io_ring_enter(m_fd, queued_submissions(), min_complete));
+    m_submitted += submitted;
+    return submitted;
+}
+
+Optional<IORingCompletion> IORing::pop_completion()
+{
+    auto head = m_header->completion_head;
+    if (head == AK::atomic_load(&m_header->completion_tail, AK::memory_order_acquire))
+        return {};
+    auto completion = m_completion_queue[head & (m_completion_entries - 1)];
+    AK::atomic_store(&m_header->completion_head, head + 1, AK::memory_order_release);
+    ++m_completed;
+    return completion;
+}
+
+ErrorOr<IORingCompletion> IORing::wait_for_completion()
+{
+    for (;;) {
+        if (auto completion = pop_completion(); completion.has_value())
+            return completion.release_value();
+        // Nothing would ever complete, so don't wait for it.
+        if (queued_submissions() == 0 && m_submitted == m_completed)
+            return Error::from_errno(ENOENT);
+        TRY(submit(1));
+    }
+}
+
+ErrorOr<size_t> IORing::result_of(IORingCompletion const& completion)
+{
+    if (completion.result < 0)
+        return Error::from_errno(-completion.result);
+    return static_cast<size_t>(completion.result);
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2022, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/Noncopyable.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/Span.h>
+#include <Kernel/API/IORing.h>
+#include <time.h>
+
+namespace Core {
+
+// A thin wrapper around the kernel's submission/completion rings, see Kernel/API/IORing.h.
+// Operations are queued with the queue_*() functions, and handed to the kernel in a single
+// batch by submit(). Their results come back as IORingCompletions, in no particular order.
+class IORing {
+    AK_MAKE_NONCOPYABLE(IORing);
+    AK_MAKE_NONMOVABLE(IORing);
+
+public:
+    static ErrorOr<NonnullOwnPtr<IORing>> create(u32 entries);
+    ~IORing();
+
+    int fd() const { return m_fd; }
+    u32 submission_entries() const { return m_submission_entries; }
+    u32 completion_entries() const { return m_completion_entries; }
+
+    // Negative offsets use (and advance) the file's current offset.
+    ErrorOr<void> queue_read(int fd, Bytes, i64 offset, u64 user_data);
+    ErrorOr<void> queue_write(int fd, ReadonlyBytes, i64 offset, u64 user_data);
+    ErrorOr<void> queue_fsync(int fd, u64 user_data);
+    ErrorOr<void> queue_accept(int fd, int flags, u64 user_data);
+    // NOTE: The timeout is only read by the kernel once submit() is called.
+    ErrorOr<void> queue_timeout(timespec const&, u64 user_data);
+    ErrorOr<void> queue_nop(u64 user_data);
+
+    u32 queued_submissions() const { return m_submission_tail - m_submitted; }
+
+    // Hands everything that's been queued to the kernel, and waits until at least `min_complete` completions are available.
+    ErrorOr<size_t> submit(u32 min_complete = 0);
+
+    Optional<IORingCompletion> pop_completion();
+    ErrorOr<IORingCompletion> wait_for_completion();
+
+    // Turns the result of a completion back into an ErrorOr.
+    static ErrorOr<size_t> result_of(IORingCompletion const&);
+
+private:
+    IORing(int fd, IORingParams const&, u8* mapping);
+
+    ErrorOr<void> queue(IORingSubmission const&);
+
+    int m_fd { -1 };
+    u32 m_submission_entries { 0 };
+    u32 m_completion_entries { 0 };
+    size_t m_mapping_size { 0 };
+    u8* m_mapping { nullptr };
+
+    IORingHeader* m_header { nullptr };
+    IORingSubmission* m_submission_queue { nullptr };
+    IORingCompletion* m_completion_queue { nullptr };
+
+    u32 m_submission_tail { 0 };
+    u32 m_submitted { 0 };
+    u32 m_completed { 0 };
+};
+
+}
@@ -5,94 +5,177 @@
  */
 
 #include <AK/ByteBuffer.h>
-#include <AK/JsonArray.h>
-#include <AK/JsonObject.h>
-#include <AK/JsonValue.h>
+#include <AK/HashMap.h>
+#include <Kernel/API/ProcessStatistics.h>
 #include <LibCore/File.h>
 #include <LibCore/ProcessStatisticsReader.h>
 #include <pwd.h>
+#include <string.h>
 
 namespace Core {
 
 HashMap<uid_t, DeprecatedString> ProcessStatisticsReader::s_usernames;
 
-ErrorOr<AllProcessesStatistics> ProcessStatisticsReader::get_all(SeekableStream& proc_all_file, bool include_usernames)
+// Takes the next `size` bytes of the snapshot.
+static ErrorOr<ReadonlyBytes> take(ReadonlyBytes& snapshot, size_t size)
 {
-    TRY(proc_all_file.seek(0, SeekMode::SetPosition));
+    if (snapshot.size() < size)
+        return Error::from_string_literal("Truncated process statistics");
+    auto bytes = snapshot.trim(size);
+    snapshot = snapshot.slice(size);
+    return bytes;
+}
 
-    AllProcessesStatistics all_processes_statistics;
+// Takes a record that is `record_size` bytes large in the snapshot, which may be more or less than
+// we know about. The fields that are missing are zero.
+template<typename Record>
+static ErrorOr<Record> take_record(ReadonlyBytes& snapshot, size_t record_size)
+{
+    Record record {};
+    auto bytes = TRY(take(snapshot, record_size));
+    memcpy(&record, bytes.data(), min(sizeof(record), record_size));
+    return record;
+}
+
+static ErrorOr<DeprecatedString> take_string(ReadonlyBytes& snapshot, size_t length)
+{
+    return DeprecatedString { StringView { TRY(take(snapshot, length)) } };
+}
+
+// Skips the padding after a record and its strings, which started when `remaining_before_record` bytes were left.
+static ErrorOr<void> skip_padding(ReadonlyBytes& snapshot, size_t remaining_before_record)
+{
+    auto record_size = remaining_before_record - snapshot.size();
+    TRY(take(snapshot, align_up_to(record_size, PROCESS_STATISTICS_ALIGNMENT) - record_size));
+    return {};
+}
+
+static ErrorOr<ThreadStatistics> take_thread(ReadonlyBytes& snapshot, ProcessStatisticsHeader const& header)
+{
+    auto remaining_before_record = snapshot.size();
+    auto record = TRY(take_record<ThreadStatisticsRecord>(snapshot, header.thread_record_size));
+
+    ThreadStatistics thread;
+    thread.tid = record.tid;
+    thread.times_scheduled = record.times_scheduled;
+    thread.time_user = record.time_user;
+    thread.time_kernel = record.time_kernel;
+    thread.cpu = record.cpu;
+    thread.priority = record.priority;
+    thread.syscall_count = record.syscall_count;
+    thread.inode_faults = record.inode_faults;
+    thread.zero_faults = record.zero_faults;
+    thread.cow_faults = record.cow_faults;
+    thread.unix_socket_read_bytes = record.unix_socket_read_bytes;
+    thread.unix_socket_write_bytes = record.unix_socket_write_bytes;
+    thread.ipv4_socket_read_bytes = record.ipv4_socket_read_bytes;
+    thread.ipv4_socket_write_bytes = record.ipv4_socket_write_bytes;
+    thread.file_read_bytes = record.file_read_bytes;
+    thread.file_write_bytes = record.file_write_bytes;
+    thread.name = TRY(take_string(snapshot, record.name_length));
+    thread.state = TRY(take_string(snapshot, record.state_length));
+    TRY(skip_padding(snapshot, remaining_before_record));
+    return thread;
+}
+
+static ErrorOr<void> take_process(ReadonlyBytes& snapshot, ProcessStatisticsHeader const& header, ProcessStatisticsRecord const& record, size_t remaining_before_record, ProcessStatistics& process)
+{
+    process.pid = record.pid;
+    process.pgid = record.pgid;
+    process.pgp = record.pgp;
+    process.sid = record.sid;
+    process.uid = record.uid;
+    process.gid = record.gid;
+    process.ppid = record.ppid;
+    process.nfds = record.nfds;
+    process.kernel = record.flags & PROCESS_STATISTICS_KERNEL;
+    process.amount_virtual = record.amount_virtual;
+    process.amount_resident = record.amount_resident;
+    process.amount_shared = record.amount_shared;
+    process.amount_dirty_private = record.amount_dirty_private;
+    process.amount_clean_inode = record.amount_clean_inode;
+    process.amount_purgeable_volatile = record.amount_purgeable_volatile;
+    process.amount_purgeable_nonvolatile = record.amount_purgeable_nonvolatile;
+    process.amount_large_page_backed = record.amount_large_page_backed;
+    process.name = TRY(take_string(snapshot, record.name_length));
+    process.executable = TRY(take_string(snapshot, record.executable_length));
+    process.tty = TRY(take_string(snapshot, record.tty_length));
+    process.pledge = TRY(take_string(snapshot, record.pledge_length));
+    process.veil = TRY(take_string(snapshot, record.veil_length));
+    TRY(skip_padding(snapshot, remaining_before_record));
 
+    process.threads.clear_with_capacity();
+    TRY(process.threads.try_ensure_capacity(record.thread_count));
+    for (u32 i = 0; i < record.thread_count; ++i)
+        process.threads.unchecked_append(TRY(take_thread(snapshot, header)));
+    return {};
+}
+
+ErrorOr<void> ProcessStatisticsReader::update(SeekableStream& proc_all_file, AllProcessesStatistics& all_processes_statistics, bool include_usernames)
+{
+    TRY(proc_all_file.seek(0, SeekMode::SetPosition));
     auto file_contents = TRY(proc_all_file.read_until_eof());
-    auto json_obj = TRY(JsonValue::from_string(file_contents)).as_object();
-    json_obj.get_array("processes"sv)->for_each([&](auto& value) {
-        const JsonObject& process_object = value.as_object();
-        Core::ProcessStatistics process;
-
-        // kernel data first
-        process.pid = process_object.get_u32("pid"sv).value_or(0);
-        process.pgid = process_object.get_u32("pgid"sv).value_or(0);
-        process.pgp = process_object.get_u32("pgp"sv).value_or(0);
-        process.sid = process_object.get_u32("sid"sv).value_or(0);
-        process.uid = process_object.get_u32("uid"sv).value_or(0);
-        process.gid = process_object.get_u32("gid"sv).value_or(0);
-        process.ppid = process_object.get_u32("ppid"sv).value_or(0);
-        process.nfds = process_object.get_u32("nfds"sv).value_or(0);
-        process.kernel = process_object.get_bool("kernel"sv).value_or(false);
-        process.name = process_object.get_deprecated_string("name"sv).value_or("");
-        process.executable = process_object.get_deprecated_string("executable"sv).value_or("");
-        process.tty = process_object.get_deprecated_string("tty"sv).value_or("");
-        process.pledge = process_object.get_deprecated_string("pledge"sv).value_or("");
-        process.veil = process_object.get_deprecated_string("veil"sv).value_or("");
-        process.amount_virtual = process_object.get_u32("amount_virtual"sv).value_or(0);
-        process.amount_resident = process_object.get_u32("amount_resident"sv).value_or(0);
-        process.amount_shared = process_object.get_u32("amount_shared"sv).value_or(0);
-        process.amount_dirty_private = process_object.get_u32("amount_dirty_private"sv).value_or(0);
-        process.amount_clean_inode = process_object.get_u32("amount_clean_inode"sv).value_or(0);
-        process.amount_purgeable_volatile = process_object.get_u32("amount_purgeable_volatile"sv).value_or(0);
-        process.amount_purgeable_nonvolatile = process_object.get_u32("amount_purgeable_nonvolatile"sv).value_or(0);
-
-        auto& thread_array = process_object.get_array("threads"sv).value();
-        process.threads.ensure_capacity(thread_array.size());
-        thread_array.for_each([&](auto& value) {
-            auto& thread_object = value.as_object();
-            Core::ThreadStatistics thread;
-            thread.tid = thread_object.get_u32("tid"sv).value_or(0);
-            thread.times_scheduled = thread_object.get_u32("times_scheduled"sv).value_or(0);
-            thread.name = thread_object.get_deprecated_string("name"sv).value_or("");
-            thread.state = thread_object.get_deprecated_string("state"sv).value_or("");
-            thread.time_user = thread_object.get_u64("time_user"sv).value_or(0);
-            thread.time_kernel = thread_object.get_u64("time_kernel"sv).value_or(0);
-            thread.cpu = thread_object.get_u32("cpu"sv).value_or(0);
-            thread.priority = thread_object.get_u32("priority"sv).value_or(0);
-            thread.syscall_count = thread_object.get_u32("syscall_count"sv).value_or(0);
-            thread.inode_faults = thread_object.get_u32("inode_faults"sv).value_or(0);
-            thread.zero_faults = thread_object.get_u32("zero_faults"sv).value_or(0);
-            thread.cow_faults = thread_object.get_u32("cow_faults"sv).value_or(0);
-            thread.unix_socket_read_bytes = thread_object.get_u32("unix_socket_read_bytes"sv).value_or(0);
-            thread.unix_socket_write_bytes = thread_object.get_u32("unix_socket_write_bytes"sv).value_or(0);
-            thread.ipv4_socket_read_bytes = thread_object.get_u32("ipv4_socket_read_bytes"sv).value_or(0);
-            thread.ipv4_socket_write_bytes = thread_object.get_u32("ipv4_socket_write_bytes"sv).value_or(0);
-            thread.file_read_bytes = thread_object.get_u32("file_read_bytes"sv).value_or(0);
-            thread.file_write_bytes = thread_object.get_u32("file_write_bytes"sv).value_or(0);
-            process.threads.append(move(thread));
-        });
+    ReadonlyBytes snapshot = file_contents.bytes();
+
+    if (snapshot.size() < sizeof(ProcessStatisticsHeader))
+        return Error::from_string_literal("Truncated process statistics");
+    ProcessStatisticsHeader header;
+    memcpy(&header, snapshot.data(), sizeof(header));
+    if (header.version != PROCESS_STATISTICS_VERSION)
+        return Error::from_string_literal("Unsupported process statistics version");
+    if (header.header_size < sizeof(ProcessStatisticsHeader) || header.process_record_size < sizeof(ProcessStatisticsRecord) || header.thread_record_size < sizeof(ThreadStatisticsRecord))
+        return Error::from_string_literal("Invalid process statistics record sizes");
+    // A delta can only be applied to the statistics from the snapshot it is relative to.
+    if (header.since_generation != 0 && header.since_generation != all_processes_statistics.generation)
+        return Error::from_string_literal("Process statistics are relative to a different snapshot");
+    TRY(take(snapshot, header.header_size));
+
+    HashMap<pid_t, size_t> previous_process_indices;
+    if (header.since_generation != 0) {
+        for (size_t i = 0; i < all_processes_statistics.processes.size(); ++i)
+            TRY(previous_process_indices.try_set(all_processes_statistics.processes[i].pid, i));
+    }
+
+    Vector<ProcessStatistics> processes;
+    TRY(processes.try_ensure_capacity(header.process_count));
+    for (u32 i = 0; i < header.process_count; ++i) {
+        auto remaining_before_record = snapshot.size();
+        auto record = TRY(take_record<ProcessStatisticsRecord>(snapshot, header.process_record_size));
+
+        auto previous_index = previous_process_indices.get(record.pid);
+        if (record.flags & PROCESS_STATISTICS_UNCHANGED) {
+            TRY(skip_padding(snapshot, remaining_before_record));
+            if (!previous_index.has_value())
+                return Error::from_string_literal("Unchanged process statistics for an unknown process");
+            processes.unchecked_append(move(all_processes_statistics.processes[previous_index.value()]));
+            continue;
+        }
+
+        // Reuse the previous statistics of the process, so we don't have to allocate all of them again.
+        ProcessStatistics process;
+        if (previous_index.has_value())
+            process = move(all_processes_statistics.processes[previous_index.value()]);
+        TRY(take_process(snapshot, header, record, remaining_before_record, process));
 
         // and synthetic data last
-        if (include_usernames) {
+        if (include_usernames)
             process.username = username_from_uid(process.uid);
-        }
-        all_processes_statistics.processes.append(move(process));
-    });
+        processes.unchecked_append(move(process));
+    }
 
-    all_processes_statistics.total_time_scheduled = json_obj.get_u64("total_time"sv).value_or(0);
-    all_processes_statistics.total_time_scheduled_kernel = json_obj.get_u64("total_time_kernel"sv).value_or(0);
-    return all_processes_statistics;
+    all_processes_statistics.processes = move(processes);
+    all_processes_statistics.total_time_scheduled = header.total_time_scheduled;
+    all_processes_statistics.total_time_scheduled_kernel = header.total_time_scheduled_kernel;
+    all_processes_statistics.generation = header.generation;
+    return {};
 }
 
 ErrorOr<AllProcessesStatistics> ProcessStatisticsReader::get_all(bool include_usernames)
 {
-    auto proc_all_file = TRY(Core::File::open("/sys/kernel/processes"sv, Core::File::OpenMode::Read));
-    return get_all(*proc_all_file, include_usernames);
+    auto proc_all_file = TRY(Core::File::open("/sys/kernel/process_statistics"sv, Core::File::OpenMode::Read));
+    AllProcessesStatistics all_processes_statistics;
+    TRY(update(*proc_all_file, all_processes_statistics, include_usernames));
+    return all_processes_statistics;
 }
 
 DeprecatedString ProcessStatisticsReader::username_from_uid(uid_t uid)
@@ -34,7 +34,7 @@ struct ThreadStatistics {
 };
 
 struct ProcessStatistics {
-    // Keep this in sync with /sys/kernel/processes.
+    // Keep this in sync with /sys/kernel/process_statistics.
     // From the kernel side:
     pid_t pid;
     pid_t pgid;
@@ -57,6 +57,7 @@ struct ProcessStatistics {
     size_t amount_clean_inode;
     size_t amount_purgeable_volatile;
     size_t amount_purgeable_nonvolatile;
+    size_t amount_large_page_backed;
 
     Vector<Core::ThreadStatistics> threads;
 
@@ -66,13 +67,18 @@ struct ProcessStatistics {
 
 struct AllProcessesStatistics {
     Vector<ProcessStatistics> processes;
-    u64 total_time_scheduled;
-    u64 total_time_scheduled_kernel;
+    u64 total_time_scheduled { 0 };
+    u64 total_time_scheduled_kernel { 0 };
+    // The generation of the snapshot these statistics were last updated from.
+    u64 generation { 0 };
 };
 
 class ProcessStatisticsReader {
 public:
-    static ErrorOr<AllProcessesStatistics> get_all(SeekableStream&, bool include_usernames = true);
+    // Brings the statistics up to date with what the kernel reports through the given stream, which
+    // has to stay open between updates. Only the processes that changed since the last update have
+    // to be parsed again. If this fails, the stream can't be used for further updates.
+    static ErrorOr<void> update(SeekableStream& proc_all_file, AllProcessesStatistics&, bool include_usernames = true);
     static ErrorOr<AllProcessesStatistics> get_all(bool include_usernames = true);
 
 private:
@@ -389,6 +389,13 @@ ErrorOr<Bytes> LocalSocket::read_without_waiting(Bytes buffer)
     return m_helper.read(buffer, MSG_DONTWAIT);
 }
 
+Optional<int> TCPSocket::fd() const
+{
+    if (!is_open())
+        return {};
+    return m_helper.fd();
+}
+
 Optional<int> LocalSocket::fd() const
 {
     if (!is_open())
@@ -30,6 +30,7 @@
 #    include <LibSystem/syscall.h>
 #    include <serenity.h>
 #    include <sys/ptrace.h>
+#    include <sys/sendfile.h>
 #endif
 
 #if defined(AK_OS_LINUX) && !defined(MFD_CLOEXEC)
@@ -1542,6 +1543,30 @@ ErrorOr<void> posix_fallocate(int fd, off_t offset, off_t length)
         return Error::from_syscall("posix_fallocate"sv, -rc);
     return {};
 }
+
+ErrorOr<size_t> sendfile(int out_fd, int in_fd, off_t* offset, size_t count)
+{
+    ssize_t rc = ::sendfile(out_fd, in_fd, offset, count);
+    if (rc < 0)
+        return Error::from_syscall("sendfile"sv, -errno);
+    return static_cast<size_t>(rc);
+}
+
+ErrorOr<int> io_ring_create(IORingParams& params)
+{
+    int fd = ::io_ring_create(&params);
+    if (fd < 0)
+        return Error::from_syscall("io_ring_create"sv, -errno);
+    return fd;
+}
+
+ErrorOr<size_t> io_ring_enter(int fd, u32 to_submit, u32 min_complete)
+{
+    int rc = ::io_ring_enter(fd, to_submit, min_complete);
+    if (rc < 0)
+        return Error::from_syscall("io_ring_enter"sv, -errno);
+    return static_cast<size_t>(rc);
+}
 #endif
 
 }
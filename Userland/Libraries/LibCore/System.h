@@ -35,6 +35,10 @@
 #    include <shadow.h>
 #endif
 
+#ifdef AK_OS_SERENITY
+struct IORingParams;
+#endif
+
 namespace Core::System {
 
 #ifdef AK_OS_SERENITY
@@ -245,6 +249,9 @@ ErrorOr<AddressInfoVector> getaddrinfo(char const* nodename, char const* servnam
 
 #ifdef AK_OS_SERENITY
 ErrorOr<void> posix_fallocate(int fd, off_t offset, off_t length);
+ErrorOr<size_t> sendfile(int out_fd, int in_fd, off_t* offset, size_t count);
+ErrorOr<int> io_ring_create(IORingParams&);
+ErrorOr<size_t> io_ring_enter(int fd, u32 to_submit, u32 min_complete);
 #endif
 
 }
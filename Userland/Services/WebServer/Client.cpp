@@ -19,6 +19,7 @@
 #include <LibCore/File.h>
 #include <LibCore/MappedFile.h>
 #include <LibCore/MimeData.h>
+#include <LibCore/System.h>
 #include <LibHTTP/HttpRequest.h>
 #include <LibHTTP/HttpResponse.h>
 #include <WebServer/Client.h>
@@ -172,11 +173,11 @@ ErrorOr<bool> Client::handle_request(ReadonlyBytes raw_request)
         .type = TRY(String::from_deprecated_string(Core::guess_mime_type_based_on_filename(real_path.bytes_as_string_view()))),
         .length = TRY(Core::DeprecatedFile::size(real_path.bytes_as_string_view()))
     };
-    TRY(send_response(*stream, request, move(info)));
+    TRY(send_file_response(*stream, request, move(info)));
     return true;
 }
 
-ErrorOr<void> Client::send_response(Stream& response, HTTP::HttpRequest const& request, ContentInfo content_info)
+ErrorOr<void> Client::send_response_header(HTTP::HttpRequest const& request, ContentInfo const& content_info)
 {
     StringBuilder builder;
     builder.append("HTTP/1.0 200 OK\r\n"sv);
@@ -194,6 +195,34 @@ ErrorOr<void> Client::send_response(Stream& response, HTTP::HttpRequest const& r
     auto builder_contents = builder.to_byte_buffer();
     TRY(m_socket->write(builder_contents));
     log_response(200, request);
+    return {};
+}
+
+ErrorOr<void> Client::send_file_response(Core::File& file, HTTP::HttpRequest const& request, ContentInfo content_info)
+{
+    auto socket_fd = m_socket->fd();
+    if (!socket_fd.has_value())
+        return Error::from_errno(ENOTCONN);
+
+    TRY(send_response_header(request, content_info));
+
+    // Let the kernel move the file contents straight into the socket, instead of
+    // bouncing every page through our buffer.
+    size_t remaining = content_info.length;
+    while (remaining > 0) {
+        auto nsent = TRY(Core::System::sendfile(socket_fd.value(), file.fd(), nullptr, remaining));
+        if (nsent == 0)
+            break;
+        remaining -= nsent;
+    }
+
+    finish_response(request);
+    return {};
+}
+
+ErrorOr<void> Client::send_response(Stream& response, HTTP::HttpRequest const& request, ContentInfo content_info)
+{
+    TRY(send_response_header(request, content_info));
 
     char buffer[PAGE_SIZE];
     do {
@@ -213,6 +242,12 @@ ErrorOr<void> Client::send_response(Stream& response, HTTP::HttpRequest const& r
         }
     } while (true);
 
+    finish_response(request);
+    return {};
+}
+
+void Client::finish_response(HTTP::HttpRequest const& request)
+{
     auto keep_alive = false;
     if (auto it = request.headers().find_if([](auto& header) { return header.name.equals_ignoring_case("Connection"sv); }); !it.is_end()) {
         if (it->value.trim_whitespace().equals_ignoring_case("keep-alive"sv))
@@ -220,8 +255,6 @@ ErrorOr<void> Client::send_response(Stream& response, HTTP::HttpRequest const& r
     }
     if (!keep_alive)
         m_socket->close();
-
-    return {};
 }
 
 ErrorOr<void> Client::send_redirect(StringView redirect_path, HTTP::HttpRequest const& request)
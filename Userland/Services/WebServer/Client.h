@@ -8,6 +8,7 @@
 #pragma once
 
 #include <AK/String.h>
+#include <LibCore/File.h>
 #include <LibCore/Object.h>
 #include <LibCore/Socket.h>
 #include <LibHTTP/Forward.h>
@@ -30,7 +31,10 @@ private:
     };
 
     ErrorOr<bool> handle_request(ReadonlyBytes);
+    ErrorOr<void> send_response_header(HTTP::HttpRequest const&, ContentInfo const&);
     ErrorOr<void> send_response(Stream&, HTTP::HttpRequest const&, ContentInfo);
+    ErrorOr<void> send_file_response(Core::File&, HTTP::HttpRequest const&, ContentInfo);
+    void finish_response(HTTP::HttpRequest const&);
     ErrorOr<void> send_redirect(StringView redirect, HTTP::HttpRequest const&);
     ErrorOr<void> send_error_response(unsigned code, HTTP::HttpRequest const&, Vector<String> const& headers = {});
     void die();
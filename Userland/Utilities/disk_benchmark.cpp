@@ -7,11 +7,14 @@
 
 #include <AK/ByteBuffer.h>
 #include <AK/DeprecatedString.h>
+#include <AK/JsonObject.h>
 #include <AK/ScopeGuard.h>
 #include <AK/Types.h>
 #include <AK/Vector.h>
 #include <LibCore/ArgsParser.h>
 #include <LibCore/ElapsedTimer.h>
+#include <LibCore/File.h>
+#include <LibCore/IORing.h>
 #include <LibCore/System.h>
 #include <LibMain/Main.h>
 #include <fcntl.h>
@@ -22,8 +25,35 @@
 struct Result {
     u64 write_bps {};
     u64 read_bps {};
+    u64 write_requests {};
+    u64 read_requests {};
 };
 
+struct DeviceRequestCounters {
+    u64 read_requests {};
+    u64 write_requests {};
+};
+
+// The kernel counts the requests the block file systems send to their devices, which tells us
+// how well adjacent blocks are being merged into larger transfers.
+static Optional<DeviceRequestCounters> device_request_counters()
+{
+    auto file = Core::File::open("/sys/kernel/diskcache"sv, Core::File::OpenMode::Read);
+    if (file.is_error())
+        return {};
+    auto contents = file.value()->read_until_eof();
+    if (contents.is_error())
+        return {};
+    auto json = JsonValue::from_string(contents.value());
+    if (json.is_error() || !json.value().is_object())
+        return {};
+    auto const& object = json.value().as_object();
+    return DeviceRequestCounters {
+        .read_requests = object.get_u64("device_read_requests"sv).value_or(0),
+        .write_requests = object.get_u64("device_write_requests"sv).value_or(0),
+    };
+}
+
 static Result average_result(Vector<Result> const& results)
 {
     Result average;
@@ -31,15 +61,24 @@ static Result average_result(Vector<Result> const& results)
     for (auto& res : results) {
         average.write_bps += res.write_bps;
         average.read_bps += res.read_bps;
+        average.write_requests += res.write_requests;
+        average.read_requests += res.read_requests;
     }
 
     average.write_bps /= results.size();
     average.read_bps /= results.size();
+    average.write_requests /= results.size();
+    average.read_requests /= results.size();
 
     return average;
 }
 
-static ErrorOr<Result> benchmark(DeprecatedString const& filename, int file_size, ByteBuffer& buffer, bool allow_cache);
+static double requests_per_mib(u64 requests, size_t file_size)
+{
+    return static_cast<double>(requests) * MiB / file_size;
+}
+
+static ErrorOr<Result> benchmark(DeprecatedString const& filename, int file_size, size_t block_size, ByteBuffer& buffer, Core::IORing* ring, bool allow_cache);
 
 ErrorOr<int> serenity_main(Main::Arguments arguments)
 {
@@ -50,9 +89,11 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
     Vector<size_t> file_sizes;
     Vector<size_t> block_sizes;
     bool allow_cache = false;
+    size_t queue_depth = 0;
 
     Core::ArgsParser args_parser;
     args_parser.add_option(allow_cache, "Allow using disk cache", "cache", 'c');
+    args_parser.add_option(queue_depth, "Keep this many requests in flight through an I/O ring, instead of using read() and write()", "queue-depth", 'q', "queue-depth");
     args_parser.add_option(directory, "Path to a directory where we can store the disk benchmark temp file", "directory", 'd', "directory");
     args_parser.add_option(time_per_benchmark_sec, "Time elapsed per benchmark (seconds)", "time-per-benchmark", 't', "time-per-benchmark");
     args_parser.add_option(file_sizes, "A comma-separated list of file sizes", "file-size", 'f', "file-size");
@@ -77,24 +118,27 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
             if (block_size > file_size)
                 continue;
 
-            auto buffer_result = ByteBuffer::create_uninitialized(block_size);
+            auto buffer_result = ByteBuffer::create_uninitialized(block_size * max(queue_depth, 1u));
             if (buffer_result.is_error()) {
                 warnln("Not enough memory to allocate space for block size = {}", block_size);
                 continue;
             }
+            OwnPtr<Core::IORing> ring;
+            if (queue_depth > 0)
+                ring = TRY(Core::IORing::create(queue_depth));
             Vector<Result> results;
 
-            outln("Running: file_size={} block_size={}", file_size, block_size);
+            outln("Running: file_size={} block_size={} queue_depth={}", file_size, block_size, queue_depth);
             auto timer = Core::ElapsedTimer::start_new();
             while (timer.elapsed_time() < time_per_benchmark) {
                 out(".");
                 fflush(stdout);
-                auto result = TRY(benchmark(filename, file_size, buffer_result.value(), allow_cache));
+                auto result = TRY(benchmark(filename, file_size, block_size, buffer_result.value(), ring.ptr(), allow_cache));
                 results.append(result);
                 usleep(100);
             }
             auto average = average_result(results);
-            outln("Finished: runs={} time={}ms write_bps={} read_bps={}", results.size(), timer.elapsed(), average.write_bps, average.read_bps);
+            outln("Finished: runs={} time={}ms write_bps={} read_bps={} write_requests_per_mib={:.2} read_requests_per_mib={:.2}", results.size(), timer.elapsed(), average.write_bps, average.read_bps, requests_per_mib(average.write_requests, file_size), requests_per_mib(average.read_requests, file_size));
 
             sleep(1);
         }
@@ -103,7 +147,39 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
     return 0;
 }
 
-ErrorOr<Result> benchmark(DeprecatedString const& filename, int file_size, ByteBuffer& buffer, bool allow_cache)
+// Keeps the ring full by queueing a block for every slot in the buffer, and replacing each one as it completes.
+static ErrorOr<void> transfer_with_io_ring(Core::IORing& ring, int fd, bool is_write, size_t file_size, size_t block_size, Bytes buffer)
+{
+    size_t queue_depth = buffer.size() / block_size;
+    size_t next_offset = 0;
+    size_t in_flight = 0;
+
+    auto queue_next_block = [&](size_t slot) -> ErrorOr<void> {
+        auto slot_buffer = buffer.slice(slot * block_size, min(block_size, file_size - next_offset));
+        if (is_write)
+            TRY(ring.queue_write(fd, slot_buffer, next_offset, slot));
+        else
+            TRY(ring.queue_read(fd, slot_buffer, next_offset, slot));
+        next_offset += slot_buffer.size();
+        ++in_flight;
+        return {};
+    };
+
+    for (size_t slot = 0; slot < queue_depth && next_offset < file_size; ++slot)
+        TRY(queue_next_block(slot));
+
+    while (in_flight > 0) {
+        auto completion = TRY(ring.wait_for_completion());
+        --in_flight;
+        if (TRY(Core::IORing::result_of(completion)) == 0)
+            return Error::from_string_view("Unexpected end of file"sv);
+        if (next_offset < file_size)
+            TRY(queue_next_block(completion.user_data));
+    }
+    return {};
+}
+
+ErrorOr<Result> benchmark(DeprecatedString const& filename, int file_size, size_t block_size, ByteBuffer& buffer, Core::IORing* ring, bool allow_cache)
 {
     int flags = O_CREAT | O_TRUNC | O_RDWR;
     if (!allow_cache)
@@ -123,25 +199,42 @@ ErrorOr<Result> benchmark(DeprecatedString const& filename, int file_size, ByteB
 
     Result result;
 
+    auto counters_before_write = device_request_counters();
     auto timer = Core::ElapsedTimer::start_new();
 
-    ssize_t total_written = 0;
-    while (total_written < file_size) {
-        auto nwritten = TRY(Core::System::write(fd, buffer));
-        total_written += nwritten;
+    if (ring) {
+        TRY(transfer_with_io_ring(*ring, fd, true, file_size, block_size, buffer.bytes()));
+    } else {
+        ssize_t total_written = 0;
+        while (total_written < file_size) {
+            auto nwritten = TRY(Core::System::write(fd, buffer));
+            total_written += nwritten;
+        }
     }
 
     result.write_bps = (u64)(timer.elapsed() ? (file_size / timer.elapsed()) : file_size) * 1000;
 
+    auto counters_before_read = device_request_counters();
     TRY(Core::System::lseek(fd, 0, SEEK_SET));
 
     timer.start();
-    ssize_t total_read = 0;
-    while (total_read < file_size) {
-        auto nread = TRY(Core::System::read(fd, buffer));
-        total_read += nread;
+    if (ring) {
+        TRY(transfer_with_io_ring(*ring, fd, false, file_size, block_size, buffer.bytes()));
+    } else {
+        ssize_t total_read = 0;
+        while (total_read < file_size) {
+            auto nread = TRY(Core::System::read(fd, buffer));
+            total_read += nread;
+        }
     }
 
     result.read_bps = (u64)(timer.elapsed() ? (file_size / timer.elapsed()) : file_size) * 1000;
+
+    // NOTE: With the cache enabled, most writes only reach the device when the cache is flushed later on.
+    auto counters_after_read = device_request_counters();
+    if (counters_before_write.has_value() && counters_before_read.has_value() && counters_after_read.has_value()) {
+        result.write_requests = counters_before_read->write_requests - counters_before_write->write_requests;
+        result.read_requests = counters_after_read->read_requests - counters_before_read->read_requests;
+    }
     return result;
 }
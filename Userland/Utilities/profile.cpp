@@ -52,6 +52,10 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
                 event_mask |= PERF_EVENT_SYSCALL;
             else if (event_type == "read")
                 event_mask |= PERF_EVENT_READ;
+            else if (event_type == "lock_contention")
+                event_mask |= PERF_EVENT_LOCK_CONTENTION;
+            else if (event_type == "off_cpu")
+                event_mask |= PERF_EVENT_OFF_CPU;
             else {
                 warnln("Unknown event type '{}' specified.", event_type);
                 exit(1);
@@ -63,7 +67,7 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
 
     auto print_types = [] {
         outln();
-        outln("Event type can be one of: sample, context_switch, page_fault, syscall, read, kmalloc and kfree.");
+        outln("Event type can be one of: sample, context_switch, page_fault, syscall, read, lock_contention, off_cpu, kmalloc and kfree.");
     };
 
     if (!args_parser.parse(arguments, Core::ArgsParser::FailureBehavior::PrintUsage)) {
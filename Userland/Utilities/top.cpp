@@ -11,6 +11,7 @@
 #include <AK/QuickSort.h>
 #include <AK/Vector.h>
 #include <LibCore/ArgsParser.h>
+#include <LibCore/File.h>
 #include <LibCore/ProcessStatisticsReader.h>
 #include <LibCore/System.h>
 #include <LibMain/Main.h>
@@ -89,9 +90,26 @@ struct Snapshot {
     u64 total_time_scheduled_kernel { 0 };
 };
 
+// Kept open between snapshots, so that only the processes that changed have to be read again.
+static OwnPtr<Core::File> s_proc_all;
+static Core::AllProcessesStatistics s_all_processes;
+
+static ErrorOr<Core::AllProcessesStatistics const*> update_all_processes()
+{
+    if (!s_proc_all)
+        s_proc_all = TRY(Core::File::open("/sys/kernel/process_statistics"sv, Core::File::OpenMode::Read));
+    if (auto result = Core::ProcessStatisticsReader::update(*s_proc_all, s_all_processes); result.is_error()) {
+        // Start over with a complete snapshot next time.
+        s_proc_all = nullptr;
+        s_all_processes = {};
+        return result.release_error();
+    }
+    return &s_all_processes;
+}
+
 static ErrorOr<Snapshot> get_snapshot()
 {
-    auto all_processes = TRY(Core::ProcessStatisticsReader::get_all());
+    auto const& all_processes = *TRY(update_all_processes());
 
     Snapshot snapshot;
     for (auto& process : all_processes.processes) {
@@ -199,7 +217,7 @@ static void enable_nonblocking_stdin()
 ErrorOr<int> serenity_main(Main::Arguments arguments)
 {
     TRY(Core::System::pledge("stdio rpath tty sigaction"));
-    TRY(Core::System::unveil("/sys/kernel/processes", "r"));
+    TRY(Core::System::unveil("/sys/kernel/process_statistics", "r"));
     TRY(Core::System::unveil("/etc/passwd", "r"));
     unveil(nullptr, nullptr);
 